@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "common/json/GcWorkers.h"
+#include "common/json/JsGc.h"
+
+namespace {
+
+using fiber::json::GcHeap;
+using fiber::json::JsValue;
+
+template <typename Fn>
+double seconds(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// A config document held as a script global: objects of short strings
+// and numbers, nested a few levels.
+JsValue build_config(GcHeap &heap, std::size_t sections, std::size_t entries) {
+    JsValue root = JsValue::make_object(heap, sections);
+    auto *obj = reinterpret_cast<fiber::json::GcObject *>(root.gc);
+    for (std::size_t s = 0; s < sections; ++s) {
+        JsValue section = JsValue::make_array(heap, entries);
+        auto *arr = reinterpret_cast<fiber::json::GcArray *>(section.gc);
+        for (std::size_t e = 0; e < entries; ++e) {
+            JsValue entry = JsValue::make_object(heap, 2);
+            auto *fields = reinterpret_cast<fiber::json::GcObject *>(entry.gc);
+            std::string name = "route-" + std::to_string(s) + "-" + std::to_string(e);
+            fiber::json::gc_object_set(&heap, fields, fiber::json::gc_new_string(&heap, "name", 4),
+                                       JsValue::make_string(heap, name.data(), name.size()));
+            fiber::json::gc_object_set(&heap, fields, fiber::json::gc_new_string(&heap, "weight", 6),
+                                       JsValue::make_integer(static_cast<std::int64_t>(e)));
+            fiber::json::gc_array_push(&heap, arr, entry);
+        }
+        std::string key = "section-" + std::to_string(s);
+        fiber::json::gc_object_set(&heap, obj, fiber::json::gc_new_string(&heap, key.data(), key.size()), section);
+    }
+    return root;
+}
+
+void bench_pause(std::size_t helpers, int reps) {
+    GcHeap heap;
+    std::unique_ptr<fiber::json::GcWorkers> workers;
+    if (helpers > 0) {
+        workers = std::make_unique<fiber::json::GcWorkers>(helpers);
+        fiber::json::gc_set_workers(heap, workers.get(), 0);
+    }
+    JsValue root = build_config(heap, 64, 8192);
+    JsValue *roots[] = {&root};
+    double total = seconds([&]() {
+        for (int i = 0; i < reps; ++i) {
+            fiber::json::gc_collect(&heap, roots, 1);
+        }
+    });
+    std::printf("%zu helpers: %.1f MB live, %.2f ms per collection\n", helpers,
+                static_cast<double>(heap.bytes) / (1 << 20), total * 1000 / reps);
+}
+
+} // namespace
+
+int main() {
+    for (std::size_t helpers : {0, 1, 3, 7}) {
+        bench_pause(helpers, 10);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "common/json/JsonDecode.h"
+#include "common/json/JsGc.h"
+
+namespace {
+
+using fiber::json::GcHeap;
+using fiber::json::JsValue;
+using fiber::json::Parser;
+
+// An API-style list response: nested objects, short keys, mixed scalars,
+// a few escaped and non-ASCII strings.
+std::string make_payload(std::size_t target) {
+    std::string out = "{\"items\":[";
+    for (std::size_t i = 0; out.size() < target; ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        out += "{\"id\":" + std::to_string(100000 + i) + ",\"name\":\"user-" + std::to_string(i) +
+               "\",\"email\":\"user" + std::to_string(i) + "@example.com\",\"active\":" +
+               (i % 3 ? "true" : "false") + ",\"score\":" + std::to_string(i % 1000) + ".25" +
+               ",\"tags\":[\"alpha\",\"beta\",\"caf\xc3\xa9\"],\"bio\":\"line one\\nline \\\"two\\\"\"," +
+               "\"address\":{\"city\":\"Berlin\",\"zip\":\"10115\",\"geo\":[52.52,13.405]},\"manager\":null}";
+    }
+    out += "],\"total\":" + std::to_string(target) + "}";
+    return out;
+}
+
+double run(Parser::Backend backend, const std::string &payload, std::size_t iterations) {
+    GcHeap heap;
+    Parser parser(heap, backend);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        JsValue value;
+        if (!parser.parse(payload, value)) {
+            std::fprintf(stderr, "parse failed: %s\n", parser.error().message.c_str());
+            return 0;
+        }
+        fiber::json::gc_collect(&heap, nullptr, 0);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(payload.size() * iterations) / elapsed.count() / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+int main() {
+    struct Case {
+        const char *name;
+        std::size_t size;
+        std::size_t iterations;
+    };
+    const Case cases[] = {
+        {"1KB", 1024, 20000},
+        {"64KB", 64 * 1024, 400},
+        {"10MB", 10 * 1024 * 1024, 3},
+    };
+    std::printf("%-6s %12s %12s %8s\n", "size", "scalar MB/s", "indexed MB/s", "speedup");
+    for (const auto &c : cases) {
+        std::string payload = make_payload(c.size);
+        double scalar = run(Parser::Backend::Scalar, payload, c.iterations);
+        double indexed = run(Parser::Backend::Indexed, payload, c.iterations);
+        std::printf("%-6s %12.1f %12.1f %7.2fx\n", c.name, scalar, indexed, scalar > 0 ? indexed / scalar : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/json/JsValueEncode.h"
+#include "common/json/JsonDecode.h"
+#include "common/json/JsonEncode.h"
+#include "common/json/JsonNumber.h"
+#include "common/json/JsGc.h"
+
+namespace {
+
+using fiber::json::BufferGenerator;
+using fiber::json::BufferSink;
+using fiber::json::GcHeap;
+using fiber::json::Generator;
+using fiber::json::JsValue;
+using fiber::json::OutputSink;
+using fiber::json::Parser;
+
+class StringSink final : public OutputSink {
+public:
+    [[nodiscard]] bool write(const char *data, std::size_t len) override {
+        out.append(data, len);
+        return true;
+    }
+
+    void reset() override {
+        out.clear();
+    }
+
+    std::string out;
+};
+
+// A metrics push: series of timestamped float samples plus a few counters.
+std::string make_metrics(std::size_t samples) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> dist(0.0, 1000.0);
+    std::string out = "{\"series\":[";
+    for (std::size_t s = 0; s * 100 < samples; ++s) {
+        if (s > 0) {
+            out += ',';
+        }
+        out += "{\"name\":\"cpu." + std::to_string(s) + "\",\"points\":[";
+        for (std::size_t i = 0; i < 100; ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            char buf[64];
+            auto end = std::to_chars(buf, buf + sizeof(buf), dist(rng), std::chars_format::fixed, 3).ptr;
+            out += "[" + std::to_string(1700000000000 + i * 1000) + "," + std::string(buf, end) + "]";
+        }
+        out += "],\"count\":" + std::to_string(rng() % 100000) + "}";
+    }
+    out += "]}";
+    return out;
+}
+
+template <typename Fn>
+double seconds(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// What JsonDecode/JsonEncode did before JsonNumber: strtod on a temporary
+// string, and 17 significant digits on output.
+double legacy_parse(const std::string &text) {
+    std::string copy(text);
+    errno = 0;
+    return std::strtod(copy.c_str(), nullptr);
+}
+
+std::size_t legacy_format(char *buf, double value) {
+    return static_cast<std::size_t>(
+        std::to_chars(buf, buf + 64, value, std::chars_format::general, std::numeric_limits<double>::max_digits10).ptr -
+        buf);
+}
+
+void bench_conversions() {
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    std::vector<double> values(200000);
+    std::vector<std::string> texts(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = dist(rng);
+        char buf[64];
+        texts[i].assign(buf, legacy_format(buf, values[i]));
+    }
+    double sink = 0;
+    double legacy = seconds([&] {
+        for (const auto &text : texts) {
+            sink += legacy_parse(text);
+        }
+    });
+    double fast = seconds([&] {
+        for (const auto &text : texts) {
+            double value = 0;
+            (void)fiber::json::parse_json_double(text.data(), text.data() + text.size(), value);
+            sink += value;
+        }
+    });
+    std::printf("parse  %8.1f ns legacy %8.1f ns fast %6.2fx\n", legacy * 1e9 / texts.size(),
+                fast * 1e9 / texts.size(), legacy / fast);
+
+    std::size_t chars = 0;
+    char buf[64];
+    legacy = seconds([&] {
+        for (double value : values) {
+            chars += legacy_format(buf, value);
+        }
+    });
+    fast = seconds([&] {
+        for (double value : values) {
+            chars += static_cast<std::size_t>(fiber::json::write_double(buf, value) - buf);
+        }
+    });
+    std::printf("format %8.1f ns legacy %8.1f ns fast %6.2fx\n", legacy * 1e9 / values.size(),
+                fast * 1e9 / values.size(), legacy / fast);
+    if (sink == 0.5 && chars == 0) {
+        std::printf("\n");
+    }
+}
+
+void bench_document(std::size_t samples, std::size_t iterations) {
+    std::string payload = make_metrics(samples);
+    GcHeap heap;
+    Parser parser(heap);
+    JsValue root;
+    double decode = seconds([&] {
+        for (std::size_t i = 0; i < iterations; ++i) {
+            root = JsValue::make_undefined();
+            fiber::json::gc_collect(&heap, nullptr, 0);
+            if (!parser.parse(payload, root)) {
+                std::fprintf(stderr, "parse failed: %s\n", parser.error().message.c_str());
+                return;
+            }
+        }
+    });
+    StringSink sink;
+    sink.out.reserve(payload.size() * 2);
+    double encode = seconds([&] {
+        for (std::size_t i = 0; i < iterations; ++i) {
+            sink.reset();
+            Generator gen(sink);
+            (void)fiber::json::encode_js_value(gen, root);
+        }
+    });
+    BufferSink buffer;
+    double buffered = seconds([&] {
+        for (std::size_t i = 0; i < iterations; ++i) {
+            buffer.reset();
+            BufferGenerator gen(buffer);
+            (void)fiber::json::encode_js_value(gen, root);
+        }
+    });
+    double mb = static_cast<double>(payload.size() * iterations) / (1024.0 * 1024.0);
+    std::printf("%7zu floats: decode %8.1f MB/s, encode %8.1f MB/s, buffered %8.1f MB/s (%zu bytes in, %zu out)\n",
+                samples, mb / decode, mb / encode, mb / buffered, payload.size(), buffer.size());
+}
+
+} // namespace
+
+int main() {
+    bench_conversions();
+    bench_document(1000, 2000);
+    bench_document(100000, 20);
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common/json/JsGc.h"
+
+namespace {
+
+using fiber::json::GcHeap;
+using fiber::json::GcObject;
+using fiber::json::GcString;
+using fiber::json::JsValue;
+
+template <typename Fn>
+double seconds(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// What GcObject was before the control-byte table: chained buckets at 3/4
+// load over entries linked in insertion order, with a free list.
+class LegacyObject {
+public:
+    void set(GcString *key, JsValue value) {
+        std::uint64_t hash = fiber::json::gc_string_hash(key);
+        std::int32_t idx = find(key, hash);
+        if (idx != -1) {
+            entries_[idx].value = value;
+            return;
+        }
+        if ((size_ + 1) * 4 > buckets_.size() * 3) {
+            rehash(buckets_.empty() ? 8 : buckets_.size() * 2);
+        }
+        if (free_head_ != -1) {
+            idx = free_head_;
+            free_head_ = entries_[idx].next_free;
+        } else {
+            idx = static_cast<std::int32_t>(entries_.size());
+            entries_.emplace_back();
+        }
+        Entry &entry = entries_[idx];
+        entry = Entry{key, value, hash, -1, tail_, -1, -1, true};
+        std::size_t bucket = hash & (buckets_.size() - 1);
+        entry.next_bucket = buckets_[bucket];
+        buckets_[bucket] = idx;
+        if (tail_ != -1) {
+            entries_[tail_].next_order = idx;
+        } else {
+            head_ = idx;
+        }
+        tail_ = idx;
+        size_ += 1;
+    }
+
+    // Out of line, as gc_object_get was, so neither side is inlined into
+    // the timing loop.
+    __attribute__((noinline)) const JsValue *get(const GcString *key) const {
+        std::int32_t idx = find(key, fiber::json::gc_string_hash(key));
+        return idx == -1 ? nullptr : &entries_[idx].value;
+    }
+
+    template <typename Fn>
+    void for_each(Fn &&fn) const {
+        for (std::int32_t cursor = head_; cursor != -1; cursor = entries_[cursor].next_order) {
+            fn(entries_[cursor].value);
+        }
+    }
+
+private:
+    struct Entry {
+        GcString *key = nullptr;
+        JsValue value;
+        std::uint64_t hash = 0;
+        std::int32_t next_bucket = -1;
+        std::int32_t prev_order = -1;
+        std::int32_t next_order = -1;
+        std::int32_t next_free = -1;
+        bool occupied = false;
+    };
+
+    std::int32_t find(const GcString *key, std::uint64_t hash) const {
+        if (buckets_.empty()) {
+            return -1;
+        }
+        for (std::int32_t idx = buckets_[hash & (buckets_.size() - 1)]; idx != -1; idx = entries_[idx].next_bucket) {
+            const Entry &entry = entries_[idx];
+            if (entry.occupied && entry.hash == hash && fiber::json::gc_string_equals(entry.key, key)) {
+                return idx;
+            }
+        }
+        return -1;
+    }
+
+    void rehash(std::size_t bucket_count) {
+        buckets_.assign(bucket_count, -1);
+        for (std::size_t i = 0; i < entries_.size(); ++i) {
+            Entry &entry = entries_[i];
+            if (!entry.occupied) {
+                continue;
+            }
+            std::size_t bucket = entry.hash & (bucket_count - 1);
+            entry.next_bucket = buckets_[bucket];
+            buckets_[bucket] = static_cast<std::int32_t>(i);
+        }
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<std::int32_t> buckets_;
+    std::int32_t head_ = -1;
+    std::int32_t tail_ = -1;
+    std::int32_t free_head_ = -1;
+    std::size_t size_ = 0;
+};
+
+std::vector<GcString *> make_keys(GcHeap &heap, std::size_t count, const char *prefix) {
+    std::vector<GcString *> keys;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string text = prefix + std::to_string(i);
+        keys.push_back(fiber::json::gc_new_string(&heap, text.data(), text.size()));
+    }
+    return keys;
+}
+
+void report(const char *what, std::size_t keys, std::size_t ops, double legacy, double table) {
+    std::printf("%5zu keys %-7s %7.1f ns legacy %7.1f ns table %6.2fx\n", keys, what, legacy * 1e9 / ops,
+                table * 1e9 / ops, legacy / table);
+}
+
+// Lookups go through separate key cells with the same text, as script
+// member names do, so each hit compares the characters.
+void bench_object(std::size_t count, std::size_t ops) {
+    GcHeap heap;
+    std::vector<GcString *> keys = make_keys(heap, count, "field_");
+    std::vector<GcString *> probes = make_keys(heap, count, "field_");
+    for (GcString *probe : probes) {
+        (void)fiber::json::gc_string_hash(probe);
+    }
+    // Root the keys so the collections that reclaim built objects keep them.
+    std::vector<JsValue> key_values(2 * count);
+    std::vector<JsValue *> roots;
+    for (std::size_t i = 0; i < key_values.size(); ++i) {
+        GcString *key = i < count ? keys[i] : probes[i - count];
+        key_values[i].type_ = fiber::json::JsNodeType::HeapString;
+        key_values[i].gc = &key->hdr;
+        roots.push_back(&key_values[i]);
+    }
+    std::size_t rounds = ops / count;
+    std::int64_t sink = 0;
+
+    double legacy = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            LegacyObject built;
+            for (std::size_t i = 0; i < count; ++i) {
+                built.set(keys[i], JsValue::make_integer(static_cast<std::int64_t>(i)));
+            }
+            sink += static_cast<std::int64_t>(built.get(keys[0]) != nullptr);
+        }
+    });
+    double table = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            GcObject *built = fiber::json::gc_new_object(&heap, 0);
+            for (std::size_t i = 0; i < count; ++i) {
+                (void)fiber::json::gc_object_set(&heap, built, keys[i], JsValue::make_integer(static_cast<std::int64_t>(i)));
+            }
+            sink += static_cast<std::int64_t>(fiber::json::gc_object_get(built, keys[0]) != nullptr);
+            if (r % 64 == 63) {
+                fiber::json::gc_collect(&heap, roots.data(), roots.size());
+            }
+        }
+    });
+    report("insert", count, rounds * count, legacy, table);
+
+    LegacyObject legacy_obj;
+    for (std::size_t i = 0; i < count; ++i) {
+        legacy_obj.set(keys[i], JsValue::make_integer(static_cast<std::int64_t>(i)));
+    }
+    GcObject *obj = fiber::json::gc_new_object(&heap, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        (void)fiber::json::gc_object_set(&heap, obj, keys[i], JsValue::make_integer(static_cast<std::int64_t>(i)));
+    }
+
+    legacy = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (GcString *probe : probes) {
+                sink += legacy_obj.get(probe)->i;
+            }
+        }
+    });
+    table = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (GcString *probe : probes) {
+                sink += fiber::json::gc_object_get(obj, probe)->i;
+            }
+        }
+    });
+    report("lookup", count, rounds * count, legacy, table);
+
+    legacy = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            legacy_obj.for_each([&](const JsValue &value) { sink += value.i; });
+        }
+    });
+    table = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (std::size_t i = 0; i < obj->entry_count; ++i) {
+                if (obj->entries[i].key) {
+                    sink += obj->entries[i].value.i;
+                }
+            }
+        }
+    });
+    report("iterate", count, rounds * count, legacy, table);
+    if (sink == 0) {
+        std::printf("\n");
+    }
+}
+
+} // namespace
+
+int main() {
+    bench_object(4, 4000000);
+    bench_object(32, 4000000);
+    bench_object(1024, 4000000);
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/json/JsGc.h"
+#include "common/json/Utf.h"
+
+namespace {
+
+using fiber::json::GcHeap;
+using fiber::json::GcString;
+
+template <typename Fn>
+double seconds(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// What GcString hashing and mixed-encoding equality did before: FNV-1a a
+// code unit at a time, and a scalar compare loop.
+std::uint64_t legacy_hash(const GcString *str) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < str->len; ++i) {
+        hash ^= str->encoding == fiber::json::GcStringEncoding::Byte ? str->data8[i] : str->data16[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool legacy_equals(const GcString *bytes, const GcString *units) {
+    for (std::size_t i = 0; i < bytes->len; ++i) {
+        if (units->data16[i] != static_cast<char16_t>(bytes->data8[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The UTF-8 scan and UTF-16 transcoder before the ASCII block paths.
+bool legacy_write_utf16(const char *data, std::size_t len, char16_t *dst) {
+    std::size_t units = 0;
+    for (std::size_t pos = 0; pos < len;) {
+        std::uint32_t codepoint = 0;
+        if (!fiber::json::utf8_next_codepoint(data, len, pos, codepoint)) {
+            return false;
+        }
+        units += codepoint <= 0xFFFF ? 1 : 2;
+    }
+    if (units == 0) {
+        return true;
+    }
+    std::size_t pos = 0;
+    std::size_t out_pos = 0;
+    while (pos < len) {
+        std::uint32_t codepoint = 0;
+        if (!fiber::json::utf8_next_codepoint(data, len, pos, codepoint)) {
+            return false;
+        }
+        if (codepoint <= 0xFFFF) {
+            dst[out_pos++] = static_cast<char16_t>(codepoint);
+            continue;
+        }
+        std::uint32_t value = codepoint - 0x10000;
+        dst[out_pos++] = static_cast<char16_t>(0xD800 + (value >> 10));
+        dst[out_pos++] = static_cast<char16_t>(0xDC00 + (value & 0x3FF));
+    }
+    return true;
+}
+
+void report(const char *what, const char *input, std::size_t bytes, double legacy, double fast) {
+    std::printf("%-13s %-10s legacy %8.2f GB/s  new %8.2f GB/s  %6.2fx\n", what, input, bytes / legacy / 1e9,
+                bytes / fast / 1e9, legacy / fast);
+}
+
+void bench_input(const char *name, const std::vector<std::string> &texts, std::size_t rounds) {
+    GcHeap heap;
+    std::vector<GcString *> bytes;
+    std::vector<GcString *> units;
+    std::size_t total = 0;
+    for (const std::string &text : texts) {
+        bytes.push_back(fiber::json::gc_new_string(&heap, text.data(), text.size()));
+        std::u16string wide(text.begin(), text.end());
+        units.push_back(fiber::json::gc_new_string_utf16(&heap, wide.data(), wide.size()));
+        total += text.size();
+    }
+    total *= rounds;
+    std::uint64_t sink = 0;
+
+    // Both sides fill the per-string cache the way gc_string_hash does,
+    // dropping it first so every call hashes.
+    double legacy = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (GcString *str : bytes) {
+                str->hash_valid = false;
+                if (!str->hash_valid) {
+                    str->hash = legacy_hash(str);
+                    str->hash_valid = true;
+                }
+                sink += str->hash;
+            }
+        }
+    });
+    double fast = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (GcString *str : bytes) {
+                str->hash_valid = false;
+                sink += fiber::json::gc_string_hash(str);
+            }
+        }
+    });
+    report("hash", name, total, legacy, fast);
+
+    legacy = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (std::size_t i = 0; i < bytes.size(); ++i) {
+                sink += legacy_equals(bytes[i], units[i]);
+            }
+        }
+    });
+    fast = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (std::size_t i = 0; i < bytes.size(); ++i) {
+                sink += fiber::json::gc_string_equals(bytes[i], units[i]);
+            }
+        }
+    });
+    report("equals mixed", name, total, legacy, fast);
+
+    std::u16string out(texts.front().size() * 2 + 16, u'\0');
+    legacy = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (const std::string &text : texts) {
+                sink += legacy_write_utf16(text.data(), text.size(), out.data());
+            }
+        }
+    });
+    fast = seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (const std::string &text : texts) {
+                fiber::json::Utf8ScanResult scan;
+                sink += fiber::json::utf8_scan(text.data(), text.size(), scan) &&
+                        fiber::json::utf8_write_utf16(text.data(), text.size(), out.data(), scan.utf16_len);
+            }
+        }
+    });
+    report("utf8->utf16", name, total, legacy, fast);
+    if (sink == 0) {
+        std::printf("\n");
+    }
+}
+
+} // namespace
+
+// A log line or URL built up from pieces with +: what concatenation did
+// before (a fresh flat copy per step) against gc_string_extend.
+void bench_concat(std::size_t pieces, int reps) {
+    GcHeap heap;
+    gc_set_threshold(heap, std::size_t(1) << 30);
+    std::string piece(48, 'x');
+    std::size_t check = 0;
+    double legacy = seconds([&]() {
+        for (int rep = 0; rep < reps; ++rep) {
+            GcString *built = fiber::json::gc_new_string_bytes(&heap, nullptr, 0);
+            for (std::size_t i = 0; i < pieces; ++i) {
+                GcString *next = fiber::json::gc_new_string_bytes_uninit(&heap, built->len + piece.size());
+                std::memcpy(next->data8, built->data8, built->len);
+                std::memcpy(next->data8 + built->len, piece.data(), piece.size());
+                built = next;
+            }
+            check += built->len;
+            fiber::json::gc_collect(&heap, nullptr, 0);
+        }
+    });
+    double current = seconds([&]() {
+        for (int rep = 0; rep < reps; ++rep) {
+            GcString *built = nullptr;
+            for (std::size_t i = 0; i < pieces; ++i) {
+                std::size_t len = built ? built->len : 0;
+                built = fiber::json::gc_string_extend(&heap, built, piece.size(), fiber::json::GcStringEncoding::Byte);
+                std::memcpy(built->data8 + len, piece.data(), piece.size());
+            }
+            check += built->len;
+            fiber::json::gc_collect(&heap, nullptr, 0);
+        }
+    });
+    std::printf("concat %zu x 48B: legacy %.3fs, current %.3fs (%zu)\n", pieces, legacy, current, check);
+}
+
+int main() {
+    // Header names and short values: the object-key case.
+    std::vector<std::string> headers = {"host", "accept", "content-type", "content-length", "x-request-id",
+                                        "accept-encoding", "user-agent", "authorization", "cache-control",
+                                        "x-forwarded-for"};
+    bench_input("headers", headers, 400000);
+
+    std::string body;
+    while (body.size() < 8192) {
+        body += "{\"id\":12345,\"name\":\"fiber json payload\",\"tags\":[\"a\",\"b\"]},";
+    }
+    bench_input("8KB ascii", {body}, 20000);
+
+    bench_concat(8, 200000);
+    bench_concat(400, 2000);
+    return 0;
+}
@@ -0,0 +1,1292 @@
+#include "Regex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include "json/Utf.h"
+
+namespace fiber::common {
+
+namespace {
+
+constexpr char32_t kMaxCodepoint = 0x10FFFF;
+constexpr int kMaxRepeat = 1000;
+constexpr int kMaxDepth = 256;
+constexpr std::size_t kMaxProgram = 1u << 16;
+constexpr std::size_t kMaxDfaStates = 2048;
+// NFA instructions a DFA may visit while building states, summed over its
+// life; past that the thread matches the pattern with the NFA instead.
+constexpr std::size_t kMaxDfaWork = 1u << 20;
+// DFAs kept per thread; the cache starts over when it fills.
+constexpr std::size_t kDfaCacheSize = 16;
+constexpr std::size_t kRegexCacheSize = 128;
+constexpr std::uint32_t kBeginMarker = 0xFFFFFFFFu;
+
+using RangeList = std::vector<std::pair<char32_t, char32_t>>;
+using ByteSeq = std::vector<std::pair<std::uint8_t, std::uint8_t>>;
+
+struct Node {
+    enum class Kind : std::uint8_t {
+        Empty,
+        Class,
+        Concat,
+        Alternate,
+        Repeat,
+        Assert,
+    };
+
+    Kind kind = Kind::Empty;
+    RangeList ranges;
+    std::vector<std::unique_ptr<Node>> children;
+    int min = 0;
+    int max = 0;
+    bool greedy = true;
+    Regex::Op assert_op = Regex::Op::AssertBegin;
+};
+
+std::unique_ptr<Node> make_node(Node::Kind kind) {
+    auto node = std::make_unique<Node>();
+    node->kind = kind;
+    return node;
+}
+
+void normalize(RangeList &ranges) {
+    std::sort(ranges.begin(), ranges.end());
+    RangeList merged;
+    for (const auto &range : ranges) {
+        if (!merged.empty() && range.first <= merged.back().second + 1) {
+            merged.back().second = std::max(merged.back().second, range.second);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    ranges.swap(merged);
+}
+
+void negate(RangeList &ranges) {
+    normalize(ranges);
+    RangeList out;
+    char32_t next = 0;
+    for (const auto &range : ranges) {
+        if (range.first > next) {
+            out.emplace_back(next, range.first - 1);
+        }
+        next = range.second + 1;
+    }
+    if (next <= kMaxCodepoint) {
+        out.emplace_back(next, kMaxCodepoint);
+    }
+    ranges.swap(out);
+}
+
+void add_digit(RangeList &ranges) {
+    ranges.emplace_back('0', '9');
+}
+
+void add_word(RangeList &ranges) {
+    ranges.emplace_back('0', '9');
+    ranges.emplace_back('A', 'Z');
+    ranges.emplace_back('_', '_');
+    ranges.emplace_back('a', 'z');
+}
+
+void add_space(RangeList &ranges) {
+    ranges.emplace_back(0x09, 0x0D);
+    ranges.emplace_back(0x20, 0x20);
+    ranges.emplace_back(0xA0, 0xA0);
+    ranges.emplace_back(0x1680, 0x1680);
+    ranges.emplace_back(0x2000, 0x200A);
+    ranges.emplace_back(0x2028, 0x2029);
+    ranges.emplace_back(0x202F, 0x202F);
+    ranges.emplace_back(0x205F, 0x205F);
+    ranges.emplace_back(0x3000, 0x3000);
+    ranges.emplace_back(0xFEFF, 0xFEFF);
+}
+
+// \d \w \s and their negations; returns false for any other escape letter.
+bool add_class_escape(char c, RangeList &ranges) {
+    RangeList set;
+    switch (c) {
+        case 'd':
+        case 'D':
+            add_digit(set);
+            break;
+        case 'w':
+        case 'W':
+            add_word(set);
+            break;
+        case 's':
+        case 'S':
+            add_space(set);
+            break;
+        default:
+            return false;
+    }
+    if (c == 'D' || c == 'W' || c == 'S') {
+        negate(set);
+    }
+    ranges.insert(ranges.end(), set.begin(), set.end());
+    return true;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+class PatternParser {
+public:
+    explicit PatternParser(std::string_view pattern) : pattern_(pattern) {
+    }
+
+    std::expected<std::unique_ptr<Node>, RegexError> parse() {
+        auto node = parse_alternate();
+        if (node && pos_ < pattern_.size()) {
+            fail("unmatched ')'");
+            node.reset();
+        }
+        if (!node) {
+            return std::unexpected(error_.value_or(RegexError{"invalid pattern", pos_}));
+        }
+        return node;
+    }
+
+private:
+    std::string_view pattern_;
+    std::size_t pos_ = 0;
+    int depth_ = 0;
+    std::optional<RegexError> error_;
+
+    void fail(const char *message) {
+        if (!error_) {
+            error_ = RegexError{message, pos_};
+        }
+    }
+
+    bool eof() const {
+        return pos_ >= pattern_.size();
+    }
+
+    char peek() const {
+        return pattern_[pos_];
+    }
+
+    std::unique_ptr<Node> parse_alternate() {
+        auto first = parse_sequence();
+        if (!first || eof() || peek() != '|') {
+            return first;
+        }
+        auto alt = make_node(Node::Kind::Alternate);
+        alt->children.push_back(std::move(first));
+        while (!eof() && peek() == '|') {
+            ++pos_;
+            auto next = parse_sequence();
+            if (!next) {
+                return nullptr;
+            }
+            alt->children.push_back(std::move(next));
+        }
+        return alt;
+    }
+
+    std::unique_ptr<Node> parse_sequence() {
+        auto seq = make_node(Node::Kind::Concat);
+        while (!eof() && peek() != '|' && peek() != ')') {
+            auto atom = parse_atom();
+            if (!atom) {
+                return nullptr;
+            }
+            atom = parse_quantifier(std::move(atom));
+            if (!atom) {
+                return nullptr;
+            }
+            seq->children.push_back(std::move(atom));
+        }
+        return seq;
+    }
+
+    bool parse_int(int &out) {
+        std::size_t start = pos_;
+        long value = 0;
+        while (!eof() && peek() >= '0' && peek() <= '9') {
+            value = value * 10 + (peek() - '0');
+            if (value > kMaxRepeat) {
+                value = kMaxRepeat + 1;
+            }
+            ++pos_;
+        }
+        out = static_cast<int>(value);
+        return pos_ > start;
+    }
+
+    // {n}, {n,} or {n,m}. Leaves pos_ untouched when the brace is not a
+    // quantifier so that it is read back as a literal.
+    bool parse_braces(int &min, int &max) {
+        std::size_t saved = pos_;
+        ++pos_;
+        if (!parse_int(min)) {
+            pos_ = saved;
+            return false;
+        }
+        max = min;
+        if (!eof() && peek() == ',') {
+            ++pos_;
+            if (!parse_int(max)) {
+                max = -1;
+            }
+        }
+        if (eof() || peek() != '}') {
+            pos_ = saved;
+            return false;
+        }
+        ++pos_;
+        return true;
+    }
+
+    std::unique_ptr<Node> parse_quantifier(std::unique_ptr<Node> atom) {
+        if (eof()) {
+            return atom;
+        }
+        int min = 0;
+        int max = 0;
+        switch (peek()) {
+            case '*':
+                min = 0;
+                max = -1;
+                ++pos_;
+                break;
+            case '+':
+                min = 1;
+                max = -1;
+                ++pos_;
+                break;
+            case '?':
+                min = 0;
+                max = 1;
+                ++pos_;
+                break;
+            case '{':
+                if (!parse_braces(min, max)) {
+                    return atom;
+                }
+                if (min > kMaxRepeat || max > kMaxRepeat) {
+                    fail("repeat count too large");
+                    return nullptr;
+                }
+                if (max >= 0 && max < min) {
+                    fail("invalid repeat range");
+                    return nullptr;
+                }
+                break;
+            default:
+                return atom;
+        }
+        bool greedy = true;
+        if (!eof() && peek() == '?') {
+            greedy = false;
+            ++pos_;
+        }
+        if (!eof() && (peek() == '*' || peek() == '+' || peek() == '?')) {
+            fail("nothing to repeat");
+            return nullptr;
+        }
+        auto rep = make_node(Node::Kind::Repeat);
+        rep->min = min;
+        rep->max = max;
+        rep->greedy = greedy;
+        rep->children.push_back(std::move(atom));
+        return rep;
+    }
+
+    std::unique_ptr<Node> make_class(RangeList ranges, bool negated) {
+        if (negated) {
+            negate(ranges);
+        } else {
+            normalize(ranges);
+        }
+        auto node = make_node(Node::Kind::Class);
+        node->ranges = std::move(ranges);
+        return node;
+    }
+
+    std::unique_ptr<Node> make_assert(Regex::Op op) {
+        auto node = make_node(Node::Kind::Assert);
+        node->assert_op = op;
+        return node;
+    }
+
+    bool read_codepoint(char32_t &out) {
+        std::uint32_t cp = 0;
+        if (!fiber::json::utf8_next_codepoint(pattern_.data(), pattern_.size(), pos_, cp)) {
+            fail("invalid utf-8 in pattern");
+            return false;
+        }
+        out = cp;
+        return true;
+    }
+
+    bool read_hex(std::size_t digits, char32_t &out) {
+        char32_t value = 0;
+        for (std::size_t i = 0; i < digits; ++i) {
+            int v = eof() ? -1 : hex_value(peek());
+            if (v < 0) {
+                fail("invalid hex escape");
+                return false;
+            }
+            value = value * 16 + static_cast<char32_t>(v);
+            ++pos_;
+        }
+        out = value;
+        return true;
+    }
+
+    // pos_ is on the character following the backslash.
+    bool parse_escape_char(char32_t &out) {
+        char c = peek();
+        switch (c) {
+            case 't':
+                ++pos_;
+                out = '\t';
+                return true;
+            case 'n':
+                ++pos_;
+                out = '\n';
+                return true;
+            case 'r':
+                ++pos_;
+                out = '\r';
+                return true;
+            case 'f':
+                ++pos_;
+                out = '\f';
+                return true;
+            case 'v':
+                ++pos_;
+                out = '\v';
+                return true;
+            case '0':
+                ++pos_;
+                if (!eof() && peek() >= '0' && peek() <= '9') {
+                    fail("octal escapes are not supported");
+                    return false;
+                }
+                out = 0;
+                return true;
+            case 'x':
+                ++pos_;
+                return read_hex(2, out);
+            case 'u':
+                ++pos_;
+                if (!eof() && peek() == '{') {
+                    ++pos_;
+                    char32_t value = 0;
+                    std::size_t digits = 0;
+                    while (!eof() && peek() != '}') {
+                        int v = hex_value(peek());
+                        if (v < 0 || ++digits > 6) {
+                            fail("invalid unicode escape");
+                            return false;
+                        }
+                        value = value * 16 + static_cast<char32_t>(v);
+                        ++pos_;
+                    }
+                    if (eof() || digits == 0 || value > kMaxCodepoint) {
+                        fail("invalid unicode escape");
+                        return false;
+                    }
+                    ++pos_;
+                    out = value;
+                    return true;
+                }
+                return read_hex(4, out);
+            case 'c':
+                if (pos_ + 1 < pattern_.size()) {
+                    char letter = pattern_[pos_ + 1];
+                    if ((letter >= 'a' && letter <= 'z') || (letter >= 'A' && letter <= 'Z')) {
+                        pos_ += 2;
+                        out = static_cast<char32_t>(letter % 32);
+                        return true;
+                    }
+                }
+                fail("invalid control escape");
+                return false;
+            default:
+                if (c >= '1' && c <= '9') {
+                    fail("backreferences are not supported");
+                    return false;
+                }
+                return read_codepoint(out);
+        }
+    }
+
+    std::unique_ptr<Node> parse_atom() {
+        switch (peek()) {
+            case '(':
+                return parse_group();
+            case '[':
+                return parse_class();
+            case '.': {
+                ++pos_;
+                RangeList ranges{{'\n', '\n'}, {'\r', '\r'}, {0x2028, 0x2029}};
+                return make_class(std::move(ranges), true);
+            }
+            case '^':
+                ++pos_;
+                return make_assert(Regex::Op::AssertBegin);
+            case '$':
+                ++pos_;
+                return make_assert(Regex::Op::AssertEnd);
+            case '\\':
+                return parse_escape();
+            case '*':
+            case '+':
+            case '?':
+                fail("nothing to repeat");
+                return nullptr;
+            default: {
+                char32_t cp = 0;
+                if (!read_codepoint(cp)) {
+                    return nullptr;
+                }
+                return make_class(RangeList{{cp, cp}}, false);
+            }
+        }
+    }
+
+    std::unique_ptr<Node> parse_group() {
+        ++pos_;
+        if (!eof() && peek() == '?') {
+            ++pos_;
+            if (!eof() && peek() == ':') {
+                ++pos_;
+            } else if (!eof() && peek() == '<' && pos_ + 1 < pattern_.size() &&
+                       pattern_[pos_ + 1] != '=' && pattern_[pos_ + 1] != '!') {
+                std::size_t close = pattern_.find('>', pos_);
+                if (close == std::string_view::npos) {
+                    fail("invalid group name");
+                    return nullptr;
+                }
+                pos_ = close + 1;
+            } else {
+                fail("lookaround is not supported");
+                return nullptr;
+            }
+        }
+        if (++depth_ > kMaxDepth) {
+            fail("pattern nested too deeply");
+            return nullptr;
+        }
+        auto inner = parse_alternate();
+        --depth_;
+        if (!inner) {
+            return nullptr;
+        }
+        if (eof() || peek() != ')') {
+            fail("missing ')'");
+            return nullptr;
+        }
+        ++pos_;
+        return inner;
+    }
+
+    std::unique_ptr<Node> parse_escape() {
+        ++pos_;
+        if (eof()) {
+            fail("trailing backslash");
+            return nullptr;
+        }
+        char c = peek();
+        if (c == 'b' || c == 'B') {
+            ++pos_;
+            return make_assert(c == 'b' ? Regex::Op::AssertWord : Regex::Op::AssertNotWord);
+        }
+        RangeList ranges;
+        if (add_class_escape(c, ranges)) {
+            ++pos_;
+            return make_class(std::move(ranges), false);
+        }
+        char32_t cp = 0;
+        if (!parse_escape_char(cp)) {
+            return nullptr;
+        }
+        return make_class(RangeList{{cp, cp}}, false);
+    }
+
+    // One class member: a code point, or a \d-style set (is_set = true).
+    bool parse_class_atom(char32_t &cp, RangeList &ranges, bool &is_set) {
+        is_set = false;
+        if (peek() != '\\') {
+            return read_codepoint(cp);
+        }
+        ++pos_;
+        if (eof()) {
+            fail("trailing backslash");
+            return false;
+        }
+        char c = peek();
+        if (add_class_escape(c, ranges)) {
+            ++pos_;
+            is_set = true;
+            return true;
+        }
+        if (c == 'b') {
+            ++pos_;
+            cp = '\b';
+            return true;
+        }
+        if (c == '-') {
+            ++pos_;
+            cp = '-';
+            return true;
+        }
+        return parse_escape_char(cp);
+    }
+
+    std::unique_ptr<Node> parse_class() {
+        ++pos_;
+        bool negated = false;
+        if (!eof() && peek() == '^') {
+            negated = true;
+            ++pos_;
+        }
+        RangeList ranges;
+        while (true) {
+            if (eof()) {
+                fail("missing ']'");
+                return nullptr;
+            }
+            if (peek() == ']') {
+                ++pos_;
+                break;
+            }
+            char32_t lo = 0;
+            bool is_set = false;
+            if (!parse_class_atom(lo, ranges, is_set)) {
+                return nullptr;
+            }
+            if (is_set) {
+                continue;
+            }
+            if (pos_ + 1 < pattern_.size() && peek() == '-' && pattern_[pos_ + 1] != ']') {
+                ++pos_;
+                char32_t hi = 0;
+                bool hi_set = false;
+                if (!parse_class_atom(hi, ranges, hi_set)) {
+                    return nullptr;
+                }
+                if (hi_set || hi < lo) {
+                    fail("invalid class range");
+                    return nullptr;
+                }
+                ranges.emplace_back(lo, hi);
+            } else {
+                ranges.emplace_back(lo, lo);
+            }
+        }
+        return make_class(std::move(ranges), negated);
+    }
+};
+
+std::size_t encode_utf8(char32_t cp, std::uint8_t *out) {
+    if (cp <= 0x7F) {
+        out[0] = static_cast<std::uint8_t>(cp);
+        return 1;
+    }
+    if (cp <= 0x7FF) {
+        out[0] = static_cast<std::uint8_t>(0xC0 | (cp >> 6));
+        out[1] = static_cast<std::uint8_t>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp <= 0xFFFF) {
+        out[0] = static_cast<std::uint8_t>(0xE0 | (cp >> 12));
+        out[1] = static_cast<std::uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = static_cast<std::uint8_t>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<std::uint8_t>(0xF0 | (cp >> 18));
+    out[1] = static_cast<std::uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = static_cast<std::uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = static_cast<std::uint8_t>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Splits a code point range into byte-range sequences, each of which is a
+// fixed-length UTF-8 encoding whose positions vary independently.
+void utf8_sequences(char32_t lo, char32_t hi, std::vector<ByteSeq> &out) {
+    static constexpr char32_t kLengthMax[] = {0x7F, 0x7FF, 0xFFFF};
+    for (char32_t limit : kLengthMax) {
+        if (lo <= limit && hi > limit) {
+            utf8_sequences(lo, limit, out);
+            utf8_sequences(limit + 1, hi, out);
+            return;
+        }
+    }
+    if (hi <= 0x7F) {
+        out.push_back(ByteSeq{{static_cast<std::uint8_t>(lo), static_cast<std::uint8_t>(hi)}});
+        return;
+    }
+    for (int i = 1; i < 4; ++i) {
+        char32_t mask = (char32_t{1} << (6 * i)) - 1;
+        if ((lo & ~mask) != (hi & ~mask)) {
+            if ((lo & mask) != 0) {
+                utf8_sequences(lo, lo | mask, out);
+                utf8_sequences((lo | mask) + 1, hi, out);
+                return;
+            }
+            if ((hi & mask) != mask) {
+                utf8_sequences(lo, (hi & ~mask) - 1, out);
+                utf8_sequences(hi & ~mask, hi, out);
+                return;
+            }
+        }
+    }
+    std::uint8_t a[4];
+    std::uint8_t b[4];
+    std::size_t n = encode_utf8(lo, a);
+    encode_utf8(hi, b);
+    ByteSeq seq;
+    for (std::size_t i = 0; i < n; ++i) {
+        seq.emplace_back(a[i], b[i]);
+    }
+    out.push_back(std::move(seq));
+}
+
+class ProgramBuilder {
+public:
+    explicit ProgramBuilder(std::vector<Regex::Inst> &prog) : prog_(prog) {
+    }
+
+    bool too_large() const {
+        return too_large_;
+    }
+
+    std::uint32_t pc() const {
+        return static_cast<std::uint32_t>(prog_.size());
+    }
+
+    std::uint32_t emit(Regex::Op op, std::uint8_t lo = 0, std::uint8_t hi = 0) {
+        if (prog_.size() >= kMaxProgram) {
+            too_large_ = true;
+        }
+        Regex::Inst inst;
+        inst.op = op;
+        inst.lo = lo;
+        inst.hi = hi;
+        prog_.push_back(inst);
+        return static_cast<std::uint32_t>(prog_.size() - 1);
+    }
+
+    void emit_node(const Node &node) {
+        if (too_large_) {
+            return;
+        }
+        switch (node.kind) {
+            case Node::Kind::Empty:
+                break;
+            case Node::Kind::Class:
+                emit_class(node.ranges);
+                break;
+            case Node::Kind::Concat:
+                for (const auto &child : node.children) {
+                    emit_node(*child);
+                }
+                break;
+            case Node::Kind::Alternate:
+                emit_alternatives(node.children.size(), [&](std::size_t i) {
+                    emit_node(*node.children[i]);
+                });
+                break;
+            case Node::Kind::Repeat:
+                emit_repeat(node);
+                break;
+            case Node::Kind::Assert:
+                emit(node.assert_op);
+                break;
+        }
+    }
+
+private:
+    std::vector<Regex::Inst> &prog_;
+    bool too_large_ = false;
+
+    template <typename F>
+    void emit_alternatives(std::size_t count, F &&emit_one) {
+        std::vector<std::uint32_t> jumps;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (too_large_) {
+                return;
+            }
+            if (i + 1 == count) {
+                emit_one(i);
+                break;
+            }
+            std::uint32_t split = emit(Regex::Op::Split);
+            prog_[split].x = split + 1;
+            emit_one(i);
+            jumps.push_back(emit(Regex::Op::Jmp));
+            prog_[split].y = pc();
+        }
+        for (std::uint32_t jump : jumps) {
+            prog_[jump].x = pc();
+        }
+    }
+
+    void emit_class(const RangeList &ranges) {
+        std::vector<ByteSeq> seqs;
+        for (const auto &range : ranges) {
+            utf8_sequences(range.first, range.second, seqs);
+        }
+        if (seqs.empty()) {
+            // Empty class: a range that no byte satisfies.
+            emit(Regex::Op::Range, 1, 0);
+            return;
+        }
+        emit_alternatives(seqs.size(), [&](std::size_t i) {
+            for (const auto &bytes : seqs[i]) {
+                emit(Regex::Op::Range, bytes.first, bytes.second);
+            }
+        });
+    }
+
+    void set_branch(std::uint32_t split, std::uint32_t body, std::uint32_t exit, bool greedy) {
+        prog_[split].x = greedy ? body : exit;
+        prog_[split].y = greedy ? exit : body;
+    }
+
+    void emit_repeat(const Node &node) {
+        const Node &child = *node.children.front();
+        for (int i = 0; i < node.min && !too_large_; ++i) {
+            emit_node(child);
+        }
+        if (node.max < 0) {
+            std::uint32_t loop = emit(Regex::Op::Split);
+            emit_node(child);
+            std::uint32_t jump = emit(Regex::Op::Jmp);
+            prog_[jump].x = loop;
+            set_branch(loop, loop + 1, pc(), node.greedy);
+            return;
+        }
+        std::vector<std::uint32_t> splits;
+        for (int i = node.min; i < node.max && !too_large_; ++i) {
+            splits.push_back(emit(Regex::Op::Split));
+            emit_node(child);
+        }
+        for (std::uint32_t split : splits) {
+            set_branch(split, split + 1, pc(), node.greedy);
+        }
+    }
+};
+
+bool is_word_byte(std::uint8_t c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+bool assert_holds(Regex::Op op, std::string_view text, std::size_t pos) {
+    switch (op) {
+        case Regex::Op::AssertBegin:
+            return pos == 0;
+        case Regex::Op::AssertEnd:
+            return pos == text.size();
+        case Regex::Op::AssertWord:
+        case Regex::Op::AssertNotWord: {
+            bool before = pos > 0 && is_word_byte(static_cast<std::uint8_t>(text[pos - 1]));
+            bool after = pos < text.size() && is_word_byte(static_cast<std::uint8_t>(text[pos]));
+            return (before != after) == (op == Regex::Op::AssertWord);
+        }
+        default:
+            return false;
+    }
+}
+
+class ThreadList {
+public:
+    explicit ThreadList(std::size_t size) : sparse_(size) {
+        pcs_.reserve(size);
+        starts_.reserve(size);
+    }
+
+    bool contains(std::uint32_t pc) const {
+        std::uint32_t index = sparse_[pc];
+        return index < pcs_.size() && pcs_[index] == pc;
+    }
+
+    void insert(std::uint32_t pc, std::size_t start) {
+        sparse_[pc] = static_cast<std::uint32_t>(pcs_.size());
+        pcs_.push_back(pc);
+        starts_.push_back(start);
+    }
+
+    void clear() {
+        pcs_.clear();
+        starts_.clear();
+    }
+
+    bool empty() const {
+        return pcs_.empty();
+    }
+
+    std::size_t size() const {
+        return pcs_.size();
+    }
+
+    std::uint32_t pc(std::size_t i) const {
+        return pcs_[i];
+    }
+
+    std::size_t start(std::size_t i) const {
+        return starts_[i];
+    }
+
+private:
+    std::vector<std::uint32_t> sparse_;
+    std::vector<std::uint32_t> pcs_;
+    std::vector<std::size_t> starts_;
+};
+
+// Follows empty transitions from pc in priority order.
+void add_thread(const std::vector<Regex::Inst> &prog,
+                ThreadList &list,
+                std::vector<std::uint32_t> &stack,
+                std::uint32_t pc,
+                std::size_t start,
+                std::string_view text,
+                std::size_t pos) {
+    stack.push_back(pc);
+    while (!stack.empty()) {
+        std::uint32_t cur = stack.back();
+        stack.pop_back();
+        if (list.contains(cur)) {
+            continue;
+        }
+        list.insert(cur, start);
+        const Regex::Inst &inst = prog[cur];
+        switch (inst.op) {
+            case Regex::Op::Jmp:
+                stack.push_back(inst.x);
+                break;
+            case Regex::Op::Split:
+                stack.push_back(inst.y);
+                stack.push_back(inst.x);
+                break;
+            case Regex::Op::AssertBegin:
+            case Regex::Op::AssertEnd:
+            case Regex::Op::AssertWord:
+            case Regex::Op::AssertNotWord:
+                if (assert_holds(inst.op, text, pos)) {
+                    stack.push_back(cur + 1);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+} // namespace
+
+std::expected<Regex, RegexError> Regex::compile(std::string_view pattern) {
+    PatternParser parser(pattern);
+    auto root = parser.parse();
+    if (!root) {
+        return std::unexpected(root.error());
+    }
+    Regex re;
+    re.pattern_.assign(pattern.data(), pattern.size());
+    ProgramBuilder builder(re.prog_);
+    builder.emit_node(**root);
+    builder.emit(Op::Match);
+
+    // Unanchored entry: prefer starting here, otherwise skip one byte.
+    re.search_start_ = builder.pc();
+    std::uint32_t split = builder.emit(Op::Split);
+    builder.emit(Op::Range, 0x00, 0xFF);
+    std::uint32_t jump = builder.emit(Op::Jmp);
+    re.prog_[split].x = re.start_;
+    re.prog_[split].y = split + 1;
+    re.prog_[jump].x = split;
+    if (builder.too_large()) {
+        return std::unexpected(RegexError{"pattern too large", 0});
+    }
+
+    for (const auto &inst : re.prog_) {
+        if (inst.op == Op::AssertWord || inst.op == Op::AssertNotWord) {
+            re.has_word_assert_ = true;
+        }
+    }
+    for (std::uint32_t pc = re.start_; re.prog_[pc].op == Op::Range && re.prog_[pc].lo == re.prog_[pc].hi; ++pc) {
+        re.prefix_.push_back(static_cast<char>(re.prog_[pc].lo));
+    }
+    re.build_byte_classes();
+    static std::atomic<std::uint64_t> next_id{1};
+    re.id_ = next_id.fetch_add(1, std::memory_order_relaxed);
+    return re;
+}
+
+void Regex::build_byte_classes() {
+    bool boundary[257] = {};
+    for (const auto &inst : prog_) {
+        if (inst.op == Op::Range && inst.lo <= inst.hi) {
+            boundary[inst.lo] = true;
+            boundary[inst.hi + 1] = true;
+        }
+    }
+    std::uint32_t cls = 0;
+    for (int b = 0; b < 256; ++b) {
+        if (b > 0 && boundary[b]) {
+            ++cls;
+        }
+        byte_class_[b] = static_cast<std::uint8_t>(cls);
+    }
+    class_count_ = cls + 1;
+}
+
+// A DFA from one entry pc, grown a state at a time as matching reaches
+// transitions not taken before. States are sets of NFA pcs that consume input
+// or finish (Range, Match, AssertEnd); a trailing kBeginMarker flags "still
+// at offset 0".
+struct Regex::Dfa {
+    static constexpr std::uint8_t kMatch = 1;
+    static constexpr std::uint8_t kMatchAtEnd = 2;
+    static constexpr std::int32_t kDead = -1;
+    static constexpr std::int32_t kUnknown = -2;
+    static constexpr std::int32_t kFailed = -3;
+
+    // class_count entries per state: a state id, kDead, or kUnknown.
+    std::vector<std::int32_t> next;
+    std::vector<std::uint8_t> flags;
+    std::map<std::vector<std::uint32_t>, std::int32_t> ids;
+    // The key of each state in ids.
+    std::vector<const std::vector<std::uint32_t> *> states;
+    std::int32_t start = kDead;
+    std::int32_t idle = kDead;
+    bool failed = false;
+    std::size_t work = 0;
+    // seen[pc] == mark for pcs visited by the current walk.
+    std::vector<std::uint32_t> seen;
+    std::uint32_t mark = 0;
+    std::vector<std::uint32_t> stack;
+    std::vector<std::uint32_t> seeds;
+
+    bool init(const Regex &re, std::uint32_t entry) {
+        seen.assign(re.prog_.size(), 0);
+        start = intern(re, closure(re, {entry}, true));
+        if (start >= 0 && !re.prefix_.empty()) {
+            idle = intern(re, closure(re, {entry}, false));
+        }
+        if (start < 0 || idle == kFailed) {
+            fail();
+            return false;
+        }
+        return true;
+    }
+
+    std::int32_t step(const Regex &re, std::int32_t state, std::uint8_t byte) {
+        std::int32_t target = next[static_cast<std::size_t>(state) * re.class_count_ + re.byte_class_[byte]];
+        return target != kUnknown ? target : transition(re, state, byte);
+    }
+
+    std::int32_t transition(const Regex &re, std::int32_t state, std::uint8_t byte) {
+        if (work > kMaxDfaWork) {
+            fail();
+            return kFailed;
+        }
+        seeds.clear();
+        for (std::uint32_t pc : *states[static_cast<std::size_t>(state)]) {
+            if (pc == kBeginMarker) {
+                continue;
+            }
+            const Inst &inst = re.prog_[pc];
+            if (inst.op == Op::Range && inst.lo <= byte && byte <= inst.hi) {
+                seeds.push_back(pc + 1);
+            }
+        }
+        std::int32_t target = seeds.empty() ? kDead : intern(re, closure(re, seeds, false));
+        if (target == kFailed) {
+            fail();
+            return kFailed;
+        }
+        next[static_cast<std::size_t>(state) * re.class_count_ + re.byte_class_[byte]] = target;
+        return target;
+    }
+
+    std::vector<std::uint32_t> closure(const Regex &re, const std::vector<std::uint32_t> &from, bool at_begin) {
+        ++mark;
+        std::vector<std::uint32_t> set;
+        stack.assign(from.begin(), from.end());
+        while (!stack.empty()) {
+            std::uint32_t pc = stack.back();
+            stack.pop_back();
+            if (seen[pc] == mark) {
+                continue;
+            }
+            seen[pc] = mark;
+            ++work;
+            const Inst &inst = re.prog_[pc];
+            switch (inst.op) {
+                case Op::Jmp:
+                    stack.push_back(inst.x);
+                    break;
+                case Op::Split:
+                    stack.push_back(inst.x);
+                    stack.push_back(inst.y);
+                    break;
+                case Op::AssertBegin:
+                    if (at_begin) {
+                        stack.push_back(pc + 1);
+                    }
+                    break;
+                default:
+                    set.push_back(pc);
+                    break;
+            }
+        }
+        std::sort(set.begin(), set.end());
+        if (at_begin && !set.empty()) {
+            set.push_back(kBeginMarker);
+        }
+        return set;
+    }
+
+    bool match_at_end(const Regex &re, const std::vector<std::uint32_t> &set) {
+        bool at_begin = !set.empty() && set.back() == kBeginMarker;
+        ++mark;
+        stack.clear();
+        for (std::uint32_t pc : set) {
+            if (pc != kBeginMarker) {
+                stack.push_back(pc);
+            }
+        }
+        while (!stack.empty()) {
+            std::uint32_t pc = stack.back();
+            stack.pop_back();
+            if (seen[pc] == mark) {
+                continue;
+            }
+            seen[pc] = mark;
+            ++work;
+            const Inst &inst = re.prog_[pc];
+            switch (inst.op) {
+                case Op::Match:
+                    return true;
+                case Op::Jmp:
+                    stack.push_back(inst.x);
+                    break;
+                case Op::Split:
+                    stack.push_back(inst.x);
+                    stack.push_back(inst.y);
+                    break;
+                case Op::AssertBegin:
+                    if (at_begin) {
+                        stack.push_back(pc + 1);
+                    }
+                    break;
+                case Op::AssertEnd:
+                    stack.push_back(pc + 1);
+                    break;
+                default:
+                    break;
+            }
+        }
+        return false;
+    }
+
+    std::int32_t intern(const Regex &re, std::vector<std::uint32_t> set) {
+        if (set.empty()) {
+            return kDead;
+        }
+        auto it = ids.find(set);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        if (states.size() >= kMaxDfaStates) {
+            return kFailed;
+        }
+        std::uint8_t state_flags = 0;
+        for (std::uint32_t pc : set) {
+            if (pc != kBeginMarker && re.prog_[pc].op == Op::Match) {
+                state_flags |= kMatch | kMatchAtEnd;
+            }
+        }
+        if (!(state_flags & kMatchAtEnd) && match_at_end(re, set)) {
+            state_flags |= kMatchAtEnd;
+        }
+        auto id = static_cast<std::int32_t>(states.size());
+        states.push_back(&ids.emplace(std::move(set), id).first->first);
+        flags.push_back(state_flags);
+        next.resize(next.size() + re.class_count_, kUnknown);
+        return id;
+    }
+
+    // Keeps only the flag, so a pattern that outgrew the budget costs
+    // nothing more until the cache is dropped.
+    void fail() {
+        *this = Dfa{};
+        failed = true;
+    }
+};
+
+Regex::Dfa *Regex::dfa_for(std::uint32_t entry) const {
+    if (has_word_assert_) {
+        return nullptr;
+    }
+    thread_local std::unordered_map<std::uint64_t, std::unique_ptr<Dfa>> cache;
+    std::uint64_t key = id_ << 1 | (entry == search_start_ ? 1 : 0);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        if (cache.size() >= kDfaCacheSize) {
+            cache.clear();
+        }
+        auto built = std::make_unique<Dfa>();
+        built->init(*this, entry);
+        it = cache.emplace(key, std::move(built)).first;
+    }
+    return it->second->failed ? nullptr : it->second.get();
+}
+
+bool Regex::pike(std::string_view text,
+                 std::size_t from,
+                 bool anchored,
+                 bool full,
+                 std::size_t &begin,
+                 std::size_t &end) const {
+    ThreadList clist(prog_.size());
+    ThreadList nlist(prog_.size());
+    std::vector<std::uint32_t> stack;
+    bool matched = false;
+    std::size_t n = text.size();
+    std::size_t pos = from;
+    while (true) {
+        if (!matched && (!anchored || pos == from)) {
+            if (clist.empty() && !anchored && !prefix_.empty()) {
+                std::size_t hit = text.find(prefix_, pos);
+                if (hit == std::string_view::npos) {
+                    break;
+                }
+                pos = hit;
+            }
+            add_thread(prog_, clist, stack, start_, pos, text, pos);
+        }
+        if (clist.empty()) {
+            break;
+        }
+        for (std::size_t i = 0; i < clist.size(); ++i) {
+            const Inst &inst = prog_[clist.pc(i)];
+            if (inst.op == Op::Match) {
+                if (full && pos != n) {
+                    continue;
+                }
+                matched = true;
+                begin = clist.start(i);
+                end = pos;
+                // Lower-priority threads can no longer win.
+                break;
+            }
+            if (inst.op == Op::Range && pos < n) {
+                auto byte = static_cast<std::uint8_t>(text[pos]);
+                if (inst.lo <= byte && byte <= inst.hi) {
+                    add_thread(prog_, nlist, stack, clist.pc(i) + 1, clist.start(i), text, pos + 1);
+                }
+            }
+        }
+        if (pos >= n) {
+            break;
+        }
+        std::swap(clist, nlist);
+        nlist.clear();
+        ++pos;
+    }
+    return matched;
+}
+
+bool Regex::full_match(std::string_view text) const {
+    if (Dfa *dfa = dfa_for(start_)) {
+        std::int32_t state = dfa->start;
+        for (std::size_t pos = 0; state >= 0 && pos < text.size(); ++pos) {
+            state = dfa->step(*this, state, static_cast<std::uint8_t>(text[pos]));
+        }
+        if (state == Dfa::kDead) {
+            return false;
+        }
+        if (state >= 0) {
+            return (dfa->flags[static_cast<std::size_t>(state)] & Dfa::kMatchAtEnd) != 0;
+        }
+    }
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    return pike(text, 0, true, true, begin, end);
+}
+
+bool Regex::search(std::string_view text) const {
+    if (Dfa *dfa = dfa_for(search_start_)) {
+        std::int32_t state = dfa->start;
+        if (dfa->flags[static_cast<std::size_t>(state)] & Dfa::kMatch) {
+            return true;
+        }
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            if (state == dfa->idle && !prefix_.empty()) {
+                pos = text.find(prefix_, pos);
+                if (pos == std::string_view::npos) {
+                    break;
+                }
+            }
+            state = dfa->step(*this, state, static_cast<std::uint8_t>(text[pos]));
+            if (state < 0) {
+                break;
+            }
+            if (dfa->flags[static_cast<std::size_t>(state)] & Dfa::kMatch) {
+                return true;
+            }
+            ++pos;
+        }
+        if (state == Dfa::kDead) {
+            return false;
+        }
+        if (state >= 0) {
+            return (dfa->flags[static_cast<std::size_t>(state)] & Dfa::kMatchAtEnd) != 0;
+        }
+    }
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    return pike(text, 0, false, false, begin, end);
+}
+
+bool Regex::find(std::string_view text, std::size_t from, std::size_t &begin, std::size_t &end) const {
+    if (from > text.size()) {
+        return false;
+    }
+    return pike(text, from, false, false, begin, end);
+}
+
+std::shared_ptr<const Regex> regex_cached(std::string_view pattern) {
+    thread_local std::unordered_map<std::string, std::shared_ptr<const Regex>> cache;
+    std::string key(pattern);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    auto compiled = Regex::compile(pattern);
+    if (!compiled) {
+        return nullptr;
+    }
+    if (cache.size() >= kRegexCacheSize) {
+        cache.clear();
+    }
+    auto regex = std::make_shared<const Regex>(std::move(*compiled));
+    cache.emplace(std::move(key), regex);
+    return regex;
+}
+
+} // namespace fiber::common
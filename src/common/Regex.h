@@ -0,0 +1,102 @@
+#ifndef FIBER_COMMON_REGEX_H
+#define FIBER_COMMON_REGEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fiber::common {
+
+struct RegexError {
+    std::string message;
+    std::size_t position = 0;
+};
+
+// Automata-based regular expressions with RE2 semantics: ECMAScript syntax
+// without backreferences or lookaround, matched in time linear in the input.
+// Patterns are compiled to a byte-level Thompson NFA; when the pattern has no
+// word-boundary assertions the boolean queries run a DFA whose states are
+// built as the input reaches them, cached per thread within a fixed budget
+// and abandoned for the NFA once that is spent. A compiled Regex is immutable
+// and safe to share across threads.
+class Regex {
+public:
+    static std::expected<Regex, RegexError> compile(std::string_view pattern);
+
+    Regex(Regex &&) noexcept = default;
+    Regex &operator=(Regex &&) noexcept = default;
+    Regex(const Regex &) = delete;
+    Regex &operator=(const Regex &) = delete;
+
+    const std::string &pattern() const {
+        return pattern_;
+    }
+
+    // True if the whole of text matches.
+    bool full_match(std::string_view text) const;
+    // True if some substring of text matches.
+    bool search(std::string_view text) const;
+    // Leftmost-first match starting at or after from; fills [begin, end).
+    bool find(std::string_view text, std::size_t from, std::size_t &begin, std::size_t &end) const;
+
+    enum class Op : std::uint8_t {
+        Range,
+        Split,
+        Jmp,
+        Match,
+        AssertBegin,
+        AssertEnd,
+        AssertWord,
+        AssertNotWord,
+    };
+
+    // Range consumes one byte in [lo, hi] and continues at pc + 1; Split
+    // prefers x over y; asserts fall through to pc + 1.
+    struct Inst {
+        Op op = Op::Match;
+        std::uint8_t lo = 0;
+        std::uint8_t hi = 0;
+        std::uint32_t x = 0;
+        std::uint32_t y = 0;
+    };
+
+private:
+    struct Dfa;
+
+    Regex() = default;
+
+    void build_byte_classes();
+    // The calling thread's DFA from entry, or nullptr once it has run out of
+    // budget and the NFA has to be used.
+    Dfa *dfa_for(std::uint32_t entry) const;
+    bool pike(std::string_view text,
+              std::size_t from,
+              bool anchored,
+              bool full,
+              std::size_t &begin,
+              std::size_t &end) const;
+
+    std::string pattern_;
+    std::vector<Inst> prog_;
+    std::uint32_t start_ = 0;
+    std::uint32_t search_start_ = 0;
+    std::string prefix_;
+    bool has_word_assert_ = false;
+    std::uint8_t byte_class_[256] = {};
+    std::uint32_t class_count_ = 0;
+    // Unique per compile; keys the per-thread DFA caches.
+    std::uint64_t id_ = 0;
+};
+
+// Compiles pattern through a small per-thread cache so call sites that only
+// see the pattern at run time (strings.match etc.) do not recompile it per
+// call. Returns nullptr for invalid patterns.
+std::shared_ptr<const Regex> regex_cached(std::string_view pattern);
+
+} // namespace fiber::common
+
+#endif // FIBER_COMMON_REGEX_H
@@ -0,0 +1,14 @@
+#ifndef FIBER_COMMON_SHA256_H
+#define FIBER_COMMON_SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fiber::common {
+
+std::array<std::uint8_t, 32> sha256_digest(const std::uint8_t *data, std::size_t len);
+
+} // namespace fiber::common
+
+#endif // FIBER_COMMON_SHA256_H
@@ -0,0 +1,840 @@
+#include "BinaryCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace fiber::json {
+namespace {
+
+constexpr std::size_t kMaxReserve = 1024;
+constexpr std::uint64_t kMaxInt64 = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+
+class BinaryWriter {
+public:
+    BinaryWriter(GcHeap &heap, BinaryFormat format, BufferSink &sink)
+        : heap_(heap), format_(format), sink_(sink) {}
+
+    GeneratorBase::Result value(const JsValue &value, std::size_t depth) {
+        if (depth > BinaryStreamParser::kMaxDepth) {
+            return GeneratorBase::Result::MaxDepthExceeded;
+        }
+        switch (value.type_) {
+            case JsNodeType::Null:
+                return put(format_ == BinaryFormat::MsgPack ? 0xC0 : 0xF6);
+            case JsNodeType::Boolean:
+                if (format_ == BinaryFormat::MsgPack) {
+                    return put(value.b ? 0xC3 : 0xC2);
+                }
+                return put(value.b ? 0xF5 : 0xF4);
+            case JsNodeType::Integer:
+                return integer(value.i);
+            case JsNodeType::Float:
+                return number(value.f);
+            case JsNodeType::HeapString:
+                return string(reinterpret_cast<const GcString *>(value.gc));
+            case JsNodeType::NativeString:
+                return text(value.ns().data, value.ns().len);
+            case JsNodeType::NativeBinary:
+                return binary(value.nb().data, value.nb().len);
+            case JsNodeType::HeapBinary: {
+                auto *bin = reinterpret_cast<const GcBinary *>(value.gc);
+                if (!bin) {
+                    return GeneratorBase::Result::InvalidValue;
+                }
+                return binary(bin->data, bin->len);
+            }
+            case JsNodeType::Array: {
+                auto *arr = reinterpret_cast<const GcArray *>(value.gc);
+                if (!arr) {
+                    return GeneratorBase::Result::InvalidValue;
+                }
+                GeneratorBase::Result result = container(JsNodeType::Array, arr->size);
+                for (std::size_t i = 0; result == GeneratorBase::Result::OK && i < arr->size; ++i) {
+                    result = this->value(gc_array_at(arr, i), depth + 1);
+                }
+                return result;
+            }
+            case JsNodeType::Object: {
+                auto *obj = reinterpret_cast<const GcObject *>(value.gc);
+                if (!obj) {
+                    return GeneratorBase::Result::InvalidValue;
+                }
+                GeneratorBase::Result result = container(JsNodeType::Object, obj->size);
+                for (std::size_t i = 0; result == GeneratorBase::Result::OK && i < obj->entry_count; ++i) {
+                    const GcObjectEntry &entry = obj->entries[i];
+                    if (!entry.key) {
+                        continue;
+                    }
+                    result = string(entry.key);
+                    if (result == GeneratorBase::Result::OK) {
+                        result = this->value(entry.value, depth + 1);
+                    }
+                }
+                return result;
+            }
+            case JsNodeType::LazyJson: {
+                auto *lazy = reinterpret_cast<GcLazyJson *>(value.gc);
+                const JsValue *forced = lazy ? lazy_json_force(heap_, lazy) : nullptr;
+                if (!forced) {
+                    return GeneratorBase::Result::ErrorState;
+                }
+                return this->value(*forced, depth);
+            }
+            case JsNodeType::Exception:
+                return exception(reinterpret_cast<const GcException *>(value.gc), depth);
+            case JsNodeType::Undefined:
+            case JsNodeType::Interator:
+                return GeneratorBase::Result::InvalidValue;
+        }
+        return GeneratorBase::Result::InvalidValue;
+    }
+
+private:
+    GcHeap &heap_;
+    BinaryFormat format_;
+    BufferSink &sink_;
+    std::string scratch_;
+
+    GeneratorBase::Result put(std::uint8_t byte) {
+        return sink_.put(static_cast<char>(byte)) ? GeneratorBase::Result::OK : GeneratorBase::Result::ErrorState;
+    }
+
+    GeneratorBase::Result write(const void *data, std::size_t len) {
+        return sink_.write(static_cast<const char *>(data), len) ? GeneratorBase::Result::OK
+                                                                 : GeneratorBase::Result::ErrorState;
+    }
+
+    // A type byte followed by value in width big-endian bytes.
+    GeneratorBase::Result fixed(std::uint8_t type, std::uint64_t value, std::size_t width) {
+        std::uint8_t buf[9];
+        buf[0] = type;
+        for (std::size_t i = 0; i < width; ++i) {
+            buf[width - i] = static_cast<std::uint8_t>(value >> (8 * i));
+        }
+        return write(buf, width + 1);
+    }
+
+    // CBOR initial byte and argument in the shortest form.
+    GeneratorBase::Result head(std::uint8_t major, std::uint64_t n) {
+        std::uint8_t type = static_cast<std::uint8_t>(major << 5);
+        if (n < 24) {
+            return put(static_cast<std::uint8_t>(type | n));
+        }
+        if (n <= 0xFF) {
+            return fixed(type | 24, n, 1);
+        }
+        if (n <= 0xFFFF) {
+            return fixed(type | 25, n, 2);
+        }
+        if (n <= 0xFFFFFFFFULL) {
+            return fixed(type | 26, n, 4);
+        }
+        return fixed(type | 27, n, 8);
+    }
+
+    // MessagePack length prefix: the fix form below fix_limit, else the
+    // 8/16/32-bit forms starting at type8 (0 when the format has no 8-bit
+    // form and type16 is used instead).
+    GeneratorBase::Result length(std::uint8_t fix, std::size_t fix_limit, std::uint8_t type8, std::uint8_t type16,
+                                 std::size_t n) {
+        if (n < fix_limit) {
+            return put(static_cast<std::uint8_t>(fix | n));
+        }
+        if (type8 && n <= 0xFF) {
+            return fixed(type8, n, 1);
+        }
+        if (n <= 0xFFFF) {
+            return fixed(type16, n, 2);
+        }
+        if (n <= 0xFFFFFFFFULL) {
+            return fixed(static_cast<std::uint8_t>(type16 + 1), n, 4);
+        }
+        return GeneratorBase::Result::InvalidValue;
+    }
+
+    GeneratorBase::Result integer(std::int64_t v) {
+        if (format_ == BinaryFormat::Cbor) {
+            return v >= 0 ? head(0, static_cast<std::uint64_t>(v)) : head(1, static_cast<std::uint64_t>(-(v + 1)));
+        }
+        if (v >= 0) {
+            auto u = static_cast<std::uint64_t>(v);
+            if (u < 0x80) {
+                return put(static_cast<std::uint8_t>(u));
+            }
+            if (u <= 0xFF) {
+                return fixed(0xCC, u, 1);
+            }
+            if (u <= 0xFFFF) {
+                return fixed(0xCD, u, 2);
+            }
+            if (u <= 0xFFFFFFFFULL) {
+                return fixed(0xCE, u, 4);
+            }
+            return fixed(0xCF, u, 8);
+        }
+        auto bits = static_cast<std::uint64_t>(v);
+        if (v >= -32) {
+            return put(static_cast<std::uint8_t>(bits));
+        }
+        if (v >= std::numeric_limits<std::int8_t>::min()) {
+            return fixed(0xD0, bits, 1);
+        }
+        if (v >= std::numeric_limits<std::int16_t>::min()) {
+            return fixed(0xD1, bits, 2);
+        }
+        if (v >= std::numeric_limits<std::int32_t>::min()) {
+            return fixed(0xD2, bits, 4);
+        }
+        return fixed(0xD3, bits, 8);
+    }
+
+    // float32 when it holds the value exactly, float64 otherwise.
+    GeneratorBase::Result number(double v) {
+        bool cbor = format_ == BinaryFormat::Cbor;
+        auto narrow = static_cast<float>(v);
+        if (static_cast<double>(narrow) == v) {
+            std::uint32_t bits = 0;
+            std::memcpy(&bits, &narrow, sizeof(bits));
+            return fixed(cbor ? 0xFA : 0xCA, bits, 4);
+        }
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return fixed(cbor ? 0xFB : 0xCB, bits, 8);
+    }
+
+    GeneratorBase::Result text(const char *data, std::size_t len) {
+        GeneratorBase::Result result = format_ == BinaryFormat::Cbor ? head(3, len)
+                                                                     : length(0xA0, 32, 0xD9, 0xDA, len);
+        if (result != GeneratorBase::Result::OK) {
+            return result;
+        }
+        return write(data, len);
+    }
+
+    GeneratorBase::Result string(const GcString *str) {
+        if (!str) {
+            return GeneratorBase::Result::InvalidString;
+        }
+        if (str->encoding == GcStringEncoding::Byte &&
+            std::all_of(str->data8, str->data8 + str->len, [](std::uint8_t ch) { return ch < 0x80; })) {
+            return text(reinterpret_cast<const char *>(str->data8), str->len);
+        }
+        if (!gc_string_to_utf8(str, scratch_)) {
+            return GeneratorBase::Result::InvalidString;
+        }
+        return text(scratch_.data(), scratch_.size());
+    }
+
+    GeneratorBase::Result binary(const std::uint8_t *data, std::size_t len) {
+        if (!data && len > 0) {
+            return GeneratorBase::Result::InvalidValue;
+        }
+        GeneratorBase::Result result = format_ == BinaryFormat::Cbor ? head(2, len)
+                                                                     : length(0, 0, 0xC4, 0xC5, len);
+        if (result != GeneratorBase::Result::OK) {
+            return result;
+        }
+        return write(data, len);
+    }
+
+    GeneratorBase::Result container(JsNodeType type, std::size_t n) {
+        bool map = type == JsNodeType::Object;
+        if (format_ == BinaryFormat::Cbor) {
+            return head(map ? 5 : 4, n);
+        }
+        return map ? length(0x80, 16, 0, 0xDE, n) : length(0x90, 16, 0, 0xDC, n);
+    }
+
+    // Same shape as the JSON encoding of an exception.
+    GeneratorBase::Result exception(const GcException *exc, std::size_t depth) {
+        if (!exc) {
+            return GeneratorBase::Result::InvalidValue;
+        }
+        GeneratorBase::Result result = container(JsNodeType::Object, 4);
+        auto field = [&](const char *name, auto &&write_value) {
+            if (result == GeneratorBase::Result::OK) {
+                result = text(name, std::strlen(name));
+            }
+            if (result == GeneratorBase::Result::OK) {
+                result = write_value();
+            }
+        };
+        auto string_or_null = [&](const GcString *str) {
+            return str ? string(str) : value(JsValue::make_null(), depth);
+        };
+        field("position", [&] { return integer(exc->position); });
+        field("name", [&] { return string_or_null(exc->name); });
+        field("message", [&] { return string_or_null(exc->message); });
+        field("meta", [&] {
+            return value(exc->meta.type_ == JsNodeType::Undefined ? JsValue::make_null() : exc->meta, depth + 1);
+        });
+        return result;
+    }
+};
+
+enum class HeadKind {
+    Null,
+    Boolean,
+    Integer,
+    Float,
+    String,
+    Binary,
+    Array,
+    Map,
+    Break,
+    Tag,
+};
+
+enum class HeadResult {
+    Ok,
+    NeedMore,
+    Error,
+};
+
+struct Head {
+    HeadKind kind = HeadKind::Null;
+    std::uint64_t n = 0;
+    std::int64_t i = 0;
+    double f = 0;
+    bool indefinite = false;
+    std::size_t size = 1;
+    const char *error = nullptr;
+};
+
+std::uint64_t load_be(const std::uint8_t *p, std::size_t width) {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < width; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+double load_float32(std::uint64_t bits) {
+    auto narrow = static_cast<std::uint32_t>(bits);
+    float value = 0;
+    std::memcpy(&value, &narrow, sizeof(value));
+    return value;
+}
+
+double load_float64(std::uint64_t bits) {
+    double value = 0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double load_float16(std::uint64_t bits) {
+    int exponent = static_cast<int>((bits >> 10) & 0x1F);
+    int mantissa = static_cast<int>(bits & 0x3FF);
+    double value = 0;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    return (bits & 0x8000) ? -value : value;
+}
+
+HeadResult fail(Head &out, const char *message) {
+    out.error = message;
+    return HeadResult::Error;
+}
+
+// Reads a type byte plus its width-byte argument.
+HeadResult sized(const std::uint8_t *p, std::size_t avail, std::size_t width, HeadKind kind, Head &out) {
+    if (avail < width + 1) {
+        return HeadResult::NeedMore;
+    }
+    out.kind = kind;
+    out.n = load_be(p + 1, width);
+    out.size = width + 1;
+    return HeadResult::Ok;
+}
+
+HeadResult read_msgpack_head(const std::uint8_t *p, std::size_t avail, Head &out) {
+    std::uint8_t type = p[0];
+    out = {};
+    if (type <= 0x7F) {
+        out.kind = HeadKind::Integer;
+        out.i = type;
+        return HeadResult::Ok;
+    }
+    if (type >= 0xE0) {
+        out.kind = HeadKind::Integer;
+        out.i = static_cast<std::int8_t>(type);
+        return HeadResult::Ok;
+    }
+    if (type <= 0x8F) {
+        out.kind = HeadKind::Map;
+        out.n = type & 0x0F;
+        return HeadResult::Ok;
+    }
+    if (type <= 0x9F) {
+        out.kind = HeadKind::Array;
+        out.n = type & 0x0F;
+        return HeadResult::Ok;
+    }
+    if (type <= 0xBF) {
+        out.kind = HeadKind::String;
+        out.n = type & 0x1F;
+        return HeadResult::Ok;
+    }
+    HeadResult result = HeadResult::Ok;
+    switch (type) {
+        case 0xC0:
+            out.kind = HeadKind::Null;
+            return HeadResult::Ok;
+        case 0xC2:
+        case 0xC3:
+            out.kind = HeadKind::Boolean;
+            out.n = type & 1;
+            return HeadResult::Ok;
+        case 0xC4:
+        case 0xC5:
+        case 0xC6:
+            return sized(p, avail, std::size_t{1} << (type - 0xC4), HeadKind::Binary, out);
+        case 0xCA:
+        case 0xCB:
+            result = sized(p, avail, type == 0xCA ? 4 : 8, HeadKind::Float, out);
+            out.f = type == 0xCA ? load_float32(out.n) : load_float64(out.n);
+            return result;
+        case 0xCC:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            result = sized(p, avail, std::size_t{1} << (type - 0xCC), HeadKind::Integer, out);
+            if (result == HeadResult::Ok && out.n > kMaxInt64) {
+                return fail(out, "integer overflow");
+            }
+            out.i = static_cast<std::int64_t>(out.n);
+            return result;
+        case 0xD0:
+        case 0xD1:
+        case 0xD2:
+        case 0xD3: {
+            std::size_t width = std::size_t{1} << (type - 0xD0);
+            result = sized(p, avail, width, HeadKind::Integer, out);
+            // Sign-extend from width bytes.
+            unsigned shift = static_cast<unsigned>(64 - width * 8);
+            out.i = static_cast<std::int64_t>(out.n << shift) >> shift;
+            return result;
+        }
+        case 0xD9:
+        case 0xDA:
+        case 0xDB:
+            return sized(p, avail, std::size_t{1} << (type - 0xD9), HeadKind::String, out);
+        case 0xDC:
+        case 0xDD:
+            return sized(p, avail, type == 0xDC ? 2 : 4, HeadKind::Array, out);
+        case 0xDE:
+        case 0xDF:
+            return sized(p, avail, type == 0xDE ? 2 : 4, HeadKind::Map, out);
+        case 0xC1:
+            return fail(out, "invalid MessagePack type byte");
+        default:
+            return fail(out, "unsupported MessagePack extension");
+    }
+}
+
+HeadResult read_cbor_head(const std::uint8_t *p, std::size_t avail, Head &out) {
+    out = {};
+    std::uint8_t major = p[0] >> 5;
+    std::uint8_t info = p[0] & 0x1F;
+    if (info < 24) {
+        out.n = info;
+    } else if (info <= 27) {
+        std::size_t width = std::size_t{1} << (info - 24);
+        if (avail < width + 1) {
+            return HeadResult::NeedMore;
+        }
+        out.n = load_be(p + 1, width);
+        out.size = width + 1;
+    } else if (info == 31) {
+        out.indefinite = true;
+        if (major == 7) {
+            out.kind = HeadKind::Break;
+            return HeadResult::Ok;
+        }
+        if (major < 2 || major == 6) {
+            return fail(out, "invalid indefinite-length item");
+        }
+    } else {
+        return fail(out, "invalid CBOR additional information");
+    }
+    switch (major) {
+        case 0:
+        case 1:
+            if (out.n > kMaxInt64) {
+                return fail(out, "integer overflow");
+            }
+            out.kind = HeadKind::Integer;
+            out.i = major == 0 ? static_cast<std::int64_t>(out.n) : -1 - static_cast<std::int64_t>(out.n);
+            return HeadResult::Ok;
+        case 2:
+            out.kind = HeadKind::Binary;
+            return HeadResult::Ok;
+        case 3:
+            out.kind = HeadKind::String;
+            return HeadResult::Ok;
+        case 4:
+            out.kind = HeadKind::Array;
+            return HeadResult::Ok;
+        case 5:
+            out.kind = HeadKind::Map;
+            return HeadResult::Ok;
+        case 6:
+            out.kind = HeadKind::Tag;
+            return HeadResult::Ok;
+        default:
+            break;
+    }
+    switch (info) {
+        case 20:
+        case 21:
+            out.kind = HeadKind::Boolean;
+            out.n = info == 21 ? 1 : 0;
+            return HeadResult::Ok;
+        case 22:
+        case 23:
+            out.kind = HeadKind::Null;
+            return HeadResult::Ok;
+        case 25:
+            out.kind = HeadKind::Float;
+            out.f = load_float16(out.n);
+            return HeadResult::Ok;
+        case 26:
+            out.kind = HeadKind::Float;
+            out.f = load_float32(out.n);
+            return HeadResult::Ok;
+        case 27:
+            out.kind = HeadKind::Float;
+            out.f = load_float64(out.n);
+            return HeadResult::Ok;
+        default:
+            return fail(out, "unsupported CBOR simple value");
+    }
+}
+
+} // namespace
+
+GeneratorBase::Result encode_binary(GcHeap &heap, BinaryFormat format, const JsValue &value, BufferSink &sink) {
+    BinaryWriter writer(heap, format, sink);
+    return writer.value(value, 0);
+}
+
+BinaryStreamParser::BinaryStreamParser(GcHeap &heap, BinaryFormat format)
+    : heap_(heap), format_(format) {
+    reset();
+}
+
+void BinaryStreamParser::reset() {
+    error_ = {};
+    root_ = JsValue();
+    has_result_ = false;
+    failed_ = false;
+    frames_.clear();
+    offset_ = 0;
+    head_len_ = 0;
+    payload_ = Payload::None;
+    payload_len_ = 0;
+    payload_bytes_.clear();
+    chunked_ = Payload::None;
+    chunks_.clear();
+}
+
+BinaryStreamParser::Status BinaryStreamParser::parse(const std::uint8_t *data, std::size_t len) {
+    if (failed_) {
+        return Status::Error;
+    }
+    if (!data && len > 0) {
+        (void)set_error("input is null", offset_);
+        return Status::Error;
+    }
+    std::size_t pos = 0;
+    while (pos < len) {
+        if ((complete() && !set_error("trailing bytes after value", offset_)) || !step(data, len, pos)) {
+            failed_ = true;
+            return Status::Error;
+        }
+    }
+    return complete() ? Status::Complete : Status::NeedMore;
+}
+
+BinaryStreamParser::Status BinaryStreamParser::finish() {
+    if (failed_) {
+        return Status::Error;
+    }
+    if (complete()) {
+        return Status::Complete;
+    }
+    (void)set_error("premature end of input", offset_);
+    failed_ = true;
+    return Status::Error;
+}
+
+const ParseError &BinaryStreamParser::error() const {
+    return error_;
+}
+
+const JsValue &BinaryStreamParser::root() const {
+    return root_;
+}
+
+bool BinaryStreamParser::has_result() const {
+    return has_result_;
+}
+
+bool BinaryStreamParser::complete() const {
+    return has_result_ && frames_.empty() && head_len_ == 0 && payload_ == Payload::None &&
+           chunked_ == Payload::None;
+}
+
+// Consumes one item head, with its payload when that is already in data,
+// or a piece of a payload that spans chunks.
+bool BinaryStreamParser::step(const std::uint8_t *data, std::size_t len, std::size_t &pos) {
+    if (payload_ != Payload::None) {
+        std::size_t take = static_cast<std::size_t>(
+            std::min<std::uint64_t>(payload_len_ - payload_bytes_.size(), len - pos));
+        payload_bytes_.append(reinterpret_cast<const char *>(data + pos), take);
+        pos += take;
+        offset_ += take;
+        if (payload_bytes_.size() < payload_len_) {
+            return true;
+        }
+        Payload kind = payload_;
+        payload_ = Payload::None;
+        bool ok = finish_payload(kind, payload_bytes_.data(), payload_bytes_.size());
+        payload_bytes_.clear();
+        return ok;
+    }
+
+    const std::uint8_t *p = data + pos;
+    std::size_t avail = len - pos;
+    std::size_t carried = head_len_;
+    std::uint8_t joined[sizeof(head_)];
+    if (carried > 0) {
+        std::size_t take = std::min(sizeof(head_) - carried, avail);
+        std::memcpy(joined, head_, carried);
+        std::memcpy(joined + carried, p, take);
+        p = joined;
+        avail = carried + take;
+    }
+    std::size_t start = offset_ - carried;
+    Head head;
+    HeadResult result = format_ == BinaryFormat::MsgPack ? read_msgpack_head(p, avail, head)
+                                                         : read_cbor_head(p, avail, head);
+    if (result == HeadResult::Error) {
+        return set_error(head.error, start);
+    }
+    if (result == HeadResult::NeedMore) {
+        std::memmove(head_, p, avail);
+        head_len_ = avail;
+        pos = len;
+        offset_ += avail - carried;
+        return true;
+    }
+    head_len_ = 0;
+    pos += head.size - carried;
+    offset_ += head.size - carried;
+
+    switch (head.kind) {
+        case HeadKind::Null:
+            return add(JsValue::make_null());
+        case HeadKind::Boolean:
+            return add(JsValue::make_boolean(head.n != 0));
+        case HeadKind::Integer:
+            return add(JsValue::make_integer(head.i));
+        case HeadKind::Float:
+            return add(JsValue::make_float(head.f));
+        case HeadKind::String:
+        case HeadKind::Binary: {
+            Payload kind = head.kind == HeadKind::String ? Payload::String : Payload::Binary;
+            if (chunked_ != Payload::None && (head.indefinite || kind != chunked_)) {
+                return set_error("invalid chunk in indefinite-length string", start);
+            }
+            if (head.indefinite) {
+                chunked_ = kind;
+                chunks_.clear();
+                return true;
+            }
+            if (head.n <= len - pos) {
+                auto n = static_cast<std::size_t>(head.n);
+                const char *bytes = reinterpret_cast<const char *>(data + pos);
+                pos += n;
+                offset_ += n;
+                return finish_payload(kind, bytes, n);
+            }
+            payload_ = kind;
+            payload_len_ = head.n;
+            payload_bytes_.clear();
+            payload_bytes_.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(head.n, 64 * kMaxReserve)));
+            return true;
+        }
+        case HeadKind::Array:
+        case HeadKind::Map:
+            if (chunked_ != Payload::None) {
+                return set_error("invalid chunk in indefinite-length string", start);
+            }
+            return open(head.kind == HeadKind::Map ? JsNodeType::Object : JsNodeType::Array, head.n,
+                        head.indefinite);
+        case HeadKind::Break:
+            if (chunked_ != Payload::None) {
+                Payload kind = chunked_;
+                chunked_ = Payload::None;
+                bool ok = finish_payload(kind, chunks_.data(), chunks_.size());
+                chunks_.clear();
+                return ok;
+            }
+            return close_indefinite();
+        case HeadKind::Tag:
+            return true;
+    }
+    return set_error("invalid item", start);
+}
+
+bool BinaryStreamParser::finish_payload(Payload kind, const char *data, std::size_t len) {
+    if (chunked_ != Payload::None) {
+        chunks_.append(data, len);
+        return true;
+    }
+    JsValue value;
+    if (kind == Payload::String) {
+        GcString *str = gc_new_string(&heap_, data, len);
+        if (!str) {
+            return set_error("invalid UTF-8 string", offset_ - len);
+        }
+        value.type_ = JsNodeType::HeapString;
+        value.gc = &str->hdr;
+    } else {
+        GcBinary *bin = gc_new_binary(&heap_, reinterpret_cast<const std::uint8_t *>(data), len);
+        if (!bin) {
+            return set_error("out of memory", offset_);
+        }
+        value.type_ = JsNodeType::HeapBinary;
+        value.gc = &bin->hdr;
+    }
+    return add(std::move(value));
+}
+
+bool BinaryStreamParser::open(JsNodeType type, std::uint64_t count, bool indefinite) {
+    if (frames_.size() >= kMaxDepth) {
+        return set_error("nesting too deep", offset_);
+    }
+    if (type == JsNodeType::Object && count > std::numeric_limits<std::uint64_t>::max() / 2) {
+        return set_error("map too large", offset_);
+    }
+    auto capacity = static_cast<std::size_t>(std::min<std::uint64_t>(count, kMaxReserve));
+    Frame frame;
+    frame.type = type;
+    frame.remaining = type == JsNodeType::Object ? count * 2 : count;
+    frame.indefinite = indefinite;
+    JsValue value;
+    value.type_ = type;
+    if (type == JsNodeType::Object) {
+        frame.object = gc_new_object(&heap_, capacity);
+        value.gc = frame.object ? &frame.object->hdr : nullptr;
+    } else {
+        frame.array = gc_new_array(&heap_, capacity);
+        value.gc = frame.array ? &frame.array->hdr : nullptr;
+    }
+    if (!value.gc) {
+        return set_error("out of memory", offset_);
+    }
+    if (!attach(std::move(value))) {
+        return false;
+    }
+    if (!indefinite && count == 0) {
+        item_done();
+        return true;
+    }
+    frames_.push_back(frame);
+    return true;
+}
+
+bool BinaryStreamParser::close_indefinite() {
+    if (frames_.empty() || !frames_.back().indefinite) {
+        return set_error("unexpected break", offset_ - 1);
+    }
+    if (frames_.back().key) {
+        return set_error("map key without value", offset_ - 1);
+    }
+    frames_.pop_back();
+    item_done();
+    return true;
+}
+
+bool BinaryStreamParser::add(JsValue value) {
+    if (!attach(std::move(value))) {
+        return false;
+    }
+    item_done();
+    return true;
+}
+
+// Stores value as the root, the next element of the open array, or the
+// next key or value of the open map.
+bool BinaryStreamParser::attach(JsValue value) {
+    if (frames_.empty()) {
+        root_ = std::move(value);
+        has_result_ = true;
+        return true;
+    }
+    Frame &frame = frames_.back();
+    if (frame.type == JsNodeType::Array) {
+        return gc_array_push(&heap_, frame.array, std::move(value)) || set_error("out of memory", offset_);
+    }
+    if (frame.key) {
+        GcString *key = frame.key;
+        frame.key = nullptr;
+        return gc_object_set(&heap_, frame.object, key, std::move(value)) || set_error("out of memory", offset_);
+    }
+    if (value.type_ == JsNodeType::HeapString) {
+        frame.key = reinterpret_cast<GcString *>(value.gc);
+        return true;
+    }
+    if (value.type_ == JsNodeType::Integer) {
+        std::string text = std::to_string(value.i);
+        frame.key = gc_new_string(&heap_, text.data(), text.size());
+        return frame.key || set_error("out of memory", offset_);
+    }
+    return set_error("map key must be a string or integer", offset_);
+}
+
+void BinaryStreamParser::item_done() {
+    while (!frames_.empty()) {
+        Frame &frame = frames_.back();
+        if (frame.indefinite) {
+            return;
+        }
+        frame.remaining -= 1;
+        if (frame.remaining > 0) {
+            return;
+        }
+        frames_.pop_back();
+    }
+}
+
+bool BinaryStreamParser::set_error(const char *message, std::size_t offset) {
+    error_.message = message;
+    error_.offset = offset;
+    return false;
+}
+
+bool decode_binary(GcHeap &heap, BinaryFormat format, const std::uint8_t *data, std::size_t len, JsValue &out,
+                   ParseError &error) {
+    BinaryStreamParser parser(heap, format);
+    if (parser.parse(data, len) == BinaryStreamParser::Status::Error ||
+        parser.finish() != BinaryStreamParser::Status::Complete) {
+        error = parser.error();
+        return false;
+    }
+    out = parser.root();
+    return true;
+}
+
+} // namespace fiber::json
@@ -0,0 +1,108 @@
+#ifndef FIBER_BINARYCODEC_H
+#define FIBER_BINARYCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "JsGc.h"
+#include "JsonDecode.h"
+#include "JsonEncode.h"
+
+namespace fiber::json {
+
+enum class BinaryFormat {
+    MsgPack,
+    Cbor,
+};
+
+// Appends value to sink in the given format. Binaries are written as
+// bin/byte strings, integers in their shortest form, floats as float32 when
+// that is exact, and lazy documents are forced on heap. Undefined and iterators have no
+// encoding (InvalidValue).
+[[nodiscard]] GeneratorBase::Result encode_binary(GcHeap &heap, BinaryFormat format, const JsValue &value,
+                                                  BufferSink &sink);
+
+// Decodes one MessagePack or CBOR item delivered in chunks, building the
+// value on heap as it arrives; same contract as StreamParser. Map keys must
+// be strings or integers (integers become their decimal text). MessagePack
+// extensions and CBOR tags other than self-describe are not understood:
+// extensions are an error and tags are dropped, keeping the tagged item.
+class BinaryStreamParser {
+public:
+    enum class Status {
+        Ok,
+        NeedMore,
+        Complete,
+        Error,
+    };
+
+    BinaryStreamParser(GcHeap &heap, BinaryFormat format);
+    BinaryStreamParser(const BinaryStreamParser &) = delete;
+    BinaryStreamParser &operator=(const BinaryStreamParser &) = delete;
+    BinaryStreamParser(BinaryStreamParser &&) = delete;
+    BinaryStreamParser &operator=(BinaryStreamParser &&) = delete;
+
+    void reset();
+    [[nodiscard]] Status parse(const std::uint8_t *data, std::size_t len);
+    [[nodiscard]] Status finish();
+    [[nodiscard]] const ParseError &error() const;
+    [[nodiscard]] const JsValue &root() const;
+    [[nodiscard]] bool has_result() const;
+
+    static constexpr std::size_t kMaxDepth = 512;
+
+private:
+    enum class Payload {
+        None,
+        String,
+        Binary,
+    };
+
+    struct Frame {
+        JsNodeType type = JsNodeType::Undefined;
+        GcArray *array = nullptr;
+        GcObject *object = nullptr;
+        GcString *key = nullptr;
+        std::uint64_t remaining = 0;
+        bool indefinite = false;
+    };
+
+    GcHeap &heap_;
+    BinaryFormat format_;
+    ParseError error_;
+    JsValue root_;
+    bool has_result_ = false;
+    bool failed_ = false;
+    std::vector<Frame> frames_;
+    std::size_t offset_ = 0;
+    // An item head cut off by the end of a chunk.
+    std::uint8_t head_[9] = {};
+    std::size_t head_len_ = 0;
+    // A string or binary whose bytes span chunks.
+    Payload payload_ = Payload::None;
+    std::uint64_t payload_len_ = 0;
+    std::string payload_bytes_;
+    // CBOR indefinite-length string or byte string being joined.
+    Payload chunked_ = Payload::None;
+    std::string chunks_;
+
+    [[nodiscard]] bool complete() const;
+    [[nodiscard]] bool step(const std::uint8_t *data, std::size_t len, std::size_t &pos);
+    [[nodiscard]] bool finish_payload(Payload kind, const char *data, std::size_t len);
+    [[nodiscard]] bool open(JsNodeType type, std::uint64_t count, bool indefinite);
+    [[nodiscard]] bool close_indefinite();
+    [[nodiscard]] bool add(JsValue value);
+    [[nodiscard]] bool attach(JsValue value);
+    void item_done();
+    [[nodiscard]] bool set_error(const char *message, std::size_t offset);
+};
+
+// One-shot BinaryStreamParser.
+[[nodiscard]] bool decode_binary(GcHeap &heap, BinaryFormat format, const std::uint8_t *data, std::size_t len,
+                                 JsValue &out, ParseError &error);
+
+} // namespace fiber::json
+
+#endif // FIBER_BINARYCODEC_H
@@ -0,0 +1,61 @@
+#include "GcWorkers.h"
+
+namespace fiber::json {
+
+GcWorkers::GcWorkers(std::size_t helpers)
+    : group_(helpers) {
+    group_.start([this](async::ThreadGroup::Thread &thread) {
+        loop(thread);
+    });
+}
+
+GcWorkers::~GcWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    group_.join();
+}
+
+void GcWorkers::run(const Job &job) {
+    std::lock_guard<std::mutex> turn(run_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        pending_ = group_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+    job(group_.size());
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() {
+        return pending_ == 0;
+    });
+    job_ = nullptr;
+}
+
+void GcWorkers::loop(async::ThreadGroup::Thread &thread) {
+    std::uint64_t seen = 0;
+    for (;;) {
+        const Job *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() {
+                return stopping_ || generation_ != seen;
+            });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+            job = job_;
+        }
+        (*job)(thread.index());
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+} // namespace fiber::json
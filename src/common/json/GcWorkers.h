@@ -0,0 +1,51 @@
+#ifndef FIBER_GCWORKERS_H
+#define FIBER_GCWORKERS_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include "../../async/ThreadGroup.h"
+#include "../NonCopyable.h"
+#include "../NonMovable.h"
+
+namespace fiber::json {
+
+// Helper threads that mark and sweep large heaps alongside the collecting
+// thread (gc_set_workers). One pool can serve several heaps; their
+// collections take turns.
+class GcWorkers : public common::NonCopyable, public common::NonMovable {
+public:
+    using Job = std::function<void(std::size_t)>;
+
+    explicit GcWorkers(std::size_t helpers);
+    ~GcWorkers();
+
+    // Threads a job runs on: the helpers and the caller.
+    std::size_t size() const noexcept {
+        return group_.size() + 1;
+    }
+
+    // Calls job(i) once for every i below size(), the last on the calling
+    // thread, and returns when all calls have.
+    void run(const Job &job);
+
+private:
+    void loop(async::ThreadGroup::Thread &thread);
+
+    async::ThreadGroup group_;
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const Job *job_ = nullptr;
+    std::uint64_t generation_ = 0;
+    std::size_t pending_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace fiber::json
+
+#endif // FIBER_GCWORKERS_H
@@ -5,42 +5,111 @@
 #include "JsGc.h"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <cstring>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "GcWorkers.h"
+#include "Utf.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace fiber::json {
 namespace {
 
-constexpr std::uint64_t kFnvOffsetBasis = 14695981039346656037ull;
-constexpr std::uint64_t kFnvPrime = 1099511628211ull;
-constexpr std::size_t kMinBucketCount = 8;
-constexpr std::size_t kMaxLoadNumerator = 3;
-constexpr std::size_t kMaxLoadDenominator = 4;
+constexpr std::uint64_t kHashSecret0 = 0xa0761d6478bd642full;
+constexpr std::uint64_t kHashSecret1 = 0xe7037ed1a0b428dbull;
+constexpr std::uint64_t kHashSecret2 = 0x8ebc6af09c88c6e3ull;
+constexpr std::size_t kGroupWidth = kGcObjectGroupWidth;
+constexpr std::size_t kSlotBytes = sizeof(std::uint8_t) + sizeof(std::uint32_t);
+constexpr std::size_t kNoSlot = static_cast<std::size_t>(-1);
+constexpr std::uint8_t kCtrlEmpty = 0x80;
+constexpr std::uint8_t kCtrlDeleted = 0xFE;
+constexpr std::size_t kMaxFreeBytes = 1 << 20;
+constexpr std::size_t kInlineArrayCapacity = 16;
+constexpr std::size_t kInlineObjectCapacity = 8;
+constexpr std::size_t kMinAtomSlots = 64;
+// Appends shorter than this copy into a plain string rather than starting a
+// GcStringBuffer.
+constexpr std::size_t kMinBufferedString = 64;
 
 GcMark flip_mark(GcMark mark) {
     return (mark == GcMark::GcMark_0) ? GcMark::GcMark_1 : GcMark::GcMark_0;
 }
 
+std::uint64_t hash_mix(std::uint64_t lhs, std::uint64_t rhs) {
+    unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+}
+
+// Four code units as one word of 16-bit lanes. Byte strings are widened
+// so both encodings of the same text hash and compare alike.
+std::uint64_t load_units(const std::uint8_t *data) {
+    std::uint32_t bytes = 0;
+    std::memcpy(&bytes, data, sizeof(bytes));
+    std::uint64_t word = bytes;
+    word = (word | (word << 16)) & 0x0000FFFF0000FFFFull;
+    return (word | (word << 8)) & 0x00FF00FF00FF00FFull;
+}
+
+std::uint64_t load_units(const char16_t *data) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+// wyhash-style: one 64x64->128 multiply per eight code units, two
+// independent lanes on long strings.
+template <typename Unit>
+std::uint64_t hash_units(const Unit *data, std::size_t len) {
+    std::uint64_t seed = kHashSecret0 ^ len;
+    std::size_t i = 0;
+    if (len >= 16) {
+        std::uint64_t other = seed;
+        for (; i + 16 <= len; i += 16) {
+            seed = hash_mix(load_units(data + i) ^ kHashSecret1, load_units(data + i + 4) ^ seed);
+            other = hash_mix(load_units(data + i + 8) ^ kHashSecret2, load_units(data + i + 12) ^ other);
+        }
+        seed ^= other;
+    }
+    for (; i + 8 <= len; i += 8) {
+        seed = hash_mix(load_units(data + i) ^ kHashSecret1, load_units(data + i + 4) ^ seed);
+    }
+    // The last 0-7 units: two overlapping words, or for fewer than four the
+    // first, middle and last unit.
+    std::size_t rest = len - i;
+    std::uint64_t head = 0;
+    std::uint64_t tail = 0;
+    if (rest >= 4) {
+        head = load_units(data + i);
+        tail = load_units(data + len - 4);
+    } else if (rest > 0) {
+        head = (static_cast<std::uint64_t>(data[i]) << 32) | (static_cast<std::uint64_t>(data[i + rest / 2]) << 16) |
+               static_cast<std::uint64_t>(data[len - 1]);
+    }
+    return hash_mix(kHashSecret1 ^ len, hash_mix(head ^ kHashSecret1, tail ^ seed));
+}
+
 std::uint64_t hash_code_units(const GcString *str) {
-    std::uint64_t hash = kFnvOffsetBasis;
     if (!str || str->len == 0) {
-        return hash;
+        return hash_units(static_cast<const std::uint8_t *>(nullptr), 0);
     }
     if (str->encoding == GcStringEncoding::Byte) {
-        for (std::size_t i = 0; i < str->len; ++i) {
-            hash ^= static_cast<std::uint16_t>(str->data8[i]);
-            hash *= kFnvPrime;
-        }
-        return hash;
+        return hash_units(str->data8, str->len);
     }
-    for (std::size_t i = 0; i < str->len; ++i) {
-        hash ^= static_cast<std::uint16_t>(str->data16[i]);
-        hash *= kFnvPrime;
-    }
-    return hash;
+    return hash_units(str->data16, str->len);
 }
 
 std::uint64_t string_hash(const GcString *str) {
@@ -56,6 +125,34 @@ std::uint64_t string_hash(const GcString *str) {
     return mutable_str->hash;
 }
 
+bool units_equal(const std::uint8_t *bytes, const char16_t *units, std::size_t len) {
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i narrow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(units + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(units + i + 8));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi16(_mm_unpacklo_epi8(narrow, zero), lo),
+                                   _mm_cmpeq_epi16(_mm_unpackhi_epi8(narrow, zero), hi));
+        if (_mm_movemask_epi8(eq) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i + 4 <= len; i += 4) {
+        if (load_units(bytes + i) != load_units(units + i)) {
+            return false;
+        }
+    }
+    for (; i < len; ++i) {
+        if (units[i] != bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool string_equals(const GcString *lhs, const GcString *rhs) {
     if (lhs == rhs) {
         return true;
@@ -76,42 +173,210 @@ bool string_equals(const GcString *lhs, const GcString *rhs) {
         return std::memcmp(lhs->data16, rhs->data16, lhs->len * sizeof(char16_t)) == 0;
     }
     if (lhs->encoding == GcStringEncoding::Byte) {
-        for (std::size_t i = 0; i < lhs->len; ++i) {
-            if (rhs->data16[i] != static_cast<char16_t>(lhs->data8[i])) {
-                return false;
-            }
+        return units_equal(lhs->data8, rhs->data16, lhs->len);
+    }
+    return units_equal(rhs->data8, lhs->data16, lhs->len);
+}
+
+// Full control bytes hold the low 7 bits of the hash; the rest picks the
+// first group to probe.
+std::uint8_t ctrl_h2(std::uint64_t hash) {
+    return static_cast<std::uint8_t>(hash & 0x7F);
+}
+
+std::size_t max_load(std::size_t slot_count) {
+    return slot_count - slot_count / 8;
+}
+
+std::size_t slot_count_for(std::size_t members) {
+    std::size_t slot_count = kGroupWidth;
+    while (max_load(slot_count) < members) {
+        slot_count <<= 1;
+    }
+    return slot_count;
+}
+
+// One group of control bytes; each match returns a bit per slot.
+struct CtrlGroup {
+#if defined(__SSE2__)
+    explicit CtrlGroup(const std::uint8_t *ctrl)
+        : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {}
+
+    std::uint32_t match(std::uint8_t h2) const {
+        return static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(h2)))));
+    }
+
+    std::uint32_t match_empty() const {
+        return match(kCtrlEmpty);
+    }
+
+    // Empty or deleted: the only control bytes with the high bit set.
+    std::uint32_t match_free() const {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+    }
+
+    __m128i bytes;
+#else
+    explicit CtrlGroup(const std::uint8_t *ctrl) : bytes(ctrl) {}
+
+    std::uint32_t match(std::uint8_t h2) const {
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < kGroupWidth; ++i) {
+            bits |= static_cast<std::uint32_t>(bytes[i] == h2) << i;
         }
-        return true;
+        return bits;
     }
-    for (std::size_t i = 0; i < lhs->len; ++i) {
-        if (lhs->data16[i] != static_cast<char16_t>(rhs->data8[i])) {
-            return false;
+
+    std::uint32_t match_empty() const {
+        return match(kCtrlEmpty);
+    }
+
+    std::uint32_t match_free() const {
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < kGroupWidth; ++i) {
+            bits |= static_cast<std::uint32_t>(bytes[i] >> 7) << i;
+        }
+        return bits;
+    }
+
+    const std::uint8_t *bytes;
+#endif
+};
+
+// Triangular probing over groups; visits every group once when the group
+// count is a power of two.
+struct ProbeSeq {
+    ProbeSeq(std::uint64_t hash, std::size_t slot_count)
+        : mask(slot_count / kGroupWidth - 1), offset(static_cast<std::size_t>(hash >> 7) & mask) {}
+
+    std::size_t base() const {
+        return offset * kGroupWidth;
+    }
+
+    void next() {
+        step += 1;
+        offset = (offset + step) & mask;
+    }
+
+    std::size_t mask;
+    std::size_t offset;
+    std::size_t step = 0;
+};
+
+std::size_t atom_slot(const GcAtomTable &table, const std::uint8_t *data, std::size_t len, std::uint64_t hash) {
+    std::size_t mask = table.slots.size() - 1;
+    for (std::size_t slot = static_cast<std::size_t>(hash) & mask;; slot = (slot + 1) & mask) {
+        const GcString *atom = table.slots[slot];
+        if (!atom ||
+            (atom->hash == hash && atom->len == len && (len == 0 || std::memcmp(atom->data8, data, len) == 0))) {
+            return slot;
+        }
+    }
+}
+
+void rehash_atoms(GcAtomTable &table, std::size_t slot_count) {
+    std::vector<GcString *> old(slot_count, nullptr);
+    old.swap(table.slots);
+    for (GcString *atom : old) {
+        if (atom) {
+            table.slots[atom_slot(table, atom->data8, atom->len, atom->hash)] = atom;
         }
     }
-    return true;
 }
 
-std::size_t next_pow2(std::size_t value) {
-    if (value <= 1) {
-        return 1;
+// Drops the atoms this collection is about to free, then re-probes the
+// survivors, shrinking the table once it is mostly empty.
+void sweep_atoms(GcHeap *heap) {
+    GcAtomTable &table = heap->atoms;
+    for (GcString *&atom : table.slots) {
+        if (atom && atom->hdr.mark_ != heap->live_mark) {
+            atom = nullptr;
+            table.count -= 1;
+        }
     }
-    std::size_t result = 1;
-    while (result < value) {
-        result <<= 1;
+    std::size_t slot_count = table.slots.size();
+    while (slot_count > kMinAtomSlots && table.count * 8 < slot_count) {
+        slot_count /= 2;
     }
-    return result;
+    rehash_atoms(table, slot_count);
 }
 
-std::size_t bucket_count_for_entries(std::size_t entry_capacity) {
-    if (entry_capacity == 0) {
+std::size_t size_class_of(std::size_t size) {
+    if (size == 0 || size > kGcSizeClasses * kGcSizeClassBytes) {
         return 0;
     }
-    std::size_t needed =
-        (entry_capacity * kMaxLoadDenominator + kMaxLoadNumerator - 1) / kMaxLoadNumerator;
-    if (needed < kMinBucketCount) {
-        needed = kMinBucketCount;
+    return (size + kGcSizeClassBytes - 1) / kGcSizeClassBytes;
+}
+
+void *heap_alloc(GcHeap *heap, std::size_t size) {
+    std::size_t size_class = size_class_of(size);
+    if (size_class == 0) {
+        return heap->alloc.alloc(size);
+    }
+    void *&head = heap->free_blocks[size_class - 1];
+    if (!head) {
+        return heap->alloc.alloc(size_class * kGcSizeClassBytes);
+    }
+    void *block = head;
+    head = *static_cast<void **>(block);
+    heap->free_bytes -= size_class * kGcSizeClassBytes;
+    return block;
+}
+
+void heap_free_class(GcHeap *heap, void *block, std::size_t size_class) {
+    std::size_t bytes = size_class * kGcSizeClassBytes;
+    if (size_class == 0 || heap->free_bytes + bytes > kMaxFreeBytes) {
+        heap->alloc.free(block);
+        return;
+    }
+    void *&head = heap->free_blocks[size_class - 1];
+    *static_cast<void **>(block) = head;
+    head = block;
+    heap->free_bytes += bytes;
+}
+
+void heap_free(GcHeap *heap, void *block, std::size_t size) {
+    heap_free_class(heap, block, size_class_of(size));
+}
+
+JsValue *inline_elems(GcArray *arr) {
+    return reinterpret_cast<JsValue *>(arr + 1);
+}
+
+GcObjectEntry *inline_entries(GcObject *obj) {
+    return reinterpret_cast<GcObjectEntry *>(obj + 1);
+}
+
+std::uint8_t *inline_ctrl(GcObject *obj) {
+    return reinterpret_cast<std::uint8_t *>(inline_entries(obj) + obj->inline_capacity);
+}
+
+std::size_t array_elem_bytes(GcArrayKind kind) {
+    return kind == GcArrayKind::Values ? sizeof(JsValue) : sizeof(std::int64_t);
+}
+
+bool array_elems_inline(GcArray *arr) {
+    return arr->inline_capacity != 0 && arr->elems == inline_elems(arr);
+}
+
+void free_elems(GcHeap *heap, GcArray *arr) {
+    if (arr->elems && !array_elems_inline(arr)) {
+        heap_free(heap, arr->elems, array_elem_bytes(arr->kind) * arr->capacity);
+    }
+}
+
+void free_entries(GcHeap *heap, GcObject *obj) {
+    if (obj->entries && (obj->inline_capacity == 0 || obj->entries != inline_entries(obj))) {
+        heap_free(heap, obj->entries, sizeof(GcObjectEntry) * obj->entry_capacity);
+    }
+}
+
+// ctrl and slots share one block, ctrl first.
+void free_table(GcHeap *heap, GcObject *obj) {
+    if (obj->ctrl && (obj->inline_capacity == 0 || obj->ctrl != inline_ctrl(obj))) {
+        heap_free(heap, obj->ctrl, kSlotBytes * obj->slot_count);
     }
-    return next_pow2(needed);
 }
 
 struct DecodedString {
@@ -212,112 +477,181 @@ void append_utf8(std::string &out, std::uint32_t codepoint) {
     }
 }
 
-int32_t find_entry_index(const GcObject *obj, const GcString *key, std::uint64_t hash) {
-    if (!obj || obj->bucket_count == 0 || !obj->buckets) {
-        return -1;
+// Compares the characters on every stored-hash match.
+std::size_t find_slot_colliding(const GcObject *obj, const GcString *key, std::uint64_t hash) {
+    std::uint8_t h2 = ctrl_h2(hash);
+    ProbeSeq seq(hash, obj->slot_count);
+    for (std::size_t probes = 0; probes <= seq.mask; ++probes, seq.next()) {
+        std::size_t base = seq.base();
+        CtrlGroup group(obj->ctrl + base);
+        for (std::uint32_t bits = group.match(h2); bits != 0; bits &= bits - 1) {
+            std::size_t slot = base + static_cast<std::size_t>(std::countr_zero(bits));
+            const GcObjectEntry &entry = obj->entries[obj->slots[slot]];
+            if (entry.hash == hash && string_equals(entry.key, key)) {
+                return slot;
+            }
+        }
+        if (group.match_empty() != 0) {
+            break;
+        }
     }
-    std::size_t bucket = static_cast<std::size_t>(hash) & obj->bucket_mask;
-    int32_t idx = obj->buckets[bucket];
-    while (idx != -1) {
-        const GcObjectEntry &entry = obj->entries[idx];
-        if (entry.occupied && entry.hash == hash && string_equals(entry.key, key)) {
-            return idx;
+    return kNoSlot;
+}
+
+// Distinct keys practically never share all 64 hash bits, so the probe
+// compares stored hashes only and checks the characters of the one entry
+// that matches; a real collision goes the slow way. Nothing is live across
+// a call, and inlining it into get/set/remove saves the call on small
+// objects.
+__attribute__((always_inline)) inline std::size_t find_slot(const GcObject *obj,
+                                                             const GcString *key,
+                                                             std::uint64_t hash) {
+    if (obj->slot_count == 0) {
+        return kNoSlot;
+    }
+    std::uint8_t h2 = ctrl_h2(hash);
+    ProbeSeq seq(hash, obj->slot_count);
+    for (std::size_t probes = 0; probes <= seq.mask; ++probes, seq.next()) {
+        std::size_t base = seq.base();
+        CtrlGroup group(obj->ctrl + base);
+        for (std::uint32_t bits = group.match(h2); bits != 0; bits &= bits - 1) {
+            std::size_t slot = base + static_cast<std::size_t>(std::countr_zero(bits));
+            const GcObjectEntry &entry = obj->entries[obj->slots[slot]];
+            if (entry.hash == hash) {
+                if (entry.key == key || string_equals(entry.key, key)) {
+                    return slot;
+                }
+                return find_slot_colliding(obj, key, hash);
+            }
+        }
+        if (group.match_empty() != 0) {
+            break;
         }
-        idx = entry.next_bucket;
     }
-    return -1;
+    return kNoSlot;
 }
 
-bool rehash_buckets(GcHeap *heap, GcObject *obj, std::size_t new_bucket_count) {
-    if (!heap || !obj) {
-        return false;
+std::size_t find_free_slot(const GcObject *obj, std::uint64_t hash) {
+    ProbeSeq seq(hash, obj->slot_count);
+    while (true) {
+        std::size_t base = seq.base();
+        std::uint32_t bits = CtrlGroup(obj->ctrl + base).match_free();
+        if (bits != 0) {
+            return base + static_cast<std::size_t>(std::countr_zero(bits));
+        }
+        seq.next();
     }
-    if (new_bucket_count == 0) {
-        return false;
+}
+
+void place_entry(GcObject *obj, std::uint64_t hash, std::size_t idx) {
+    std::size_t slot = find_free_slot(obj, hash);
+    if (obj->ctrl[slot] == kCtrlEmpty) {
+        obj->growth_left -= 1;
     }
-    auto *new_buckets =
-        static_cast<std::int32_t *>(heap->alloc.alloc(sizeof(std::int32_t) * new_bucket_count));
-    if (!new_buckets) {
-        return false;
+    obj->ctrl[slot] = ctrl_h2(hash);
+    obj->slots[slot] = static_cast<std::uint32_t>(idx);
+}
+
+// Drops tombstones, keeping insertion order. The table must be refilled.
+void compact_entries(GcObject *obj) {
+    std::size_t live = 0;
+    for (std::size_t i = 0; i < obj->entry_count; ++i) {
+        if (obj->entries[i].key) {
+            obj->entries[live++] = obj->entries[i];
+        }
     }
-    for (std::size_t i = 0; i < new_bucket_count; ++i) {
-        new_buckets[i] = -1;
+    for (std::size_t i = live; i < obj->entry_count; ++i) {
+        obj->entries[i] = GcObjectEntry{};
     }
+    obj->entry_count = live;
+}
+
+void fill_table(GcObject *obj) {
+    std::memset(obj->ctrl, kCtrlEmpty, obj->slot_count);
+    obj->growth_left = max_load(obj->slot_count);
     for (std::size_t i = 0; i < obj->entry_count; ++i) {
-        GcObjectEntry &entry = obj->entries[i];
-        if (!entry.occupied) {
-            entry.next_bucket = -1;
-            continue;
+        place_entry(obj, obj->entries[i].hash, i);
+    }
+}
+
+// Rebuilds the table with slot_count slots, compacting the entries first.
+bool rebuild_table(GcHeap *heap, GcObject *obj, std::size_t slot_count) {
+    if (slot_count != obj->slot_count) {
+        std::uint8_t *ctrl = nullptr;
+        if (obj->inline_capacity > 0 && slot_count == kGroupWidth) {
+            ctrl = inline_ctrl(obj);
+        } else {
+            ctrl = static_cast<std::uint8_t *>(heap_alloc(heap, kSlotBytes * slot_count));
+            if (!ctrl) {
+                return false;
+            }
         }
-        std::size_t bucket = static_cast<std::size_t>(entry.hash) & (new_bucket_count - 1);
-        entry.next_bucket = new_buckets[bucket];
-        new_buckets[bucket] = static_cast<std::int32_t>(i);
+        free_table(heap, obj);
+        obj->ctrl = ctrl;
+        obj->slots = reinterpret_cast<std::uint32_t *>(ctrl + slot_count);
+        obj->slot_count = slot_count;
     }
-    if (obj->buckets) {
-        heap->alloc.free(obj->buckets);
+    if (obj->entry_count != obj->size) {
+        compact_entries(obj);
     }
-    obj->buckets = new_buckets;
-    obj->bucket_count = new_bucket_count;
-    obj->bucket_mask = new_bucket_count - 1;
+    fill_table(obj);
     return true;
 }
 
+// Copies the live entries into a new array; the table must be rebuilt if
+// that dropped tombstones.
 bool grow_entries(GcHeap *heap, GcObject *obj, std::size_t new_capacity) {
     if (!heap || !obj || new_capacity == 0) {
         return false;
     }
-    auto *new_entries =
-        static_cast<GcObjectEntry *>(heap->alloc.alloc(sizeof(GcObjectEntry) * new_capacity));
+    auto *new_entries = static_cast<GcObjectEntry *>(heap_alloc(heap, sizeof(GcObjectEntry) * new_capacity));
     if (!new_entries) {
         return false;
     }
-    for (std::size_t i = 0; i < new_capacity; ++i) {
-        new_entries[i].key = nullptr;
-        new_entries[i].hash = 0;
-        new_entries[i].next_bucket = -1;
-        new_entries[i].prev_order = -1;
-        new_entries[i].next_order = -1;
-        new_entries[i].next_free = -1;
-        new_entries[i].occupied = false;
-        std::construct_at(&new_entries[i].value);
-    }
+    std::size_t live = 0;
     for (std::size_t i = 0; i < obj->entry_count; ++i) {
-        new_entries[i].key = obj->entries[i].key;
-        new_entries[i].hash = obj->entries[i].hash;
-        new_entries[i].next_bucket = obj->entries[i].next_bucket;
-        new_entries[i].prev_order = obj->entries[i].prev_order;
-        new_entries[i].next_order = obj->entries[i].next_order;
-        new_entries[i].next_free = obj->entries[i].next_free;
-        new_entries[i].occupied = obj->entries[i].occupied;
-        new_entries[i].value = std::move(obj->entries[i].value);
-    }
-    if (obj->entries) {
-        for (std::size_t i = 0; i < obj->entry_capacity; ++i) {
-            std::destroy_at(&obj->entries[i].value);
+        if (obj->entries[i].key) {
+            new_entries[live++] = obj->entries[i];
         }
-        heap->alloc.free(obj->entries);
     }
+    std::uninitialized_value_construct_n(new_entries + live, new_capacity - live);
+    free_entries(heap, obj);
     obj->entries = new_entries;
     obj->entry_capacity = new_capacity;
+    obj->entry_count = live;
     return true;
 }
 
-int32_t allocate_entry(GcObject *obj) {
-    if (!obj) {
-        return -1;
+// Makes room for expected members. Appending into a full entry array
+// compacts it when at least a quarter is tombstones and doubles it
+// otherwise; the table doubles past 7/8 load and is rebuilt in place once
+// deleted slots use up its growth.
+bool reserve_members(GcHeap *heap, GcObject *obj, std::size_t expected) {
+    std::size_t appended = expected > obj->size ? expected - obj->size : 0;
+    bool rebuild = false;
+    if (obj->entry_count + appended > obj->entry_capacity) {
+        std::size_t tombstones = obj->entry_count - obj->size;
+        if (expected > obj->entry_capacity || tombstones * 4 < obj->entry_capacity) {
+            std::size_t new_capacity = obj->entry_capacity == 0 ? expected : obj->entry_capacity * 2;
+            while (new_capacity < expected) {
+                new_capacity *= 2;
+            }
+            if (!grow_entries(heap, obj, new_capacity)) {
+                return false;
+            }
+        }
+        // Without tombstones the entries keep their indices and the table
+        // stays valid.
+        rebuild = tombstones > 0;
     }
-    if (obj->free_head != -1) {
-        int32_t idx = obj->free_head;
-        obj->free_head = obj->entries[idx].next_free;
-        obj->entries[idx].next_free = -1;
-        return idx;
+    std::size_t slot_count = obj->slot_count;
+    if (slot_count == 0 || max_load(slot_count) < expected) {
+        slot_count = slot_count_for(expected);
     }
-    if (obj->entry_count >= obj->entry_capacity) {
-        return -1;
+    if (rebuild || slot_count != obj->slot_count || obj->growth_left < appended) {
+        return rebuild_table(heap, obj, slot_count);
     }
-    int32_t idx = static_cast<int32_t>(obj->entry_count);
-    obj->entry_count += 1;
-    return idx;
+    return true;
 }
 
 JsValue make_heap_string_value(GcString *str) {
@@ -355,10 +689,12 @@ bool build_object_snapshot(GcHeap *heap, GcIterator *iter, const GcObject *obj)
     iter->snapshot_index = 0;
     iter->snapshot_size = 0;
     iter->snapshot_keys = nullptr;
+    // Entries keep their seq through compaction, so the members not yet
+    // visited are exactly the live ones past last_seq.
     std::size_t count = 0;
-    for (int32_t cursor = iter->cursor; cursor != -1; cursor = obj->entries[cursor].next_order) {
-        const GcObjectEntry &entry = obj->entries[cursor];
-        if (entry.occupied && entry.key) {
+    for (std::size_t i = 0; i < obj->entry_count; ++i) {
+        const GcObjectEntry &entry = obj->entries[i];
+        if (entry.key && entry.seq > iter->last_seq) {
             count += 1;
         }
     }
@@ -370,9 +706,9 @@ bool build_object_snapshot(GcHeap *heap, GcIterator *iter, const GcObject *obj)
         return false;
     }
     std::size_t idx = 0;
-    for (int32_t cursor = iter->cursor; cursor != -1; cursor = obj->entries[cursor].next_order) {
-        const GcObjectEntry &entry = obj->entries[cursor];
-        if (entry.occupied && entry.key) {
+    for (std::size_t i = 0; i < obj->entry_count; ++i) {
+        const GcObjectEntry &entry = obj->entries[i];
+        if (entry.key && entry.seq > iter->last_seq) {
             keys[idx++] = entry.key;
         }
     }
@@ -381,8 +717,10 @@ bool build_object_snapshot(GcHeap *heap, GcIterator *iter, const GcObject *obj)
     return true;
 }
 
+// size covers the cell and whatever it keeps inline; it is also what the
+// cell counts towards the heap, saturated at 4 GiB.
 GcHeader *gc_alloc_raw(GcHeap *heap, std::size_t size, GcKind kind) {
-    void *mem = heap->alloc.alloc(size);
+    void *mem = heap_alloc(heap, size);
     if (!mem) {
         return nullptr;
     }
@@ -390,19 +728,192 @@ GcHeader *gc_alloc_raw(GcHeap *heap, std::size_t size, GcKind kind) {
     hdr->next = nullptr;
     hdr->mark_ = flip_mark(heap->live_mark);
     hdr->kind = kind;
-    hdr->size_ = static_cast<std::uint32_t>(size);
+    hdr->size_class = static_cast<std::uint16_t>(size_class_of(size));
+    hdr->size_ = static_cast<std::uint32_t>(std::min<std::size_t>(size, std::numeric_limits<std::uint32_t>::max()));
     return hdr;
 }
 
+// Releases a cell that was never linked.
+void gc_free_raw(GcHeap *heap, GcHeader *hdr) {
+    heap_free_class(heap, hdr, hdr->size_class);
+}
+
+// An owned string of len code units with storage inline, NUL-terminated.
+GcString *gc_alloc_string(GcHeap *heap, std::size_t len, GcStringEncoding encoding) {
+    std::size_t unit = encoding == GcStringEncoding::Byte ? sizeof(std::uint8_t) : sizeof(char16_t);
+    if (len >= (std::numeric_limits<std::size_t>::max() - sizeof(GcString)) / unit) {
+        return nullptr;
+    }
+    auto *hdr = gc_alloc_raw(heap, sizeof(GcString) + unit * (len + 1), GcKind::String);
+    if (!hdr) {
+        return nullptr;
+    }
+    auto *str = reinterpret_cast<GcString *>(hdr);
+    str->len = len;
+    str->encoding = encoding;
+    str->hash = 0;
+    str->hash_valid = false;
+    str->owner = nullptr;
+    if (encoding == GcStringEncoding::Byte) {
+        str->data8 = reinterpret_cast<std::uint8_t *>(str + 1);
+        str->data8[len] = 0;
+    } else {
+        str->data16 = reinterpret_cast<char16_t *>(str + 1);
+        str->data16[len] = 0;
+    }
+    return str;
+}
+
+GcStringBuffer *gc_alloc_string_buffer(GcHeap *heap, std::size_t capacity, GcStringEncoding encoding) {
+    std::size_t unit = encoding == GcStringEncoding::Byte ? sizeof(std::uint8_t) : sizeof(char16_t);
+    if (capacity >= (std::numeric_limits<std::size_t>::max() - sizeof(GcStringBuffer)) / unit) {
+        return nullptr;
+    }
+    auto *hdr = gc_alloc_raw(heap, sizeof(GcStringBuffer) + unit * capacity, GcKind::StringBuffer);
+    if (!hdr) {
+        return nullptr;
+    }
+    auto *buf = reinterpret_cast<GcStringBuffer *>(hdr);
+    buf->encoding = encoding;
+    buf->capacity = capacity;
+    buf->used = 0;
+    buf->data8 = reinterpret_cast<std::uint8_t *>(buf + 1);
+    return buf;
+}
+
+// The buffer prefix ends, if appending to prefix may write in place.
+GcStringBuffer *extensible_buffer(const GcString *prefix) {
+    if (!prefix || !prefix->owner || prefix->owner->kind != GcKind::StringBuffer) {
+        return nullptr;
+    }
+    auto *buf = reinterpret_cast<GcStringBuffer *>(prefix->owner);
+    if (buf->data8 != prefix->data8 || buf->used != prefix->len) {
+        return nullptr;
+    }
+    return buf;
+}
+
+// Copies str's code units to dst, widening them when dst is UTF-16.
+void copy_units(void *dst, GcStringEncoding encoding, const GcString *str) {
+    if (!str || str->len == 0) {
+        return;
+    }
+    if (encoding == GcStringEncoding::Byte) {
+        std::memcpy(dst, str->data8, str->len);
+    } else if (str->encoding == GcStringEncoding::Utf16) {
+        std::memcpy(dst, str->data16, sizeof(char16_t) * str->len);
+    } else {
+        auto *out = static_cast<char16_t *>(dst);
+        for (std::size_t i = 0; i < str->len; ++i) {
+            out[i] = str->data8[i];
+        }
+    }
+}
+
 void gc_link(GcHeap *heap, GcHeader *hdr) {
     hdr->next = heap->head;
     heap->head = hdr;
+    if (++heap->top_cells == kGcSegmentCells) {
+        heap->segments.push_back({hdr, heap->top_cells});
+        heap->top_cells = 0;
+    }
     heap->bytes += hdr->size_;
+    heap->allocated += hdr->size_;
+    GcKindStats &kind = heap->stats.kinds[static_cast<std::size_t>(hdr->kind)];
+    ++kind.allocated_cells;
+    kind.allocated_bytes += hdr->size_;
+    heap->stats.peak_bytes = std::max(heap->stats.peak_bytes, heap->bytes);
 }
 
-void gc_mark_obj(GcHeap *heap, GcHeader *obj);
+// A string borrowing the first len code units of buf.
+GcString *borrow_buffer(GcHeap *heap, GcStringBuffer *buf, std::size_t len) {
+    auto *hdr = gc_alloc_raw(heap, sizeof(GcString), GcKind::String);
+    if (!hdr) {
+        return nullptr;
+    }
+    auto *str = reinterpret_cast<GcString *>(hdr);
+    str->len = len;
+    str->encoding = buf->encoding;
+    str->hash = 0;
+    str->hash_valid = false;
+    str->owner = &buf->hdr;
+    str->data8 = buf->data8;
+    gc_link(heap, hdr);
+    return str;
+}
 
-void gc_mark_value(GcHeap *heap, const JsValue &value) {
+GcString *buffered_string(GcHeap *heap, const GcString *prefix, std::size_t len, std::size_t capacity,
+                          GcStringEncoding encoding) {
+    GcStringBuffer *buf = gc_alloc_string_buffer(heap, capacity, encoding);
+    if (!buf) {
+        return nullptr;
+    }
+    copy_units(buf->data8, encoding, prefix);
+    buf->used = len;
+    gc_link(heap, &buf->hdr);
+    return borrow_buffer(heap, buf, len);
+}
+
+void gc_note_static(GcHeap *heap, const GcHeader *obj) {
+    // Regions do not overlap: only the last one starting at or below obj
+    // can hold it.
+    auto *ptr = reinterpret_cast<const std::uint8_t *>(obj);
+    auto &orphans = heap->static_orphans;
+    auto it = std::upper_bound(orphans.begin(), orphans.end(), ptr, [](const std::uint8_t *p, const GcStaticPin *pin) {
+        return p < pin->region->base;
+    });
+    if (it == orphans.begin()) {
+        return;
+    }
+    GcStaticPin *pin = *(it - 1);
+    if (!pin->seen && pin->region->contains(obj)) {
+        pin->seen = true;
+    }
+}
+
+// Marks cells live and queues them for scan_cell. Marking is iterative, so
+// deeply nested values cannot overflow the stack.
+struct SerialMarker {
+    GcHeap *heap;
+    std::vector<GcHeader *> &stack;
+
+    void push(GcHeader *obj) {
+        if (!obj || obj->mark_ == heap->live_mark) {
+            return;
+        }
+        if (obj->mark_ == GcMark::GcMark_Static) {
+            if (heap->static_scan) {
+                gc_note_static(heap, obj);
+            }
+            return;
+        }
+        obj->mark_ = heap->live_mark;
+        stack.push_back(obj);
+    }
+};
+
+// The same for several threads: whoever flips a cell's mark scans it.
+// Static regions are not tracked, so heaps with orphan pins mark serially.
+struct SharedMarker {
+    GcMark live_mark;
+    std::vector<GcHeader *> &stack;
+
+    void push(GcHeader *obj) {
+        if (!obj) {
+            return;
+        }
+        std::atomic_ref<GcMark> mark(obj->mark_);
+        GcMark seen = mark.load(std::memory_order_relaxed);
+        if (seen == live_mark || seen == GcMark::GcMark_Static ||
+            !mark.compare_exchange_strong(seen, live_mark, std::memory_order_relaxed)) {
+            return;
+        }
+        stack.push_back(obj);
+    }
+};
+
+template <typename Marker>
+void mark_value(Marker &marker, const JsValue &value) {
     switch (value.type_) {
         case JsNodeType::HeapString:
         case JsNodeType::HeapBinary:
@@ -410,119 +921,194 @@ void gc_mark_value(GcHeap *heap, const JsValue &value) {
         case JsNodeType::Object:
         case JsNodeType::Exception:
         case JsNodeType::Interator:
-            if (value.gc) {
-                gc_mark_obj(heap, value.gc);
-            }
+        case JsNodeType::LazyJson:
+            marker.push(value.gc);
             break;
         default:
             break;
     }
 }
 
-void gc_mark_obj(GcHeap *heap, GcHeader *obj) {
-    if (!obj || obj->mark_ == heap->live_mark) {
-        return;
-    }
-    obj->mark_ = heap->live_mark;
+template <typename Marker>
+void scan_cell(Marker &marker, GcHeader *obj) {
     switch (obj->kind) {
-        case GcKind::String:
+        case GcKind::String: {
+            auto *str = reinterpret_cast<GcString *>(obj);
+            marker.push(str->owner);
             break;
+        }
         case GcKind::Binary:
+        case GcKind::Buffer:
+        case GcKind::StringBuffer:
             break;
         case GcKind::Array: {
             auto *arr = reinterpret_cast<GcArray *>(obj);
+            if (arr->kind != GcArrayKind::Values) {
+                break;
+            }
             for (std::size_t i = 0; i < arr->size; ++i) {
-                gc_mark_value(heap, arr->elems[i]);
+                mark_value(marker, arr->elems[i]);
             }
             break;
         }
         case GcKind::Object: {
             auto *objv = reinterpret_cast<GcObject *>(obj);
-            int32_t cursor = objv->head;
-            while (cursor != -1) {
-                const GcObjectEntry &entry = objv->entries[cursor];
+            for (std::size_t i = 0; i < objv->entry_count; ++i) {
+                const GcObjectEntry &entry = objv->entries[i];
                 if (entry.key) {
-                    gc_mark_obj(heap, &entry.key->hdr);
+                    marker.push(&entry.key->hdr);
+                    mark_value(marker, entry.value);
                 }
-                gc_mark_value(heap, entry.value);
-                cursor = entry.next_order;
             }
             break;
         }
         case GcKind::Exception: {
             auto *exc = reinterpret_cast<GcException *>(obj);
             if (exc->name) {
-                gc_mark_obj(heap, &exc->name->hdr);
+                marker.push(&exc->name->hdr);
             }
             if (exc->message) {
-                gc_mark_obj(heap, &exc->message->hdr);
+                marker.push(&exc->message->hdr);
             }
-            gc_mark_value(heap, exc->meta);
+            mark_value(marker, exc->meta);
             break;
         }
         case GcKind::Iterator: {
             auto *iter = reinterpret_cast<GcIterator *>(obj);
             if (iter->array) {
-                gc_mark_obj(heap, &iter->array->hdr);
+                marker.push(&iter->array->hdr);
             }
             if (iter->object) {
-                gc_mark_obj(heap, &iter->object->hdr);
+                marker.push(&iter->object->hdr);
             }
             if (iter->has_current) {
-                gc_mark_value(heap, iter->current_key);
-                gc_mark_value(heap, iter->current_value);
+                mark_value(marker, iter->current_key);
+                mark_value(marker, iter->current_value);
             }
             for (std::size_t i = 0; i < iter->snapshot_size; ++i) {
                 if (iter->snapshot_keys && iter->snapshot_keys[i]) {
-                    gc_mark_obj(heap, &iter->snapshot_keys[i]->hdr);
+                    marker.push(&iter->snapshot_keys[i]->hdr);
                 }
             }
             break;
         }
+        case GcKind::LazyJson: {
+            auto *lazy = reinterpret_cast<GcLazyJson *>(obj);
+            mark_value(marker, lazy->forced);
+            if (lazy->root != lazy) {
+                marker.push(&lazy->root->hdr);
+                break;
+            }
+            for (const auto &cell : lazy->doc->cells) {
+                marker.push(&cell.second->hdr);
+            }
+            break;
+        }
     }
 }
 
-void gc_free_obj(GcHeap *heap, GcHeader *obj) {
-    switch (obj->kind) {
-        case GcKind::String: {
-            auto *str = reinterpret_cast<GcString *>(obj);
-            if (str->encoding == GcStringEncoding::Utf16) {
-                if (str->data16) {
-                    heap->alloc.free(str->data16);
+void gc_mark_value(GcHeap *heap, const JsValue &value) {
+    SerialMarker marker{heap, heap->mark_stack};
+    mark_value(marker, value);
+}
+
+void drain_marks(GcHeap *heap) {
+    SerialMarker marker{heap, heap->mark_stack};
+    while (!heap->mark_stack.empty()) {
+        GcHeader *obj = heap->mark_stack.back();
+        heap->mark_stack.pop_back();
+        scan_cell(marker, obj);
+    }
+}
+
+constexpr std::size_t kMarkChunk = 256;
+
+// Marking on every thread of a GcWorkers job. Each thread drains a stack of
+// its own and hands half of it over while another thread is out of work;
+// marking is done once every thread waits and nothing is left over.
+class ParallelMark {
+public:
+    ParallelMark(GcHeap *heap, std::size_t threads) : heap_(heap), threads_(threads) {
+        std::vector<GcHeader *> &roots = heap->mark_stack;
+        for (std::size_t i = 0; i < roots.size(); i += kMarkChunk) {
+            std::size_t end = std::min(roots.size(), i + kMarkChunk);
+            chunks_.emplace_back(roots.begin() + static_cast<std::ptrdiff_t>(i),
+                                 roots.begin() + static_cast<std::ptrdiff_t>(end));
+        }
+        roots.clear();
+    }
+
+    void work() {
+        std::vector<GcHeader *> stack;
+        SharedMarker marker{heap_->live_mark, stack};
+        while (take(stack)) {
+            while (!stack.empty()) {
+                GcHeader *obj = stack.back();
+                stack.pop_back();
+                scan_cell(marker, obj);
+                if (stack.size() > 1 && hungry_.load(std::memory_order_relaxed) > 0) {
+                    share(stack);
                 }
-            } else if (str->data8) {
-                heap->alloc.free(str->data8);
             }
-            break;
         }
-        case GcKind::Binary: {
-            auto *bin = reinterpret_cast<GcBinary *>(obj);
-            if (bin->data) {
-                heap->alloc.free(bin->data);
-            }
-            break;
+    }
+
+private:
+    void share(std::vector<GcHeader *> &stack) {
+        auto half = stack.begin() + static_cast<std::ptrdiff_t>(stack.size() / 2);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            chunks_.emplace_back(stack.begin(), half);
         }
-        case GcKind::Array: {
-            auto *arr = reinterpret_cast<GcArray *>(obj);
-            if (arr->elems) {
-                for (std::size_t i = 0; i < arr->capacity; ++i) {
-                    std::destroy_at(&arr->elems[i]);
-                }
-                heap->alloc.free(arr->elems);
+        stack.erase(stack.begin(), half);
+        ready_.notify_one();
+    }
+
+    bool take(std::vector<GcHeader *> &stack) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++idle_;
+        hungry_.fetch_add(1, std::memory_order_relaxed);
+        while (chunks_.empty() && !done_) {
+            if (idle_ == threads_) {
+                done_ = true;
+                ready_.notify_all();
+                break;
             }
-            break;
+            ready_.wait(lock);
+        }
+        hungry_.fetch_sub(1, std::memory_order_relaxed);
+        if (chunks_.empty()) {
+            return false;
         }
+        --idle_;
+        stack = std::move(chunks_.back());
+        chunks_.pop_back();
+        return true;
+    }
+
+    GcHeap *heap_;
+    std::size_t threads_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<std::vector<GcHeader *>> chunks_;
+    std::size_t idle_ = 0;
+    bool done_ = false;
+    std::atomic<std::size_t> hungry_{0};
+};
+
+void gc_free_obj(GcHeap *heap, GcHeader *obj) {
+    switch (obj->kind) {
+        case GcKind::String:
+        case GcKind::Binary:
+        case GcKind::StringBuffer:
+            break;
+        case GcKind::Array:
+            free_elems(heap, reinterpret_cast<GcArray *>(obj));
+            break;
         case GcKind::Object: {
             auto *objv = reinterpret_cast<GcObject *>(obj);
-            if (objv->entries) {
-                for (std::size_t i = 0; i < objv->entry_capacity; ++i) {
-                    std::destroy_at(&objv->entries[i].value);
-                }
-                heap->alloc.free(objv->entries);
-            }
-            if (objv->buckets) {
-                heap->alloc.free(objv->buckets);
-            }
+            free_entries(heap, objv);
+            free_table(heap, objv);
             break;
         }
         case GcKind::Exception: {
@@ -539,127 +1125,452 @@ void gc_free_obj(GcHeap *heap, GcHeader *obj) {
             std::destroy_at(&iter->current_value);
             break;
         }
+        case GcKind::LazyJson: {
+            auto *lazy = reinterpret_cast<GcLazyJson *>(obj);
+            std::destroy_at(&lazy->doc);
+            std::destroy_at(&lazy->forced);
+            break;
+        }
+        case GcKind::Buffer: {
+            auto *buf = reinterpret_cast<GcBuffer *>(obj);
+            std::destroy_at(&buf->bytes);
+            break;
+        }
     }
+    GcKindStats &kind = heap->stats.kinds[static_cast<std::size_t>(obj->kind)];
+    ++kind.freed_cells;
+    kind.freed_bytes += obj->size_;
     heap->bytes -= obj->size_;
-    heap->alloc.free(obj);
+    gc_free_raw(heap, obj);
+}
+
+// A region owned only by heap pins can stay alive just through values still
+// reachable from those heaps; find ours while marking.
+void gc_begin_static_scan(GcHeap *heap) {
+    auto &orphans = heap->static_orphans;
+    orphans.clear();
+    for (auto &pin : heap->static_pins) {
+        pin.orphan = static_cast<std::size_t>(pin.region.use_count()) <= pin.region->pins.load();
+        pin.seen = false;
+        if (pin.orphan) {
+            orphans.push_back(&pin);
+        }
+    }
+    std::sort(orphans.begin(), orphans.end(), [](const GcStaticPin *lhs, const GcStaticPin *rhs) {
+        return lhs->region->base < rhs->region->base;
+    });
+    heap->static_scan = !orphans.empty();
+}
+
+void gc_end_static_scan(GcHeap *heap) {
+    if (!heap->static_scan) {
+        return;
+    }
+    heap->static_orphans.clear();
+    std::erase_if(heap->static_pins, [heap](const GcStaticPin &pin) {
+        if (!pin.orphan || pin.seen) {
+            return false;
+        }
+        heap->static_pinned.erase(pin.region.get());
+        return true;
+    });
+    heap->static_scan = false;
+}
+
+std::uint64_t gc_now_ns() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+// A collection is gc_begin_collect, marking from every root, then
+// gc_finish_collect to sweep what was not reached.
+void gc_begin_collect(GcHeap *heap) {
+    heap->collect_start_ns = gc_now_ns();
+    heap->collect_start_bytes = heap->bytes;
+    heap->live_mark = flip_mark(heap->live_mark);
+    gc_begin_static_scan(heap);
+}
+
+// The cells of one segment, from first up to end, split into the live ones,
+// relinked from live_first to live_last, and the dead ones chained on dead.
+struct SweepRun {
+    GcHeader *first = nullptr;
+    GcHeader *end = nullptr;
+    GcHeader *live_first = nullptr;
+    GcHeader *live_last = nullptr;
+    std::size_t live = 0;
+    GcHeader *dead = nullptr;
+};
+
+void sweep_run(GcMark live_mark, SweepRun &run) {
+    for (GcHeader *cell = run.first; cell != run.end;) {
+        GcHeader *next = cell->next;
+        if (cell->mark_ == live_mark) {
+            if (run.live_last) {
+                run.live_last->next = cell;
+            } else {
+                run.live_first = cell;
+            }
+            run.live_last = cell;
+            ++run.live;
+        } else {
+            cell->next = run.dead;
+            run.dead = cell;
+        }
+        cell = next;
+    }
+}
+
+// Sweeps each segment on its own, on the workers' threads if parallel, then
+// stitches the survivors back together and frees the rest on this thread.
+void sweep_segments(GcHeap *heap, bool parallel) {
+    std::vector<SweepRun> runs;
+    runs.reserve(heap->segments.size() + 1);
+    runs.push_back({heap->head, heap->segments.empty() ? nullptr : heap->segments.back().first});
+    for (std::size_t i = heap->segments.size(); i > 0; --i) {
+        runs.push_back({heap->segments[i - 1].first, i > 1 ? heap->segments[i - 2].first : nullptr});
+    }
+    GcMark live_mark = heap->live_mark;
+    if (parallel && runs.size() > 1) {
+        std::atomic<std::size_t> next{0};
+        heap->workers->run([&](std::size_t) {
+            for (std::size_t i = next.fetch_add(1); i < runs.size(); i = next.fetch_add(1)) {
+                sweep_run(live_mark, runs[i]);
+            }
+        });
+    } else {
+        for (SweepRun &run : runs) {
+            sweep_run(live_mark, run);
+        }
+    }
+
+    heap->head = nullptr;
+    GcHeader *last = nullptr;
+    for (SweepRun &run : runs) {
+        if (!run.live_first) {
+            continue;
+        }
+        if (last) {
+            last->next = run.live_first;
+        } else {
+            heap->head = run.live_first;
+        }
+        last = run.live_last;
+    }
+    if (last) {
+        last->next = nullptr;
+    }
+    // Runs that shrank fold into their older neighbour.
+    heap->segments.clear();
+    heap->top_cells = 0;
+    for (std::size_t i = runs.size(); i > 0; --i) {
+        const SweepRun &run = runs[i - 1];
+        if (!run.live_first) {
+            continue;
+        }
+        if (!heap->segments.empty() && heap->segments.back().cells + run.live <= kGcSegmentCells) {
+            heap->segments.back().first = run.live_first;
+            heap->segments.back().cells += run.live;
+        } else {
+            heap->segments.push_back({run.live_first, run.live});
+        }
+    }
+
+    for (SweepRun &run : runs) {
+        for (GcHeader *cell = run.dead; cell;) {
+            GcHeader *next = cell->next;
+            gc_free_obj(heap, cell);
+            cell = next;
+        }
+    }
+}
+
+void gc_record_collection(GcHeap *heap) {
+    GcStats &stats = heap->stats;
+    std::uint64_t pause = gc_now_ns() - heap->collect_start_ns;
+    ++stats.collections;
+    stats.pause_ns += pause;
+    stats.max_pause_ns = std::max(stats.max_pause_ns, pause);
+    std::size_t bucket = std::min<std::size_t>(std::bit_width(pause / 1000), kGcPauseBuckets - 1);
+    ++stats.pauses[bucket];
+    stats.collected_bytes += heap->collect_start_bytes;
+    stats.survived_bytes += heap->bytes;
+
+    const GcThresholdPolicy &policy = heap->threshold_policy;
+    if (!policy.adaptive) {
+        return;
+    }
+    double survival = heap->collect_start_bytes == 0
+                          ? 0.0
+                          : static_cast<double>(heap->bytes) / static_cast<double>(heap->collect_start_bytes);
+    double next = static_cast<double>(heap->bytes) * (policy.base_growth + policy.survival_growth * survival);
+    next = std::clamp(next, static_cast<double>(policy.min_threshold), static_cast<double>(policy.max_threshold));
+    heap->threshold = static_cast<std::size_t>(next);
+}
+
+void gc_finish_collect(GcHeap *heap) {
+    bool parallel = heap->workers && heap->bytes >= heap->parallel_bytes;
+    if (parallel && !heap->static_scan && !heap->mark_stack.empty()) {
+        ParallelMark mark(heap, heap->workers->size());
+        heap->workers->run([&](std::size_t) {
+            mark.work();
+        });
+    }
+    drain_marks(heap);
+    gc_end_static_scan(heap);
+    if (heap->atoms.count > 0) {
+        sweep_atoms(heap);
+    }
+    sweep_segments(heap, parallel);
+    gc_record_collection(heap);
+}
+
+constexpr std::size_t kStaticAlign = alignof(std::max_align_t);
+
+std::size_t static_align(std::size_t size) {
+    return (size + kStaticAlign - 1) & ~(kStaticAlign - 1);
+}
+
+void *gc_static_alloc(GcStaticRegion *region, std::size_t size) {
+    std::size_t aligned = static_align(size);
+    if (!region->base || region->capacity - region->used < aligned) {
+        return nullptr;
+    }
+    void *mem = region->base + region->used;
+    region->used += aligned;
+    return mem;
+}
+
+GcHeader *gc_static_alloc_raw(GcStaticRegion *region, std::size_t size, GcKind kind) {
+    void *mem = gc_static_alloc(region, size);
+    if (!mem) {
+        return nullptr;
+    }
+    auto *hdr = static_cast<GcHeader *>(mem);
+    hdr->next = nullptr;
+    hdr->mark_ = GcMark::GcMark_Static;
+    hdr->kind = kind;
+    hdr->size_class = 0;
+    hdr->size_ = static_cast<std::uint32_t>(size);
+    return hdr;
 }
 
 } // namespace
 
 GcString *gc_new_string_bytes(GcHeap *heap, const std::uint8_t *data, std::size_t len) {
-    auto *hdr = gc_alloc_raw(heap, sizeof(GcString), GcKind::String);
-    if (!hdr) {
+    if (len > 0 && !data) {
         return nullptr;
     }
-    auto *str = reinterpret_cast<GcString *>(hdr);
-    str->len = len;
-    str->encoding = GcStringEncoding::Byte;
-    str->hash = 0;
-    str->hash_valid = false;
-    str->data8 = nullptr;
-    if (len > 0 && !data) {
-        heap->alloc.free(str);
+    GcString *str = gc_alloc_string(heap, len, GcStringEncoding::Byte);
+    if (!str) {
         return nullptr;
     }
     if (len > 0) {
-        str->data8 = static_cast<std::uint8_t *>(heap->alloc.alloc(len + 1));
-        if (!str->data8) {
-            heap->alloc.free(str);
-            return nullptr;
-        }
         std::memcpy(str->data8, data, len);
-        str->data8[len] = 0;
     }
-    gc_link(heap, hdr);
+    gc_link(heap, &str->hdr);
     return str;
 }
 
 GcString *gc_new_string_bytes_uninit(GcHeap *heap, std::size_t len) {
-    auto *hdr = gc_alloc_raw(heap, sizeof(GcString), GcKind::String);
-    if (!hdr) {
+    GcString *str = gc_alloc_string(heap, len, GcStringEncoding::Byte);
+    if (!str) {
+        return nullptr;
+    }
+    gc_link(heap, &str->hdr);
+    return str;
+}
+
+GcString *gc_new_string_utf16(GcHeap *heap, const char16_t *data, std::size_t len) {
+    if (len > 0 && !data) {
+        return nullptr;
+    }
+    GcString *str = gc_alloc_string(heap, len, GcStringEncoding::Utf16);
+    if (!str) {
         return nullptr;
     }
-    auto *str = reinterpret_cast<GcString *>(hdr);
-    str->len = len;
-    str->encoding = GcStringEncoding::Byte;
-    str->hash = 0;
-    str->hash_valid = false;
-    str->data8 = nullptr;
     if (len > 0) {
-        str->data8 = static_cast<std::uint8_t *>(heap->alloc.alloc(len + 1));
-        if (!str->data8) {
-            heap->alloc.free(str);
+        std::memcpy(str->data16, data, sizeof(char16_t) * len);
+    }
+    gc_link(heap, &str->hdr);
+    return str;
+}
+
+GcString *gc_new_string_utf16_uninit(GcHeap *heap, std::size_t len) {
+    GcString *str = gc_alloc_string(heap, len, GcStringEncoding::Utf16);
+    if (!str) {
+        return nullptr;
+    }
+    gc_link(heap, &str->hdr);
+    return str;
+}
+
+GcString *gc_new_string(GcHeap *heap, const char *data, std::size_t len) {
+    if (len > 0 && !data) {
+        return nullptr;
+    }
+    Utf8ScanResult scan;
+    if (len > 0 && !utf8_scan(data, len, scan)) {
+        return nullptr;
+    }
+    if (scan.all_byte) {
+        if (scan.utf16_len == len) {
+            return gc_new_string_bytes(heap, reinterpret_cast<const std::uint8_t *>(data), len);
+        }
+        GcString *str = gc_new_string_bytes_uninit(heap, scan.utf16_len);
+        if (str && !utf8_write_bytes(data, len, str->data8, scan.utf16_len)) {
             return nullptr;
         }
-        str->data8[len] = 0;
+        return str;
+    }
+    GcString *str = gc_new_string_utf16_uninit(heap, scan.utf16_len);
+    if (str && !utf8_write_utf16(data, len, str->data16, scan.utf16_len)) {
+        return nullptr;
     }
-    gc_link(heap, hdr);
     return str;
 }
 
-GcString *gc_new_string_utf16(GcHeap *heap, const char16_t *data, std::size_t len) {
+GcString *gc_new_string_slice(GcHeap *heap, const GcString *parent, std::size_t start, std::size_t len) {
+    constexpr std::size_t kMinSlice = 32;
+    if (!parent || start > parent->len || len > parent->len - start) {
+        return nullptr;
+    }
+    bool byte = parent->encoding == GcStringEncoding::Byte;
+    if (len < kMinSlice || len < parent->len / 4) {
+        if (byte) {
+            return gc_new_string_bytes(heap, parent->data8 + start, len);
+        }
+        return gc_new_string_utf16(heap, parent->data16 + start, len);
+    }
     auto *hdr = gc_alloc_raw(heap, sizeof(GcString), GcKind::String);
     if (!hdr) {
         return nullptr;
     }
     auto *str = reinterpret_cast<GcString *>(hdr);
     str->len = len;
-    str->encoding = GcStringEncoding::Utf16;
+    str->encoding = parent->encoding;
     str->hash = 0;
     str->hash_valid = false;
-    str->data16 = nullptr;
-    if (len > 0 && !data) {
-        heap->alloc.free(str);
-        return nullptr;
-    }
-    if (len > 0) {
-        str->data16 = static_cast<char16_t *>(heap->alloc.alloc(sizeof(char16_t) * (len + 1)));
-        if (!str->data16) {
-            heap->alloc.free(str);
-            return nullptr;
-        }
-        std::memcpy(str->data16, data, sizeof(char16_t) * len);
-        str->data16[len] = 0;
+    str->owner = parent->owner ? parent->owner : const_cast<GcHeader *>(&parent->hdr);
+    if (byte) {
+        str->data8 = parent->data8 + start;
+    } else {
+        str->data16 = parent->data16 + start;
     }
     gc_link(heap, hdr);
     return str;
 }
 
-GcString *gc_new_string_utf16_uninit(GcHeap *heap, std::size_t len) {
+GcString *gc_new_string_borrowed(GcHeap *heap, GcHeader *owner, const char *data, std::size_t len) {
+    if (!owner || (len > 0 && !data)) {
+        return nullptr;
+    }
     auto *hdr = gc_alloc_raw(heap, sizeof(GcString), GcKind::String);
     if (!hdr) {
         return nullptr;
     }
     auto *str = reinterpret_cast<GcString *>(hdr);
     str->len = len;
-    str->encoding = GcStringEncoding::Utf16;
+    str->encoding = GcStringEncoding::Byte;
     str->hash = 0;
     str->hash_valid = false;
-    str->data16 = nullptr;
-    if (len > 0) {
-        str->data16 = static_cast<char16_t *>(heap->alloc.alloc(sizeof(char16_t) * (len + 1)));
-        if (!str->data16) {
-            heap->alloc.free(str);
-            return nullptr;
-        }
-        str->data16[len] = 0;
-    }
+    str->owner = owner;
+    str->data8 = reinterpret_cast<std::uint8_t *>(const_cast<char *>(data));
     gc_link(heap, hdr);
     return str;
 }
 
-GcString *gc_new_string(GcHeap *heap, const char *data, std::size_t len) {
-    if (len > 0 && !data) {
+GcString *gc_string_extend(GcHeap *heap, const GcString *prefix, std::size_t extra, GcStringEncoding encoding) {
+    std::size_t len = prefix ? prefix->len : 0;
+    if (extra > std::numeric_limits<std::size_t>::max() - len) {
         return nullptr;
     }
-    DecodedString decoded;
-    if (len > 0 && !decode_utf8(data, len, decoded)) {
-        return nullptr;
+    if (prefix && prefix->encoding == GcStringEncoding::Utf16) {
+        encoding = GcStringEncoding::Utf16;
+    }
+    std::size_t total = len + extra;
+    GcStringBuffer *buf = extensible_buffer(prefix);
+    if (buf && buf->encoding == encoding && total <= buf->capacity) {
+        GcString *str = borrow_buffer(heap, buf, total);
+        if (str) {
+            buf->used = total;
+        }
+        return str;
     }
-    if (decoded.is_byte) {
-        return gc_new_string_bytes(heap, decoded.bytes.data(), decoded.bytes.size());
+    if (!buf && total < kMinBufferedString) {
+        GcString *str = gc_alloc_string(heap, total, encoding);
+        if (!str) {
+            return nullptr;
+        }
+        copy_units(str->data8, encoding, prefix);
+        gc_link(heap, &str->hdr);
+        return str;
     }
-    return gc_new_string_utf16(heap, decoded.u16.data(), decoded.u16.size());
+    // Double a buffer that ran out; a string appended to for the first time
+    // may well be done, so leave it less slack.
+    std::size_t capacity = buf ? std::max(total, buf->capacity * 2) : total + total / 2;
+    if (capacity < total) {
+        capacity = total;
+    }
+    return buffered_string(heap, prefix, total, capacity, encoding);
+}
+
+GcString *gc_string_reserve(GcHeap *heap, const GcString *str, std::size_t capacity) {
+    std::size_t len = str ? str->len : 0;
+    GcStringEncoding encoding = str ? str->encoding : GcStringEncoding::Byte;
+    return buffered_string(heap, str, len, std::max(capacity, len), encoding);
+}
+
+void gc_set_atom_limit(GcHeap &heap, std::size_t max_len) {
+    heap.atoms.max_len = max_len;
+    if (max_len == 0) {
+        heap.atoms.count = 0;
+        heap.atoms.slots.clear();
+    }
+}
+
+GcString *gc_atom(GcHeap *heap, const char *data, std::size_t len) {
+    if (!heap || len > heap->atoms.max_len) {
+        return gc_new_string(heap, data, len);
+    }
+    for (std::size_t i = 0; i < len; ++i) {
+        if (static_cast<unsigned char>(data[i]) >= 0x80) {
+            return gc_new_string(heap, data, len);
+        }
+    }
+    return gc_atom_bytes(heap, reinterpret_cast<const std::uint8_t *>(data), len);
+}
+
+GcString *gc_atom_bytes(GcHeap *heap, const std::uint8_t *data, std::size_t len) {
+    if (!heap || heap->atoms.max_len == 0 || len > heap->atoms.max_len) {
+        return gc_new_string_bytes(heap, data, len);
+    }
+    GcAtomTable &table = heap->atoms;
+    if ((table.count + 1) * 2 > table.slots.size()) {
+        rehash_atoms(table, std::max(kMinAtomSlots, table.slots.size() * 2));
+    }
+    std::uint64_t hash = hash_units(data, len);
+    std::size_t slot = atom_slot(table, data, len, hash);
+    if (table.slots[slot]) {
+        return table.slots[slot];
+    }
+    GcString *atom = gc_new_string_bytes(heap, data, len);
+    if (!atom) {
+        return nullptr;
+    }
+    atom->hash = hash;
+    atom->hash_valid = true;
+    table.slots[slot] = atom;
+    table.count += 1;
+    return atom;
+}
+
+std::uint64_t gc_string_hash(const GcString *str) {
+    return string_hash(str);
+}
+
+bool gc_string_equals(const GcString *lhs, const GcString *rhs) {
+    return string_equals(lhs, rhs);
 }
 
 bool gc_string_to_utf8(const GcString *str, std::string &out) {
@@ -760,32 +1671,527 @@ bool gc_string_to_utf8(const GcString *str, std::string &out) {
     return true;
 }
 
+GcStaticRegion::GcStaticRegion(std::size_t capacity) {
+    if (capacity > 0) {
+        base = static_cast<std::uint8_t *>(alloc.alloc(capacity));
+        this->capacity = base ? capacity : 0;
+    }
+}
+
+GcStaticRegion::~GcStaticRegion() {
+    if (base) {
+        alloc.free(base);
+    }
+}
+
+bool GcStaticRegion::contains(const GcHeader *hdr) const {
+    auto *ptr = reinterpret_cast<const std::uint8_t *>(hdr);
+    return base && ptr >= base && ptr < base + used;
+}
+
+std::size_t gc_static_string_size(std::size_t utf8_len) {
+    // Decoding never yields more code units than input bytes.
+    return static_align(sizeof(GcString)) + static_align(sizeof(char16_t) * (utf8_len + 1));
+}
+
+std::size_t gc_static_binary_size(std::size_t len) {
+    return static_align(sizeof(GcBinary)) + static_align(len);
+}
+
+GcString *gc_new_static_string(GcStaticRegion *region, const char *data, std::size_t len) {
+    if (!region || (len > 0 && !data)) {
+        return nullptr;
+    }
+    DecodedString decoded;
+    if (len > 0 && !decode_utf8(data, len, decoded)) {
+        return nullptr;
+    }
+    std::size_t mark = region->used;
+    auto *hdr = gc_static_alloc_raw(region, sizeof(GcString), GcKind::String);
+    if (!hdr) {
+        return nullptr;
+    }
+    auto *str = reinterpret_cast<GcString *>(hdr);
+    str->encoding = decoded.is_byte ? GcStringEncoding::Byte : GcStringEncoding::Utf16;
+    str->len = decoded.is_byte ? decoded.bytes.size() : decoded.u16.size();
+    str->owner = nullptr;
+    str->data8 = nullptr;
+    if (str->len > 0) {
+        std::size_t unit = decoded.is_byte ? sizeof(std::uint8_t) : sizeof(char16_t);
+        void *data_mem = gc_static_alloc(region, unit * (str->len + 1));
+        if (!data_mem) {
+            region->used = mark;
+            return nullptr;
+        }
+        if (decoded.is_byte) {
+            str->data8 = static_cast<std::uint8_t *>(data_mem);
+            std::memcpy(str->data8, decoded.bytes.data(), str->len);
+            str->data8[str->len] = 0;
+        } else {
+            str->data16 = static_cast<char16_t *>(data_mem);
+            std::memcpy(str->data16, decoded.u16.data(), sizeof(char16_t) * str->len);
+            str->data16[str->len] = 0;
+        }
+    }
+    // Readers on other loops must never race on the lazy hash fill.
+    str->hash = hash_code_units(str);
+    str->hash_valid = true;
+    return str;
+}
+
+GcBinary *gc_new_static_binary(GcStaticRegion *region, const std::uint8_t *data, std::size_t len) {
+    if (!region || (len > 0 && !data)) {
+        return nullptr;
+    }
+    std::size_t mark = region->used;
+    auto *hdr = gc_static_alloc_raw(region, sizeof(GcBinary), GcKind::Binary);
+    if (!hdr) {
+        return nullptr;
+    }
+    auto *bin = reinterpret_cast<GcBinary *>(hdr);
+    bin->len = len;
+    bin->data = nullptr;
+    if (len > 0) {
+        bin->data = static_cast<std::uint8_t *>(gc_static_alloc(region, len));
+        if (!bin->data) {
+            region->used = mark;
+            return nullptr;
+        }
+        std::memcpy(bin->data, data, len);
+    }
+    return bin;
+}
+
+namespace {
+
+std::size_t string_units_bytes(const GcString *str) {
+    std::size_t unit = str->encoding == GcStringEncoding::Byte ? sizeof(std::uint8_t) : sizeof(char16_t);
+    return unit * (str->len + 1);
+}
+
+GcString *gc_static_copy_string(GcStaticRegion *region, const GcString *src) {
+    auto *hdr = gc_static_alloc_raw(region, sizeof(GcString), GcKind::String);
+    void *data = hdr ? gc_static_alloc(region, string_units_bytes(src)) : nullptr;
+    if (!data) {
+        return nullptr;
+    }
+    auto *str = reinterpret_cast<GcString *>(hdr);
+    str->len = src->len;
+    str->encoding = src->encoding;
+    str->owner = nullptr;
+    str->data8 = static_cast<std::uint8_t *>(data);
+    copy_units(data, src->encoding, src);
+    if (str->encoding == GcStringEncoding::Byte) {
+        str->data8[str->len] = 0;
+    } else {
+        str->data16[str->len] = 0;
+    }
+    str->hash = hash_code_units(str);
+    str->hash_valid = true;
+    return str;
+}
+
+// What a value freezes as: forced lazy documents are their materialized
+// container. False for values that cannot be frozen.
+bool freeze_source(const JsValue &value, JsValue &out) {
+    switch (value.type_) {
+        case JsNodeType::Exception:
+        case JsNodeType::Interator:
+            return false;
+        case JsNodeType::LazyJson: {
+            const JsValue &forced = reinterpret_cast<const GcLazyJson *>(value.gc)->forced;
+            if (forced.type_ != JsNodeType::Array && forced.type_ != JsNodeType::Object) {
+                return false;
+            }
+            out = forced;
+            return true;
+        }
+        default:
+            out = value;
+            return true;
+    }
+}
+
+JsValue cell_value(JsNodeType type, GcHeader *hdr) {
+    JsValue value;
+    value.type_ = type;
+    value.gc = hdr;
+    return value;
+}
+
+// Deep-copies a value graph into one static region. measure sizes the
+// region and rejects what cannot be frozen; copy then builds the graph.
+// Both walk with an explicit stack and key cells by their source, so
+// shared members and cycles stay shared.
+class Freezer {
+public:
+    bool measure(const JsValue &root) {
+        std::vector<const GcHeader *> pending;
+        auto add = [&](const JsValue &value) {
+            JsValue source;
+            if (!freeze_source(value, source)) {
+                return false;
+            }
+            switch (source.type_) {
+                case JsNodeType::NativeString:
+                    bytes_ += gc_static_string_size(source.ns().len);
+                    break;
+                case JsNodeType::NativeBinary:
+                    bytes_ += gc_static_binary_size(source.nb().len);
+                    break;
+                case JsNodeType::HeapString:
+                case JsNodeType::HeapBinary:
+                case JsNodeType::Array:
+                case JsNodeType::Object:
+                    // copy fills in the cell's copy later.
+                    if (source.gc && copies_.try_emplace(source.gc, nullptr).second) {
+                        pending.push_back(source.gc);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return true;
+        };
+        if (!add(root)) {
+            return false;
+        }
+        while (!pending.empty()) {
+            const GcHeader *cell = pending.back();
+            pending.pop_back();
+            switch (cell->kind) {
+                case GcKind::String: {
+                    auto *str = reinterpret_cast<const GcString *>(cell);
+                    bytes_ += static_align(sizeof(GcString)) + static_align(string_units_bytes(str));
+                    break;
+                }
+                case GcKind::Binary:
+                    bytes_ += gc_static_binary_size(reinterpret_cast<const GcBinary *>(cell)->len);
+                    break;
+                case GcKind::Array: {
+                    auto *arr = reinterpret_cast<const GcArray *>(cell);
+                    bytes_ += static_align(sizeof(GcArray)) + static_align(array_elem_bytes(arr->kind) * arr->size);
+                    if (arr->kind != GcArrayKind::Values) {
+                        break;
+                    }
+                    for (std::size_t i = 0; i < arr->size; ++i) {
+                        if (!add(arr->elems[i])) {
+                            return false;
+                        }
+                    }
+                    break;
+                }
+                case GcKind::Object: {
+                    auto *obj = reinterpret_cast<const GcObject *>(cell);
+                    bytes_ += static_align(sizeof(GcObject));
+                    if (obj->size > 0) {
+                        bytes_ += static_align(sizeof(GcObjectEntry) * obj->size) +
+                                  static_align(kSlotBytes * slot_count_for(obj->size));
+                    }
+                    for (std::size_t i = 0; i < obj->entry_count; ++i) {
+                        const GcObjectEntry &entry = obj->entries[i];
+                        if (entry.key && (!add(make_heap_string_value(entry.key)) || !add(entry.value))) {
+                            return false;
+                        }
+                    }
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t bytes() const {
+        return bytes_;
+    }
+
+    bool copy(GcStaticRegion *region, const JsValue &root, JsValue &out) {
+        region_ = region;
+        out = place(root);
+        while (ok_ && !pending_.empty()) {
+            auto [source, copy] = pending_.back();
+            pending_.pop_back();
+            if (source->kind == GcKind::Array) {
+                fill_array(reinterpret_cast<const GcArray *>(source), reinterpret_cast<GcArray *>(copy));
+            } else {
+                fill_object(reinterpret_cast<const GcObject *>(source), reinterpret_cast<GcObject *>(copy));
+            }
+        }
+        return ok_;
+    }
+
+private:
+    // The copy of value, allocated at once; containers are filled in later
+    // from pending_.
+    JsValue place(const JsValue &value) {
+        JsValue source;
+        if (!freeze_source(value, source)) {
+            ok_ = false;
+            return {};
+        }
+        switch (source.type_) {
+            case JsNodeType::NativeString: {
+                GcString *str = gc_new_static_string(region_, source.ns().data, source.ns().len);
+                ok_ = ok_ && str;
+                return make_heap_string_value(str);
+            }
+            case JsNodeType::NativeBinary: {
+                GcBinary *bin = gc_new_static_binary(region_, source.nb().data, source.nb().len);
+                ok_ = ok_ && bin;
+                return bin ? cell_value(JsNodeType::HeapBinary, &bin->hdr) : JsValue{};
+            }
+            case JsNodeType::HeapString:
+            case JsNodeType::HeapBinary:
+            case JsNodeType::Array:
+            case JsNodeType::Object: {
+                GcHeader *&slot = copies_[source.gc];
+                if (!slot) {
+                    slot = allocate(source.gc);
+                }
+                return cell_value(source.type_, slot);
+            }
+            default:
+                return source;
+        }
+    }
+
+    GcHeader *allocate(const GcHeader *source) {
+        GcHeader *copy = nullptr;
+        switch (source->kind) {
+            case GcKind::String: {
+                GcString *str = gc_static_copy_string(region_, reinterpret_cast<const GcString *>(source));
+                copy = str ? &str->hdr : nullptr;
+                break;
+            }
+            case GcKind::Binary: {
+                auto *bin = reinterpret_cast<const GcBinary *>(source);
+                GcBinary *frozen = gc_new_static_binary(region_, bin->data, bin->len);
+                copy = frozen ? &frozen->hdr : nullptr;
+                break;
+            }
+            case GcKind::Array:
+                copy = allocate_array(reinterpret_cast<const GcArray *>(source));
+                break;
+            default:
+                copy = allocate_object(reinterpret_cast<const GcObject *>(source));
+                break;
+        }
+        ok_ = ok_ && copy;
+        if (copy && (source->kind == GcKind::Array || source->kind == GcKind::Object)) {
+            pending_.emplace_back(source, copy);
+        }
+        return copy;
+    }
+
+    GcHeader *allocate_array(const GcArray *source) {
+        auto *hdr = gc_static_alloc_raw(region_, sizeof(GcArray), GcKind::Array);
+        if (!hdr) {
+            return nullptr;
+        }
+        auto *arr = reinterpret_cast<GcArray *>(hdr);
+        arr->size = source->size;
+        arr->capacity = source->size;
+        arr->version = 0;
+        arr->elems = nullptr;
+        arr->inline_capacity = 0;
+        arr->kind = source->kind;
+        if (arr->size > 0) {
+            std::size_t bytes = array_elem_bytes(arr->kind) * arr->size;
+            arr->elems = static_cast<JsValue *>(gc_static_alloc(region_, bytes));
+            if (!arr->elems) {
+                return nullptr;
+            }
+            // Packed payloads hold no references: copy them now, fill_array skips them.
+            if (arr->kind == GcArrayKind::Values) {
+                std::uninitialized_value_construct_n(arr->elems, arr->size);
+            } else {
+                std::memcpy(static_cast<void *>(arr->elems), source->elems, bytes);
+            }
+        }
+        return hdr;
+    }
+
+    GcHeader *allocate_object(const GcObject *source) {
+        auto *hdr = gc_static_alloc_raw(region_, sizeof(GcObject), GcKind::Object);
+        if (!hdr) {
+            return nullptr;
+        }
+        auto *obj = reinterpret_cast<GcObject *>(hdr);
+        obj->size = source->size;
+        obj->version = 0;
+        obj->entry_count = source->size;
+        obj->entry_capacity = source->size;
+        obj->slot_count = 0;
+        obj->growth_left = 0;
+        obj->next_seq = source->size + 1;
+        obj->ctrl = nullptr;
+        obj->slots = nullptr;
+        obj->entries = nullptr;
+        obj->inline_capacity = 0;
+        if (obj->size > 0) {
+            std::size_t slot_count = slot_count_for(obj->size);
+            obj->entries = static_cast<GcObjectEntry *>(gc_static_alloc(region_, sizeof(GcObjectEntry) * obj->size));
+            obj->ctrl = static_cast<std::uint8_t *>(gc_static_alloc(region_, kSlotBytes * slot_count));
+            if (!obj->entries || !obj->ctrl) {
+                return nullptr;
+            }
+            std::uninitialized_value_construct_n(obj->entries, obj->size);
+            obj->slots = reinterpret_cast<std::uint32_t *>(obj->ctrl + slot_count);
+            obj->slot_count = slot_count;
+        }
+        return hdr;
+    }
+
+    void fill_array(const GcArray *source, GcArray *arr) {
+        if (arr->kind != GcArrayKind::Values) {
+            return;
+        }
+        for (std::size_t i = 0; i < arr->size; ++i) {
+            arr->elems[i] = place(source->elems[i]);
+        }
+    }
+
+    // Tombstones are dropped; the members keep their order.
+    void fill_object(const GcObject *source, GcObject *obj) {
+        std::size_t at = 0;
+        for (std::size_t i = 0; i < source->entry_count; ++i) {
+            const GcObjectEntry &entry = source->entries[i];
+            if (!entry.key) {
+                continue;
+            }
+            GcObjectEntry &copy = obj->entries[at++];
+            copy.key = reinterpret_cast<GcString *>(place(make_heap_string_value(entry.key)).gc);
+            copy.value = place(entry.value);
+            copy.hash = entry.hash;
+            copy.seq = at;
+        }
+        if (ok_ && obj->size > 0) {
+            fill_table(obj);
+        }
+    }
+
+    GcStaticRegion *region_ = nullptr;
+    std::size_t bytes_ = 0;
+    bool ok_ = true;
+    std::unordered_map<const GcHeader *, GcHeader *> copies_;
+    std::vector<std::pair<const GcHeader *, GcHeader *>> pending_;
+};
+
+} // namespace
+
+bool gc_is_static(const GcHeader *hdr) {
+    return hdr && hdr->mark_ == GcMark::GcMark_Static;
+}
+
+void gc_pin_static(GcHeap &heap, const std::shared_ptr<const GcStaticRegion> &region) {
+    if (!region) {
+        return;
+    }
+    if (heap.static_pinned.insert(region.get()).second) {
+        heap.static_pins.emplace_back(region);
+    }
+}
+
+bool gc_freeze(const JsValue &value, GcSnapshot &out) {
+    Freezer freezer;
+    if (!freezer.measure(value)) {
+        return false;
+    }
+    auto region = std::make_shared<GcStaticRegion>(freezer.bytes());
+    if (freezer.bytes() > 0 && !region->base) {
+        return false;
+    }
+    JsValue root;
+    if (!freezer.copy(region.get(), value, root)) {
+        return false;
+    }
+    out.region = std::move(region);
+    out.root = root;
+    return true;
+}
+
+JsValue gc_snapshot_root(GcHeap &heap, const GcSnapshot &snapshot) {
+    gc_pin_static(heap, snapshot.region);
+    return snapshot.root;
+}
+
+GcStaticPin::GcStaticPin(std::shared_ptr<const GcStaticRegion> pinned)
+    : region(std::move(pinned)) {
+    if (region) {
+        region->pins.fetch_add(1);
+    }
+}
+
+GcStaticPin::GcStaticPin(GcStaticPin &&other) noexcept
+    : region(std::move(other.region)), orphan(other.orphan), seen(other.seen) {
+    other.region.reset();
+}
+
+GcStaticPin &GcStaticPin::operator=(GcStaticPin &&other) noexcept {
+    if (this != &other) {
+        if (region) {
+            region->pins.fetch_sub(1);
+        }
+        region = std::move(other.region);
+        orphan = other.orphan;
+        seen = other.seen;
+        other.region.reset();
+    }
+    return *this;
+}
+
+GcStaticPin::~GcStaticPin() {
+    if (region) {
+        region->pins.fetch_sub(1);
+    }
+}
+
 GcBinary *gc_new_binary(GcHeap *heap, const std::uint8_t *data, std::size_t len) {
-    auto *hdr = gc_alloc_raw(heap, sizeof(GcBinary), GcKind::Binary);
+    if ((len > 0 && !data) || len > std::numeric_limits<std::size_t>::max() - sizeof(GcBinary)) {
+        return nullptr;
+    }
+    auto *hdr = gc_alloc_raw(heap, sizeof(GcBinary) + len, GcKind::Binary);
     if (!hdr) {
         return nullptr;
     }
     auto *bin = reinterpret_cast<GcBinary *>(hdr);
     bin->len = len;
-    bin->data = nullptr;
-    if (len > 0 && !data) {
-        heap->alloc.free(bin);
-        return nullptr;
-    }
+    bin->data = reinterpret_cast<std::uint8_t *>(bin + 1);
     if (len > 0) {
-        bin->data = static_cast<std::uint8_t *>(heap->alloc.alloc(len));
-        if (!bin->data) {
-            heap->alloc.free(bin);
-            return nullptr;
-        }
         std::memcpy(bin->data, data, len);
     }
     gc_link(heap, hdr);
     return bin;
 }
 
-GcArray *gc_new_array(GcHeap *heap, std::size_t capacity) {
-    auto *hdr = gc_alloc_raw(heap, sizeof(GcArray), GcKind::Array);
+GcBuffer *gc_new_buffer(GcHeap *heap, std::shared_ptr<const std::string> bytes) {
+    if (!bytes) {
+        return nullptr;
+    }
+    auto *hdr = gc_alloc_raw(heap, sizeof(GcBuffer), GcKind::Buffer);
+    if (!hdr) {
+        return nullptr;
+    }
+    // Pinned bytes count towards the heap so large inputs drive collection.
+    std::size_t total = std::min<std::size_t>(sizeof(GcBuffer) + bytes->size(),
+                                              std::numeric_limits<std::uint32_t>::max());
+    hdr->size_ = static_cast<std::uint32_t>(total);
+    auto *buf = reinterpret_cast<GcBuffer *>(hdr);
+    std::construct_at(&buf->bytes, std::move(bytes));
+    gc_link(heap, hdr);
+    return buf;
+}
+
+namespace {
+
+// Inline storage is JsValue-sized whatever the kind so unpack_array can
+// widen it in place; packed arrays only use the front half of it.
+GcArray *new_array(GcHeap *heap, std::size_t capacity, GcArrayKind kind) {
+    bool inline_elems_fit = capacity <= kInlineArrayCapacity;
+    std::size_t size = sizeof(GcArray) + (inline_elems_fit ? sizeof(JsValue) * capacity : 0);
+    auto *hdr = gc_alloc_raw(heap, size, GcKind::Array);
     if (!hdr) {
         return nullptr;
     }
@@ -794,22 +2200,163 @@ GcArray *gc_new_array(GcHeap *heap, std::size_t capacity) {
     arr->capacity = capacity;
     arr->version = 0;
     arr->elems = nullptr;
+    arr->inline_capacity = 0;
+    arr->kind = kind;
     if (capacity > 0) {
-        arr->elems = static_cast<JsValue *>(heap->alloc.alloc(sizeof(JsValue) * capacity));
-        if (!arr->elems) {
-            heap->alloc.free(arr);
-            return nullptr;
+        if (inline_elems_fit) {
+            arr->elems = inline_elems(arr);
+            arr->inline_capacity = static_cast<std::uint32_t>(capacity);
+        } else {
+            arr->elems = static_cast<JsValue *>(heap_alloc(heap, array_elem_bytes(kind) * capacity));
+            if (!arr->elems) {
+                gc_free_raw(heap, hdr);
+                return nullptr;
+            }
         }
-        for (std::size_t i = 0; i < capacity; ++i) {
-            std::construct_at(&arr->elems[i]);
+        if (kind == GcArrayKind::Values) {
+            for (std::size_t i = 0; i < capacity; ++i) {
+                std::construct_at(&arr->elems[i]);
+            }
         }
     }
     gc_link(heap, hdr);
     return arr;
 }
 
+GcArrayKind packed_kind_of(const JsValue &value) {
+    switch (value.type_) {
+        case JsNodeType::Integer:
+            return GcArrayKind::Int64;
+        case JsNodeType::Float:
+            return GcArrayKind::Float64;
+        default:
+            return GcArrayKind::Values;
+    }
+}
+
+std::byte *array_bytes(GcArray *arr) {
+    return reinterpret_cast<std::byte *>(arr->elems);
+}
+
+// Widens a packed array to JsValues, in place when the elements are inline
+// (back to front, so no element is overwritten before it is read).
+bool unpack_array(GcHeap *heap, GcArray *arr) {
+    if (arr->kind == GcArrayKind::Values) {
+        return true;
+    }
+    JsValue *elems = nullptr;
+    if (array_elems_inline(arr)) {
+        elems = inline_elems(arr);
+        for (std::size_t i = arr->size; i-- > 0;) {
+            JsValue value = gc_array_at(arr, i);
+            std::construct_at(&elems[i], value);
+        }
+    } else {
+        if (arr->capacity > 0) {
+            elems = static_cast<JsValue *>(heap_alloc(heap, sizeof(JsValue) * arr->capacity));
+            if (!elems) {
+                return false;
+            }
+        }
+        for (std::size_t i = 0; i < arr->size; ++i) {
+            std::construct_at(&elems[i], gc_array_at(arr, i));
+        }
+        free_elems(heap, arr);
+    }
+    for (std::size_t i = arr->size; i < arr->capacity; ++i) {
+        std::construct_at(&elems[i]);
+    }
+    arr->elems = elems;
+    arr->kind = GcArrayKind::Values;
+    return true;
+}
+
+// Readies arr to hold value: an empty packed array takes the value's kind,
+// a packed array that cannot hold it is unpacked.
+bool array_accept(GcHeap *heap, GcArray *arr, const JsValue &value) {
+    if (arr->kind == GcArrayKind::Values) {
+        return true;
+    }
+    GcArrayKind kind = packed_kind_of(value);
+    if (kind == arr->kind) {
+        return true;
+    }
+    if (arr->size == 0 && kind != GcArrayKind::Values) {
+        arr->kind = kind;
+        return true;
+    }
+    return unpack_array(heap, arr);
+}
+
+// The caller has run array_accept for value.
+void array_store(GcArray *arr, std::size_t index, JsValue value) {
+    switch (arr->kind) {
+        case GcArrayKind::Int64:
+            arr->ints[index] = value.i;
+            break;
+        case GcArrayKind::Float64:
+            arr->floats[index] = value.f;
+            break;
+        case GcArrayKind::Values:
+            arr->elems[index] = std::move(value);
+            break;
+    }
+}
+
+} // namespace
+
+GcArray *gc_new_array(GcHeap *heap, std::size_t capacity) {
+    return new_array(heap, capacity, GcArrayKind::Values);
+}
+
+GcArray *gc_new_packed_array(GcHeap *heap, std::size_t capacity) {
+    return new_array(heap, capacity, GcArrayKind::Int64);
+}
+
+bool gc_array_pack(GcHeap *heap, GcArray *arr) {
+    if (!heap || !arr || gc_is_static(&arr->hdr) || arr->kind != GcArrayKind::Values || arr->size == 0) {
+        return false;
+    }
+    GcArrayKind kind = packed_kind_of(arr->elems[0]);
+    if (kind == GcArrayKind::Values) {
+        return false;
+    }
+    for (std::size_t i = 1; i < arr->size; ++i) {
+        if (packed_kind_of(arr->elems[i]) != kind) {
+            return false;
+        }
+    }
+    // Both payloads are 8 bytes wide, so the int64 view copies either.
+    if (array_elems_inline(arr)) {
+        // Front to back: ints[i] lands inside elems[i / 2], already read.
+        for (std::size_t i = 0; i < arr->size; ++i) {
+            std::int64_t bits = arr->elems[i].i;
+            arr->ints[i] = bits;
+        }
+    } else {
+        auto *ints = static_cast<std::int64_t *>(heap_alloc(heap, sizeof(std::int64_t) * arr->capacity));
+        if (!ints) {
+            return false;
+        }
+        for (std::size_t i = 0; i < arr->size; ++i) {
+            ints[i] = arr->elems[i].i;
+        }
+        free_elems(heap, arr);
+        arr->ints = ints;
+    }
+    arr->kind = kind;
+    return true;
+}
+
+bool gc_array_unpack(GcHeap *heap, GcArray *arr) {
+    if (!heap || !arr || gc_is_static(&arr->hdr)) {
+        return arr && arr->kind == GcArrayKind::Values;
+    }
+    return unpack_array(heap, arr);
+}
+
 bool gc_array_reserve(GcHeap *heap, GcArray *arr, std::size_t expected) {
-    if (!heap || !arr) {
+    if (!heap || !arr || gc_is_static(&arr->hdr)) {
         return false;
     }
     if (expected <= arr->capacity) {
@@ -819,40 +2366,47 @@ bool gc_array_reserve(GcHeap *heap, GcArray *arr, std::size_t expected) {
     while (new_capacity < expected) {
         new_capacity *= 2;
     }
-    auto *new_elems = static_cast<JsValue *>(heap->alloc.alloc(sizeof(JsValue) * new_capacity));
+    std::size_t elem_bytes = array_elem_bytes(arr->kind);
+    auto *new_elems = static_cast<std::byte *>(heap_alloc(heap, elem_bytes * new_capacity));
     if (!new_elems) {
         return false;
     }
-    for (std::size_t i = 0; i < new_capacity; ++i) {
-        std::construct_at(&new_elems[i]);
-    }
-    for (std::size_t i = 0; i < arr->size; ++i) {
-        new_elems[i] = std::move(arr->elems[i]);
+    // JsValue is trivially copyable: move the live prefix in one copy.
+    if (arr->size > 0) {
+        std::memcpy(new_elems, arr->elems, elem_bytes * arr->size);
     }
-    if (arr->elems) {
-        for (std::size_t i = 0; i < arr->capacity; ++i) {
-            std::destroy_at(&arr->elems[i]);
+    if (arr->kind == GcArrayKind::Values) {
+        auto *values = reinterpret_cast<JsValue *>(new_elems);
+        for (std::size_t i = arr->size; i < new_capacity; ++i) {
+            std::construct_at(&values[i]);
         }
-        heap->alloc.free(arr->elems);
     }
-    arr->elems = new_elems;
+    free_elems(heap, arr);
+    arr->elems = reinterpret_cast<JsValue *>(new_elems);
     arr->capacity = new_capacity;
     return true;
 }
 
-const JsValue *gc_array_get(const GcArray *arr, std::size_t index) {
+std::optional<JsValue> gc_array_get(const GcArray *arr, std::size_t index) {
     if (!arr || index >= arr->size) {
-        return nullptr;
+        return std::nullopt;
     }
-    return &arr->elems[index];
+    return gc_array_at(arr, index);
 }
 
 bool gc_array_set(GcHeap *heap, GcArray *arr, std::size_t index, JsValue value) {
-    if (!heap || !arr) {
+    if (!heap || !arr || gc_is_static(&arr->hdr)) {
+        return false;
+    }
+    // Holes read as undefined, which only a Values array can hold.
+    if (index > arr->size && !unpack_array(heap, arr)) {
+        return false;
+    }
+    if (!array_accept(heap, arr, value)) {
         return false;
     }
     if (index < arr->size) {
-        arr->elems[index] = std::move(value);
+        array_store(arr, index, std::move(value));
         return true;
     }
     if (!gc_array_reserve(heap, arr, index + 1)) {
@@ -862,32 +2416,34 @@ bool gc_array_set(GcHeap *heap, GcArray *arr, std::size_t index, JsValue value)
         arr->elems[arr->size] = JsValue::make_undefined();
         arr->size += 1;
     }
-    arr->elems[arr->size] = std::move(value);
+    array_store(arr, arr->size, std::move(value));
     arr->size += 1;
     arr->version += 1;
     return true;
 }
 
 bool gc_array_push(GcHeap *heap, GcArray *arr, JsValue value) {
-    if (!heap || !arr) {
+    if (!heap || !arr || gc_is_static(&arr->hdr)) {
         return false;
     }
-    if (!gc_array_reserve(heap, arr, arr->size + 1)) {
+    if (!array_accept(heap, arr, value) || !gc_array_reserve(heap, arr, arr->size + 1)) {
         return false;
     }
-    arr->elems[arr->size] = std::move(value);
+    array_store(arr, arr->size, std::move(value));
     arr->size += 1;
     arr->version += 1;
     return true;
 }
 
 bool gc_array_pop(GcArray *arr, JsValue *out) {
-    if (!arr || arr->size == 0) {
+    if (!arr || gc_is_static(&arr->hdr) || arr->size == 0) {
         return false;
     }
     std::size_t idx = arr->size - 1;
-    JsValue removed = std::move(arr->elems[idx]);
-    arr->elems[idx] = JsValue::make_undefined();
+    JsValue removed = gc_array_at(arr, idx);
+    if (arr->kind == GcArrayKind::Values) {
+        arr->elems[idx] = JsValue::make_undefined();
+    }
     arr->size -= 1;
     arr->version += 1;
     if (out) {
@@ -897,42 +2453,50 @@ bool gc_array_pop(GcArray *arr, JsValue *out) {
 }
 
 bool gc_array_insert(GcHeap *heap, GcArray *arr, std::size_t index, JsValue value) {
-    if (!heap || !arr) {
+    if (!heap || !arr || gc_is_static(&arr->hdr)) {
         return false;
     }
     if (index > arr->size) {
         index = arr->size;
     }
-    if (!gc_array_reserve(heap, arr, arr->size + 1)) {
+    if (!array_accept(heap, arr, value) || !gc_array_reserve(heap, arr, arr->size + 1)) {
         return false;
     }
-    for (std::size_t i = arr->size; i > index; --i) {
-        arr->elems[i] = std::move(arr->elems[i - 1]);
-    }
-    arr->elems[index] = std::move(value);
+    std::size_t elem_bytes = array_elem_bytes(arr->kind);
+    std::byte *bytes = array_bytes(arr);
+    std::memmove(bytes + (index + 1) * elem_bytes, bytes + index * elem_bytes, (arr->size - index) * elem_bytes);
+    array_store(arr, index, std::move(value));
     arr->size += 1;
     arr->version += 1;
     return true;
 }
 
 bool gc_array_remove(GcArray *arr, std::size_t index, JsValue *out) {
-    if (!arr || index >= arr->size) {
+    if (!arr || gc_is_static(&arr->hdr) || index >= arr->size) {
         return false;
     }
     if (out) {
-        *out = std::move(arr->elems[index]);
+        *out = gc_array_at(arr, index);
     }
-    for (std::size_t i = index + 1; i < arr->size; ++i) {
-        arr->elems[i - 1] = std::move(arr->elems[i]);
+    std::size_t elem_bytes = array_elem_bytes(arr->kind);
+    std::byte *bytes = array_bytes(arr);
+    std::memmove(bytes + index * elem_bytes, bytes + (index + 1) * elem_bytes, (arr->size - index - 1) * elem_bytes);
+    if (arr->kind == GcArrayKind::Values) {
+        arr->elems[arr->size - 1] = JsValue::make_undefined();
     }
-    arr->elems[arr->size - 1] = JsValue::make_undefined();
     arr->size -= 1;
     arr->version += 1;
     return true;
 }
 
 GcObject *gc_new_object(GcHeap *heap, std::size_t capacity) {
-    auto *hdr = gc_alloc_raw(heap, sizeof(GcObject), GcKind::Object);
+    bool inline_fit = capacity <= kInlineObjectCapacity;
+    std::size_t slot_count = capacity > 0 ? slot_count_for(capacity) : 0;
+    std::size_t size = sizeof(GcObject);
+    if (inline_fit && capacity > 0) {
+        size += sizeof(GcObjectEntry) * capacity + kSlotBytes * kGroupWidth;
+    }
+    auto *hdr = gc_alloc_raw(heap, size, GcKind::Object);
     if (!hdr) {
         return nullptr;
     }
@@ -941,57 +2505,63 @@ GcObject *gc_new_object(GcHeap *heap, std::size_t capacity) {
     obj->version = 0;
     obj->entry_count = 0;
     obj->entry_capacity = capacity;
-    obj->bucket_count = 0;
-    obj->bucket_mask = 0;
-    obj->head = -1;
-    obj->tail = -1;
-    obj->free_head = -1;
-    obj->buckets = nullptr;
+    obj->slot_count = 0;
+    obj->growth_left = 0;
+    obj->next_seq = 1;
+    obj->ctrl = nullptr;
+    obj->slots = nullptr;
     obj->entries = nullptr;
+    obj->inline_capacity = 0;
     if (capacity > 0) {
-        obj->entries = static_cast<GcObjectEntry *>(heap->alloc.alloc(sizeof(GcObjectEntry) * capacity));
-        if (!obj->entries) {
-            heap->alloc.free(obj);
-            return nullptr;
-        }
-        for (std::size_t i = 0; i < capacity; ++i) {
-            obj->entries[i].key = nullptr;
-            obj->entries[i].hash = 0;
-            obj->entries[i].next_bucket = -1;
-            obj->entries[i].prev_order = -1;
-            obj->entries[i].next_order = -1;
-            obj->entries[i].next_free = -1;
-            obj->entries[i].occupied = false;
-            std::construct_at(&obj->entries[i].value);
-        }
-        obj->bucket_count = bucket_count_for_entries(capacity);
-        if (obj->bucket_count == 0) {
-            for (std::size_t i = 0; i < capacity; ++i) {
-                std::destroy_at(&obj->entries[i].value);
-            }
-            heap->alloc.free(obj->entries);
-            heap->alloc.free(obj);
-            return nullptr;
-        }
-        obj->buckets =
-            static_cast<std::int32_t *>(heap->alloc.alloc(sizeof(std::int32_t) * obj->bucket_count));
-        if (!obj->buckets) {
-            for (std::size_t i = 0; i < capacity; ++i) {
-                std::destroy_at(&obj->entries[i].value);
+        if (inline_fit) {
+            obj->inline_capacity = static_cast<std::uint32_t>(capacity);
+            obj->entries = inline_entries(obj);
+            obj->ctrl = inline_ctrl(obj);
+        } else {
+            obj->entries = static_cast<GcObjectEntry *>(heap_alloc(heap, sizeof(GcObjectEntry) * capacity));
+            obj->ctrl = static_cast<std::uint8_t *>(heap_alloc(heap, kSlotBytes * slot_count));
+            if (!obj->entries || !obj->ctrl) {
+                if (obj->entries) {
+                    heap_free(heap, obj->entries, sizeof(GcObjectEntry) * capacity);
+                }
+                if (obj->ctrl) {
+                    heap_free(heap, obj->ctrl, kSlotBytes * slot_count);
+                }
+                gc_free_raw(heap, hdr);
+                return nullptr;
             }
-            heap->alloc.free(obj->entries);
-            heap->alloc.free(obj);
-            return nullptr;
         }
-        for (std::size_t i = 0; i < obj->bucket_count; ++i) {
-            obj->buckets[i] = -1;
-        }
-        obj->bucket_mask = obj->bucket_count - 1;
+        std::uninitialized_value_construct_n(obj->entries, capacity);
+        obj->slots = reinterpret_cast<std::uint32_t *>(obj->ctrl + slot_count);
+        obj->slot_count = slot_count;
+        fill_table(obj);
     }
     gc_link(heap, hdr);
     return obj;
 }
 
+GcLazyJson *gc_new_lazy_json(GcHeap *heap, std::shared_ptr<LazyJsonDoc> doc, GcLazyJson *root, std::uint32_t at) {
+    auto *hdr = gc_alloc_raw(heap, sizeof(GcLazyJson), GcKind::LazyJson);
+    if (!hdr) {
+        return nullptr;
+    }
+    auto *lazy = reinterpret_cast<GcLazyJson *>(hdr);
+    if (!root) {
+        // The root carries the document so its size drives collection.
+        std::size_t doc_bytes = doc->text.size() + (doc->index.size() + doc->close.size()) * sizeof(std::uint32_t);
+        std::size_t total = std::min<std::size_t>(sizeof(GcLazyJson) + doc_bytes,
+                                                  std::numeric_limits<std::uint32_t>::max());
+        hdr->size_ = static_cast<std::uint32_t>(total);
+        root = lazy;
+    }
+    std::construct_at(&lazy->doc, std::move(doc));
+    lazy->root = root;
+    lazy->at = at;
+    std::construct_at(&lazy->forced);
+    gc_link(heap, hdr);
+    return lazy;
+}
+
 GcException *gc_new_exception(GcHeap *heap, std::int64_t position, GcString *name, GcString *message, JsValue meta) {
     auto *hdr = gc_alloc_raw(heap, sizeof(GcException), GcKind::Exception);
     if (!hdr) {
@@ -1057,7 +2627,7 @@ GcIterator *gc_new_array_iterator(GcHeap *heap, GcArray *array, GcIteratorMode m
     iter->array = array;
     iter->object = nullptr;
     iter->index = 0;
-    iter->cursor = -1;
+    iter->last_seq = 0;
     iter->snapshot_keys = nullptr;
     iter->snapshot_size = 0;
     iter->snapshot_index = 0;
@@ -1081,7 +2651,7 @@ GcIterator *gc_new_object_iterator(GcHeap *heap, GcObject *object, GcIteratorMod
     iter->array = nullptr;
     iter->object = object;
     iter->index = 0;
-    iter->cursor = object ? object->head : -1;
+    iter->last_seq = 0;
     iter->snapshot_keys = nullptr;
     iter->snapshot_size = 0;
     iter->snapshot_index = 0;
@@ -1121,18 +2691,19 @@ bool gc_iterator_next(GcHeap *heap, GcIterator *iter, JsValue &out, bool &done)
                 iter->has_current = true;
                 return true;
             case GcIteratorMode::Values:
-                out = arr->elems[idx];
+                out = gc_array_at(arr, idx);
                 iter->current_value = out;
                 iter->current_key = JsValue::make_integer(static_cast<int64_t>(idx));
                 iter->has_current = true;
                 return true;
             case GcIteratorMode::Entries: {
                 JsValue key = JsValue::make_integer(static_cast<int64_t>(idx));
-                if (!build_entry_array(heap, key, arr->elems[idx], out)) {
+                JsValue value = gc_array_at(arr, idx);
+                if (!build_entry_array(heap, key, value, out)) {
                     return false;
                 }
                 iter->current_key = key;
-                iter->current_value = arr->elems[idx];
+                iter->current_value = value;
                 iter->has_current = true;
                 return true;
             }
@@ -1183,13 +2754,12 @@ bool gc_iterator_next(GcHeap *heap, GcIterator *iter, JsValue &out, bool &done)
         }
         return true;
     }
-    while (iter->cursor != -1) {
-        int32_t cursor = iter->cursor;
-        GcObjectEntry &entry = obj->entries[cursor];
-        iter->cursor = entry.next_order;
-        if (!entry.occupied || !entry.key) {
+    while (iter->index < obj->entry_count) {
+        GcObjectEntry &entry = obj->entries[iter->index++];
+        if (!entry.key) {
             continue;
         }
+        iter->last_seq = entry.seq;
         JsValue key_value = make_heap_string_value(entry.key);
         done = false;
         switch (iter->mode) {
@@ -1219,73 +2789,32 @@ bool gc_iterator_next(GcHeap *heap, GcIterator *iter, JsValue &out, bool &done)
 }
 
 bool gc_object_reserve(GcHeap *heap, GcObject *obj, std::size_t expected) {
-    if (!heap || !obj) {
+    if (!heap || !obj || gc_is_static(&obj->hdr)) {
         return false;
     }
-    std::size_t new_capacity = obj->entry_capacity ? obj->entry_capacity : 1;
-    if (expected > new_capacity) {
-        while (new_capacity < expected) {
-            new_capacity *= 2;
-        }
-        if (!grow_entries(heap, obj, new_capacity)) {
-            return false;
-        }
-    } else if (obj->entry_capacity == 0 && expected > 0) {
-        if (!grow_entries(heap, obj, expected)) {
-            return false;
-        }
-    }
-    std::size_t desired_bucket_count =
-        bucket_count_for_entries(std::max(expected, obj->size));
-    if (desired_bucket_count > obj->bucket_count) {
-        if (!rehash_buckets(heap, obj, desired_bucket_count)) {
-            return false;
-        }
-    } else if (obj->bucket_count == 0 && desired_bucket_count > 0) {
-        if (!rehash_buckets(heap, obj, desired_bucket_count)) {
-            return false;
-        }
-    }
-    return true;
+    return reserve_members(heap, obj, std::max(expected, obj->size));
 }
 
 bool gc_object_set(GcHeap *heap, GcObject *obj, GcString *key, JsValue value) {
-    if (!obj || !key) {
+    if (!obj || gc_is_static(&obj->hdr) || !key) {
         return false;
     }
     std::uint64_t hash = string_hash(key);
-    int32_t existing = find_entry_index(obj, key, hash);
-    if (existing != -1) {
-        obj->entries[existing].value = std::move(value);
+    std::size_t slot = find_slot(obj, key, hash);
+    if (slot != kNoSlot) {
+        obj->entries[obj->slots[slot]].value = value;
         return true;
     }
-    if (!gc_object_reserve(heap, obj, obj->size + 1)) {
-        return false;
-    }
-    if (obj->bucket_count == 0 || !obj->buckets || !obj->entries) {
-        return false;
-    }
-    int32_t idx = allocate_entry(obj);
-    if (idx == -1) {
+    if (!heap || !reserve_members(heap, obj, obj->size + 1)) {
         return false;
     }
+    std::size_t idx = obj->entry_count++;
     GcObjectEntry &entry = obj->entries[idx];
     entry.key = key;
-    entry.value = std::move(value);
+    entry.value = value;
     entry.hash = hash;
-    entry.occupied = true;
-    entry.next_free = -1;
-    std::size_t bucket = static_cast<std::size_t>(hash) & obj->bucket_mask;
-    entry.next_bucket = obj->buckets[bucket];
-    obj->buckets[bucket] = idx;
-    entry.prev_order = obj->tail;
-    entry.next_order = -1;
-    if (obj->tail != -1) {
-        obj->entries[obj->tail].next_order = idx;
-    } else {
-        obj->head = idx;
-    }
-    obj->tail = idx;
+    entry.seq = obj->next_seq++;
+    place_entry(obj, hash, idx);
     obj->size += 1;
     obj->version += 1;
     return true;
@@ -1295,88 +2824,75 @@ const JsValue *gc_object_get(const GcObject *obj, const GcString *key) {
     if (!obj || !key) {
         return nullptr;
     }
-    std::uint64_t hash = string_hash(key);
-    int32_t idx = find_entry_index(obj, key, hash);
-    if (idx == -1) {
+    std::size_t slot = find_slot(obj, key, string_hash(key));
+    if (slot == kNoSlot) {
         return nullptr;
     }
-    return &obj->entries[idx].value;
+    return &obj->entries[obj->slots[slot]].value;
 }
 
 bool gc_object_remove(GcObject *obj, const GcString *key) {
-    if (!obj || !key || obj->bucket_count == 0 || !obj->buckets) {
+    if (!obj || gc_is_static(&obj->hdr) || !key) {
         return false;
     }
-    std::uint64_t hash = string_hash(key);
-    std::size_t bucket = static_cast<std::size_t>(hash) & obj->bucket_mask;
-    int32_t prev = -1;
-    int32_t idx = obj->buckets[bucket];
-    while (idx != -1) {
-        GcObjectEntry &entry = obj->entries[idx];
-        if (entry.occupied && entry.hash == hash && string_equals(entry.key, key)) {
-            if (prev == -1) {
-                obj->buckets[bucket] = entry.next_bucket;
-            } else {
-                obj->entries[prev].next_bucket = entry.next_bucket;
-            }
-            if (entry.prev_order != -1) {
-                obj->entries[entry.prev_order].next_order = entry.next_order;
-            } else {
-                obj->head = entry.next_order;
-            }
-            if (entry.next_order != -1) {
-                obj->entries[entry.next_order].prev_order = entry.prev_order;
-            } else {
-                obj->tail = entry.prev_order;
-            }
-            entry.occupied = false;
-            entry.key = nullptr;
-            entry.hash = 0;
-            entry.next_bucket = -1;
-            entry.prev_order = -1;
-            entry.next_order = -1;
-            entry.value = JsValue();
-            entry.next_free = obj->free_head;
-            obj->free_head = idx;
-            obj->size -= 1;
-            obj->version += 1;
-            return true;
-        }
-        prev = idx;
-        idx = entry.next_bucket;
+    std::size_t slot = find_slot(obj, key, string_hash(key));
+    if (slot == kNoSlot) {
+        return false;
+    }
+    // A probe only moves past a group with no empty slot, so one that has
+    // an empty can take another.
+    if (CtrlGroup(obj->ctrl + slot / kGroupWidth * kGroupWidth).match_empty() != 0) {
+        obj->ctrl[slot] = kCtrlEmpty;
+        obj->growth_left += 1;
+    } else {
+        obj->ctrl[slot] = kCtrlDeleted;
     }
-    return false;
+    GcObjectEntry &entry = obj->entries[obj->slots[slot]];
+    entry.key = nullptr;
+    entry.value = JsValue();
+    obj->size -= 1;
+    obj->version += 1;
+    while (obj->entry_count > 0 && !obj->entries[obj->entry_count - 1].key) {
+        obj->entry_count -= 1;
+    }
+    // Compacting needs no allocation, so it is done here rather than left
+    // to the next insert.
+    if (obj->entry_count - obj->size > obj->size) {
+        compact_entries(obj);
+        fill_table(obj);
+    }
+    return true;
 }
 
 const GcObjectEntry *gc_object_entry_at(const GcObject *obj, std::size_t index) {
     if (!obj || index >= obj->size) {
         return nullptr;
     }
-    std::size_t current = 0;
-    int32_t cursor = obj->head;
-    while (cursor != -1) {
-        if (current == index) {
-            return &obj->entries[cursor];
+    if (obj->entry_count == obj->size) {
+        return &obj->entries[index];
+    }
+    for (std::size_t i = 0; i < obj->entry_count; ++i) {
+        if (obj->entries[i].key && index-- == 0) {
+            return &obj->entries[i];
         }
-        cursor = obj->entries[cursor].next_order;
-        current += 1;
     }
     return nullptr;
 }
 
 void gc_collect(GcHeap *heap, JsValue **roots, std::size_t root_count) {
-    heap->live_mark = flip_mark(heap->live_mark);
+    gc_begin_collect(heap);
     for (std::size_t i = 0; i < root_count; ++i) {
         gc_mark_value(heap, *roots[i]);
     }
-    GcHeader **cursor = &heap->head;
-    while (*cursor) {
-        GcHeader *obj = *cursor;
-        if (obj->mark_ != heap->live_mark) {
-            *cursor = obj->next;
-            gc_free_obj(heap, obj);
-        } else {
-            cursor = &obj->next;
+    gc_finish_collect(heap);
+}
+
+GcHeap::~GcHeap() {
+    for (void *block : free_blocks) {
+        while (block) {
+            void *next = *static_cast<void **>(block);
+            alloc.free(block);
+            block = next;
         }
     }
 }
@@ -1393,6 +2909,80 @@ void gc_set_threshold(GcHeap &heap, std::size_t value) {
     heap.threshold = value;
 }
 
+void gc_set_workers(GcHeap &heap, GcWorkers *workers, std::size_t min_bytes) {
+    heap.workers = workers;
+    heap.parallel_bytes = min_bytes;
+}
+
+void gc_set_threshold_policy(GcHeap &heap, const GcThresholdPolicy &policy) {
+    heap.threshold_policy = policy;
+    // A zero threshold turns collection off; adapting must never get there.
+    heap.threshold_policy.min_threshold = std::max<std::size_t>(policy.min_threshold, 1);
+    heap.threshold_policy.max_threshold = std::max(policy.max_threshold, heap.threshold_policy.min_threshold);
+}
+
+GcStats gc_stats(const GcHeap &heap) {
+    GcStats stats = heap.stats;
+    stats.taken_ns = gc_now_ns();
+    stats.bytes = heap.bytes;
+    stats.allocated = heap.allocated;
+    stats.threshold = heap.threshold;
+    return stats;
+}
+
+GcStats gc_stats_since(const GcStats &before, const GcStats &now) {
+    GcStats out = now;
+    out.allocated -= before.allocated;
+    out.collections -= before.collections;
+    out.pause_ns -= before.pause_ns;
+    for (std::size_t i = 0; i < kGcPauseBuckets; ++i) {
+        out.pauses[i] -= before.pauses[i];
+    }
+    out.collected_bytes -= before.collected_bytes;
+    out.survived_bytes -= before.survived_bytes;
+    for (std::size_t i = 0; i < kGcKindCount; ++i) {
+        out.kinds[i].allocated_cells -= before.kinds[i].allocated_cells;
+        out.kinds[i].allocated_bytes -= before.kinds[i].allocated_bytes;
+        out.kinds[i].freed_cells -= before.kinds[i].freed_cells;
+        out.kinds[i].freed_bytes -= before.kinds[i].freed_bytes;
+    }
+    return out;
+}
+
+double gc_allocation_rate(const GcStats &before, const GcStats &now) {
+    if (now.taken_ns <= before.taken_ns) {
+        return 0.0;
+    }
+    double bytes = static_cast<double>(now.allocated - before.allocated);
+    return bytes * 1e9 / static_cast<double>(now.taken_ns - before.taken_ns);
+}
+
+double gc_survival_ratio(const GcStats &stats) {
+    if (stats.collected_bytes == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(stats.survived_bytes) / static_cast<double>(stats.collected_bytes);
+}
+
+std::uint64_t gc_pause_quantile(const GcStats &stats, double q) {
+    std::size_t total = 0;
+    for (std::size_t count : stats.pauses) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    double target = std::max(1.0, q * static_cast<double>(total));
+    std::size_t seen = 0;
+    for (std::size_t i = 0; i + 1 < kGcPauseBuckets; ++i) {
+        seen += stats.pauses[i];
+        if (static_cast<double>(seen) >= target) {
+            return std::uint64_t{1000} << i;
+        }
+    }
+    return stats.max_pause_ns;
+}
+
 void GcRootSet::add_global(JsValue *value) {
     if (value) {
         globals_.push_back(value);
@@ -1400,9 +2990,10 @@ void GcRootSet::add_global(JsValue *value) {
 }
 
 void GcRootSet::remove_global(JsValue *value) {
-    for (std::size_t i = 0; i < globals_.size(); ++i) {
-        if (globals_[i] == value) {
-            globals_[i] = globals_.back();
+    // Searches from the most recent entry; marking does not care about order.
+    for (std::size_t i = globals_.size(); i > 0; --i) {
+        if (globals_[i - 1] == value) {
+            globals_[i - 1] = globals_.back();
             globals_.pop_back();
             return;
         }
@@ -1430,35 +3021,45 @@ void GcRootSet::add_stack_root(JsValue *value) {
     }
 }
 
-void GcRootSet::add_temp_root(JsValue *value) {
-    if (value) {
-        temps_.push_back(value);
+void GcRootSet::add_provider(RootProvider *provider) {
+    if (!provider || provider->prev_provider_ || providers_ == provider) {
+        return;
     }
+    provider->next_provider_ = providers_;
+    if (providers_) {
+        providers_->prev_provider_ = provider;
+    }
+    providers_ = provider;
 }
 
-void GcRootSet::remove_temp_root(JsValue *value) {
-    for (std::size_t i = 0; i < temps_.size(); ++i) {
-        if (temps_[i] == value) {
-            temps_[i] = temps_.back();
-            temps_.pop_back();
-            return;
-        }
+void GcRootSet::remove_provider(RootProvider *provider) {
+    if (!provider || (!provider->prev_provider_ && providers_ != provider)) {
+        return;
+    }
+    if (provider->prev_provider_) {
+        provider->prev_provider_->next_provider_ = provider->next_provider_;
+    } else {
+        providers_ = provider->next_provider_;
+    }
+    if (provider->next_provider_) {
+        provider->next_provider_->prev_provider_ = provider->prev_provider_;
     }
+    provider->prev_provider_ = nullptr;
+    provider->next_provider_ = nullptr;
 }
 
-void GcRootSet::add_provider(RootProvider *provider) {
-    if (provider) {
-        providers_.push_back(provider);
+void GcRootSet::RootVisitor::visit(JsValue *value) {
+    if (value) {
+        gc_mark_value(heap_, *value);
     }
 }
 
-void GcRootSet::remove_provider(RootProvider *provider) {
-    for (std::size_t i = 0; i < providers_.size(); ++i) {
-        if (providers_[i] == provider) {
-            providers_[i] = providers_.back();
-            providers_.pop_back();
-            return;
-        }
+void GcRootSet::RootVisitor::visit_range(JsValue *base, std::size_t count) {
+    if (!base) {
+        return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        gc_mark_value(heap_, base[i]);
     }
 }
 
@@ -1469,43 +3070,42 @@ void GcRootSet::visit_all(RootVisitor &visitor) {
     for (auto *value : stack_) {
         visitor.visit(value);
     }
-    for (auto *value : temps_) {
-        visitor.visit(value);
+    for (GcRootHandle *handle = handles_; handle; handle = handle->next_) {
+        visitor.visit(handle->value_);
     }
-    for (auto *provider : providers_) {
-        if (provider) {
-            provider->visit_roots(visitor);
-        }
+    for (RootProvider *provider = providers_; provider; provider = provider->next_provider_) {
+        provider->visit_roots(visitor);
     }
 }
 
 void gc_collect(GcHeap &heap, GcRootSet &roots) {
-    std::vector<JsValue *> root_values;
-    GcRootSet::RootVisitor visitor(root_values);
+    gc_begin_collect(&heap);
+    GcRootSet::RootVisitor visitor(heap);
     roots.visit_all(visitor);
-    gc_collect(&heap, root_values.data(), root_values.size());
+    gc_finish_collect(&heap);
 }
 
-GcRootHandle::GcRootHandle(GcRootSet &roots, JsValue *value)
-    : roots_(&roots), value_(value) {
-    if (roots_ && value_) {
-        roots_->add_temp_root(value_);
+GcRootHandle::GcRootHandle(GcRootSet &roots, JsValue *value) {
+    if (!value) {
+        return;
     }
+    roots_ = &roots;
+    value_ = value;
+    next_ = roots.handles_;
+    if (next_) {
+        next_->prev_ = this;
+    }
+    roots.handles_ = this;
 }
 
-GcRootHandle::GcRootHandle(GcRootHandle &&other) noexcept
-    : roots_(other.roots_), value_(other.value_) {
-    other.roots_ = nullptr;
-    other.value_ = nullptr;
+GcRootHandle::GcRootHandle(GcRootHandle &&other) noexcept {
+    take(other);
 }
 
 GcRootHandle &GcRootHandle::operator=(GcRootHandle &&other) noexcept {
     if (this != &other) {
         reset();
-        roots_ = other.roots_;
-        value_ = other.value_;
-        other.roots_ = nullptr;
-        other.value_ = nullptr;
+        take(other);
     }
     return *this;
 }
@@ -1514,12 +3114,42 @@ GcRootHandle::~GcRootHandle() {
     reset();
 }
 
+void GcRootHandle::take(GcRootHandle &other) {
+    roots_ = other.roots_;
+    value_ = other.value_;
+    prev_ = other.prev_;
+    next_ = other.next_;
+    if (roots_) {
+        if (prev_) {
+            prev_->next_ = this;
+        } else {
+            roots_->handles_ = this;
+        }
+        if (next_) {
+            next_->prev_ = this;
+        }
+    }
+    other.roots_ = nullptr;
+    other.value_ = nullptr;
+    other.prev_ = nullptr;
+    other.next_ = nullptr;
+}
+
 void GcRootHandle::reset() {
-    if (roots_ && value_) {
-        roots_->remove_temp_root(value_);
+    if (roots_) {
+        if (prev_) {
+            prev_->next_ = next_;
+        } else {
+            roots_->handles_ = next_;
+        }
+        if (next_) {
+            next_->prev_ = prev_;
+        }
     }
     roots_ = nullptr;
     value_ = nullptr;
+    prev_ = nullptr;
+    next_ = nullptr;
 }
 
 } // namespace fiber::json
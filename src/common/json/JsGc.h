@@ -5,9 +5,15 @@
 #ifndef FIBER_JSGC_H
 #define FIBER_JSGC_H
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "JsNode.h"
@@ -22,12 +28,18 @@ enum class GcKind : std::uint8_t {
     Object,
     Exception,
     Iterator,
+    LazyJson,
+    Buffer,
+    StringBuffer,
 };
 
 struct GcHeader {
     GcHeader *next = nullptr;
     GcMark mark_ = GcMark::GcMark_0;
     GcKind kind = GcKind::String;
+    // Free-list class the cell's block was carved for (GcHeap::free_blocks),
+    // 0 when it came straight from the allocator.
+    std::uint16_t size_class = 0;
     std::uint32_t size_ = 0;
 };
 
@@ -36,6 +48,7 @@ enum class GcStringEncoding : std::uint8_t {
     Utf16,
 };
 
+// Owned strings keep their code units (plus a NUL) inline after the cell.
 struct GcString {
     GcHeader hdr;
     std::size_t len = 0;
@@ -46,46 +59,114 @@ struct GcString {
         std::uint8_t *data8;
         char16_t *data16;
     };
+    // Set on borrowed strings (gc_new_string_slice, gc_new_string_borrowed):
+    // the data points into memory this cell keeps alive, is not ours to free
+    // and is not NUL-terminated.
+    GcHeader *owner = nullptr;
 };
 
+// Growable storage behind strings built by appending (gc_string_extend).
+// Each such string borrows a prefix of data; used is the length of the
+// longest, and only a string ending at used may grow in place, so the
+// strings sharing the buffer never see each other's writes. Code units are
+// inline after the cell.
+struct GcStringBuffer {
+    GcHeader hdr;
+    GcStringEncoding encoding = GcStringEncoding::Byte;
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+    union {
+        std::uint8_t *data8;
+        char16_t *data16;
+    };
+};
+
+// Bytes are inline after the cell.
 struct GcBinary {
     GcHeader hdr;
     std::size_t len = 0;
     std::uint8_t *data = nullptr;
 };
 
+// How a GcArray holds its elements. Packed arrays store bare int64 or
+// double payloads, 8 bytes each out of line instead of a 16-byte JsValue.
+// Storing any other type converts the array to Values for good, except
+// that an empty packed array takes the kind of its first element.
+enum class GcArrayKind : std::uint8_t {
+    Values,
+    Int64,
+    Float64,
+};
+
+// Arrays created with a small capacity keep their first inline_capacity
+// elements inline after the cell, with room for JsValues whatever the
+// kind; the elements move out of line once they grow past it. Only Values
+// arrays may be written through elems directly; read with gc_array_at.
 struct GcArray {
     GcHeader hdr;
     std::size_t size = 0;
     std::size_t capacity = 0;
     std::uint64_t version = 0;
-    JsValue *elems = nullptr;
+    union {
+        JsValue *elems = nullptr;
+        std::int64_t *ints;
+        double *floats;
+    };
+    std::uint32_t inline_capacity = 0;
+    GcArrayKind kind = GcArrayKind::Values;
 };
 
+// Element index, which must be below size, of an array of any kind.
+inline JsValue gc_array_at(const GcArray *arr, std::size_t index) {
+    JsValue value;
+    switch (arr->kind) {
+        case GcArrayKind::Int64:
+            value.type_ = JsNodeType::Integer;
+            value.i = arr->ints[index];
+            return value;
+        case GcArrayKind::Float64:
+            value.type_ = JsNodeType::Float;
+            value.f = arr->floats[index];
+            return value;
+        case GcArrayKind::Values:
+            break;
+    }
+    return arr->elems[index];
+}
+
+// A member of a GcObject. Removing a member leaves a tombstone with a null
+// key until the object is compacted.
 struct GcObjectEntry {
     GcString *key = nullptr;
     JsValue value;
+    // gc_string_hash(key), so probes reject other keys without loading them.
     std::uint64_t hash = 0;
-    std::int32_t next_bucket = -1;
-    std::int32_t prev_order = -1;
-    std::int32_t next_order = -1;
-    std::int32_t next_free = -1;
-    bool occupied = false;
+    // Insertion sequence number; increases along the entries array.
+    std::uint64_t seq = 0;
 };
 
+inline constexpr std::size_t kGcObjectGroupWidth = 16;
+
+// An insertion-ordered hash map in the SwissTable layout. entries[0,
+// entry_count) holds the members in insertion order, tombstones included.
+// An open-addressed table of slot_count control bytes (ctrl: empty, deleted,
+// or 7 bits of the key hash) and entry indices (slots) finds them, probing
+// kGcObjectGroupWidth control bytes at a time. Like GcArray, small objects
+// keep inline_capacity entries and a one-group table inline after the cell.
 struct GcObject {
     GcHeader hdr;
     std::size_t size = 0;
     std::uint64_t version = 0;
     std::size_t entry_count = 0;
     std::size_t entry_capacity = 0;
-    std::size_t bucket_count = 0;
-    std::size_t bucket_mask = 0;
-    std::int32_t head = -1;
-    std::int32_t tail = -1;
-    std::int32_t free_head = -1;
-    std::int32_t *buckets = nullptr;
+    std::size_t slot_count = 0;
+    // Empty slots that may still be filled before the table is rebuilt.
+    std::size_t growth_left = 0;
+    std::uint64_t next_seq = 1;
+    std::uint8_t *ctrl = nullptr;
+    std::uint32_t *slots = nullptr;
     GcObjectEntry *entries = nullptr;
+    std::uint32_t inline_capacity = 0;
 };
 
 struct GcException {
@@ -115,8 +196,10 @@ struct GcIterator {
     bool using_snapshot = false;
     GcArray *array = nullptr;
     GcObject *object = nullptr;
+    // Array index, or position in the object's entries.
     std::size_t index = 0;
-    std::int32_t cursor = -1;
+    // seq of the last object entry returned.
+    std::uint64_t last_seq = 0;
     GcString **snapshot_keys = nullptr;
     std::size_t snapshot_size = 0;
     std::size_t snapshot_index = 0;
@@ -125,34 +208,294 @@ struct GcIterator {
     bool has_current = false;
 };
 
+struct GcLazyJson;
+
+// Source of a lazily decoded document (Parser::parse_lazy): the text, its
+// structural index, and the cells handed out so far keyed by index entry,
+// so repeated access to a container yields the same cell.
+struct LazyJsonDoc {
+    std::string text;
+    std::vector<std::uint32_t> index;
+    // For each opening bracket in index, the entry of its closing bracket.
+    std::vector<std::uint32_t> close;
+    std::unordered_map<std::uint32_t, GcLazyJson *> cells;
+    // Parser::set_pack_arrays when the document was parsed.
+    bool pack_arrays = false;
+};
+
+// An object or array of a lazy document. Members are decoded on access;
+// forced holds the materialized GcObject/GcArray once something needed the
+// whole container, after which the cell only forwards to it. All cells of a
+// document keep each other alive through root.
+struct GcLazyJson {
+    GcHeader hdr;
+    std::shared_ptr<LazyJsonDoc> doc;
+    GcLazyJson *root = nullptr;
+    std::uint32_t at = 0;
+    JsValue forced;
+};
+
+// Input bytes shared with the host, pinned for as long as a string
+// borrowed from them (gc_new_string_borrowed) is reachable.
+struct GcBuffer {
+    GcHeader hdr;
+    std::shared_ptr<const std::string> bytes;
+};
+
+struct GcStaticRegion;
+
+// Keeps a static region alive for as long as values of this heap may point
+// into it; GcStaticRegion::pins counts the heaps holding one.
+struct GcStaticPin {
+    GcStaticPin() = default;
+    explicit GcStaticPin(std::shared_ptr<const GcStaticRegion> pinned);
+    GcStaticPin(const GcStaticPin &) = delete;
+    GcStaticPin &operator=(const GcStaticPin &) = delete;
+    GcStaticPin(GcStaticPin &&other) noexcept;
+    GcStaticPin &operator=(GcStaticPin &&other) noexcept;
+    ~GcStaticPin();
+
+    std::shared_ptr<const GcStaticRegion> region;
+    bool orphan = false;
+    bool seen = false;
+};
+
+// Blocks up to kGcSizeClasses * kGcSizeClassBytes are rounded up to a
+// multiple of kGcSizeClassBytes and recycled through per-class free lists.
+inline constexpr std::size_t kGcSizeClassBytes = 16;
+inline constexpr std::size_t kGcSizeClasses = 64;
+
+// Weak intern table of short Byte strings (gc_atom). The table does not keep
+// its atoms alive: gc_collect drops the entries whose cells it frees.
+// Open addressing with linear probing, at most half full.
+struct GcAtomTable {
+    // Longest string interned, in code units; 0 turns interning off.
+    std::size_t max_len = 0;
+    std::size_t count = 0;
+    std::vector<GcString *> slots;
+};
+
+class GcWorkers;
+
+// Cells linked into a heap since the previous segment began, so sweeping
+// can split the head list: a segment runs from first, its newest cell, up
+// to the first cell of the next older segment.
+struct GcSegment {
+    GcHeader *first = nullptr;
+    std::size_t cells = 0;
+};
+
+inline constexpr std::size_t kGcSegmentCells = 4096;
+
+inline constexpr std::size_t kGcKindCount = static_cast<std::size_t>(GcKind::StringBuffer) + 1;
+// Pause bucket 0 counts pauses under 1us and bucket i those in
+// [2^(i-1), 2^i) us; the last bucket also takes everything longer.
+inline constexpr std::size_t kGcPauseBuckets = 24;
+
+struct GcKindStats {
+    std::size_t allocated_cells = 0;
+    std::size_t allocated_bytes = 0;
+    std::size_t freed_cells = 0;
+    std::size_t freed_bytes = 0;
+};
+
+// What a heap has done since it was created. gc_stats copies the counters
+// along with the heap's current size and the time, so two snapshots taken
+// an event-loop iteration apart give that iteration (gc_stats_since).
+struct GcStats {
+    // steady_clock, in nanoseconds.
+    std::uint64_t taken_ns = 0;
+    std::size_t bytes = 0;
+    std::size_t allocated = 0;
+    std::size_t threshold = 0;
+    std::size_t peak_bytes = 0;
+    std::size_t collections = 0;
+    std::uint64_t pause_ns = 0;
+    std::uint64_t max_pause_ns = 0;
+    std::array<std::size_t, kGcPauseBuckets> pauses{};
+    // Summed over collections: bytes in use as each began, and what
+    // survived it.
+    std::size_t collected_bytes = 0;
+    std::size_t survived_bytes = 0;
+    std::array<GcKindStats, kGcKindCount> kinds{};
+};
+
+// With adaptive set, every collection moves the threshold to the bytes that
+// survived times base_growth + survival_growth * (survival ratio), clamped
+// to [min_threshold, max_threshold]: a heap that keeps most of what it holds
+// gets room to grow instead of being collected again for little return.
+struct GcThresholdPolicy {
+    bool adaptive = false;
+    std::size_t min_threshold = 1 << 20;
+    std::size_t max_threshold = std::size_t{1} << 32;
+    double base_growth = 2.0;
+    double survival_growth = 4.0;
+};
+
 struct GcHeap {
+    GcHeap() = default;
+    GcHeap(const GcHeap &) = delete;
+    GcHeap &operator=(const GcHeap &) = delete;
+    // Returns the free lists to the allocator; cells still linked are not
+    // reclaimed.
+    ~GcHeap();
+
     GcHeader *head = nullptr;
     std::size_t bytes = 0;
+    // Monotonic count of bytes ever linked into the heap; never reduced by
+    // sweeping, so callers can meter allocation over an interval.
+    std::size_t allocated = 0;
     std::size_t threshold = 1 << 20;
     GcMark live_mark = GcMark::GcMark_0;
     mem::Allocator alloc;
+    // Singly linked through each block's first word; free_bytes is their
+    // total, capped so a burst of garbage is not held forever.
+    std::array<void *, kGcSizeClasses> free_blocks{};
+    std::size_t free_bytes = 0;
+    std::vector<GcStaticPin> static_pins;
+    // The regions in static_pins, so pinning again is a lookup.
+    std::unordered_set<const GcStaticRegion *> static_pinned;
+    // Orphaned pins sorted by region base, while a collection looks for them.
+    std::vector<GcStaticPin *> static_orphans;
+    bool static_scan = false;
+    GcAtomTable atoms;
+    // Oldest first; the cells linked after segments.back() (top_cells of
+    // them) form one more run at the head.
+    std::vector<GcSegment> segments;
+    std::size_t top_cells = 0;
+    // Cells marked but not yet scanned; kept to reuse its storage.
+    std::vector<GcHeader *> mark_stack;
+    // Not owned; see gc_set_workers.
+    GcWorkers *workers = nullptr;
+    std::size_t parallel_bytes = 0;
+    GcStats stats;
+    GcThresholdPolicy threshold_policy;
+    std::uint64_t collect_start_ns = 0;
+    std::size_t collect_start_bytes = 0;
+};
+
+// Immutable cells carved from one contiguous block that never belongs to a
+// GcHeap. They carry GcMark_Static, are skipped by marking and sweeping, and
+// are released only with the region, so a region can be shared read-only by
+// every loop. Heaps that hand out its values pin it (gc_pin_static).
+struct GcStaticRegion {
+    explicit GcStaticRegion(std::size_t capacity);
+    GcStaticRegion(const GcStaticRegion &) = delete;
+    GcStaticRegion &operator=(const GcStaticRegion &) = delete;
+    ~GcStaticRegion();
+
+    bool contains(const GcHeader *hdr) const;
+
+    std::uint8_t *base = nullptr;
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+    mutable std::atomic<std::size_t> pins{0};
+    mem::Allocator alloc;
 };
 
 std::size_t gc_bytes_used(const GcHeap &heap);
 std::size_t gc_threshold(const GcHeap &heap);
 void gc_set_threshold(GcHeap &heap, std::size_t value);
+// Collections that start with at least min_bytes in use mark and sweep on
+// workers' threads too; null workers keeps every collection on the caller.
+// workers must outlive the heap's use of it.
+void gc_set_workers(GcHeap &heap, GcWorkers *workers, std::size_t min_bytes);
+void gc_set_threshold_policy(GcHeap &heap, const GcThresholdPolicy &policy);
+
+GcStats gc_stats(const GcHeap &heap);
+// Counters of now less those of before; sizes, the peak and the longest
+// pause are now's.
+GcStats gc_stats_since(const GcStats &before, const GcStats &now);
+// Bytes per second allocated between two snapshots.
+double gc_allocation_rate(const GcStats &before, const GcStats &now);
+// Fraction of the bytes collections found in use that they kept; 0 before
+// the first collection.
+double gc_survival_ratio(const GcStats &stats);
+// Upper bound of the pause bucket holding the q-th quantile (0 < q <= 1), in
+// nanoseconds; pauses past the last bucket report max_pause_ns.
+std::uint64_t gc_pause_quantile(const GcStats &stats, double q);
 
 GcString *gc_new_string(GcHeap *heap, const char *data, std::size_t len);
 GcString *gc_new_string_bytes(GcHeap *heap, const std::uint8_t *data, std::size_t len);
 GcString *gc_new_string_bytes_uninit(GcHeap *heap, std::size_t len);
 GcString *gc_new_string_utf16(GcHeap *heap, const char16_t *data, std::size_t len);
 GcString *gc_new_string_utf16_uninit(GcHeap *heap, std::size_t len);
+// Code units [start, start + len) of parent. Long slices share the parent's
+// storage instead of copying; short ones, or ones that would pin a much
+// larger parent, are copied.
+GcString *gc_new_string_slice(GcHeap *heap, const GcString *parent, std::size_t start, std::size_t len);
+// A Byte string over len bytes of ASCII at data without copying them; owner
+// must keep data alive (a GcBuffer, or any cell whose storage holds it).
+GcString *gc_new_string_borrowed(GcHeap *heap, GcHeader *owner, const char *data, std::size_t len);
+// A string of prefix's code units followed by extra uninitialized ones for
+// the caller to fill, in the wider of prefix's encoding and encoding.
+// Appending to a string that ends its buffer writes in place and the result
+// shares the buffer, which grows geometrically, so building a string by
+// repeated appends costs amortized linear time. Short results are plain
+// owned strings. prefix may be null.
+GcString *gc_string_extend(GcHeap *heap, const GcString *prefix, std::size_t extra, GcStringEncoding encoding);
+// A copy of str (null for an empty one) in a buffer with room for capacity
+// code units, so gc_string_extend can append up to that length in place.
+GcString *gc_string_reserve(GcHeap *heap, const GcString *str, std::size_t capacity);
+// Interns strings of at most max_len code units from now on; 0 turns it off
+// and empties the table.
+void gc_set_atom_limit(GcHeap &heap, std::size_t max_len);
+// The heap's one cell for this text, with its hash filled in, so repeated
+// keys share storage and usually compare by pointer. Text over the limit,
+// or with interning off, gets a fresh string. gc_atom takes UTF-8 and
+// interns only ASCII; gc_atom_bytes takes Latin-1 code units.
+GcString *gc_atom(GcHeap *heap, const char *data, std::size_t len);
+GcString *gc_atom_bytes(GcHeap *heap, const std::uint8_t *data, std::size_t len);
 bool gc_string_to_utf8(const GcString *str, std::string &out);
+// Code-unit hash and equality as object keys use them; both ignore the
+// encoding, so a Byte and a Utf16 string with the same text agree.
+std::uint64_t gc_string_hash(const GcString *str);
+bool gc_string_equals(const GcString *lhs, const GcString *rhs);
+std::size_t gc_static_string_size(std::size_t utf8_len);
+std::size_t gc_static_binary_size(std::size_t len);
+GcString *gc_new_static_string(GcStaticRegion *region, const char *data, std::size_t len);
+GcBinary *gc_new_static_binary(GcStaticRegion *region, const std::uint8_t *data, std::size_t len);
+bool gc_is_static(const GcHeader *hdr);
+void gc_pin_static(GcHeap &heap, const std::shared_ptr<const GcStaticRegion> &region);
+
+// A read-only deep copy of a value graph in a static region of its own
+// (gc_freeze). Any number of loops may read it at once; heaps never mark
+// into it, and writes through its arrays and objects fail.
+struct GcSnapshot {
+    std::shared_ptr<const GcStaticRegion> region;
+    JsValue root;
+};
+
+// Copies strings, binaries, arrays, objects and forced lazy documents,
+// keeping shared members and cycles shared and dropping object tombstones.
+// False on exceptions, iterators and unforced lazy documents, or when the
+// region cannot be allocated.
+bool gc_freeze(const JsValue &value, GcSnapshot &out);
+// snapshot's root for use with heap's values; pins the region to heap.
+JsValue gc_snapshot_root(GcHeap &heap, const GcSnapshot &snapshot);
 GcBinary *gc_new_binary(GcHeap *heap, const std::uint8_t *data, std::size_t len);
+GcBuffer *gc_new_buffer(GcHeap *heap, std::shared_ptr<const std::string> bytes);
 GcArray *gc_new_array(GcHeap *heap, std::size_t capacity);
+// An empty packed array (Int64 until its first element says otherwise), as
+// scripts create them.
+GcArray *gc_new_packed_array(GcHeap *heap, std::size_t capacity);
+// Packs a Values array whose elements are all integers or all floats; false
+// and unchanged otherwise.
+bool gc_array_pack(GcHeap *heap, GcArray *arr);
+// Converts a packed array to Values, for callers that need JsValue
+// addresses; false only when out of memory.
+bool gc_array_unpack(GcHeap *heap, GcArray *arr);
 bool gc_array_reserve(GcHeap *heap, GcArray *arr, std::size_t expected);
-const JsValue *gc_array_get(const GcArray *arr, std::size_t index);
+// Empty past the end. Packed elements have no JsValue to point at, so the
+// element comes back by value whatever the kind.
+std::optional<JsValue> gc_array_get(const GcArray *arr, std::size_t index);
 bool gc_array_set(GcHeap *heap, GcArray *arr, std::size_t index, JsValue value);
 bool gc_array_push(GcHeap *heap, GcArray *arr, JsValue value);
 bool gc_array_pop(GcArray *arr, JsValue *out);
 bool gc_array_insert(GcHeap *heap, GcArray *arr, std::size_t index, JsValue value);
 bool gc_array_remove(GcArray *arr, std::size_t index, JsValue *out);
 GcObject *gc_new_object(GcHeap *heap, std::size_t capacity);
+GcLazyJson *gc_new_lazy_json(GcHeap *heap, std::shared_ptr<LazyJsonDoc> doc, GcLazyJson *root, std::uint32_t at);
 GcException *gc_new_exception(GcHeap *heap, std::int64_t position, GcString *name, GcString *message, JsValue meta);
 GcException *gc_new_exception(GcHeap *heap, std::int64_t position, GcString *name, GcString *message);
 GcException *gc_new_exception(GcHeap *heap, std::int64_t position, const char *name, std::size_t name_len,
@@ -166,48 +509,55 @@ bool gc_object_reserve(GcHeap *heap, GcObject *obj, std::size_t expected);
 bool gc_object_set(GcHeap *heap, GcObject *obj, GcString *key, JsValue value);
 const JsValue *gc_object_get(const GcObject *obj, const GcString *key);
 bool gc_object_remove(GcObject *obj, const GcString *key);
+// The index-th member in insertion order; constant time unless the object
+// holds tombstones. Loops over every member should walk entries directly,
+// skipping null keys.
 const GcObjectEntry *gc_object_entry_at(const GcObject *obj, std::size_t index);
 void gc_collect(GcHeap *heap, JsValue **roots, std::size_t root_count);
 
+class GcRootHandle;
+
+// What gc_collect(GcHeap &, GcRootSet &) marks from. Handles and providers
+// link themselves in and out in constant time, and roots are marked where
+// they live instead of being gathered first.
 class GcRootSet {
 public:
+    GcRootSet() = default;
+    GcRootSet(const GcRootSet &) = delete;
+    GcRootSet &operator=(const GcRootSet &) = delete;
+
+    // For long-lived values; removal searches from the most recent.
     void add_global(JsValue *value);
     void remove_global(JsValue *value);
 
+    // Stack roots are dropped a frame at a time.
     void push_frame();
     void pop_frame();
     void add_stack_root(JsValue *value);
 
-    void add_temp_root(JsValue *value);
-    void remove_temp_root(JsValue *value);
-
+    // Marks roots as they are visited.
     class RootVisitor {
     public:
-        explicit RootVisitor(std::vector<JsValue *> &roots) : roots_(&roots) {}
-
-        void visit(JsValue *value) {
-            if (value) {
-                roots_->push_back(value);
-            }
-        }
-
-        void visit_range(JsValue *base, std::size_t count) {
-            if (!base || count == 0) {
-                return;
-            }
-            for (std::size_t i = 0; i < count; ++i) {
-                roots_->push_back(base + i);
-            }
-        }
+        explicit RootVisitor(GcHeap &heap) : heap_(&heap) {}
+
+        void visit(JsValue *value);
+        void visit_range(JsValue *base, std::size_t count);
 
     private:
-        std::vector<JsValue *> *roots_ = nullptr;
+        GcHeap *heap_ = nullptr;
     };
 
+    // Something with roots of its own, such as an interpreter's stack and
+    // slots, visited in place on each collection.
     class RootProvider {
     public:
         virtual ~RootProvider() = default;
         virtual void visit_roots(RootVisitor &visitor) = 0;
+
+    private:
+        friend class GcRootSet;
+        RootProvider *prev_provider_ = nullptr;
+        RootProvider *next_provider_ = nullptr;
     };
 
     void add_provider(RootProvider *provider);
@@ -216,15 +566,19 @@ public:
     void visit_all(RootVisitor &visitor);
 
 private:
+    friend class GcRootHandle;
+
     std::vector<JsValue *> globals_;
     std::vector<JsValue *> stack_;
     std::vector<std::size_t> frames_;
-    std::vector<JsValue *> temps_;
-    std::vector<RootProvider *> providers_;
+    GcRootHandle *handles_ = nullptr;
+    RootProvider *providers_ = nullptr;
 };
 
 void gc_collect(GcHeap &heap, GcRootSet &roots);
 
+// Roots one value while it lives: a node of its GcRootSet's intrusive list,
+// so taking and dropping a root never allocates.
 class GcRootHandle {
 public:
     GcRootHandle() = default;
@@ -238,8 +592,15 @@ public:
     void reset();
 
 private:
+    friend class GcRootSet;
+
+    // Takes other's place in the list.
+    void take(GcRootHandle &other);
+
     GcRootSet *roots_ = nullptr;
     JsValue *value_ = nullptr;
+    GcRootHandle *prev_ = nullptr;
+    GcRootHandle *next_ = nullptr;
 };
 
 } // namespace fiber::json
@@ -7,12 +7,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <type_traits>
 
 namespace fiber::json {
 
 enum class GcMark : std::uint8_t {
     GcMark_0,
     GcMark_1,
+    GcMark_Static,
 };
 
 struct GcHeader;
@@ -32,6 +34,7 @@ enum class JsNodeType : std::uint8_t {
     Exception,
     NativeBinary,
     HeapBinary,
+    LazyJson,
 };
 
 struct NativeStr {
@@ -46,42 +49,54 @@ public:
     std::uint8_t *data = nullptr;
 };
 
+// A tag and one 8-byte payload, trivially copyable: copies are two register
+// moves and arrays of values can be moved with memcpy. Native strings and
+// binaries keep their pointer in the payload and their length next to the
+// tag, so they are limited to kMaxNativeLength bytes.
 struct JsValue {
+    static constexpr std::size_t kMaxNativeLength = 0xFFFFFFFF;
+
     static JsValue make_undefined();
     static JsValue make_null();
     static JsValue make_boolean(bool value);
     static JsValue make_integer(int64_t value);
     static JsValue make_float(double value);
+    // Undefined when len exceeds kMaxNativeLength.
     static JsValue make_native_string(char *data, std::size_t len);
     static JsValue make_native_binary(std::uint8_t *data, std::size_t len);
     static JsValue make_string(GcHeap &heap, const char *data, std::size_t len);
     static JsValue make_binary(GcHeap &heap, const std::uint8_t *data, std::size_t len);
     static JsValue make_array(GcHeap &heap, std::size_t capacity);
+    // Starts packed; see GcArrayKind.
+    static JsValue make_packed_array(GcHeap &heap, std::size_t capacity);
     static JsValue make_object(GcHeap &heap, std::size_t capacity);
 
-    JsValue();
-    JsValue(const JsValue &other);
-    JsValue(JsValue &&other) noexcept;
-    JsValue &operator=(const JsValue &other);
-    JsValue &operator=(JsValue &&other) noexcept;
-    ~JsValue();
+    [[nodiscard]] NativeStr ns() const {
+        return {native_len_, str_};
+    }
+    [[nodiscard]] NativeBin nb() const {
+        return {native_len_, bin_};
+    }
+
+    JsNodeType type_ = JsNodeType::Undefined;
+
+private:
+    std::uint32_t native_len_ = 0;
 
-    JsNodeType type_;
+public:
     union {
         bool b;
-        int64_t i;
+        int64_t i = 0;
         double f;
         GcHeader *gc;
-        NativeStr ns;
-        NativeBin nb;
+        char *str_;
+        std::uint8_t *bin_;
     };
-
-private:
-    void destroy();
-    void copy_from(const JsValue &other);
-    void move_from(JsValue &&other);
 };
 
+static_assert(sizeof(JsValue) == 16);
+static_assert(std::is_trivially_copyable_v<JsValue>);
+
 } // namespace fiber::json
 
 
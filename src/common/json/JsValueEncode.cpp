@@ -5,60 +5,125 @@
 #include "JsValueEncode.h"
 
 #include "JsGc.h"
+#include "JsonDecode.h"
 
 namespace fiber::json {
 namespace {
 
-Generator::Result encode_array(Generator &gen, const GcArray *arr);
-Generator::Result encode_object(Generator &gen, const GcObject *obj);
+template <typename Sink>
+GeneratorBase::Result encode_array(BasicGenerator<Sink> &gen, const GcArray *arr);
+template <typename Sink>
+GeneratorBase::Result encode_object(BasicGenerator<Sink> &gen, const GcObject *obj);
+template <typename Sink>
+GeneratorBase::Result encode_lazy(BasicGenerator<Sink> &gen, const GcLazyJson *lazy);
 
-Generator::Result encode_array(Generator &gen, const GcArray *arr) {
+template <typename Sink>
+GeneratorBase::Result encode_array(BasicGenerator<Sink> &gen, const GcArray *arr) {
     if (!arr) {
-        return Generator::Result::InvalidValue;
+        return GeneratorBase::Result::InvalidValue;
     }
-    Generator::Result result = gen.array_open();
-    if (result != Generator::Result::OK) {
+    GeneratorBase::Result result = gen.array_open();
+    if (result != GeneratorBase::Result::OK) {
         return result;
     }
     for (std::size_t i = 0; i < arr->size; ++i) {
-        result = encode_js_value(gen, arr->elems[i]);
-        if (result != Generator::Result::OK) {
+        result = encode_js_value(gen, gc_array_at(arr, i));
+        if (result != GeneratorBase::Result::OK) {
             return result;
         }
     }
     return gen.array_close();
 }
 
-Generator::Result encode_object(Generator &gen, const GcObject *obj) {
+template <typename Sink>
+GeneratorBase::Result encode_object(BasicGenerator<Sink> &gen, const GcObject *obj) {
     if (!obj) {
-        return Generator::Result::InvalidValue;
+        return GeneratorBase::Result::InvalidValue;
     }
-    Generator::Result result = gen.map_open();
-    if (result != Generator::Result::OK) {
+    GeneratorBase::Result result = gen.map_open();
+    if (result != GeneratorBase::Result::OK) {
         return result;
     }
-    int32_t cursor = obj->head;
-    while (cursor != -1) {
-        const GcObjectEntry &entry = obj->entries[cursor];
-        if (!entry.occupied || !entry.key) {
-            return Generator::Result::InvalidValue;
+    for (std::size_t i = 0; i < obj->entry_count; ++i) {
+        const GcObjectEntry &entry = obj->entries[i];
+        if (!entry.key) {
+            continue;
         }
         result = gen.string(entry.key);
-        if (result != Generator::Result::OK) {
+        if (result != GeneratorBase::Result::OK) {
             return result;
         }
         result = encode_js_value(gen, entry.value);
-        if (result != Generator::Result::OK) {
+        if (result != GeneratorBase::Result::OK) {
             return result;
         }
-        cursor = entry.next_order;
     }
     return gen.map_close();
 }
 
+// Untouched lazy containers are copied from their source. When something
+// inside was forced, members are walked so that only the forced cells are
+// encoded from their values and the rest is still copied.
+template <typename Sink>
+GeneratorBase::Result encode_lazy(BasicGenerator<Sink> &gen, const GcLazyJson *lazy) {
+    if (!lazy) {
+        return GeneratorBase::Result::InvalidValue;
+    }
+    const char *text = nullptr;
+    std::size_t len = 0;
+    if (lazy_json_text(lazy, text, len)) {
+        return gen.raw(text, len);
+    }
+    if (lazy->forced.type_ != JsNodeType::Undefined) {
+        return encode_js_value(gen, lazy->forced);
+    }
+    const LazyJsonDoc &doc = *lazy->doc;
+    const char *src = doc.text.data();
+    bool array = lazy_json_is_array(lazy);
+    GeneratorBase::Result result = array ? gen.array_open() : gen.map_open();
+    if (result != GeneratorBase::Result::OK) {
+        return result;
+    }
+    std::uint32_t end = doc.close[lazy->at];
+    std::uint32_t at = lazy->at + 1;
+    while (at < end) {
+        if (!array) {
+            result = gen.raw(src + doc.index[at], doc.index[at + 1] - doc.index[at] + 1);
+            if (result != GeneratorBase::Result::OK) {
+                return result;
+            }
+            at += 3;
+        }
+        std::uint32_t next = 0;
+        char ch = src[doc.index[at]];
+        if (ch == '{' || ch == '[') {
+            next = doc.close[at] + 1;
+            auto found = doc.cells.find(at);
+            if (found != doc.cells.end()) {
+                result = encode_lazy(gen, found->second);
+            } else {
+                result = gen.raw(src + doc.index[at], doc.index[next - 1] - doc.index[at] + 1);
+            }
+        } else {
+            next = ch == '"' ? at + 2 : at + 1;
+            std::size_t stop = ch == '"' ? doc.index[at + 1] + 1 : doc.index[next];
+            while (src[stop - 1] == ' ' || src[stop - 1] == '\t' || src[stop - 1] == '\n' || src[stop - 1] == '\r') {
+                stop -= 1;
+            }
+            result = gen.raw(src + doc.index[at], stop - doc.index[at]);
+        }
+        if (result != GeneratorBase::Result::OK) {
+            return result;
+        }
+        at = next + 1;
+    }
+    return array ? gen.array_close() : gen.map_close();
+}
+
 } // namespace
 
-Generator::Result encode_js_value(Generator &gen, const JsValue &value) {
+template <typename Sink>
+GeneratorBase::Result encode_js_value(BasicGenerator<Sink> &gen, const JsValue &value) {
     switch (value.type_) {
         case JsNodeType::Null:
             return gen.null_value();
@@ -71,35 +136,37 @@ Generator::Result encode_js_value(Generator &gen, const JsValue &value) {
         case JsNodeType::HeapString: {
             auto *str = reinterpret_cast<const GcString *>(value.gc);
             if (!str) {
-                return Generator::Result::InvalidString;
+                return GeneratorBase::Result::InvalidString;
             }
             return gen.string(str);
         }
         case JsNodeType::NativeString:
-            return gen.string(value.ns.data, value.ns.len);
+            return gen.string(value.ns().data, value.ns().len);
         case JsNodeType::Array:
             return encode_array(gen, reinterpret_cast<const GcArray *>(value.gc));
         case JsNodeType::Object:
             return encode_object(gen, reinterpret_cast<const GcObject *>(value.gc));
+        case JsNodeType::LazyJson:
+            return encode_lazy(gen, reinterpret_cast<const GcLazyJson *>(value.gc));
         case JsNodeType::Exception: {
             auto *exc = reinterpret_cast<const GcException *>(value.gc);
             if (!exc) {
-                return Generator::Result::InvalidValue;
+                return GeneratorBase::Result::InvalidValue;
             }
-            Generator::Result result = gen.map_open();
-            if (result != Generator::Result::OK) {
+            GeneratorBase::Result result = gen.map_open();
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             result = gen.string("position", 8);
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             result = gen.integer(exc->position);
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             result = gen.string("name", 4);
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             if (exc->name) {
@@ -107,11 +174,11 @@ Generator::Result encode_js_value(Generator &gen, const JsValue &value) {
             } else {
                 result = gen.null_value();
             }
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             result = gen.string("message", 7);
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             if (exc->message) {
@@ -119,11 +186,11 @@ Generator::Result encode_js_value(Generator &gen, const JsValue &value) {
             } else {
                 result = gen.null_value();
             }
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             result = gen.string("meta", 4);
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             if (exc->meta.type_ == JsNodeType::Undefined) {
@@ -131,25 +198,28 @@ Generator::Result encode_js_value(Generator &gen, const JsValue &value) {
             } else {
                 result = encode_js_value(gen, exc->meta);
             }
-            if (result != Generator::Result::OK) {
+            if (result != GeneratorBase::Result::OK) {
                 return result;
             }
             return gen.map_close();
         }
         case JsNodeType::NativeBinary:
-            return gen.binary(value.nb.data, value.nb.len);
+            return gen.binary(value.nb().data, value.nb().len);
         case JsNodeType::HeapBinary: {
             auto *bin = reinterpret_cast<const GcBinary *>(value.gc);
             if (!bin) {
-                return Generator::Result::InvalidString;
+                return GeneratorBase::Result::InvalidString;
             }
             return gen.binary(bin->data, bin->len);
         }
         case JsNodeType::Undefined:
         case JsNodeType::Interator:
-            return Generator::Result::InvalidValue;
+            return GeneratorBase::Result::InvalidValue;
     }
-    return Generator::Result::InvalidValue;
+    return GeneratorBase::Result::InvalidValue;
 }
 
+template GeneratorBase::Result encode_js_value(Generator &gen, const JsValue &value);
+template GeneratorBase::Result encode_js_value(BufferGenerator &gen, const JsValue &value);
+
 } // namespace fiber::json
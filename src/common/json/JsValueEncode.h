@@ -10,7 +10,12 @@
 
 namespace fiber::json {
 
-Generator::Result encode_js_value(Generator &gen, const JsValue &value);
+// Instantiated for Generator and BufferGenerator.
+template <typename Sink>
+GeneratorBase::Result encode_js_value(BasicGenerator<Sink> &gen, const JsValue &value);
+
+extern template GeneratorBase::Result encode_js_value(Generator &gen, const JsValue &value);
+extern template GeneratorBase::Result encode_js_value(BufferGenerator &gen, const JsValue &value);
 
 } // namespace fiber::json
 
@@ -90,14 +90,15 @@ bool is_truthy(const JsValue &value) {
             return str && str->len > 0;
         }
         case JsNodeType::NativeString:
-            return value.ns.len > 0;
+            return value.ns().len > 0;
         case JsNodeType::NativeBinary:
-            return value.nb.len > 0;
+            return value.nb().len > 0;
         case JsNodeType::HeapBinary:
         case JsNodeType::Array:
         case JsNodeType::Object:
         case JsNodeType::Interator:
         case JsNodeType::Exception:
+        case JsNodeType::LazyJson:
             return true;
     }
     return false;
@@ -111,6 +112,7 @@ enum class StringKind : std::uint8_t {
 
 struct StringSource {
     StringKind kind = StringKind::NativeUtf8;
+    const GcString *str = nullptr;
     const std::uint8_t *bytes = nullptr;
     const char16_t *u16 = nullptr;
     const char *utf8 = nullptr;
@@ -125,6 +127,7 @@ bool build_string_source(const JsValue &value, StringSource &out, JsOpError &err
             error = JsOpError::TypeError;
             return false;
         }
+        out.str = str;
         if (str->encoding == GcStringEncoding::Byte) {
             out.kind = StringKind::HeapByte;
             out.bytes = str->data8;
@@ -138,8 +141,8 @@ bool build_string_source(const JsValue &value, StringSource &out, JsOpError &err
     }
     if (value.type_ == JsNodeType::NativeString) {
         out.kind = StringKind::NativeUtf8;
-        out.utf8 = value.ns.data;
-        out.len = value.ns.len;
+        out.utf8 = value.ns().data;
+        out.len = value.ns().len;
         if (!utf8_scan(out.utf8, out.len, out.scan)) {
             error = JsOpError::InvalidUtf8;
             return false;
@@ -186,14 +189,19 @@ bool concat_strings(GcHeap *heap, const StringSource &lhs, const StringSource &r
         return true;
     }
 
-    if (all_byte) {
-        GcString *result = gc_new_string_bytes_uninit(heap, total_len);
-        if (!result) {
-            error = JsOpError::OutOfMemory;
-            return false;
-        }
+    // A heap string on the left is extended, in place when it ends its
+    // buffer, so a string built up in a loop is not copied every time.
+    const GcString *prefix = lhs.str;
+    std::size_t offset = prefix ? prefix->len : 0;
+    GcString *result = gc_string_extend(heap, prefix, total_len - offset,
+                                        all_byte ? GcStringEncoding::Byte : GcStringEncoding::Utf16);
+    if (!result) {
+        error = JsOpError::OutOfMemory;
+        return false;
+    }
+
+    if (result->encoding == GcStringEncoding::Byte) {
         std::uint8_t *dst = result->data8;
-        std::size_t offset = 0;
         auto append_part = [&](const StringSource &part) -> bool {
             switch (part.kind) {
                 case StringKind::HeapByte:
@@ -213,7 +221,7 @@ bool concat_strings(GcHeap *heap, const StringSource &lhs, const StringSource &r
             }
             return false;
         };
-        if (!append_part(lhs) || !append_part(rhs)) {
+        if ((!prefix && !append_part(lhs)) || !append_part(rhs)) {
             error = JsOpError::InvalidUtf8;
             return false;
         }
@@ -222,13 +230,7 @@ bool concat_strings(GcHeap *heap, const StringSource &lhs, const StringSource &r
         return true;
     }
 
-    GcString *result = gc_new_string_utf16_uninit(heap, total_len);
-    if (!result) {
-        error = JsOpError::OutOfMemory;
-        return false;
-    }
     char16_t *dst = result->data16;
-    std::size_t offset = 0;
     auto append_part = [&](const StringSource &part) -> bool {
         switch (part.kind) {
             case StringKind::HeapUtf16:
@@ -251,7 +253,7 @@ bool concat_strings(GcHeap *heap, const StringSource &lhs, const StringSource &r
         }
         return false;
     };
-    if (!append_part(lhs) || !append_part(rhs)) {
+    if ((!prefix && !append_part(lhs)) || !append_part(rhs)) {
         error = JsOpError::InvalidUtf8;
         return false;
     }
@@ -263,14 +265,14 @@ bool concat_strings(GcHeap *heap, const StringSource &lhs, const StringSource &r
 bool string_to_utf8_copy(const JsValue &value, std::string &out, JsOpError &error) {
     out.clear();
     if (value.type_ == JsNodeType::NativeString) {
-        if (!utf8_validate(value.ns.data, value.ns.len)) {
+        if (!utf8_validate(value.ns().data, value.ns().len)) {
             error = JsOpError::InvalidUtf8;
             return false;
         }
-        if (value.ns.len == 0) {
+        if (value.ns().len == 0) {
             return true;
         }
-        out.assign(value.ns.data, value.ns.len);
+        out.assign(value.ns().data, value.ns().len);
         return true;
     }
     if (value.type_ == JsNodeType::HeapString) {
@@ -350,8 +352,8 @@ bool init_string_cursor(const JsValue &value, StringCursor &out, JsOpError &erro
     }
     if (value.type_ == JsNodeType::NativeString) {
         out.kind = StringKind::NativeUtf8;
-        out.utf8 = value.ns.data;
-        out.len = value.ns.len;
+        out.utf8 = value.ns().data;
+        out.len = value.ns().len;
         if (out.len > 0 && !out.utf8) {
             error = JsOpError::InvalidUtf8;
             return false;
@@ -530,12 +532,13 @@ bool strict_equal(const JsValue &lhs, const JsValue &rhs, JsOpError &error) {
         case JsNodeType::Float:
             return lhs.f == rhs.f;
         case JsNodeType::NativeBinary:
-            return lhs.nb.data == rhs.nb.data && lhs.nb.len == rhs.nb.len;
+            return lhs.nb().data == rhs.nb().data && lhs.nb().len == rhs.nb().len;
         case JsNodeType::HeapBinary:
         case JsNodeType::Array:
         case JsNodeType::Object:
         case JsNodeType::Interator:
         case JsNodeType::Exception:
+        case JsNodeType::LazyJson:
             return lhs.gc == rhs.gc;
         case JsNodeType::HeapString:
         case JsNodeType::NativeString:
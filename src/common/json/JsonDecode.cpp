@@ -4,16 +4,19 @@
 
 #include "JsonDecode.h"
 
-#include <cerrno>
-#include <charconv>
+#include <algorithm>
 #include <cstdint>
-#include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "JsonIndex.h"
+#include "JsonNumber.h"
+
 namespace fiber::json {
 namespace {
 
@@ -128,38 +131,13 @@ Utf8DecodeResult decode_utf8_codepoint(const char *data, std::size_t len, std::s
 
 GcString *make_gc_string(GcHeap &heap, const DecodedString &decoded) {
     if (decoded.is_byte) {
-        return gc_new_string_bytes(&heap, decoded.bytes.data(), decoded.bytes.size());
+        return gc_atom_bytes(&heap, decoded.bytes.data(), decoded.bytes.size());
     }
     return gc_new_string_utf16(&heap, decoded.u16.data(), decoded.u16.size());
 }
 
 bool ensure_array_capacity(GcHeap &heap, GcArray *arr, std::size_t needed) {
-    if (needed <= arr->capacity) {
-        return true;
-    }
-    std::size_t new_capacity = arr->capacity ? arr->capacity * 2 : kInitialContainerCapacity;
-    while (new_capacity < needed) {
-        new_capacity *= 2;
-    }
-    auto *new_elems = static_cast<JsValue *>(heap.alloc.alloc(sizeof(JsValue) * new_capacity));
-    if (!new_elems) {
-        return false;
-    }
-    for (std::size_t i = 0; i < new_capacity; ++i) {
-        std::construct_at(&new_elems[i]);
-    }
-    for (std::size_t i = 0; i < arr->size; ++i) {
-        new_elems[i] = std::move(arr->elems[i]);
-    }
-    if (arr->elems) {
-        for (std::size_t i = 0; i < arr->capacity; ++i) {
-            std::destroy_at(&arr->elems[i]);
-        }
-        heap.alloc.free(arr->elems);
-    }
-    arr->elems = new_elems;
-    arr->capacity = new_capacity;
-    return true;
+    return needed <= arr->capacity || gc_array_reserve(&heap, arr, std::max(needed, kInitialContainerCapacity));
 }
 
 bool set_parse_error(ParseError &error, const char *message, std::size_t offset) {
@@ -207,7 +185,7 @@ bool is_delimiter(char ch) {
     return is_ws(ch) || ch == ',' || ch == ']' || ch == '}' || ch == ':';
 }
 
-LexResult lex_string(const std::string &buffer, std::size_t start, bool final, LexToken &out, ParseError &error,
+LexResult lex_string(std::string_view buffer, std::size_t start, bool final, LexToken &out, ParseError &error,
                      std::size_t total_offset) {
     std::size_t i = start + 1;
     DecodedString decoded;
@@ -347,7 +325,7 @@ LexResult lex_string(const std::string &buffer, std::size_t start, bool final, L
     return LexResult::Error;
 }
 
-LexResult lex_literal(const std::string &buffer, std::size_t start, bool final,
+LexResult lex_literal(std::string_view buffer, std::size_t start, bool final,
                       const char *literal, TokenType type, LexToken &out, ParseError &error,
                       std::size_t total_offset) {
     std::size_t len = std::strlen(literal);
@@ -370,7 +348,7 @@ LexResult lex_literal(const std::string &buffer, std::size_t start, bool final,
     return LexResult::Ok;
 }
 
-LexResult lex_number(const std::string &buffer, std::size_t start, bool final, LexToken &out, ParseError &error,
+LexResult lex_number(std::string_view buffer, std::size_t start, bool final, LexToken &out, ParseError &error,
                      std::size_t total_offset) {
     std::size_t i = start;
     bool is_float = false;
@@ -443,15 +421,13 @@ LexResult lex_number(const std::string &buffer, std::size_t start, bool final, L
     const char *num_start = buffer.data() + start;
     const char *num_end = buffer.data() + i;
     if (is_float) {
-        std::string number(num_start, num_end);
-        errno = 0;
-        char *end_ptr = nullptr;
-        double value = std::strtod(number.c_str(), &end_ptr);
-        if (errno == ERANGE) {
+        double value = 0;
+        std::errc ec = parse_json_double(num_start, num_end, value);
+        if (ec == std::errc::result_out_of_range) {
             set_parse_error(error, "floating point overflow", total_offset + start);
             return LexResult::Error;
         }
-        if (end_ptr != number.c_str() + number.size()) {
+        if (ec != std::errc()) {
             set_parse_error(error, "invalid number", total_offset + start);
             return LexResult::Error;
         }
@@ -459,12 +435,12 @@ LexResult lex_number(const std::string &buffer, std::size_t start, bool final, L
         out.value = JsValue::make_float(value);
     } else {
         int64_t value = 0;
-        auto result = std::from_chars(num_start, num_end, value);
-        if (result.ec == std::errc::result_out_of_range) {
+        std::errc ec = parse_json_int64(num_start, num_end, value);
+        if (ec == std::errc::result_out_of_range) {
             set_parse_error(error, "integer overflow", total_offset + start);
             return LexResult::Error;
         }
-        if (result.ec != std::errc()) {
+        if (ec != std::errc()) {
             set_parse_error(error, "invalid number", total_offset + start);
             return LexResult::Error;
         }
@@ -476,7 +452,7 @@ LexResult lex_number(const std::string &buffer, std::size_t start, bool final, L
     return LexResult::Ok;
 }
 
-LexResult lex_token(const std::string &buffer, std::size_t &pos, bool final, LexToken &out, ParseError &error,
+LexResult lex_token(std::string_view buffer, std::size_t &pos, bool final, LexToken &out, ParseError &error,
                     std::size_t total_offset) {
     std::size_t i = pos;
     while (i < buffer.size() && is_ws(buffer[i])) {
@@ -590,7 +566,18 @@ public:
         return true;
     }
 
-private:
+    void seek(std::size_t pos) {
+        pos_ = pos;
+    }
+
+    void pack_arrays(bool pack) {
+        pack_arrays_ = pack;
+    }
+
+    [[nodiscard]] std::size_t position() const {
+        return pos_;
+    }
+
     bool parse_value(JsValue &out) {
         skip_ws();
         if (pos_ >= len_) {
@@ -728,6 +715,9 @@ private:
             }
             if (data_[pos_] == ']') {
                 pos_ += 1;
+                if (pack_arrays_) {
+                    (void)gc_array_pack(&heap_, arr);
+                }
                 return true;
             }
             return set_error("expected ',' or ']' after array value", pos_);
@@ -875,31 +865,30 @@ private:
         const char *num_start = data_ + start;
         const char *num_end = data_ + pos_;
         if (is_float) {
-            std::string number(num_start, num_end);
-            errno = 0;
-            char *end_ptr = nullptr;
-            double value = std::strtod(number.c_str(), &end_ptr);
-            if (errno == ERANGE) {
+            double value = 0;
+            std::errc ec = parse_json_double(num_start, num_end, value);
+            if (ec == std::errc::result_out_of_range) {
                 return set_error("floating point overflow", start);
             }
-            if (end_ptr != number.c_str() + number.size()) {
+            if (ec != std::errc()) {
                 return set_error("invalid number", start);
             }
             out = JsValue::make_float(value);
             return true;
         }
         int64_t value = 0;
-        auto result = std::from_chars(num_start, num_end, value);
-        if (result.ec == std::errc::result_out_of_range) {
+        std::errc ec = parse_json_int64(num_start, num_end, value);
+        if (ec == std::errc::result_out_of_range) {
             return set_error("integer overflow", start);
         }
-        if (result.ec != std::errc()) {
+        if (ec != std::errc()) {
             return set_error("invalid number", start);
         }
         out = JsValue::make_integer(value);
         return true;
     }
 
+private:
     bool parse_hex(uint32_t &out) {
         if (pos_ + 4 > len_) {
             return set_error("invalid unicode escape", pos_);
@@ -954,12 +943,421 @@ private:
     const char *data_ = nullptr;
     std::size_t len_ = 0;
     std::size_t pos_ = 0;
+    bool pack_arrays_ = false;
 };
 
+// True when the bytes are ASCII without backslashes, i.e. a string body
+// that decodes to itself.
+bool is_plain_string_body(const char *data, std::size_t len) {
+    constexpr std::uint64_t kOnes = 0x0101010101010101ULL;
+    constexpr std::uint64_t kHigh = 0x8080808080808080ULL;
+    std::size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + i, sizeof(word));
+        std::uint64_t backslash = word ^ (kOnes * '\\');
+        if ((word | ((backslash - kOnes) & ~backslash)) & kHigh) {
+            return false;
+        }
+    }
+    for (; i < len; ++i) {
+        auto ch = static_cast<unsigned char>(data[i]);
+        if (ch >= 0x80 || ch == '\\') {
+            return false;
+        }
+    }
+    return true;
+}
+
+const JsValue *force_lazy(GcHeap &heap, GcLazyJson *lazy);
+
+// Stage 2 of the two-stage decoder: walks the structural index instead of
+// the bytes. Only valid documents need to come out right; on anything
+// unexpected it returns false and Parser reruns ParserImpl, which owns the
+// error messages and offsets. With Build off it only checks the document,
+// which is how lazy documents are validated up front.
+template <bool Build>
+class IndexedParserImpl {
+public:
+    IndexedParserImpl(GcHeap &heap,
+                      const char *data,
+                      std::size_t len,
+                      const std::vector<std::uint32_t> &index,
+                      DecodedString &scratch)
+        : heap_(heap), data_(data), len_(len), index_(index), scratch_(scratch),
+          scalar_(heap, scalar_error_, data, len) {}
+
+    bool parse(JsValue &out) {
+        return parse_value(out) && next_ == index_.size();
+    }
+
+    // Decodes the value starting at index entry at of a lazy document,
+    // reusing the cells already handed out for containers inside it.
+    bool parse_at(std::size_t at, LazyJsonDoc *doc, JsValue &out) {
+        next_ = at;
+        doc_ = doc;
+        self_ = at;
+        return parse_value(out);
+    }
+
+    // Records, for each bracket that opens a container, the index entry of
+    // its closing bracket.
+    void record_close(std::vector<std::uint32_t> *close) {
+        close_ = close;
+    }
+
+    // Plain strings point into the input instead of copying it; owner must
+    // keep the input alive.
+    void borrow_from(GcHeader *owner) {
+        owner_ = owner;
+    }
+
+    void pack_arrays(bool pack) {
+        pack_arrays_ = pack;
+        scalar_.pack_arrays(pack);
+    }
+
+private:
+    bool parse_value(JsValue &out) {
+        if (next_ >= index_.size()) {
+            return false;
+        }
+        std::size_t entry = next_++;
+        std::size_t pos = index_[entry];
+        switch (data_[pos]) {
+            case '"': {
+                GcString *str = nullptr;
+                if (!parse_string(pos, str)) {
+                    return false;
+                }
+                if constexpr (Build) {
+                    out.type_ = JsNodeType::HeapString;
+                    out.gc = &str->hdr;
+                }
+                return true;
+            }
+            case '{':
+                if (GcLazyJson *cell = cell_at(entry)) {
+                    return reuse_cell(entry, cell, out);
+                }
+                return parse_object(entry, out);
+            case '[':
+                if (GcLazyJson *cell = cell_at(entry)) {
+                    return reuse_cell(entry, cell, out);
+                }
+                return parse_array(entry, out);
+            case 't':
+                return parse_literal(pos, "true", out, JsValue::make_boolean(true));
+            case 'f':
+                return parse_literal(pos, "false", out, JsValue::make_boolean(false));
+            case 'n':
+                return parse_literal(pos, "null", out, JsValue::make_null());
+            default:
+                scalar_.seek(pos);
+                return scalar_.parse_number(out) && at_boundary(scalar_.position());
+        }
+    }
+
+    bool parse_object(std::size_t entry, JsValue &out) {
+        GcObject *obj = nullptr;
+        if constexpr (Build) {
+            obj = gc_new_object(&heap_, kInitialContainerCapacity);
+            if (!obj) {
+                return false;
+            }
+            out.type_ = JsNodeType::Object;
+            out.gc = &obj->hdr;
+        }
+        if (peek() == '}') {
+            return close_container(entry);
+        }
+        while (true) {
+            if (peek() != '"') {
+                return false;
+            }
+            std::size_t key_pos = index_[next_++];
+            GcString *key = nullptr;
+            if (!parse_string(key_pos, key) || peek() != ':') {
+                return false;
+            }
+            next_ += 1;
+            JsValue value;
+            if (!parse_value(value)) {
+                return false;
+            }
+            if constexpr (Build) {
+                if (!gc_object_set(&heap_, obj, key, std::move(value))) {
+                    return false;
+                }
+            }
+            char ch = peek();
+            if (ch == ',') {
+                next_ += 1;
+                continue;
+            }
+            return ch == '}' && close_container(entry);
+        }
+    }
+
+    bool parse_array(std::size_t entry, JsValue &out) {
+        GcArray *arr = nullptr;
+        if constexpr (Build) {
+            arr = gc_new_array(&heap_, kInitialContainerCapacity);
+            if (!arr) {
+                return false;
+            }
+            out.type_ = JsNodeType::Array;
+            out.gc = &arr->hdr;
+        }
+        if (peek() == ']') {
+            return close_container(entry);
+        }
+        while (true) {
+            JsValue value;
+            if (!parse_value(value)) {
+                return false;
+            }
+            if constexpr (Build) {
+                if (!ensure_array_capacity(heap_, arr, arr->size + 1)) {
+                    return false;
+                }
+                arr->elems[arr->size] = std::move(value);
+                arr->size += 1;
+                arr->version += 1;
+            }
+            char ch = peek();
+            if (ch == ',') {
+                next_ += 1;
+                continue;
+            }
+            if constexpr (Build) {
+                if (ch == ']' && pack_arrays_) {
+                    (void)gc_array_pack(&heap_, arr);
+                }
+            }
+            return ch == ']' && close_container(entry);
+        }
+    }
+
+    bool close_container(std::size_t entry) {
+        if (close_) {
+            (*close_)[entry] = static_cast<std::uint32_t>(next_);
+        }
+        next_ += 1;
+        return true;
+    }
+
+    // A container below the one being decoded that a script already holds a
+    // cell for: share that cell's materialized value so both stay one object.
+    GcLazyJson *cell_at(std::size_t entry) const {
+        if (!Build || !doc_ || entry == self_) {
+            return nullptr;
+        }
+        auto found = doc_->cells.find(static_cast<std::uint32_t>(entry));
+        return found == doc_->cells.end() ? nullptr : found->second;
+    }
+
+    bool reuse_cell(std::size_t entry, GcLazyJson *cell, JsValue &out) {
+        const JsValue *forced = force_lazy(heap_, cell);
+        if (!forced) {
+            return false;
+        }
+        out = *forced;
+        next_ = doc_->close[entry] + 1;
+        return true;
+    }
+
+    // The entry after an opening quote is always its closing quote, so
+    // plain bodies are copied without looking at them twice; anything with
+    // escapes or UTF-8 goes through the scalar decoder.
+    bool parse_string(std::size_t open, GcString *&out) {
+        if (peek() != '"') {
+            return false;
+        }
+        std::size_t close = index_[next_++];
+        const char *body = data_ + open + 1;
+        std::size_t body_len = close - open - 1;
+        if (is_plain_string_body(body, body_len)) {
+            if constexpr (!Build) {
+                return true;
+            }
+            // A borrowed cell costs as much as a short copy; share atoms instead.
+            if (body_len <= heap_.atoms.max_len) {
+                out = gc_atom_bytes(&heap_, reinterpret_cast<const std::uint8_t *>(body), body_len);
+            } else if (owner_) {
+                out = gc_new_string_borrowed(&heap_, owner_, body, body_len);
+            } else {
+                out = gc_new_string_bytes(&heap_, reinterpret_cast<const std::uint8_t *>(body), body_len);
+            }
+            return out != nullptr;
+        }
+        scalar_.seek(open);
+        if (!scalar_.parse_string(scratch_) || scalar_.position() != close + 1) {
+            return false;
+        }
+        if constexpr (!Build) {
+            return true;
+        }
+        out = make_gc_string(heap_, scratch_);
+        return out != nullptr;
+    }
+
+    bool parse_literal(std::size_t pos, std::string_view literal, JsValue &out, const JsValue &value) {
+        if (len_ - pos < literal.size() || std::memcmp(data_ + pos, literal.data(), literal.size()) != 0 ||
+            !at_boundary(pos + literal.size())) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    // A scalar must end where stage 1 saw its token end, otherwise inputs
+    // like "truex" or "1x" would slip through.
+    [[nodiscard]] bool at_boundary(std::size_t end) const {
+        if (end >= len_) {
+            return true;
+        }
+        switch (data_[end]) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+            case ',':
+            case ':':
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case '"':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    [[nodiscard]] char peek() const {
+        return next_ < index_.size() ? data_[index_[next_]] : '\0';
+    }
+
+    GcHeap &heap_;
+    const char *data_ = nullptr;
+    std::size_t len_ = 0;
+    const std::vector<std::uint32_t> &index_;
+    DecodedString &scratch_;
+    ParseError scalar_error_;
+    ParserImpl scalar_;
+    std::size_t next_ = 0;
+    std::vector<std::uint32_t> *close_ = nullptr;
+    LazyJsonDoc *doc_ = nullptr;
+    std::size_t self_ = 0;
+    GcHeader *owner_ = nullptr;
+    bool pack_arrays_ = false;
+};
+
+// Index entry one past the value that starts at entry at.
+std::size_t lazy_value_end(const LazyJsonDoc &doc, std::size_t at) {
+    switch (doc.text[doc.index[at]]) {
+        case '{':
+        case '[':
+            return doc.close[at] + 1;
+        case '"':
+            return at + 2;
+        default:
+            return at + 1;
+    }
+}
+
+bool lazy_is_container(const LazyJsonDoc &doc, std::size_t at) {
+    char ch = doc.text[doc.index[at]];
+    return ch == '{' || ch == '[';
+}
+
+bool lazy_member(GcHeap &heap, GcLazyJson *parent, std::size_t at, JsValue &out) {
+    LazyJsonDoc &doc = *parent->doc;
+    if (lazy_is_container(doc, at)) {
+        auto key = static_cast<std::uint32_t>(at);
+        auto found = doc.cells.find(key);
+        GcLazyJson *cell = found != doc.cells.end() ? found->second : nullptr;
+        if (!cell) {
+            cell = gc_new_lazy_json(&heap, parent->doc, parent->root, key);
+            if (!cell) {
+                return false;
+            }
+            doc.cells.emplace(key, cell);
+        }
+        out.type_ = JsNodeType::LazyJson;
+        out.gc = &cell->hdr;
+        return true;
+    }
+    DecodedString scratch;
+    IndexedParserImpl<true> decoder(heap, doc.text.data(), doc.text.size(), doc.index, scratch);
+    decoder.borrow_from(&parent->root->hdr);
+    return decoder.parse_at(at, nullptr, out);
+}
+
+char16_t string_unit(const GcString *str, std::size_t i) {
+    return str->encoding == GcStringEncoding::Byte ? str->data8[i] : str->data16[i];
+}
+
+// Compares the key whose opening quote is index entry at with key, decoding
+// the source only when it has escapes or non-ASCII bytes.
+bool lazy_key_equals(GcHeap &heap,
+                     const LazyJsonDoc &doc,
+                     std::size_t at,
+                     const GcString *key,
+                     DecodedString &scratch) {
+    std::size_t open = doc.index[at];
+    const char *body = doc.text.data() + open + 1;
+    std::size_t body_len = doc.index[at + 1] - open - 1;
+    if (is_plain_string_body(body, body_len)) {
+        if (key->len != body_len) {
+            return false;
+        }
+        if (key->encoding == GcStringEncoding::Byte) {
+            return std::memcmp(key->data8, body, body_len) == 0;
+        }
+        for (std::size_t i = 0; i < body_len; ++i) {
+            if (key->data16[i] != static_cast<unsigned char>(body[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    ParseError ignored;
+    ParserImpl scalar(heap, ignored, doc.text.data(), doc.text.size());
+    scalar.seek(open);
+    if (!scalar.parse_string(scratch) || scratch.size() != key->len) {
+        return false;
+    }
+    for (std::size_t i = 0; i < key->len; ++i) {
+        char16_t unit = scratch.is_byte ? scratch.bytes[i] : scratch.u16[i];
+        if (unit != string_unit(key, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const JsValue *force_lazy(GcHeap &heap, GcLazyJson *lazy) {
+    if (lazy->forced.type_ == JsNodeType::Undefined) {
+        LazyJsonDoc &doc = *lazy->doc;
+        DecodedString scratch;
+        IndexedParserImpl<true> decoder(heap, doc.text.data(), doc.text.size(), doc.index, scratch);
+        decoder.borrow_from(&lazy->root->hdr);
+        decoder.pack_arrays(doc.pack_arrays);
+        JsValue out;
+        if (!decoder.parse_at(lazy->at, &doc, out)) {
+            return nullptr;
+        }
+        lazy->forced = std::move(out);
+    }
+    return &lazy->forced;
+}
+
 } // namespace
 
-Parser::Parser(GcHeap &heap)
-    : heap_(heap) {}
+Parser::Parser(GcHeap &heap, Backend backend)
+    : heap_(heap), backend_(backend) {}
 
 bool Parser::parse(const char *data, std::size_t len, JsValue &out) {
     error_ = {};
@@ -968,7 +1366,18 @@ bool Parser::parse(const char *data, std::size_t len, JsValue &out) {
         error_.offset = 0;
         return false;
     }
-    ParserImpl impl(heap_, error_, data ? data : "", len);
+    if (!data) {
+        data = "";
+    }
+    if (backend_ == Backend::Indexed && build_structural_index(data, len, index_)) {
+        IndexedParserImpl<true> indexed(heap_, data, len, index_, scratch_);
+        indexed.pack_arrays(pack_arrays_);
+        if (indexed.parse(out)) {
+            return true;
+        }
+    }
+    ParserImpl impl(heap_, error_, data, len);
+    impl.pack_arrays(pack_arrays_);
     return impl.parse(out);
 }
 
@@ -976,10 +1385,189 @@ bool Parser::parse(const std::string &data, JsValue &out) {
     return parse(data.data(), data.size(), out);
 }
 
+bool Parser::parse_borrowed(std::shared_ptr<const std::string> data, JsValue &out) {
+    error_ = {};
+    if (!data) {
+        error_.message = "input is null";
+        error_.offset = 0;
+        return false;
+    }
+    const char *text = data->data();
+    std::size_t len = data->size();
+    if (backend_ == Backend::Indexed && build_structural_index(text, len, index_)) {
+        GcBuffer *buffer = gc_new_buffer(&heap_, data);
+        if (buffer) {
+            IndexedParserImpl<true> indexed(heap_, text, len, index_, scratch_);
+            indexed.borrow_from(&buffer->hdr);
+            indexed.pack_arrays(pack_arrays_);
+            if (indexed.parse(out)) {
+                return true;
+            }
+        }
+    }
+    ParserImpl impl(heap_, error_, text, len);
+    impl.pack_arrays(pack_arrays_);
+    return impl.parse(out);
+}
+
+bool Parser::parse_lazy(const char *data, std::size_t len, JsValue &out) {
+    error_ = {};
+    if (!data && len > 0) {
+        error_.message = "input is null";
+        error_.offset = 0;
+        return false;
+    }
+    auto doc = std::make_shared<LazyJsonDoc>();
+    doc->text.assign(data ? data : "", len);
+    doc->pack_arrays = pack_arrays_;
+    const char *text = doc->text.data();
+    if (build_structural_index(text, len, doc->index) && !doc->index.empty() &&
+        (text[doc->index[0]] == '{' || text[doc->index[0]] == '[')) {
+        doc->close.assign(doc->index.size(), 0);
+        IndexedParserImpl<false> checker(heap_, text, len, doc->index, scratch_);
+        checker.record_close(&doc->close);
+        JsValue ignored;
+        if (checker.parse(ignored)) {
+            GcLazyJson *root = gc_new_lazy_json(&heap_, doc, nullptr, 0);
+            if (root) {
+                doc->cells.emplace(0, root);
+                out.type_ = JsNodeType::LazyJson;
+                out.gc = &root->hdr;
+                return true;
+            }
+        }
+    }
+    // Scalars are not worth a cell, and errors come from the scalar decoder.
+    return parse(text, len, out);
+}
+
+bool Parser::parse_lazy(const std::string &data, JsValue &out) {
+    return parse_lazy(data.data(), data.size(), out);
+}
+
 const ParseError &Parser::error() const {
     return error_;
 }
 
+void Parser::set_pack_arrays(bool pack) {
+    pack_arrays_ = pack;
+}
+
+bool lazy_json_is_array(const GcLazyJson *lazy) {
+    const LazyJsonDoc &doc = *lazy->doc;
+    return doc.text[doc.index[lazy->at]] == '[';
+}
+
+std::size_t lazy_json_size(GcHeap &heap, const GcLazyJson *lazy) {
+    if (lazy->forced.type_ == JsNodeType::Array) {
+        return reinterpret_cast<const GcArray *>(lazy->forced.gc)->size;
+    }
+    if (lazy->forced.type_ == JsNodeType::Object) {
+        return reinterpret_cast<const GcObject *>(lazy->forced.gc)->size;
+    }
+    const LazyJsonDoc &doc = *lazy->doc;
+    std::size_t end = doc.close[lazy->at];
+    if (lazy_json_is_array(lazy)) {
+        std::size_t count = 0;
+        for (std::size_t at = lazy->at + 1; at < end; at = lazy_value_end(doc, at) + 1) {
+            count += 1;
+        }
+        return count;
+    }
+    // Duplicate keys collapse to one member, as in a full decode, so count
+    // distinct decoded keys.
+    std::unordered_set<std::u16string> keys;
+    DecodedString scratch;
+    for (std::size_t at = lazy->at + 1; at < end; at = lazy_value_end(doc, at + 3) + 1) {
+        std::size_t open = doc.index[at];
+        const char *body = doc.text.data() + open + 1;
+        std::size_t body_len = doc.index[at + 1] - open - 1;
+        if (is_plain_string_body(body, body_len)) {
+            keys.emplace(body, body + body_len);
+            continue;
+        }
+        ParseError ignored;
+        ParserImpl scalar(heap, ignored, doc.text.data(), doc.text.size());
+        scalar.seek(open);
+        if (!scalar.parse_string(scratch)) {
+            continue;
+        }
+        if (scratch.is_byte) {
+            keys.emplace(scratch.bytes.begin(), scratch.bytes.end());
+        } else {
+            keys.emplace(scratch.u16.begin(), scratch.u16.end());
+        }
+    }
+    return keys.size();
+}
+
+bool lazy_json_get(GcHeap &heap, GcLazyJson *lazy, const GcString *key, JsValue &out) {
+    out = JsValue::make_undefined();
+    if (lazy->forced.type_ == JsNodeType::Object) {
+        const JsValue *found = gc_object_get(reinterpret_cast<const GcObject *>(lazy->forced.gc), key);
+        if (found) {
+            out = *found;
+        }
+        return true;
+    }
+    if (lazy->forced.type_ != JsNodeType::Undefined || lazy_json_is_array(lazy)) {
+        return true;
+    }
+    const LazyJsonDoc &doc = *lazy->doc;
+    std::size_t end = doc.close[lazy->at];
+    std::size_t match = 0;
+    DecodedString scratch;
+    // Duplicate keys resolve to the last one, as in a full decode.
+    for (std::size_t at = lazy->at + 1; at < end; at = lazy_value_end(doc, at + 3) + 1) {
+        if (lazy_key_equals(heap, doc, at, key, scratch)) {
+            match = at + 3;
+        }
+    }
+    return match == 0 || lazy_member(heap, lazy, match, out);
+}
+
+bool lazy_json_at(GcHeap &heap, GcLazyJson *lazy, std::size_t index, JsValue &out) {
+    out = JsValue::make_undefined();
+    if (lazy->forced.type_ == JsNodeType::Array) {
+        const auto *arr = reinterpret_cast<const GcArray *>(lazy->forced.gc);
+        if (index < arr->size) {
+            out = gc_array_at(arr, index);
+        }
+        return true;
+    }
+    if (lazy->forced.type_ != JsNodeType::Undefined || !lazy_json_is_array(lazy)) {
+        return true;
+    }
+    const LazyJsonDoc &doc = *lazy->doc;
+    std::size_t end = doc.close[lazy->at];
+    for (std::size_t at = lazy->at + 1; at < end; at = lazy_value_end(doc, at) + 1) {
+        if (index-- == 0) {
+            return lazy_member(heap, lazy, at, out);
+        }
+    }
+    return true;
+}
+
+const JsValue *lazy_json_force(GcHeap &heap, GcLazyJson *lazy) {
+    return force_lazy(heap, lazy);
+}
+
+bool lazy_json_text(const GcLazyJson *lazy, const char *&data, std::size_t &len) {
+    if (lazy->forced.type_ != JsNodeType::Undefined) {
+        return false;
+    }
+    const LazyJsonDoc &doc = *lazy->doc;
+    std::uint32_t end = doc.close[lazy->at];
+    for (const auto &cell : doc.cells) {
+        if (cell.first > lazy->at && cell.first < end && cell.second->forced.type_ != JsNodeType::Undefined) {
+            return false;
+        }
+    }
+    data = doc.text.data() + doc.index[lazy->at];
+    len = doc.index[end] - doc.index[lazy->at] + 1;
+    return true;
+}
+
 StreamParser::StreamParser(GcHeap &heap)
     : heap_(heap) {
     reset();
@@ -990,29 +1578,35 @@ void StreamParser::reset() {
     root_ = JsValue();
     has_result_ = false;
     complete_ = false;
-    buffer_.clear();
-    pos_ = 0;
+    carry_.clear();
+    carry_offset_ = 0;
+    carry_escape_ = false;
     total_offset_ = 0;
     state_stack_.clear();
     state_stack_.push_back(ParseState::Start);
     containers_.clear();
 }
 
+void StreamParser::set_handler(StreamHandler *handler) {
+    handler_ = handler;
+}
+
+void StreamParser::set_pack_arrays(bool pack) {
+    pack_arrays_ = pack;
+}
+
 StreamParser::Status StreamParser::parse(const char *data, std::size_t len) {
     if (!data && len > 0) {
-        (void)set_error("input is null", total_offset_ + pos_);
+        (void)set_error("input is null", total_offset_);
         return Status::Error;
     }
-    if (complete_) {
-        buffer_.append(data ? data : "", len);
-        return parse_internal(false);
-    }
-    buffer_.append(data ? data : "", len);
-    return parse_internal(false);
+    Status status = parse_internal(std::string_view(data ? data : "", len), false);
+    total_offset_ += len;
+    return status;
 }
 
 StreamParser::Status StreamParser::finish() {
-    return parse_internal(true);
+    return parse_internal({}, true);
 }
 
 const ParseError &StreamParser::error() const {
@@ -1027,11 +1621,80 @@ bool StreamParser::has_result() const {
     return has_result_;
 }
 
-StreamParser::Status StreamParser::parse_internal(bool final) {
+StreamParser::Status StreamParser::parse_internal(std::string_view input, bool final) {
     auto current_state = [&]() -> ParseState & {
         return state_stack_.back();
     };
 
+    // Tokens are lexed in place from input. One cut off by the end of the
+    // chunk is copied to carry_ and completed from the following chunks,
+    // taking only the bytes up to where it can end: the closing quote for
+    // strings, the next delimiter for everything else. The search resumes
+    // where it stopped (carry_escape_ says whether the carry ends inside an
+    // escape), so each byte is scanned once and the carry is lexed once.
+    std::size_t pos = 0;
+    auto next_token = [&](LexToken &tok) -> LexResult {
+        if (carry_.empty()) {
+            LexResult result = lex_token(input, pos, final, tok, error_, total_offset_);
+            if (result == LexResult::NeedMore) {
+                carry_offset_ = total_offset_ + pos;
+                carry_.assign(input.data() + pos, input.size() - pos);
+                carry_escape_ = false;
+                if (carry_[0] == '\"') {
+                    for (std::size_t i = 1; i < carry_.size(); ++i) {
+                        carry_escape_ = !carry_escape_ && carry_[i] == '\\';
+                    }
+                }
+                pos = input.size();
+            }
+            return result;
+        }
+        bool is_string = carry_[0] == '\"';
+        while (true) {
+            std::size_t take = input.size() - pos;
+            bool ended = false;
+            for (std::size_t i = pos; i < input.size(); ++i) {
+                char ch = input[i];
+                if (is_string) {
+                    if (carry_escape_) {
+                        carry_escape_ = false;
+                        continue;
+                    }
+                    if (ch == '\\') {
+                        carry_escape_ = true;
+                        continue;
+                    }
+                    ended = ch == '\"';
+                } else {
+                    ended = is_delimiter(ch);
+                }
+                if (ended) {
+                    take = i + 1 - pos;
+                    break;
+                }
+            }
+            carry_.append(input.data() + pos, take);
+            pos += take;
+            if (!ended && !final) {
+                return LexResult::NeedMore;
+            }
+            std::size_t at = 0;
+            LexResult result = lex_token(carry_, at, final, tok, error_, carry_offset_);
+            if (result == LexResult::NeedMore && pos < input.size()) {
+                continue;
+            }
+            if (result == LexResult::Ok) {
+                pos -= carry_.size() - tok.end;
+                carry_.clear();
+            }
+            return result;
+        }
+    };
+
+    auto notify = [&](bool ok, std::size_t offset) -> bool {
+        return ok || set_error("stopped by stream handler", offset);
+    };
+
     auto can_accept_value = [&]() -> bool {
         ParseState state = current_state();
         return state == ParseState::Start || state == ParseState::MapNeedVal ||
@@ -1061,10 +1724,15 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
             if (has_result_) {
                 return set_error("multiple top-level values", offset);
             }
-            root_ = std::move(value);
+            if (!handler_) {
+                root_ = std::move(value);
+            }
             has_result_ = true;
             return true;
         }
+        if (handler_) {
+            return true;
+        }
         ContainerFrame &frame = containers_.back();
         if (frame.type == JsNodeType::Array) {
             if (!ensure_array_capacity(heap_, frame.array, frame.array->size + 1)) {
@@ -1097,6 +1765,16 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
         if (!can_accept_value()) {
             return set_error("unexpected '{'", offset);
         }
+        if (handler_) {
+            if (!add_value(JsValue(), offset) || !notify(handler_->map_open(), offset)) {
+                return false;
+            }
+            ContainerFrame frame;
+            frame.type = JsNodeType::Object;
+            containers_.push_back(frame);
+            state_stack_.push_back(ParseState::MapStart);
+            return true;
+        }
         GcObject *obj = gc_new_object(&heap_, kInitialContainerCapacity);
         if (!obj) {
             return set_error("out of memory", offset);
@@ -1119,6 +1797,16 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
         if (!can_accept_value()) {
             return set_error("unexpected '['", offset);
         }
+        if (handler_) {
+            if (!add_value(JsValue(), offset) || !notify(handler_->array_open(), offset)) {
+                return false;
+            }
+            ContainerFrame frame;
+            frame.type = JsNodeType::Array;
+            containers_.push_back(frame);
+            state_stack_.push_back(ParseState::ArrayStart);
+            return true;
+        }
         GcArray *arr = gc_new_array(&heap_, kInitialContainerCapacity);
         if (!arr) {
             return set_error("out of memory", offset);
@@ -1141,7 +1829,14 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
         if (containers_.empty() || containers_.back().type != type) {
             return set_error("mismatched container close", offset);
         }
+        if (type == JsNodeType::Array && !handler_ && pack_arrays_) {
+            (void)gc_array_pack(&heap_, containers_.back().array);
+        }
         containers_.pop_back();
+        if (handler_ &&
+            !notify(type == JsNodeType::Object ? handler_->map_close() : handler_->array_close(), offset)) {
+            return false;
+        }
         if (state_stack_.size() <= 1) {
             return set_error("invalid parser state", offset);
         }
@@ -1152,6 +1847,9 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
     auto value_from_token = [&](const LexToken &tok, JsValue &value) -> bool {
         switch (tok.type) {
             case TokenType::String: {
+                if (handler_) {
+                    return notify(handler_->string(tok.text), tok.offset);
+                }
                 GcString *str = make_gc_string(heap_, tok.text);
                 if (!str) {
                     return set_error("out of memory", tok.offset);
@@ -1162,35 +1860,34 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
             }
             case TokenType::Number:
                 value = tok.value;
-                return true;
+                break;
             case TokenType::True:
                 value = JsValue::make_boolean(true);
-                return true;
+                break;
             case TokenType::False:
                 value = JsValue::make_boolean(false);
-                return true;
+                break;
             case TokenType::Null:
                 value = JsValue::make_null();
-                return true;
+                break;
             default:
                 return set_error("invalid value token", tok.offset);
         }
+        return !handler_ || notify(handler_->scalar(value), tok.offset);
     };
 
     while (true) {
         if (current_state() == ParseState::ParseComplete) {
-            while (pos_ < buffer_.size() && is_ws(buffer_[pos_])) {
-                pos_ += 1;
+            while (carry_.empty() && pos < input.size() && is_ws(input[pos])) {
+                pos += 1;
             }
-            if (pos_ == buffer_.size()) {
-                compact_buffer();
+            if (carry_.empty() && pos == input.size()) {
                 complete_ = true;
                 return Status::Complete;
             }
             LexToken extra;
-            LexResult extra_result = lex_token(buffer_, pos_, final, extra, error_, total_offset_);
+            LexResult extra_result = next_token(extra);
             if (extra_result == LexResult::NeedMore) {
-                compact_buffer();
                 complete_ = true;
                 return Status::Complete;
             }
@@ -1204,9 +1901,8 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
         }
 
         LexToken tok;
-        LexResult result = lex_token(buffer_, pos_, final, tok, error_, total_offset_);
+        LexResult result = next_token(tok);
         if (result == LexResult::NeedMore) {
-            compact_buffer();
             return Status::NeedMore;
         }
         if (result == LexResult::Error) {
@@ -1215,11 +1911,10 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
         }
         if (tok.type == TokenType::End) {
             if (final) {
-                (void)set_error("premature EOF", total_offset_ + pos_);
+                (void)set_error("premature EOF", total_offset_ + pos);
                 current_state() = ParseState::ParseError;
                 return Status::Error;
             }
-            compact_buffer();
             return Status::NeedMore;
         }
 
@@ -1244,7 +1939,14 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
                     current_state() = ParseState::ParseError;
                     return Status::Error;
                 }
-                containers_.back().key = tok.text;
+                if (handler_) {
+                    if (!notify(handler_->map_key(tok.text), tok.offset)) {
+                        current_state() = ParseState::ParseError;
+                        return Status::Error;
+                    }
+                } else {
+                    containers_.back().key = std::move(tok.text);
+                }
                 containers_.back().has_key = true;
                 state = ParseState::MapSep;
                 break;
@@ -1341,15 +2043,6 @@ StreamParser::Status StreamParser::parse_internal(bool final) {
     }
 }
 
-void StreamParser::compact_buffer() {
-    if (pos_ == 0) {
-        return;
-    }
-    total_offset_ += pos_;
-    buffer_.erase(0, pos_);
-    pos_ = 0;
-}
-
 void StreamParser::clear_error() {
     error_ = {};
 }
@@ -7,7 +7,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "JsGc.h"
@@ -37,7 +39,15 @@ struct DecodedString {
 
 class Parser {
 public:
-    explicit Parser(GcHeap &heap);
+    // Indexed builds a structural index with SIMD first and walks that
+    // (see JsonIndex.h); Scalar is the byte-at-a-time recursive descent.
+    // Both produce identical values and errors.
+    enum class Backend {
+        Indexed,
+        Scalar,
+    };
+
+    explicit Parser(GcHeap &heap, Backend backend = Backend::Indexed);
     Parser(const Parser &) = delete;
     Parser &operator=(const Parser &) = delete;
     Parser(Parser &&) = delete;
@@ -45,13 +55,69 @@ public:
 
     [[nodiscard]] bool parse(const char *data, std::size_t len, JsValue &out);
     [[nodiscard]] bool parse(const std::string &data, JsValue &out);
+    // Like parse, but ASCII strings without escapes point into data rather
+    // than being copied; data stays pinned while any of them is reachable.
+    // Only the Indexed backend borrows.
+    [[nodiscard]] bool parse_borrowed(std::shared_ptr<const std::string> data, JsValue &out);
+    // Validates the whole input but builds nothing: an object or array
+    // comes back as a LazyJson value over a private copy of the text, whose
+    // members are decoded when accessed (see lazy_json_get). Scalar
+    // documents are decoded as by parse.
+    [[nodiscard]] bool parse_lazy(const char *data, std::size_t len, JsValue &out);
+    [[nodiscard]] bool parse_lazy(const std::string &data, JsValue &out);
     [[nodiscard]] const ParseError &error() const;
+    // Store arrays of only integers or only floats packed (see
+    // GcArrayKind), including those a lazy document materializes later.
+    // Off by default: packed elements have no JsValue to point at, so only
+    // callers that read through gc_array_at should turn it on.
+    void set_pack_arrays(bool pack);
 
 private:
     GcHeap &heap_;
+    Backend backend_;
+    bool pack_arrays_ = false;
     ParseError error_;
+    std::vector<std::uint32_t> index_;
+    DecodedString scratch_;
+};
+
+// Access to LazyJson cells. Containers found inside come back as further
+// LazyJson cells, scalars as ordinary values; the getters return false only
+// when out of memory and leave out undefined for missing members. Once a
+// cell is forced they read the materialized value instead.
+[[nodiscard]] bool lazy_json_is_array(const GcLazyJson *lazy);
+[[nodiscard]] std::size_t lazy_json_size(GcHeap &heap, const GcLazyJson *lazy);
+[[nodiscard]] bool lazy_json_get(GcHeap &heap, GcLazyJson *lazy, const GcString *key, JsValue &out);
+[[nodiscard]] bool lazy_json_at(GcHeap &heap, GcLazyJson *lazy, std::size_t index, JsValue &out);
+// Materializes the container as a GcObject/GcArray, once, reusing the cells
+// already handed out for nested containers; nullptr when out of memory.
+[[nodiscard]] const JsValue *lazy_json_force(GcHeap &heap, GcLazyJson *lazy);
+// The source text of the container while neither it nor anything inside it
+// has been forced, i.e. while re-encoding it verbatim is exact.
+[[nodiscard]] bool lazy_json_text(const GcLazyJson *lazy, const char *&data, std::size_t &len);
+
+// Receives a StreamParser's document as events instead of a tree, so a
+// body can be checked or rewritten in constant memory while it arrives.
+// Strings are decoded and only valid during the call; returning false stops
+// the parse with an error.
+class StreamHandler {
+public:
+    virtual ~StreamHandler() = default;
+
+    virtual bool map_open() = 0;
+    virtual bool map_key(const DecodedString &key) = 0;
+    virtual bool map_close() = 0;
+    virtual bool array_open() = 0;
+    virtual bool array_close() = 0;
+    virtual bool string(const DecodedString &value) = 0;
+    // Numbers, booleans and null.
+    virtual bool scalar(const JsValue &value) = 0;
 };
 
+// Parses a document delivered in chunks. Each chunk is read in place and
+// need not outlive the call; only a token split across chunks is copied.
+// Without a handler the tree is built as values arrive, so root() is the
+// partial document after NeedMore.
 class StreamParser {
 public:
     enum class Status {
@@ -68,6 +134,10 @@ public:
     StreamParser &operator=(StreamParser &&) = delete;
 
     void reset();
+    // Applies until changed; reset() keeps it.
+    void set_handler(StreamHandler *handler);
+    // As Parser::set_pack_arrays, for the built tree; reset() keeps it.
+    void set_pack_arrays(bool pack);
     [[nodiscard]] Status parse(const char *data, std::size_t len);
     [[nodiscard]] Status finish();
     [[nodiscard]] const ParseError &error() const;
@@ -102,14 +172,16 @@ private:
     JsValue root_;
     bool has_result_ = false;
     bool complete_ = false;
-    std::string buffer_;
-    std::size_t pos_ = 0;
+    StreamHandler *handler_ = nullptr;
+    bool pack_arrays_ = false;
+    std::string carry_;
+    std::size_t carry_offset_ = 0;
+    bool carry_escape_ = false;
     std::size_t total_offset_ = 0;
     std::vector<ParseState> state_stack_;
     std::vector<ContainerFrame> containers_;
 
-    Status parse_internal(bool final);
-    void compact_buffer();
+    Status parse_internal(std::string_view input, bool final);
     void clear_error();
     [[nodiscard]] bool set_error(const char *message, std::size_t offset);
 };
@@ -1,12 +1,17 @@
 #include "JsonEncode.h"
 
 #include "JsGc.h"
+#include "JsonNumber.h"
 
-#include <charconv>
 #include <cmath>
-#include <limits>
+#include <cstring>
+#include <new>
 #include <string>
-#include <system_error>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace fiber::json {
     namespace {
@@ -108,8 +113,242 @@ namespace fiber::json {
             return out;
         }
 
+        bool needs_escape(unsigned char ch, bool solidus) {
+            return ch < 0x20 || ch == '\"' || ch == '\\' || (solidus && ch == '/');
+        }
+
+        // Length of the prefix write_string can copy as is: up to the first
+        // byte that needs an escape, or with high set the first non-ASCII
+        // byte (Latin-1 strings transcode those).
+        size_t scan_scalar(const unsigned char *p, size_t len, bool solidus, bool high) {
+            for (size_t i = 0; i < len; ++i) {
+                if (needs_escape(p[i], solidus) || (high && p[i] >= 0x80)) {
+                    return i;
+                }
+            }
+            return len;
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        size_t scan_sse2(const unsigned char *p, size_t len, bool solidus, bool high) {
+            const __m128i quote = _mm_set1_epi8('\"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            // Without EscapeSolidus this just finds quotes a second time.
+            const __m128i slash = _mm_set1_epi8(solidus ? '/' : '\"');
+            const __m128i ceiling = _mm_set1_epi8(0x1F);
+            size_t i = 0;
+            for (; i + 16 <= len; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(v, slash),
+                                                        _mm_cmpeq_epi8(_mm_max_epu8(v, ceiling), ceiling)));
+                auto mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+                if (high) {
+                    mask |= static_cast<unsigned>(_mm_movemask_epi8(v));
+                }
+                if (mask) {
+                    return i + static_cast<size_t>(__builtin_ctz(mask));
+                }
+            }
+            return i + scan_scalar(p + i, len - i, solidus, high);
+        }
+
+        __attribute__((target("avx2"))) size_t scan_avx2(const unsigned char *p, size_t len, bool solidus,
+                                                         bool high) {
+            const __m256i quote = _mm256_set1_epi8('\"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i slash = _mm256_set1_epi8(solidus ? '/' : '\"');
+            const __m256i ceiling = _mm256_set1_epi8(0x1F);
+            size_t i = 0;
+            for (; i + 32 <= len; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                __m256i hit = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, slash), _mm256_cmpeq_epi8(_mm256_max_epu8(v, ceiling), ceiling)));
+                auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hit));
+                if (high) {
+                    mask |= static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+                }
+                if (mask) {
+                    return i + static_cast<size_t>(__builtin_ctz(mask));
+                }
+            }
+            return i + scan_sse2(p + i, len - i, solidus, high);
+        }
+#endif
+
+        size_t scan_plain(const unsigned char *p, size_t len, bool solidus, bool high) {
+#if defined(__x86_64__) || defined(__i386__)
+            if (len >= 16) {
+                static const bool avx2 = __builtin_cpu_supports("avx2");
+                return avx2 ? scan_avx2(p, len, solidus, high) : scan_sse2(p, len, solidus, high);
+            }
+#endif
+            return scan_scalar(p, len, solidus, high);
+        }
+
+        // Gathers the pieces of one encoded string and hands them to the sink
+        // in batches through writev: clean runs by reference, escapes and
+        // transcoded characters through a small staging area.
+        template <typename Sink>
+        class StringWriter {
+        public:
+            explicit StringWriter(Sink &sink)
+                : sink_(sink) {}
+
+            // data must stay valid until the next flush.
+            [[nodiscard]] bool run(const char *data, size_t len) {
+                if (len == 0) {
+                    return true;
+                }
+                if (count_ == kParts && !flush()) {
+                    return false;
+                }
+                parts_[count_++] = {data, len};
+                return true;
+            }
+
+            // Room for n more bytes in the staging area.
+            [[nodiscard]] char *stage(size_t n) {
+                if ((kStage - staged_ < n || count_ == kParts) && !flush()) {
+                    return nullptr;
+                }
+                char *dst = stage_ + staged_;
+                staged_ += n;
+                if (count_ > 0 && parts_[count_ - 1].data + parts_[count_ - 1].len == dst) {
+                    parts_[count_ - 1].len += n;
+                } else {
+                    parts_[count_++] = {dst, n};
+                }
+                return dst;
+            }
+
+            [[nodiscard]] bool put(char ch) {
+                char *dst = stage(1);
+                if (!dst) {
+                    return false;
+                }
+                *dst = ch;
+                return true;
+            }
+
+            [[nodiscard]] bool escape(unsigned char ch) {
+                const char *esc = nullptr;
+                switch (ch) {
+                    case '\"':
+                        esc = "\\\"";
+                        break;
+                    case '\\':
+                        esc = "\\\\";
+                        break;
+                    case '\b':
+                        esc = "\\b";
+                        break;
+                    case '\f':
+                        esc = "\\f";
+                        break;
+                    case '\n':
+                        esc = "\\n";
+                        break;
+                    case '\r':
+                        esc = "\\r";
+                        break;
+                    case '\t':
+                        esc = "\\t";
+                        break;
+                    case '/':
+                        esc = "\\/";
+                        break;
+                    default:
+                        break;
+                }
+                if (esc) {
+                    char *dst = stage(2);
+                    if (!dst) {
+                        return false;
+                    }
+                    std::memcpy(dst, esc, 2);
+                    return true;
+                }
+                char *dst = stage(6);
+                if (!dst) {
+                    return false;
+                }
+                const char *hex = "0123456789ABCDEF";
+                std::memcpy(dst, "\\u00", 4);
+                dst[4] = hex[(ch >> 4) & 0x0F];
+                dst[5] = hex[ch & 0x0F];
+                return true;
+            }
+
+            [[nodiscard]] bool flush() {
+                bool ok = count_ == 0 || sink_.writev(parts_, count_);
+                count_ = 0;
+                staged_ = 0;
+                return ok;
+            }
+
+        private:
+            static constexpr size_t kParts = 32;
+            static constexpr size_t kStage = 256;
+
+            Sink &sink_;
+            OutputSlice parts_[kParts];
+            size_t count_ = 0;
+            char stage_[kStage];
+            size_t staged_ = 0;
+        };
+
     } // namespace
 
+    bool OutputSink::writev(const OutputSlice *parts, size_t count) {
+        char buf[1024];
+        size_t used = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const OutputSlice &part = parts[i];
+            if (part.len > sizeof(buf) - used) {
+                if (used > 0 && !write(buf, used)) {
+                    return false;
+                }
+                used = 0;
+                if (part.len > sizeof(buf)) {
+                    if (!write(part.data, part.len)) {
+                        return false;
+                    }
+                    continue;
+                }
+            }
+            std::memcpy(buf + used, part.data, part.len);
+            used += part.len;
+        }
+        return used == 0 || write(buf, used);
+    }
+
+    bool BufferSink::reserve(size_t capacity) {
+        return capacity <= capacity_ || grow(capacity - size_);
+    }
+
+    bool BufferSink::grow(size_t extra) {
+        size_t needed = size_ + extra;
+        if (needed < size_) {
+            return false;
+        }
+        size_t capacity = capacity_ < 256 ? 256 : capacity_;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        auto data = std::unique_ptr<char[]>(new (std::nothrow) char[capacity]);
+        if (!data) {
+            return false;
+        }
+        if (size_ > 0) {
+            std::memcpy(data.get(), data_.get(), size_);
+        }
+        data_ = std::move(data);
+        capacity_ = capacity;
+        return true;
+    }
+
     CallbackSink::CallbackSink(PrintCallback cb, void *ctx)
         : callback_(cb), ctx_(ctx) {}
 
@@ -120,18 +359,21 @@ namespace fiber::json {
         return callback_(ctx_, data, len) == 0;
     }
 
-    Generator::Generator(OutputSink &sink)
+    template <typename Sink>
+    BasicGenerator<Sink>::BasicGenerator(Sink &sink)
         : sink_(sink) {
         clear();
     }
 
-    void Generator::clear() {
+    template <typename Sink>
+    void BasicGenerator<Sink>::clear() {
         sink_.reset();
         depth_ = 1;
         state_stack_[0] = State::Start;
     }
 
-    void Generator::set_option(Option opt, bool enabled) {
+    template <typename Sink>
+    void BasicGenerator<Sink>::set_option(Option opt, bool enabled) {
         uint32_t bit = static_cast<uint32_t>(opt);
         if (enabled) {
             options_ |= bit;
@@ -140,14 +382,17 @@ namespace fiber::json {
         }
     }
 
-    void Generator::set_indent_string(const std::string &indent) {
+    template <typename Sink>
+    void BasicGenerator<Sink>::set_indent_string(const std::string &indent) {
         indent_string_ = indent;
         set_option(Option::IndentString, true);
     }
 
-    Generator::State Generator::get_state() const { return current_state(); }
+    template <typename Sink>
+    GeneratorBase::State BasicGenerator<Sink>::get_state() const { return current_state(); }
 
-    Generator::Result Generator::map_open() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::map_open() {
         Result result = prefix_for_value();
         if (result != Result::OK) {
             return result;
@@ -159,7 +404,8 @@ namespace fiber::json {
         return push(State::MapStart);
     }
 
-    Generator::Result Generator::map_close() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::map_close() {
         State state = current_state();
         if (state != State::MapStart && state != State::MapKey) {
             return set_error(Result::ErrorState);
@@ -185,7 +431,8 @@ namespace fiber::json {
         return finish_value();
     }
 
-    Generator::Result Generator::array_open() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::array_open() {
         Result result = prefix_for_value();
         if (result != Result::OK) {
             return result;
@@ -197,7 +444,8 @@ namespace fiber::json {
         return push(State::ArrayStart);
     }
 
-    Generator::Result Generator::array_close() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::array_close() {
         State state = current_state();
         if (state != State::ArrayStart && state != State::InArray) {
             return set_error(Result::ErrorState);
@@ -223,29 +471,10 @@ namespace fiber::json {
         return finish_value();
     }
 
-    Generator::Result Generator::string(const char *str, size_t len) {
-        State state = current_state();
-        if (state == State::MapStart || state == State::MapKey) {
-            Result result = prefix_for_key();
-            if (result != Result::OK) {
-                return result;
-            }
-            result = write_string(str, len);
-            if (result != Result::OK) {
-                return result;
-            }
-            if (has_option(Option::Beauty)) {
-                result = append(": ", 2);
-            } else {
-                result = append(':');
-            }
-            if (result != Result::OK) {
-                return result;
-            }
-            current_state() = State::MapValue;
-            return Result::OK;
-        }
-        Result result = prefix_for_value();
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::string(const char *str, size_t len) {
+        bool key = false;
+        Result result = begin_string(key);
         if (result != Result::OK) {
             return result;
         }
@@ -253,23 +482,31 @@ namespace fiber::json {
         if (result != Result::OK) {
             return result;
         }
-        return finish_value();
+        return end_string(key);
     }
 
-    Generator::Result Generator::string(const std::string &str) { return string(str.data(), str.size()); }
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::string(const std::string &str) { return string(str.data(), str.size()); }
 
-    Generator::Result Generator::string(const GcString *str) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::string(const GcString *str) {
         if (!str) {
             return set_error(Result::InvalidString);
         }
-        std::string utf8;
-        if (!gc_string_to_utf8(str, utf8)) {
-            return set_error(Result::InvalidString);
+        bool key = false;
+        Result result = begin_string(key);
+        if (result != Result::OK) {
+            return result;
         }
-        return string(utf8);
+        result = write_gc_string(str);
+        if (result != Result::OK) {
+            return result;
+        }
+        return end_string(key);
     }
 
-    Generator::Result Generator::binary(const std::uint8_t *data, size_t len) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::binary(const std::uint8_t *data, size_t len) {
         if (!data && len > 0) {
             return set_error(Result::InvalidString);
         }
@@ -285,24 +522,23 @@ namespace fiber::json {
         return finish_value();
     }
 
-    Generator::Result Generator::integer(int64_t value) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::integer(int64_t value) {
         Result result = prefix_for_value();
         if (result != Result::OK) {
             return result;
         }
-        char buf[32];
-        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
-        if (ec != std::errc()) {
-            return set_error(Result::InvalidValue);
-        }
-        result = append(buf, static_cast<size_t>(ptr - buf));
+        char buf[kMaxNumberChars];
+        char *end = write_int64(buf, value);
+        result = append(buf, static_cast<size_t>(end - buf));
         if (result != Result::OK) {
             return result;
         }
         return finish_value();
     }
 
-    Generator::Result Generator::double_value(double value) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::double_value(double value) {
         if (!std::isfinite(value)) {
             return set_error(Result::InvalidValue);
         }
@@ -310,20 +546,17 @@ namespace fiber::json {
         if (result != Result::OK) {
             return result;
         }
-        char buf[64];
-        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::general,
-                                       std::numeric_limits<double>::max_digits10);
-        if (ec != std::errc()) {
-            return set_error(Result::InvalidValue);
-        }
-        result = append(buf, static_cast<size_t>(ptr - buf));
+        char buf[kMaxNumberChars];
+        char *end = write_double(buf, value);
+        result = append(buf, static_cast<size_t>(end - buf));
         if (result != Result::OK) {
             return result;
         }
         return finish_value();
     }
 
-    Generator::Result Generator::bool_value(bool value) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::bool_value(bool value) {
         Result result = prefix_for_value();
         if (result != Result::OK) {
             return result;
@@ -339,7 +572,8 @@ namespace fiber::json {
         return finish_value();
     }
 
-    Generator::Result Generator::null_value() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::null_value() {
         Result result = prefix_for_value();
         if (result != Result::OK) {
             return result;
@@ -351,24 +585,25 @@ namespace fiber::json {
         return finish_value();
     }
 
-    bool Generator::has_option(Option opt) const { return (options_ & static_cast<uint32_t>(opt)) != 0; }
-
-    Generator::Result Generator::append(const char *data, size_t len) {
-        if (len == 0) {
-            return Result::OK;
-        }
-        if (!data) {
-            return set_error(Result::ErrorState);
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::raw(const char *json, size_t len) {
+        bool key = false;
+        Result result = begin_string(key);
+        if (result != Result::OK) {
+            return result;
         }
-        if (!sink_.write(data, len)) {
-            return set_error(Result::ErrorState);
+        result = append(json, len);
+        if (result != Result::OK) {
+            return result;
         }
-        return Result::OK;
+        return end_string(key);
     }
 
-    Generator::Result Generator::append(char ch) { return append(&ch, 1); }
+    template <typename Sink>
+    bool BasicGenerator<Sink>::has_option(Option opt) const { return (options_ & static_cast<uint32_t>(opt)) != 0; }
 
-    Generator::Result Generator::append_indent(size_t level) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::append_indent(size_t level) {
         if (indent_string_.empty()) {
             return Result::OK;
         }
@@ -381,7 +616,8 @@ namespace fiber::json {
         return Result::OK;
     }
 
-    Generator::Result Generator::prefix_for_value() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::prefix_for_value() {
         State state = current_state();
         if (state == State::Error) {
             return Result::ErrorState;
@@ -416,7 +652,8 @@ namespace fiber::json {
         return Result::OK;
     }
 
-    Generator::Result Generator::prefix_for_key() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::prefix_for_key() {
         State state = current_state();
         if (state == State::Error) {
             return Result::ErrorState;
@@ -451,7 +688,30 @@ namespace fiber::json {
         return set_error(Result::ErrorState);
     }
 
-    Generator::Result Generator::write_string(const char *str, size_t len) {
+    // Strings and raw text take the key or the value position depending on
+    // the state; in key position they are followed by the colon.
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::begin_string(bool &key) {
+        State state = current_state();
+        key = state == State::MapStart || state == State::MapKey;
+        return key ? prefix_for_key() : prefix_for_value();
+    }
+
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::end_string(bool key) {
+        if (!key) {
+            return finish_value();
+        }
+        Result result = has_option(Option::Beauty) ? append(": ", 2) : append(':');
+        if (result != Result::OK) {
+            return result;
+        }
+        current_state() = State::MapValue;
+        return Result::OK;
+    }
+
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::write_string(const char *str, size_t len) {
         if (!str && len > 0) {
             return set_error(Result::InvalidString);
         }
@@ -460,62 +720,95 @@ namespace fiber::json {
                 return set_error(Result::InvalidString);
             }
         }
-        Result result = append('\"');
-        if (result != Result::OK) {
-            return result;
+        bool solidus = has_option(Option::EscapeSolidus);
+        StringWriter<Sink> out(sink_);
+        const auto *p = reinterpret_cast<const unsigned char *>(str);
+        const unsigned char *end = p + len;
+        bool ok = out.put('\"');
+        while (ok && p < end) {
+            size_t run = scan_plain(p, static_cast<size_t>(end - p), solidus, false);
+            ok = out.run(reinterpret_cast<const char *>(p), run);
+            p += run;
+            if (ok && p < end) {
+                ok = out.escape(*p++);
+            }
         }
-        const unsigned char *data = reinterpret_cast<const unsigned char *>(str);
-        for (size_t i = 0; i < len; ++i) {
-            unsigned char ch = data[i];
-            switch (ch) {
-                case '\"':
-                    result = append("\\\"", 2);
-                    break;
-                case '\\':
-                    result = append("\\\\", 2);
-                    break;
-                case '\b':
-                    result = append("\\b", 2);
-                    break;
-                case '\f':
-                    result = append("\\f", 2);
-                    break;
-                case '\n':
-                    result = append("\\n", 2);
-                    break;
-                case '\r':
-                    result = append("\\r", 2);
-                    break;
-                case '\t':
-                    result = append("\\t", 2);
-                    break;
-                case '/':
-                    if (has_option(Option::EscapeSolidus)) {
-                        result = append("\\/", 2);
-                    } else {
-                        result = append('/');
-                    }
+        if (!ok || !out.put('\"') || !out.flush()) {
+            return set_error(Result::ErrorState);
+        }
+        return Result::OK;
+    }
+
+    // Encodes straight from the string's Byte (Latin-1) or Utf16 storage;
+    // ASCII runs of Byte strings are handed to the sink without copying.
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::write_gc_string(const GcString *str) {
+        bool solidus = has_option(Option::EscapeSolidus);
+        StringWriter<Sink> out(sink_);
+        bool ok = out.put('\"');
+        if (str->encoding == GcStringEncoding::Byte) {
+            const unsigned char *p = str->data8;
+            const unsigned char *end = p + str->len;
+            while (ok && p < end) {
+                size_t run = scan_plain(p, static_cast<size_t>(end - p), solidus, true);
+                ok = out.run(reinterpret_cast<const char *>(p), run);
+                p += run;
+                if (!ok || p == end) {
                     break;
-                default:
-                    if (ch < 0x20) {
-                        char buf[6] = {'\\', 'u', '0', '0', '0', '0'};
-                        const char *hex = "0123456789ABCDEF";
-                        buf[4] = hex[(ch >> 4) & 0x0F];
-                        buf[5] = hex[ch & 0x0F];
-                        result = append(buf, sizeof(buf));
-                    } else {
-                        result = append(static_cast<char>(ch));
+                }
+                unsigned char ch = *p++;
+                if (ch < 0x80) {
+                    ok = out.escape(ch);
+                } else if (char *dst = out.stage(2)) {
+                    dst[0] = static_cast<char>(0xC0 | (ch >> 6));
+                    dst[1] = static_cast<char>(0x80 | (ch & 0x3F));
+                } else {
+                    ok = false;
+                }
+            }
+        } else {
+            for (size_t i = 0; ok && i < str->len; ++i) {
+                std::uint32_t unit = str->data16[i];
+                if (unit < 0x80) {
+                    auto ch = static_cast<unsigned char>(unit);
+                    ok = needs_escape(ch, solidus) ? out.escape(ch) : out.put(static_cast<char>(ch));
+                    continue;
+                }
+                if (unit >= 0xD800 && unit <= 0xDFFF) {
+                    std::uint32_t low = i + 1 < str->len ? str->data16[i + 1] : 0;
+                    if (unit > 0xDBFF || low < 0xDC00 || low > 0xDFFF) {
+                        return set_error(Result::InvalidString);
                     }
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    i += 1;
+                }
+                size_t n = unit < 0x800 ? 2 : unit < 0x10000 ? 3 : 4;
+                char *dst = out.stage(n);
+                if (!dst) {
+                    ok = false;
                     break;
-            }
-            if (result != Result::OK) {
-                return result;
+                }
+                if (n == 2) {
+                    dst[0] = static_cast<char>(0xC0 | (unit >> 6));
+                } else if (n == 3) {
+                    dst[0] = static_cast<char>(0xE0 | (unit >> 12));
+                    dst[1] = static_cast<char>(0x80 | ((unit >> 6) & 0x3F));
+                } else {
+                    dst[0] = static_cast<char>(0xF0 | (unit >> 18));
+                    dst[1] = static_cast<char>(0x80 | ((unit >> 12) & 0x3F));
+                    dst[2] = static_cast<char>(0x80 | ((unit >> 6) & 0x3F));
+                }
+                dst[n - 1] = static_cast<char>(0x80 | (unit & 0x3F));
             }
         }
-        return append('\"');
+        if (!ok || !out.put('\"') || !out.flush()) {
+            return set_error(Result::ErrorState);
+        }
+        return Result::OK;
     }
 
-    Generator::Result Generator::finish_value() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::finish_value() {
         State &state = current_state();
         switch (state) {
             case State::Start:
@@ -539,7 +832,8 @@ namespace fiber::json {
         return set_error(Result::ErrorState);
     }
 
-    Generator::Result Generator::push(State state) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::push(State state) {
         if (depth_ >= MAX_STACK) {
             return set_error(Result::MaxDepthExceeded);
         }
@@ -548,7 +842,8 @@ namespace fiber::json {
         return Result::OK;
     }
 
-    Generator::Result Generator::pop() {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::pop() {
         if (depth_ <= 1) {
             return set_error(Result::ErrorState);
         }
@@ -556,13 +851,19 @@ namespace fiber::json {
         return Result::OK;
     }
 
-    Generator::Result Generator::set_error(Result result) {
+    template <typename Sink>
+    GeneratorBase::Result BasicGenerator<Sink>::set_error(Result result) {
         current_state() = State::Error;
         return result;
     }
 
-    Generator::State &Generator::current_state() { return state_stack_[depth_ - 1]; }
+    template <typename Sink>
+    GeneratorBase::State &BasicGenerator<Sink>::current_state() { return state_stack_[depth_ - 1]; }
+
+    template <typename Sink>
+    const GeneratorBase::State &BasicGenerator<Sink>::current_state() const { return state_stack_[depth_ - 1]; }
 
-    const Generator::State &Generator::current_state() const { return state_stack_[depth_ - 1]; }
+    template class BasicGenerator<OutputSink>;
+    template class BasicGenerator<BufferSink>;
 
 } // namespace fiber::json
@@ -6,15 +6,27 @@
 #define FIBER_JSONENCODE_H
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <string_view>
 
 namespace fiber::json {
 struct GcString;
 
+struct OutputSlice {
+    const char *data = nullptr;
+    size_t len = 0;
+};
+
 class OutputSink {
 public:
     virtual ~OutputSink() = default;
     [[nodiscard]] virtual bool write(const char *data, size_t len) = 0;
+    [[nodiscard]] virtual bool put(char ch) { return write(&ch, 1); }
+    // Several pieces at once; the default joins small ones so the sink sees
+    // few write calls.
+    [[nodiscard]] virtual bool writev(const OutputSlice *parts, size_t count);
     virtual void reset() {}
 };
 
@@ -30,7 +42,65 @@ private:
     void *ctx_;
 };
 
-class Generator {
+// Growable contiguous output. A generator typed on it (BufferGenerator)
+// calls the inline members below directly instead of through the vtable.
+class BufferSink final : public OutputSink {
+public:
+    BufferSink() = default;
+    BufferSink(const BufferSink &) = delete;
+    BufferSink &operator=(const BufferSink &) = delete;
+
+    [[nodiscard]] bool write(const char *data, size_t len) override {
+        if (len == 0) {
+            return true;
+        }
+        if (len > capacity_ - size_ && !grow(len)) {
+            return false;
+        }
+        std::memcpy(data_.get() + size_, data, len);
+        size_ += len;
+        return true;
+    }
+
+    [[nodiscard]] bool put(char ch) override {
+        if (size_ == capacity_ && !grow(1)) {
+            return false;
+        }
+        data_[size_++] = ch;
+        return true;
+    }
+
+    [[nodiscard]] bool writev(const OutputSlice *parts, size_t count) override {
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            total += parts[i].len;
+        }
+        if (total > capacity_ - size_ && !grow(total)) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(data_.get() + size_, parts[i].data, parts[i].len);
+            size_ += parts[i].len;
+        }
+        return true;
+    }
+
+    void reset() override { size_ = 0; }
+    [[nodiscard]] bool reserve(size_t capacity);
+
+    [[nodiscard]] const char *data() const { return data_.get(); }
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] std::string_view view() const { return {data_.get(), size_}; }
+
+private:
+    [[nodiscard]] bool grow(size_t extra);
+
+    std::unique_ptr<char[]> data_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+class GeneratorBase {
 public:
     enum class State { Start, MapStart, MapKey, MapValue, ArrayStart, InArray, Complete, Error };
     enum class Result {
@@ -79,12 +149,18 @@ public:
          */
         EscapeSolidus = 0x10
     };
+};
 
-    explicit Generator(OutputSink &sink);
-    Generator(const Generator &) = delete;
-    Generator &operator=(const Generator &) = delete;
-    Generator(Generator &&) = delete;
-    Generator &operator=(Generator &&) = delete;
+// Streams JSON to a sink. Sink is OutputSink for any sink behind a
+// virtual call, or a final sink type whose members then inline.
+template <typename Sink>
+class BasicGenerator : public GeneratorBase {
+public:
+    explicit BasicGenerator(Sink &sink);
+    BasicGenerator(const BasicGenerator &) = delete;
+    BasicGenerator &operator=(const BasicGenerator &) = delete;
+    BasicGenerator(BasicGenerator &&) = delete;
+    BasicGenerator &operator=(BasicGenerator &&) = delete;
 
     void clear();
     void set_option(Option opt, bool enabled = true);
@@ -106,18 +182,39 @@ public:
     Result double_value(double value);
     Result bool_value(bool value);
     Result null_value();
+    // Writes already encoded JSON as is: a value, or a string literal where
+    // a key is expected. Beauty and EscapeSolidus do not apply inside it.
+    Result raw(const char *json, size_t len);
 
 
 private:
     static constexpr size_t MAX_STACK = 128;
 
     [[nodiscard]] bool has_option(Option opt) const;
-    [[nodiscard]] Result append(const char *data, size_t len);
-    [[nodiscard]] Result append(char ch);
+    [[nodiscard]] Result append(const char *data, size_t len) {
+        if (len == 0) {
+            return Result::OK;
+        }
+        if (!data || !sink_.write(data, len)) {
+            return set_error(Result::ErrorState);
+        }
+        return Result::OK;
+    }
+
+    [[nodiscard]] Result append(char ch) {
+        if (!sink_.put(ch)) {
+            return set_error(Result::ErrorState);
+        }
+        return Result::OK;
+    }
+
     [[nodiscard]] Result append_indent(size_t level);
     [[nodiscard]] Result prefix_for_value();
     [[nodiscard]] Result prefix_for_key();
+    [[nodiscard]] Result begin_string(bool &key);
+    [[nodiscard]] Result end_string(bool key);
     [[nodiscard]] Result write_string(const char *str, size_t len);
+    [[nodiscard]] Result write_gc_string(const GcString *str);
     [[nodiscard]] Result finish_value();
     [[nodiscard]] Result push(State state);
     [[nodiscard]] Result pop();
@@ -125,12 +222,18 @@ private:
     [[nodiscard]] State &current_state();
     [[nodiscard]] const State &current_state() const;
 
-    OutputSink &sink_;
+    Sink &sink_;
     State state_stack_[MAX_STACK] = {};
     size_t depth_ = 1;
     uint32_t options_ = 0;
     std::string indent_string_ = "    ";
 };
 
+using Generator = BasicGenerator<OutputSink>;
+using BufferGenerator = BasicGenerator<BufferSink>;
+
+extern template class BasicGenerator<OutputSink>;
+extern template class BasicGenerator<BufferSink>;
+
 } // namespace fiber::json
 #endif // FIBER_JSONENCODE_H
@@ -0,0 +1,260 @@
+#include "JsonIndex.h"
+
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FIBER_JSON_INDEX_X86 1
+#endif
+
+#include "Utf.h"
+
+namespace fiber::json {
+namespace {
+
+constexpr std::size_t kBlock = 64;
+
+struct BlockMasks {
+    std::uint64_t quote = 0;
+    std::uint64_t backslash = 0;
+    std::uint64_t structural = 0;
+    std::uint64_t ws = 0;
+    std::uint64_t control = 0;
+    std::uint64_t non_ascii = 0;
+};
+
+void classify_scalar(const std::uint8_t *block, BlockMasks &out) {
+    out = {};
+    for (std::size_t i = 0; i < kBlock; ++i) {
+        std::uint8_t ch = block[i];
+        std::uint64_t bit = std::uint64_t{1} << i;
+        switch (ch) {
+            case '"':
+                out.quote |= bit;
+                break;
+            case '\\':
+                out.backslash |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                out.structural |= bit;
+                break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                out.ws |= bit;
+                break;
+            default:
+                break;
+        }
+        if (ch < 0x20) {
+            out.control |= bit;
+        }
+        if (ch >= 0x80) {
+            out.non_ascii |= bit;
+        }
+    }
+}
+
+#if FIBER_JSON_INDEX_X86
+
+std::uint64_t sse2_mask(__m128i v0, __m128i v1, __m128i v2, __m128i v3) {
+    return static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(v0))) |
+           (static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(v1))) << 16) |
+           (static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(v2))) << 32) |
+           (static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(v3))) << 48);
+}
+
+void classify_sse2(const std::uint8_t *block, BlockMasks &out) {
+    __m128i in[4];
+    for (int i = 0; i < 4; ++i) {
+        in[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+    }
+    auto eq = [&](char ch) {
+        __m128i c = _mm_set1_epi8(ch);
+        return sse2_mask(_mm_cmpeq_epi8(in[0], c), _mm_cmpeq_epi8(in[1], c), _mm_cmpeq_epi8(in[2], c),
+                         _mm_cmpeq_epi8(in[3], c));
+    };
+    // '[' and ']' are '{' and '}' with bit 0x20 cleared.
+    __m128i lower = _mm_set1_epi8(0x20);
+    __m128i folded[4];
+    for (int i = 0; i < 4; ++i) {
+        folded[i] = _mm_or_si128(in[i], lower);
+    }
+    auto folded_eq = [&](char ch) {
+        __m128i c = _mm_set1_epi8(ch);
+        return sse2_mask(_mm_cmpeq_epi8(folded[0], c), _mm_cmpeq_epi8(folded[1], c),
+                         _mm_cmpeq_epi8(folded[2], c), _mm_cmpeq_epi8(folded[3], c));
+    };
+    __m128i ceiling = _mm_set1_epi8(0x1F);
+    __m128i control[4];
+    for (int i = 0; i < 4; ++i) {
+        control[i] = _mm_cmpeq_epi8(_mm_max_epu8(in[i], ceiling), ceiling);
+    }
+    out.quote = eq('"');
+    out.backslash = eq('\\');
+    out.structural = folded_eq('{') | folded_eq('}') | eq(':') | eq(',');
+    out.ws = eq(' ') | eq('\t') | eq('\n') | eq('\r');
+    out.control = sse2_mask(control[0], control[1], control[2], control[3]);
+    out.non_ascii = sse2_mask(in[0], in[1], in[2], in[3]);
+}
+
+__attribute__((target("avx2"))) std::uint64_t avx2_mask(__m256i lo, __m256i hi) {
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(lo))) |
+           (static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(hi))) << 32);
+}
+
+__attribute__((target("avx2"))) std::uint64_t avx2_eq(__m256i lo, __m256i hi, char ch) {
+    __m256i c = _mm256_set1_epi8(ch);
+    return avx2_mask(_mm256_cmpeq_epi8(lo, c), _mm256_cmpeq_epi8(hi, c));
+}
+
+__attribute__((target("avx2"))) void classify_avx2(const std::uint8_t *block, BlockMasks &out) {
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+    auto eq = avx2_eq;
+    __m256i lower = _mm256_set1_epi8(0x20);
+    __m256i folded_lo = _mm256_or_si256(lo, lower);
+    __m256i folded_hi = _mm256_or_si256(hi, lower);
+    __m256i ceiling = _mm256_set1_epi8(0x1F);
+    out.quote = eq(lo, hi, '"');
+    out.backslash = eq(lo, hi, '\\');
+    out.structural = eq(folded_lo, folded_hi, '{') | eq(folded_lo, folded_hi, '}') | eq(lo, hi, ':') |
+                     eq(lo, hi, ',');
+    out.ws = eq(lo, hi, ' ') | eq(lo, hi, '\t') | eq(lo, hi, '\n') | eq(lo, hi, '\r');
+    out.control = avx2_mask(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, ceiling), ceiling),
+                            _mm256_cmpeq_epi8(_mm256_max_epu8(hi, ceiling), ceiling));
+    out.non_ascii = avx2_mask(lo, hi);
+}
+
+#endif
+
+std::uint64_t prefix_xor(std::uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// Bits of characters preceded by an odd run of backslashes; prev_escaped
+// carries a run that ends exactly at the block boundary.
+std::uint64_t find_escaped(std::uint64_t backslash, std::uint64_t &prev_escaped) {
+    backslash &= ~prev_escaped;
+    std::uint64_t follows_escape = (backslash << 1) | prev_escaped;
+    constexpr std::uint64_t kEvenBits = 0x5555555555555555ULL;
+    std::uint64_t odd_sequence_starts = backslash & ~kEvenBits & ~follows_escape;
+    std::uint64_t sequences_starting_on_even_bits = 0;
+    prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslash, &sequences_starting_on_even_bits) ? 1 : 0;
+    std::uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (kEvenBits ^ invert_mask) & follows_escape;
+}
+
+bool validate_utf8_bulk(const char *data, std::size_t len) {
+    std::size_t pos = 0;
+    while (pos < len) {
+        if (pos + 8 <= len) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + pos, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0) {
+                pos += 8;
+                continue;
+            }
+        }
+        std::uint32_t codepoint = 0;
+        if (!utf8_next_codepoint(data, len, pos, codepoint)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Classify>
+bool build_index(const char *data, std::size_t len, std::vector<std::uint32_t> &out, Classify classify) {
+    std::uint64_t prev_escaped = 0;
+    std::uint64_t prev_in_string = 0;
+    std::uint64_t prev_other = 0;
+    std::uint64_t any_non_ascii = 0;
+    std::uint8_t tail[kBlock];
+    BlockMasks masks;
+    for (std::size_t base = 0; base < len; base += kBlock) {
+        const auto *block = reinterpret_cast<const std::uint8_t *>(data + base);
+        std::size_t avail = len - base;
+        if (avail < kBlock) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, avail);
+            block = tail;
+        }
+        classify(block, masks);
+
+        std::uint64_t escaped = find_escaped(masks.backslash, prev_escaped);
+        std::uint64_t quote = masks.quote & ~escaped;
+        std::uint64_t in_string = prefix_xor(quote) ^ prev_in_string;
+        prev_in_string = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >> 63);
+        if (masks.control & in_string) {
+            return false;
+        }
+        any_non_ascii |= masks.non_ascii;
+
+        std::uint64_t other = ~(masks.structural | masks.ws | quote | in_string);
+        std::uint64_t scalar_start = other & ~((other << 1) | prev_other);
+        prev_other = other >> 63;
+        std::uint64_t tokens = (masks.structural & ~in_string) | quote | scalar_start;
+        if (avail < kBlock) {
+            tokens &= (std::uint64_t{1} << avail) - 1;
+        }
+        std::size_t count = out.size();
+        out.resize(count + static_cast<std::size_t>(std::popcount(tokens)));
+        std::uint32_t *dst = out.data() + count;
+        while (tokens) {
+            *dst++ = static_cast<std::uint32_t>(base + static_cast<std::size_t>(std::countr_zero(tokens)));
+            tokens &= tokens - 1;
+        }
+    }
+    if (prev_in_string) {
+        return false;
+    }
+    return any_non_ascii == 0 || validate_utf8_bulk(data, len);
+}
+
+} // namespace
+
+IndexKernel best_index_kernel() {
+#if FIBER_JSON_INDEX_X86
+    static const IndexKernel kernel = __builtin_cpu_supports("avx2") ? IndexKernel::Avx2 : IndexKernel::Sse2;
+    return kernel;
+#else
+    return IndexKernel::Scalar;
+#endif
+}
+
+bool build_structural_index(const char *data, std::size_t len, std::vector<std::uint32_t> &out, IndexKernel kernel) {
+    out.clear();
+    if (len > std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+    switch (kernel) {
+#if FIBER_JSON_INDEX_X86
+        case IndexKernel::Avx2:
+            if (__builtin_cpu_supports("avx2")) {
+                return build_index(data, len, out, classify_avx2);
+            }
+            return build_index(data, len, out, classify_sse2);
+        case IndexKernel::Sse2:
+            return build_index(data, len, out, classify_sse2);
+#endif
+        default:
+            return build_index(data, len, out, classify_scalar);
+    }
+}
+
+} // namespace fiber::json
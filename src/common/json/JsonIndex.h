@@ -0,0 +1,33 @@
+#ifndef FIBER_JSONINDEX_H
+#define FIBER_JSONINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fiber::json {
+
+enum class IndexKernel : std::uint8_t {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// Widest kernel the running CPU supports.
+[[nodiscard]] IndexKernel best_index_kernel();
+
+// Stage 1 of the two-stage decoder: classifies the input 64 bytes at a time
+// and appends to out the offset of every token start outside strings, i.e.
+// each structural character, each unescaped quote (opening and closing) and
+// the first byte of each number/literal run. Fails when the input cannot be
+// valid JSON for reasons stage 2 would not see: an unterminated string, a
+// control character inside a string, invalid UTF-8, or an input too large
+// for 32-bit offsets.
+[[nodiscard]] bool build_structural_index(const char *data,
+                                          std::size_t len,
+                                          std::vector<std::uint32_t> &out,
+                                          IndexKernel kernel = best_index_kernel());
+
+} // namespace fiber::json
+
+#endif // FIBER_JSONINDEX_H
@@ -0,0 +1,218 @@
+#include "JsonNumber.h"
+
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace fiber::json {
+namespace {
+
+constexpr char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+constexpr std::uint64_t kPow10Int[] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+// Powers of ten a double holds exactly.
+constexpr double kPow10Exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+constexpr std::uint64_t kMaxExactMantissa = std::uint64_t{1} << 53;
+
+bool is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+// Eight ASCII digits at p as one number, in three multiplies.
+std::uint32_t parse_eight_digits(const char *p) {
+    std::uint64_t v = 0;
+    std::memcpy(&v, p, sizeof(v));
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >>
+        32;
+    return static_cast<std::uint32_t>(v);
+}
+
+bool all_digits8(const char *p) {
+    std::uint64_t v = 0;
+    std::memcpy(&v, p, sizeof(v));
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
+
+// Accumulates digits at p into value; returns the first non-digit.
+const char *accumulate_digits(const char *p, const char *last, std::uint64_t &value) {
+    if constexpr (std::endian::native == std::endian::little) {
+        while (last - p >= 8 && all_digits8(p) && value < 10000000000ULL) {
+            value = value * 100000000ULL + parse_eight_digits(p);
+            p += 8;
+        }
+    }
+    while (p < last && is_digit(*p) && value < 1000000000000000000ULL) {
+        value = value * 10 + static_cast<std::uint64_t>(*p - '0');
+        ++p;
+    }
+    return p;
+}
+
+std::size_t decimal_digits(std::uint64_t value) {
+    // floor(log10) from the bit length, corrected by one comparison; zero
+    // counts as one digit.
+    value |= 1;
+    int bits = 64 - std::countl_zero(value);
+    auto t = static_cast<std::size_t>((bits * 1233) >> 12);
+    return t + 1 - (value < kPow10Int[t] ? 1 : 0);
+}
+
+char *write_uint64(char *dst, std::uint64_t value) {
+    char *end = dst + decimal_digits(value);
+    char *p = end;
+    while (value >= 100) {
+        std::size_t pair = static_cast<std::size_t>(value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        std::memcpy(p, kDigitPairs + pair, 2);
+    }
+    if (value >= 10) {
+        std::memcpy(p - 2, kDigitPairs + value * 2, 2);
+    } else {
+        p[-1] = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+} // namespace
+
+std::errc parse_json_int64(const char *first, const char *last, std::int64_t &out) {
+    bool negative = first < last && *first == '-';
+    const char *p = first + (negative ? 1 : 0);
+    if (p == last) {
+        return std::errc::invalid_argument;
+    }
+    std::uint64_t value = 0;
+    p = accumulate_digits(p, last, value);
+    for (; p < last; ++p) {
+        if (!is_digit(*p)) {
+            return std::errc::invalid_argument;
+        }
+        if (__builtin_mul_overflow(value, 10, &value) ||
+            __builtin_add_overflow(value, static_cast<std::uint64_t>(*p - '0'), &value)) {
+            return std::errc::result_out_of_range;
+        }
+    }
+    constexpr auto kMax = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+    if (value > kMax + (negative ? 1 : 0)) {
+        return std::errc::result_out_of_range;
+    }
+    out = negative ? static_cast<std::int64_t>(0 - value) : static_cast<std::int64_t>(value);
+    return {};
+}
+
+std::errc parse_json_double(const char *first, const char *last, double &out) {
+    bool negative = first < last && *first == '-';
+    const char *p = first + (negative ? 1 : 0);
+    std::uint64_t mantissa = 0;
+    const char *int_start = p;
+    p = accumulate_digits(p, last, mantissa);
+    bool exact = p == last || !is_digit(*p);
+    while (p < last && is_digit(*p)) {
+        ++p;
+    }
+    if (p == int_start) {
+        return std::errc::invalid_argument;
+    }
+    std::int64_t exponent = 0;
+    if (exact && p < last && *p == '.') {
+        const char *frac_start = ++p;
+        p = accumulate_digits(p, last, mantissa);
+        exponent = frac_start - p;
+        exact = p == last || !is_digit(*p);
+    }
+    if (exact && p < last && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool exp_negative = p < last && *p == '-';
+        if (p < last && (*p == '-' || *p == '+')) {
+            ++p;
+        }
+        std::int64_t explicit_exp = 0;
+        for (; p < last && is_digit(*p); ++p) {
+            if (explicit_exp < 100000) {
+                explicit_exp = explicit_exp * 10 + (*p - '0');
+            }
+        }
+        exponent += exp_negative ? -explicit_exp : explicit_exp;
+    }
+    if (exact && p == last && std::numeric_limits<double>::is_iec559) {
+        if (mantissa == 0) {
+            out = negative ? -0.0 : 0.0;
+            return {};
+        }
+        if (mantissa <= kMaxExactMantissa && exponent >= -22 && exponent <= 22) {
+            auto value = static_cast<double>(mantissa);
+            value = exponent < 0 ? value / kPow10Exact[-exponent] : value * kPow10Exact[exponent];
+            out = negative ? -value : value;
+            return {};
+        }
+        // 123e30: move the excess exponent into the mantissa while it stays exact.
+        if (exponent > 22 && exponent <= 22 + 15 &&
+            mantissa <= kMaxExactMantissa / kPow10Int[exponent - 22]) {
+            auto value = static_cast<double>(mantissa * kPow10Int[exponent - 22]) * kPow10Exact[22];
+            out = negative ? -value : value;
+            return {};
+        }
+    }
+    auto result = std::from_chars(first, last, out);
+    if (result.ec == std::errc() && result.ptr != last) {
+        return std::errc::invalid_argument;
+    }
+    return result.ec;
+}
+
+char *write_int64(char *dst, std::int64_t value) {
+    auto magnitude = static_cast<std::uint64_t>(value);
+    if (value < 0) {
+        *dst++ = '-';
+        magnitude = 0 - magnitude;
+    }
+    return write_uint64(dst, magnitude);
+}
+
+char *write_double(char *dst, double value) {
+    return std::to_chars(dst, dst + kMaxNumberChars, value).ptr;
+}
+
+} // namespace fiber::json
@@ -0,0 +1,32 @@
+#ifndef FIBER_JSONNUMBER_H
+#define FIBER_JSONNUMBER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace fiber::json {
+
+// Room write_int64 and write_double need at dst.
+constexpr std::size_t kMaxNumberChars = 32;
+
+// Converts text the JSON number grammar already accepted. Neither
+// allocates nor depends on the locale; both return result_out_of_range
+// when the value does not fit.
+//
+// parse_json_int64 takes -?digits. parse_json_double takes any JSON number:
+// mantissas up to 2^53 with small exponents are converted exactly with one
+// floating-point operation (Clinger's fast path), everything else goes
+// through std::from_chars, which is Eisel-Lemire based in the standard
+// libraries we build with.
+[[nodiscard]] std::errc parse_json_int64(const char *first, const char *last, std::int64_t &out);
+[[nodiscard]] std::errc parse_json_double(const char *first, const char *last, double &out);
+
+// Write the value at dst and return the end. write_double emits the
+// shortest text that reads back as the same double; value must be finite.
+char *write_int64(char *dst, std::int64_t value);
+char *write_double(char *dst, double value);
+
+} // namespace fiber::json
+
+#endif // FIBER_JSONNUMBER_H
@@ -0,0 +1,844 @@
+#include "JsonPath.h"
+
+#include <unordered_map>
+#include <utility>
+
+#include "JsonDecode.h"
+#include "JsonNumber.h"
+
+namespace fiber::json {
+namespace {
+
+constexpr std::size_t kPathCacheSize = 64;
+
+bool is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+bool is_name_char(char ch) {
+    auto byte = static_cast<unsigned char>(ch);
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || is_digit(ch) || ch == '_' || ch == '-' ||
+           byte >= 0x80;
+}
+
+void append_utf8(std::string &out, std::uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool is_string(const JsValue &value) {
+    return value.type_ == JsNodeType::HeapString || value.type_ == JsNodeType::NativeString;
+}
+
+bool is_number(const JsValue &value) {
+    return value.type_ == JsNodeType::Integer || value.type_ == JsNodeType::Float;
+}
+
+double number_of(const JsValue &value) {
+    return value.type_ == JsNodeType::Integer ? static_cast<double>(value.i) : value.f;
+}
+
+bool utf8_text(const JsValue &value, std::string &out) {
+    if (value.type_ == JsNodeType::NativeString) {
+        out.assign(value.ns().data, value.ns().len);
+        return true;
+    }
+    return gc_string_to_utf8(reinterpret_cast<const GcString *>(value.gc), out);
+}
+
+// -1, 0 or 1 in *order for comparable values; false when they are not.
+bool compare_values(const JsValue &lhs, const JsValue &rhs, int &order) {
+    if (is_number(lhs) && is_number(rhs)) {
+        if (lhs.type_ == JsNodeType::Integer && rhs.type_ == JsNodeType::Integer) {
+            order = lhs.i < rhs.i ? -1 : (lhs.i > rhs.i ? 1 : 0);
+            return true;
+        }
+        double a = number_of(lhs);
+        double b = number_of(rhs);
+        if (a != a || b != b) {
+            return false;
+        }
+        order = a < b ? -1 : (a > b ? 1 : 0);
+        return true;
+    }
+    if (is_string(lhs) && is_string(rhs)) {
+        if (lhs.type_ == JsNodeType::HeapString && rhs.type_ == JsNodeType::HeapString &&
+            gc_string_equals(reinterpret_cast<const GcString *>(lhs.gc), reinterpret_cast<const GcString *>(rhs.gc))) {
+            order = 0;
+            return true;
+        }
+        // UTF-8 byte order is code point order.
+        std::string a;
+        std::string b;
+        if (!utf8_text(lhs, a) || !utf8_text(rhs, b)) {
+            return false;
+        }
+        int cmp = a.compare(b);
+        order = cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+        return true;
+    }
+    return false;
+}
+
+bool values_equal(const JsValue &lhs, const JsValue &rhs) {
+    int order = 0;
+    if (compare_values(lhs, rhs, order)) {
+        return order == 0;
+    }
+    if (lhs.type_ != rhs.type_) {
+        return false;
+    }
+    switch (lhs.type_) {
+        case JsNodeType::Undefined:
+        case JsNodeType::Null:
+            return true;
+        case JsNodeType::Boolean:
+            return lhs.b == rhs.b;
+        case JsNodeType::Array:
+        case JsNodeType::Object:
+        case JsNodeType::LazyJson:
+            return lhs.gc == rhs.gc;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+class PathCompiler {
+public:
+    PathCompiler(std::string_view text, JsonPath &out)
+        : text_(text), out_(out) {}
+
+    bool pointer() {
+        if (text_.empty()) {
+            return true;
+        }
+        if (text_[0] != '/') {
+            return error("pointer must start with /");
+        }
+        while (pos_ < text_.size()) {
+            ++pos_;
+            std::string segment;
+            for (; pos_ < text_.size() && text_[pos_] != '/'; ++pos_) {
+                if (text_[pos_] != '~') {
+                    segment += text_[pos_];
+                } else if (pos_ + 1 < text_.size() && (text_[pos_ + 1] == '0' || text_[pos_ + 1] == '1')) {
+                    segment += text_[++pos_] == '0' ? '~' : '/';
+                } else {
+                    return error("invalid ~ escape");
+                }
+            }
+            JsonPath::Step step;
+            step.key = intern(segment);
+            // Array indices are digits without leading zeros.
+            bool digits = !segment.empty() && (segment.size() == 1 || segment[0] != '0');
+            for (char ch : segment) {
+                digits = digits && is_digit(ch);
+            }
+            step.has_index = digits && parse_json_int64(segment.data(), segment.data() + segment.size(),
+                                                        step.index) == std::errc();
+            out_.steps_.push_back(step);
+        }
+        return true;
+    }
+
+    bool path() {
+        if (!match('$')) {
+            return error("path must start with $");
+        }
+        while (pos_ < text_.size()) {
+            if (match('.')) {
+                if (peek() == '.') {
+                    return error("recursive descent is not supported");
+                }
+                JsonPath::Step step;
+                if (match('*')) {
+                    step.kind = JsonPath::StepKind::Wildcard;
+                    out_.singular_ = false;
+                } else if (!name(step)) {
+                    return false;
+                }
+                out_.steps_.push_back(step);
+            } else if (match('[')) {
+                if (!bracket(out_.steps_, false)) {
+                    return false;
+                }
+            } else {
+                return error("expected . or [");
+            }
+        }
+        return true;
+    }
+
+    bool finish() {
+        std::size_t capacity = 0;
+        for (const std::string &name : names_) {
+            capacity += gc_static_string_size(name.size());
+        }
+        out_.region_ = std::make_shared<GcStaticRegion>(capacity);
+        for (const std::string &name : names_) {
+            GcString *str = gc_new_static_string(out_.region_.get(), name.data(), name.size());
+            if (!str) {
+                pos_ = 0;
+                return error("out of memory");
+            }
+            out_.strings_.push_back(str);
+        }
+        for (const auto &[operand, name] : string_literals_) {
+            JsValue &value = out_.operands_[operand].value;
+            value.type_ = JsNodeType::HeapString;
+            value.gc = const_cast<GcHeader *>(&out_.strings_[name]->hdr);
+        }
+        return true;
+    }
+
+    [[nodiscard]] const PathError &error() const {
+        return error_;
+    }
+
+private:
+    using FilterKind = JsonPath::FilterKind;
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+    JsonPath &out_;
+    PathError error_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, std::uint32_t> index_;
+    // (operand, name) pairs resolved once the strings are allocated.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> string_literals_;
+
+    bool error(const char *message) {
+        error_.message = message;
+        error_.position = pos_;
+        return false;
+    }
+
+    [[nodiscard]] char peek() const {
+        return pos_ < text_.size() ? text_[pos_] : '\0';
+    }
+
+    bool match(char ch) {
+        if (peek() != ch) {
+            return false;
+        }
+        ++pos_;
+        return true;
+    }
+
+    bool match(std::string_view token) {
+        if (text_.substr(pos_, token.size()) != token) {
+            return false;
+        }
+        pos_ += token.size();
+        return true;
+    }
+
+    void skip_ws() {
+        while (peek() == ' ' || peek() == '\t' || peek() == '\n' || peek() == '\r') {
+            ++pos_;
+        }
+    }
+
+    std::uint32_t intern(const std::string &text) {
+        auto [it, inserted] = index_.emplace(text, static_cast<std::uint32_t>(names_.size()));
+        if (inserted) {
+            names_.push_back(text);
+        }
+        return it->second;
+    }
+
+    bool name(JsonPath::Step &step) {
+        std::size_t start = pos_;
+        while (pos_ < text_.size() && is_name_char(text_[pos_])) {
+            ++pos_;
+        }
+        if (pos_ == start) {
+            return error("expected member name");
+        }
+        step.key = intern(std::string(text_.substr(start, pos_ - start)));
+        return true;
+    }
+
+    bool quoted(std::string &out) {
+        char quote = text_[pos_++];
+        while (pos_ < text_.size() && text_[pos_] != quote) {
+            char ch = text_[pos_++];
+            if (ch != '\\') {
+                out += ch;
+                continue;
+            }
+            switch (peek()) {
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    std::uint32_t cp = 0;
+                    if (!hex4(pos_ + 1, cp)) {
+                        return error("invalid \\u escape");
+                    }
+                    pos_ += 4;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        std::uint32_t low = 0;
+                        if (text_.substr(pos_ + 1, 2) != "\\u" || !hex4(pos_ + 3, low) || low < 0xDC00 ||
+                            low > 0xDFFF) {
+                            return error("invalid surrogate pair");
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        pos_ += 6;
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                case '\\':
+                case '/':
+                case '\'':
+                case '"':
+                    out += peek();
+                    break;
+                default:
+                    return error("invalid escape");
+            }
+            ++pos_;
+        }
+        if (!match(quote)) {
+            return error("unterminated string");
+        }
+        return true;
+    }
+
+    bool hex4(std::size_t at, std::uint32_t &out) const {
+        if (at + 4 > text_.size()) {
+            return false;
+        }
+        out = 0;
+        for (std::size_t i = at; i < at + 4; ++i) {
+            char ch = text_[i];
+            std::uint32_t digit = 0;
+            if (is_digit(ch)) {
+                digit = static_cast<std::uint32_t>(ch - '0');
+            } else if (ch >= 'a' && ch <= 'f') {
+                digit = static_cast<std::uint32_t>(ch - 'a' + 10);
+            } else if (ch >= 'A' && ch <= 'F') {
+                digit = static_cast<std::uint32_t>(ch - 'A' + 10);
+            } else {
+                return false;
+            }
+            out = out * 16 + digit;
+        }
+        return true;
+    }
+
+    // JSON number grammar, as lex_number in JsonDecode; the parse_json_*
+    // converters below do not validate.
+    bool number(JsValue &out) {
+        std::size_t start = pos_;
+        auto digits = [&]() {
+            std::size_t from = pos_;
+            while (pos_ < text_.size() && is_digit(text_[pos_])) {
+                ++pos_;
+            }
+            return pos_ > from;
+        };
+        auto invalid = [&]() {
+            pos_ = start;
+            return error("invalid number");
+        };
+        bool fraction = false;
+        match('-');
+        if (match('0')) {
+            if (pos_ < text_.size() && is_digit(text_[pos_])) {
+                return invalid();
+            }
+        } else if (!digits()) {
+            return invalid();
+        }
+        if (match('.')) {
+            fraction = true;
+            if (!digits()) {
+                return invalid();
+            }
+        }
+        if (match('e') || match('E')) {
+            fraction = true;
+            if (!match('+')) {
+                match('-');
+            }
+            if (!digits()) {
+                return invalid();
+            }
+        }
+        const char *first = text_.data() + start;
+        const char *last = text_.data() + pos_;
+        std::int64_t integer = 0;
+        if (!fraction && parse_json_int64(first, last, integer) == std::errc()) {
+            out = JsValue::make_integer(integer);
+            return true;
+        }
+        double value = 0;
+        if (parse_json_double(first, last, value) != std::errc()) {
+            return invalid();
+        }
+        out = JsValue::make_float(value);
+        return true;
+    }
+
+    // After [: a name, index, wildcard or filter and the closing ].
+    bool bracket(std::vector<JsonPath::Step> &steps, bool relative) {
+        skip_ws();
+        JsonPath::Step step;
+        if (!relative && match('*')) {
+            step.kind = JsonPath::StepKind::Wildcard;
+            out_.singular_ = false;
+        } else if (!relative && match('?')) {
+            step.kind = JsonPath::StepKind::Filter;
+            out_.singular_ = false;
+            if (!or_expr(step.filter)) {
+                return false;
+            }
+        } else if (peek() == '\'' || peek() == '"') {
+            std::string key;
+            if (!quoted(key)) {
+                return false;
+            }
+            step.key = intern(key);
+        } else if (peek() == '-' || is_digit(peek())) {
+            std::size_t start = pos_;
+            pos_ += peek() == '-' ? 1 : 0;
+            while (is_digit(peek())) {
+                ++pos_;
+            }
+            if (parse_json_int64(text_.data() + start, text_.data() + pos_, step.index) != std::errc()) {
+                pos_ = start;
+                return error("invalid index");
+            }
+            step.has_index = true;
+        } else {
+            return error(relative ? "expected name or index" : "expected name, index, * or filter");
+        }
+        skip_ws();
+        if (peek() == ',') {
+            return error("unions are not supported");
+        }
+        if (peek() == ':') {
+            return error("slices are not supported");
+        }
+        if (!match(']')) {
+            return error("expected ]");
+        }
+        steps.push_back(step);
+        return true;
+    }
+
+    std::uint32_t add(FilterKind kind, std::uint32_t lhs, std::uint32_t rhs) {
+        out_.filters_.push_back({kind, lhs, rhs});
+        return static_cast<std::uint32_t>(out_.filters_.size() - 1);
+    }
+
+    bool or_expr(std::uint32_t &node) {
+        if (!and_expr(node)) {
+            return false;
+        }
+        for (skip_ws(); match("||"); skip_ws()) {
+            std::uint32_t rhs = 0;
+            if (!and_expr(rhs)) {
+                return false;
+            }
+            node = add(FilterKind::Or, node, rhs);
+        }
+        return true;
+    }
+
+    bool and_expr(std::uint32_t &node) {
+        if (!unary(node)) {
+            return false;
+        }
+        for (skip_ws(); match("&&"); skip_ws()) {
+            std::uint32_t rhs = 0;
+            if (!unary(rhs)) {
+                return false;
+            }
+            node = add(FilterKind::And, node, rhs);
+        }
+        return true;
+    }
+
+    bool unary(std::uint32_t &node) {
+        skip_ws();
+        if (peek() == '!' && text_.substr(pos_, 2) != "!=") {
+            ++pos_;
+            std::uint32_t inner = 0;
+            if (!unary(inner)) {
+                return false;
+            }
+            node = add(FilterKind::Not, inner, 0);
+            return true;
+        }
+        if (match('(')) {
+            if (!or_expr(node)) {
+                return false;
+            }
+            skip_ws();
+            return match(')') || error("expected )");
+        }
+        return comparison(node);
+    }
+
+    bool comparison(std::uint32_t &node) {
+        std::uint32_t lhs = 0;
+        if (!operand(lhs)) {
+            return false;
+        }
+        skip_ws();
+        static const std::pair<std::string_view, FilterKind> ops[] = {
+            {"==", FilterKind::Equal},     {"!=", FilterKind::NotEqual},  {"<=", FilterKind::LessEqual},
+            {">=", FilterKind::GreaterEqual}, {"<", FilterKind::Less}, {">", FilterKind::Greater},
+        };
+        for (const auto &[token, kind] : ops) {
+            if (match(token)) {
+                std::uint32_t rhs = 0;
+                if (!operand(rhs)) {
+                    return false;
+                }
+                node = add(kind, lhs, rhs);
+                return true;
+            }
+        }
+        if (out_.operands_[lhs].literal) {
+            return error("expected comparison");
+        }
+        node = add(FilterKind::Exists, lhs, 0);
+        return true;
+    }
+
+    bool operand(std::uint32_t &index) {
+        skip_ws();
+        JsonPath::Operand op;
+        op.literal = true;
+        std::uint32_t name = JsonPath::kNone;
+        if (match('@')) {
+            op.literal = false;
+            op.begin = static_cast<std::uint32_t>(out_.relative_.size());
+            for (;;) {
+                if (match('.')) {
+                    JsonPath::Step step;
+                    if (!name_or_fail(step)) {
+                        return false;
+                    }
+                    out_.relative_.push_back(step);
+                } else if (match('[')) {
+                    if (!bracket(out_.relative_, true)) {
+                        return false;
+                    }
+                } else {
+                    break;
+                }
+            }
+            op.end = static_cast<std::uint32_t>(out_.relative_.size());
+        } else if (peek() == '\'' || peek() == '"') {
+            std::string text;
+            if (!quoted(text)) {
+                return false;
+            }
+            name = intern(text);
+        } else if (peek() == '-' || is_digit(peek())) {
+            if (!number(op.value)) {
+                return false;
+            }
+        } else if (match("true")) {
+            op.value = JsValue::make_boolean(true);
+        } else if (match("false")) {
+            op.value = JsValue::make_boolean(false);
+        } else if (match("null")) {
+            op.value = JsValue::make_null();
+        } else if (peek() == '$') {
+            return error("absolute paths in filters are not supported");
+        } else {
+            return error("expected @, a literal or (");
+        }
+        index = static_cast<std::uint32_t>(out_.operands_.size());
+        out_.operands_.push_back(std::move(op));
+        if (name != JsonPath::kNone) {
+            string_literals_.emplace_back(index, name);
+        }
+        return true;
+    }
+
+    bool name_or_fail(JsonPath::Step &step) {
+        if (peek() == '*') {
+            return error("wildcards are not allowed in filter paths");
+        }
+        return name(step);
+    }
+};
+
+std::expected<JsonPath, PathError> JsonPath::compile(std::string_view text, Syntax syntax) {
+    JsonPath out;
+    PathCompiler compiler(text, out);
+    bool ok = syntax == Syntax::Pointer ? compiler.pointer() : compiler.path();
+    if (!ok || !compiler.finish()) {
+        return std::unexpected(compiler.error());
+    }
+    return out;
+}
+
+bool JsonPath::child(GcHeap &heap, const Step &step, const JsValue &value, JsValue &out) const {
+    out = JsValue::make_undefined();
+    switch (value.type_) {
+        case JsNodeType::Object: {
+            if (step.key == kNone) {
+                return true;
+            }
+            const JsValue *member = gc_object_get(reinterpret_cast<const GcObject *>(value.gc), strings_[step.key]);
+            if (member) {
+                out = *member;
+            }
+            return true;
+        }
+        case JsNodeType::Array: {
+            const auto *arr = reinterpret_cast<const GcArray *>(value.gc);
+            std::int64_t index = step.index < 0 ? step.index + static_cast<std::int64_t>(arr->size) : step.index;
+            if (step.has_index && index >= 0 && static_cast<std::size_t>(index) < arr->size) {
+                out = gc_array_at(arr, static_cast<std::size_t>(index));
+            }
+            return true;
+        }
+        case JsNodeType::LazyJson: {
+            auto *lazy = reinterpret_cast<GcLazyJson *>(value.gc);
+            if (!lazy_json_is_array(lazy)) {
+                return step.key == kNone || lazy_json_get(heap, lazy, strings_[step.key], out);
+            }
+            auto size = static_cast<std::int64_t>(lazy_json_size(heap, lazy));
+            std::int64_t index = step.index < 0 ? step.index + size : step.index;
+            if (!step.has_index || index < 0 || index >= size) {
+                return true;
+            }
+            return lazy_json_at(heap, lazy, static_cast<std::size_t>(index), out);
+        }
+        default:
+            return true;
+    }
+}
+
+bool JsonPath::children(GcHeap &heap, const Step &step, const JsValue &value, std::vector<JsValue> &out) const {
+    auto emit = [&](const JsValue &item) {
+        bool keep = true;
+        if (step.kind == StepKind::Filter && !test(heap, step.filter, item, keep)) {
+            return false;
+        }
+        if (keep) {
+            out.push_back(item);
+        }
+        return true;
+    };
+    const JsValue *container = &value;
+    if (value.type_ == JsNodeType::LazyJson) {
+        auto *lazy = reinterpret_cast<GcLazyJson *>(value.gc);
+        if (lazy_json_is_array(lazy)) {
+            std::size_t size = lazy_json_size(heap, lazy);
+            for (std::size_t i = 0; i < size; ++i) {
+                JsValue item;
+                if (!lazy_json_at(heap, lazy, i, item) || !emit(item)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        container = lazy_json_force(heap, lazy);
+        if (!container) {
+            return false;
+        }
+    }
+    if (container->type_ == JsNodeType::Array) {
+        const auto *arr = reinterpret_cast<const GcArray *>(container->gc);
+        for (std::size_t i = 0; i < arr->size; ++i) {
+            if (!emit(gc_array_at(arr, i))) {
+                return false;
+            }
+        }
+    } else if (container->type_ == JsNodeType::Object) {
+        const auto *obj = reinterpret_cast<const GcObject *>(container->gc);
+        for (std::size_t i = 0; i < obj->entry_count; ++i) {
+            if (obj->entries[i].key && !emit(obj->entries[i].value)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool JsonPath::operand(GcHeap &heap, const Operand &op, const JsValue &at, JsValue &out) const {
+    if (op.literal) {
+        out = op.value;
+        return true;
+    }
+    out = at;
+    for (std::uint32_t i = op.begin; i < op.end && out.type_ != JsNodeType::Undefined; ++i) {
+        JsValue next;
+        if (!child(heap, relative_[i], out, next)) {
+            return false;
+        }
+        out = next;
+    }
+    return true;
+}
+
+bool JsonPath::test(GcHeap &heap, std::uint32_t node, const JsValue &at, bool &result) const {
+    const FilterNode &n = filters_[node];
+    switch (n.kind) {
+        case FilterKind::Or:
+        case FilterKind::And:
+            if (!test(heap, n.lhs, at, result)) {
+                return false;
+            }
+            if (result == (n.kind == FilterKind::Or)) {
+                return true;
+            }
+            return test(heap, n.rhs, at, result);
+        case FilterKind::Not:
+            if (!test(heap, n.lhs, at, result)) {
+                return false;
+            }
+            result = !result;
+            return true;
+        case FilterKind::Exists: {
+            JsValue value;
+            if (!operand(heap, operands_[n.lhs], at, value)) {
+                return false;
+            }
+            result = value.type_ != JsNodeType::Undefined;
+            return true;
+        }
+        default:
+            break;
+    }
+    JsValue lhs;
+    JsValue rhs;
+    if (!operand(heap, operands_[n.lhs], at, lhs) || !operand(heap, operands_[n.rhs], at, rhs)) {
+        return false;
+    }
+    if (n.kind == FilterKind::Equal || n.kind == FilterKind::NotEqual) {
+        result = values_equal(lhs, rhs) == (n.kind == FilterKind::Equal);
+        return true;
+    }
+    int order = 0;
+    if (!compare_values(lhs, rhs, order)) {
+        result = false;
+        return true;
+    }
+    switch (n.kind) {
+        case FilterKind::Less:
+            result = order < 0;
+            break;
+        case FilterKind::LessEqual:
+            result = order <= 0;
+            break;
+        case FilterKind::Greater:
+            result = order > 0;
+            break;
+        default:
+            result = order >= 0;
+            break;
+    }
+    return true;
+}
+
+bool JsonPath::query(GcHeap &heap, const JsValue &root, std::vector<JsValue> &out) const {
+    std::vector<JsValue> current{root};
+    std::vector<JsValue> next;
+    for (const Step &step : steps_) {
+        next.clear();
+        for (const JsValue &value : current) {
+            if (step.kind != StepKind::Child) {
+                if (!children(heap, step, value, next)) {
+                    return false;
+                }
+                continue;
+            }
+            JsValue item;
+            if (!child(heap, step, value, item)) {
+                return false;
+            }
+            if (item.type_ != JsNodeType::Undefined) {
+                next.push_back(std::move(item));
+            }
+        }
+        current.swap(next);
+        if (current.empty()) {
+            return true;
+        }
+    }
+    out.insert(out.end(), current.begin(), current.end());
+    return true;
+}
+
+bool JsonPath::get(GcHeap &heap, const JsValue &root, JsValue &out) const {
+    if (!singular_) {
+        std::vector<JsValue> matches;
+        if (!query(heap, root, matches)) {
+            return false;
+        }
+        out = matches.empty() ? JsValue::make_undefined() : matches.front();
+        return true;
+    }
+    out = root;
+    for (std::size_t i = 0; i < steps_.size() && out.type_ != JsNodeType::Undefined; ++i) {
+        JsValue next;
+        if (!child(heap, steps_[i], out, next)) {
+            return false;
+        }
+        out = next;
+    }
+    return true;
+}
+
+std::expected<std::shared_ptr<const JsonPath>, PathError> json_path_cached(std::string_view text,
+                                                                           JsonPath::Syntax syntax) {
+    thread_local std::unordered_map<std::string, std::shared_ptr<const JsonPath>> cache;
+    std::string key;
+    key.reserve(text.size() + 1);
+    key += syntax == JsonPath::Syntax::Pointer ? 'p' : '$';
+    key.append(text);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    auto compiled = JsonPath::compile(text, syntax);
+    if (!compiled) {
+        return std::unexpected(std::move(compiled.error()));
+    }
+    if (cache.size() >= kPathCacheSize) {
+        cache.clear();
+    }
+    auto path = std::make_shared<const JsonPath>(std::move(*compiled));
+    cache.emplace(std::move(key), path);
+    return path;
+}
+
+} // namespace fiber::json
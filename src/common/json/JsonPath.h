@@ -0,0 +1,127 @@
+#ifndef FIBER_JSONPATH_H
+#define FIBER_JSONPATH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JsGc.h"
+
+namespace fiber::json {
+
+struct PathError {
+    std::string message;
+    std::size_t position = 0;
+};
+
+// A JSON Pointer (RFC 6901) or JSONPath query compiled to a list of steps
+// whose member names are pre-hashed static strings. JSONPath takes $ then
+// .name, ['name'], [n] (negative counts from the end), .* / [*] and filters
+// [?(...)]: @-relative singular paths, literals, == != < <= > >=, !, && and
+// ||, a bare path testing existence. Recursive descent, slices and unions
+// are not supported.
+//
+// Lazy documents are walked in place: member and index steps decode only
+// what they touch, while wildcards and filters force objects they iterate.
+class JsonPath {
+public:
+    enum class Syntax {
+        Pointer,
+        Path,
+    };
+
+    static std::expected<JsonPath, PathError> compile(std::string_view text, Syntax syntax);
+
+    JsonPath(JsonPath &&) noexcept = default;
+    JsonPath &operator=(JsonPath &&) noexcept = default;
+    JsonPath(const JsonPath &) = delete;
+    JsonPath &operator=(const JsonPath &) = delete;
+
+    // No wildcard or filter: at most one match.
+    [[nodiscard]] bool singular() const {
+        return singular_;
+    }
+
+    // Appends the matches in document order. False only when out of memory.
+    [[nodiscard]] bool query(GcHeap &heap, const JsValue &root, std::vector<JsValue> &out) const;
+    // The first match, undefined when there is none. False only when out of
+    // memory.
+    [[nodiscard]] bool get(GcHeap &heap, const JsValue &root, JsValue &out) const;
+
+private:
+    friend class PathCompiler;
+
+    static constexpr std::uint32_t kNone = 0xFFFFFFFF;
+
+    enum class StepKind : std::uint8_t {
+        // key and/or index; a pointer segment like "0" has both.
+        Child,
+        Wildcard,
+        Filter,
+    };
+
+    struct Step {
+        StepKind kind = StepKind::Child;
+        std::uint32_t key = kNone;
+        bool has_index = false;
+        std::int64_t index = 0;
+        // Root of the filter expression in filters_.
+        std::uint32_t filter = 0;
+    };
+
+    enum class FilterKind : std::uint8_t {
+        Or,
+        And,
+        Not,
+        Exists,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+    };
+
+    // Or/And/Not: lhs and rhs are nodes; Exists and comparisons: operands.
+    struct FilterNode {
+        FilterKind kind = FilterKind::Exists;
+        std::uint32_t lhs = 0;
+        std::uint32_t rhs = 0;
+    };
+
+    // A literal, or the @-relative steps [begin, end) in relative_.
+    struct Operand {
+        bool literal = false;
+        JsValue value;
+        std::uint32_t begin = 0;
+        std::uint32_t end = 0;
+    };
+
+    JsonPath() = default;
+
+    [[nodiscard]] bool child(GcHeap &heap, const Step &step, const JsValue &value, JsValue &out) const;
+    [[nodiscard]] bool children(GcHeap &heap, const Step &step, const JsValue &value,
+                                std::vector<JsValue> &out) const;
+    [[nodiscard]] bool operand(GcHeap &heap, const Operand &op, const JsValue &at, JsValue &out) const;
+    [[nodiscard]] bool test(GcHeap &heap, std::uint32_t node, const JsValue &at, bool &result) const;
+
+    std::vector<Step> steps_;
+    std::vector<Step> relative_;
+    std::vector<FilterNode> filters_;
+    std::vector<Operand> operands_;
+    std::vector<const GcString *> strings_;
+    std::shared_ptr<GcStaticRegion> region_;
+    bool singular_ = true;
+};
+
+// JsonPath::compile, memoized per thread.
+std::expected<std::shared_ptr<const JsonPath>, PathError> json_path_cached(std::string_view text,
+                                                                           JsonPath::Syntax syntax);
+
+} // namespace fiber::json
+
+#endif // FIBER_JSONPATH_H
@@ -0,0 +1,1509 @@
+#include "JsonSchema.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "JsonNumber.h"
+#include "Utf.h"
+
+namespace fiber::json {
+namespace {
+
+constexpr std::uint32_t kNull = 1;
+constexpr std::uint32_t kBoolean = 2;
+constexpr std::uint32_t kObject = 4;
+constexpr std::uint32_t kArray = 8;
+constexpr std::uint32_t kNumber = 16;
+constexpr std::uint32_t kString = 32;
+constexpr std::uint32_t kInteger = 64;
+
+// Nested subschema evaluations on one value path, which bounds $ref cycles
+// that never descend into the instance.
+constexpr std::size_t kMaxDepth = 1024;
+// Subschemas applying to one value in the stream validator.
+constexpr std::size_t kMaxActive = 4096;
+constexpr std::size_t kSchemaCacheSize = 64;
+
+std::uint32_t type_of(const JsValue &value) {
+    switch (value.type_) {
+        case JsNodeType::Null:
+            return kNull;
+        case JsNodeType::Boolean:
+            return kBoolean;
+        case JsNodeType::Integer:
+            return kNumber | kInteger;
+        case JsNodeType::Float:
+            return std::isfinite(value.f) && std::trunc(value.f) == value.f ? kNumber | kInteger : kNumber;
+        case JsNodeType::HeapString:
+        case JsNodeType::NativeString:
+            return kString;
+        case JsNodeType::Array:
+            return kArray;
+        case JsNodeType::Object:
+            return kObject;
+        case JsNodeType::LazyJson: {
+            const auto *lazy = reinterpret_cast<const GcLazyJson *>(value.gc);
+            return lazy && lazy_json_is_array(lazy) ? kArray : kObject;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Indexed by bit position in a type mask.
+constexpr const char *kTypeNames[] = {"null", "boolean", "object", "array", "number", "string", "integer"};
+
+std::string type_names(std::uint32_t mask) {
+    std::string out;
+    for (std::size_t i = 0; i < std::size(kTypeNames); ++i) {
+        if ((mask & (1U << i)) == 0) {
+            continue;
+        }
+        if (!out.empty()) {
+            out += " or ";
+        }
+        out += kTypeNames[i];
+    }
+    return out;
+}
+
+double number_of(const JsValue &value) {
+    return value.type_ == JsNodeType::Integer ? static_cast<double>(value.i) : value.f;
+}
+
+std::string format_number(double value) {
+    char buf[kMaxNumberChars];
+    return std::string(buf, write_double(buf, value));
+}
+
+std::string format_count(double value) {
+    return std::to_string(static_cast<std::uint64_t>(value));
+}
+
+bool multiple_of(const JsValue &value, double divisor) {
+    if (value.type_ == JsNodeType::Integer && std::trunc(divisor) == divisor && divisor < 9.0e18) {
+        return value.i % static_cast<std::int64_t>(divisor) == 0;
+    }
+    double quotient = number_of(value) / divisor;
+    if (!std::isfinite(quotient)) {
+        return false;
+    }
+    // 0.3 is a multiple of 0.1 although neither is exact in binary.
+    return std::fabs(quotient - std::round(quotient)) <= 1e-9 * std::max(1.0, std::fabs(quotient));
+}
+
+std::size_t code_points(const GcString *text) {
+    if (text->encoding == GcStringEncoding::Byte) {
+        return text->len;
+    }
+    std::size_t count = text->len;
+    for (std::size_t i = 0; i + 1 < text->len; ++i) {
+        if (text->data16[i] >= 0xD800 && text->data16[i] <= 0xDBFF && text->data16[i + 1] >= 0xDC00 &&
+            text->data16[i + 1] <= 0xDFFF) {
+            --count;
+            ++i;
+        }
+    }
+    return count;
+}
+
+// A GcString header over code units owned elsewhere, for hashing and
+// comparison; never seen by a heap.
+GcString string_view_of(const DecodedString &text) {
+    GcString view;
+    view.len = text.size();
+    if (text.is_byte) {
+        view.encoding = GcStringEncoding::Byte;
+        view.data8 = const_cast<std::uint8_t *>(text.bytes.data());
+    } else {
+        view.encoding = GcStringEncoding::Utf16;
+        view.data16 = const_cast<char16_t *>(text.u16.data());
+    }
+    return view;
+}
+
+// The string behind a string value; native (UTF-8) strings are decoded into
+// scratch. nullptr when that text is not valid UTF-8.
+const GcString *string_of(const JsValue &value, DecodedString &scratch, GcString &view) {
+    if (value.type_ == JsNodeType::HeapString) {
+        return reinterpret_cast<const GcString *>(value.gc);
+    }
+    Utf8ScanResult scan;
+    if (!utf8_scan(value.ns().data, value.ns().len, scan)) {
+        return nullptr;
+    }
+    scratch.clear();
+    scratch.is_byte = scan.all_byte;
+    bool ok = false;
+    if (scan.all_byte) {
+        scratch.bytes.resize(scan.utf16_len);
+        ok = utf8_write_bytes(value.ns().data, value.ns().len, scratch.bytes.data(), scratch.bytes.size());
+    } else {
+        scratch.u16.resize(scan.utf16_len);
+        ok = utf8_write_utf16(value.ns().data, value.ns().len, scratch.u16.data(), scratch.u16.size());
+    }
+    if (!ok) {
+        return nullptr;
+    }
+    view = string_view_of(scratch);
+    return &view;
+}
+
+// UTF-8 for the regex engine; ASCII Byte strings are used in place.
+bool utf8_of(const GcString *text, std::string &scratch, std::string_view &out) {
+    if (text->encoding == GcStringEncoding::Byte) {
+        bool ascii = true;
+        for (std::size_t i = 0; i < text->len && ascii; ++i) {
+            ascii = text->data8[i] < 0x80;
+        }
+        if (ascii) {
+            out = std::string_view(reinterpret_cast<const char *>(text->data8), text->len);
+            return true;
+        }
+    }
+    if (!gc_string_to_utf8(text, scratch)) {
+        return false;
+    }
+    out = scratch;
+    return true;
+}
+
+void append_segment(std::string &path, std::string_view segment) {
+    path += '/';
+    for (char ch : segment) {
+        if (ch == '~') {
+            path += "~0";
+        } else if (ch == '/') {
+            path += "~1";
+        } else {
+            path += ch;
+        }
+    }
+}
+
+// const and enum members are scalars or static strings.
+bool equals_constant(const JsValue &constant, const JsValue *scalar, const GcString *text) {
+    if (constant.type_ == JsNodeType::HeapString) {
+        return text && gc_string_equals(text, reinterpret_cast<const GcString *>(constant.gc));
+    }
+    if (!scalar) {
+        return false;
+    }
+    switch (constant.type_) {
+        case JsNodeType::Null:
+            return scalar->type_ == JsNodeType::Null;
+        case JsNodeType::Boolean:
+            return scalar->type_ == JsNodeType::Boolean && scalar->b == constant.b;
+        case JsNodeType::Integer:
+        case JsNodeType::Float:
+            if (scalar->type_ == JsNodeType::Integer && constant.type_ == JsNodeType::Integer) {
+                return scalar->i == constant.i;
+            }
+            return (scalar->type_ == JsNodeType::Integer || scalar->type_ == JsNodeType::Float) &&
+                   number_of(*scalar) == number_of(constant);
+        default:
+            return false;
+    }
+}
+
+const JsValue *force(GcHeap &heap, const JsValue &value) {
+    if (value.type_ != JsNodeType::LazyJson) {
+        return &value;
+    }
+    auto *lazy = reinterpret_cast<GcLazyJson *>(value.gc);
+    return lazy ? lazy_json_force(heap, lazy) : nullptr;
+}
+
+// Structural equality for uniqueItems.
+bool values_equal(GcHeap &heap, const JsValue &lhs_value, const JsValue &rhs_value) {
+    const JsValue *lhs = force(heap, lhs_value);
+    const JsValue *rhs = force(heap, rhs_value);
+    if (!lhs || !rhs) {
+        return false;
+    }
+    std::uint32_t type = type_of(*lhs);
+    if ((type & kNumber) != 0) {
+        return equals_constant(*lhs, rhs, nullptr);
+    }
+    if (type != type_of(*rhs)) {
+        return false;
+    }
+    switch (type) {
+        case kNull:
+            return true;
+        case kBoolean:
+            return lhs->b == rhs->b;
+        case kString: {
+            DecodedString lhs_scratch;
+            DecodedString rhs_scratch;
+            GcString lhs_view;
+            GcString rhs_view;
+            const GcString *a = string_of(*lhs, lhs_scratch, lhs_view);
+            const GcString *b = string_of(*rhs, rhs_scratch, rhs_view);
+            return a && b && gc_string_equals(a, b);
+        }
+        case kArray: {
+            const auto *a = reinterpret_cast<const GcArray *>(lhs->gc);
+            const auto *b = reinterpret_cast<const GcArray *>(rhs->gc);
+            if (a->size != b->size) {
+                return false;
+            }
+            for (std::size_t i = 0; i < a->size; ++i) {
+                if (!values_equal(heap, gc_array_at(a, i), gc_array_at(b, i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case kObject: {
+            const auto *a = reinterpret_cast<const GcObject *>(lhs->gc);
+            const auto *b = reinterpret_cast<const GcObject *>(rhs->gc);
+            if (a->size != b->size) {
+                return false;
+            }
+            for (std::size_t cursor = 0; cursor < a->entry_count; ++cursor) {
+                const GcObjectEntry &entry = a->entries[cursor];
+                if (!entry.key) {
+                    continue;
+                }
+                const JsValue *other = gc_object_get(b, entry.key);
+                if (!other || !values_equal(heap, entry.value, *other)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+class SchemaCompiler {
+public:
+    SchemaCompiler(GcHeap &heap, JsonSchema &out)
+        : heap_(heap), out_(out) {}
+
+    bool run(const JsValue &root) {
+        out_.nodes_.emplace_back();
+        const JsValue *schema = force(heap_, root);
+        if (schema && schema->type_ == JsNodeType::Object) {
+            const auto *obj = reinterpret_cast<const GcObject *>(schema->gc);
+            for (std::size_t cursor = 0; cursor < obj->entry_count; ++cursor) {
+                const GcObjectEntry &entry = obj->entries[cursor];
+                if (!entry.key) {
+                    continue;
+                }
+                std::string keyword;
+                if (!gc_string_to_utf8(entry.key, keyword) || (keyword != "$defs" && keyword != "definitions")) {
+                    continue;
+                }
+                const JsValue *defs = force(heap_, entry.value);
+                if (!defs || defs->type_ != JsNodeType::Object) {
+                    return error("must be an object", "/" + keyword);
+                }
+                const auto *defs_obj = reinterpret_cast<const GcObject *>(defs->gc);
+                for (std::size_t at = 0; at < defs_obj->entry_count; ++at) {
+                    if (!defs_obj->entries[at].key) {
+                        continue;
+                    }
+                    std::string name;
+                    if (!gc_string_to_utf8(defs_obj->entries[at].key, name)) {
+                        return error("invalid name", "/" + keyword);
+                    }
+                    std::string ref = "#";
+                    append_segment(ref, keyword);
+                    append_segment(ref, name);
+                    auto node = static_cast<std::uint32_t>(out_.nodes_.size());
+                    out_.nodes_.emplace_back();
+                    defs_.emplace(ref, node);
+                    pending_.push_back({&defs_obj->entries[at].value, node, ref.substr(1)});
+                }
+            }
+        }
+        if (!compile(root, 0, "")) {
+            return false;
+        }
+        for (const Pending &def : pending_) {
+            if (!compile(*def.schema, def.node, def.path)) {
+                return false;
+            }
+        }
+        return finish();
+    }
+
+    [[nodiscard]] const SchemaError &error() const {
+        return error_;
+    }
+
+private:
+    using Inst = JsonSchema::Inst;
+    using Op = JsonSchema::Op;
+
+    struct Pending {
+        const JsValue *schema = nullptr;
+        std::uint32_t node = 0;
+        std::string path;
+    };
+
+    GcHeap &heap_;
+    JsonSchema &out_;
+    SchemaError error_;
+    std::unordered_map<std::string, std::uint32_t> defs_;
+    std::unordered_map<std::string, std::uint32_t> strings_;
+    std::vector<Pending> pending_;
+    // (constant, string) pairs resolved once the strings are allocated.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> string_constants_;
+
+    bool error(std::string message, std::string path) {
+        error_.message = std::move(message);
+        error_.path = std::move(path);
+        return false;
+    }
+
+    std::uint32_t intern(const std::string &text) {
+        auto [it, inserted] = strings_.emplace(text, static_cast<std::uint32_t>(out_.names_.size()));
+        if (inserted) {
+            out_.names_.push_back(text);
+        }
+        return it->second;
+    }
+
+    static bool to_text(const JsValue &value, std::string &out) {
+        if (value.type_ == JsNodeType::HeapString) {
+            return gc_string_to_utf8(reinterpret_cast<const GcString *>(value.gc), out);
+        }
+        if (value.type_ == JsNodeType::NativeString) {
+            out.assign(value.ns().data, value.ns().len);
+            return utf8_validate(out.data(), out.size());
+        }
+        return false;
+    }
+
+    static bool to_number(const JsValue &value, double &out) {
+        if (value.type_ != JsNodeType::Integer && value.type_ != JsNodeType::Float) {
+            return false;
+        }
+        out = number_of(value);
+        return std::isfinite(out);
+    }
+
+    static bool to_count(const JsValue &value, double &out) {
+        return to_number(value, out) && out >= 0 && std::trunc(out) == out;
+    }
+
+    bool subschema(const JsValue &value, const std::string &path, std::uint32_t &node) {
+        node = static_cast<std::uint32_t>(out_.nodes_.size());
+        out_.nodes_.emplace_back();
+        return compile(value, node, path);
+    }
+
+    // Like subschema, but false becomes kReject so the parent can name
+    // what it rejects.
+    bool subschema_or_reject(const JsValue &value, const std::string &path, std::uint32_t &node) {
+        if (value.type_ == JsNodeType::Boolean && !value.b) {
+            node = JsonSchema::kReject;
+            return true;
+        }
+        return subschema(value, path, node);
+    }
+
+    bool subschemas(const JsValue &value, const std::string &path, std::vector<std::uint32_t> &nodes) {
+        if (value.type_ != JsNodeType::Array || reinterpret_cast<const GcArray *>(value.gc)->size == 0) {
+            return error("must be a non-empty array", path);
+        }
+        const auto *arr = reinterpret_cast<const GcArray *>(value.gc);
+        for (std::size_t i = 0; i < arr->size; ++i) {
+            std::uint32_t node = 0;
+            if (!subschema(gc_array_at(arr, i), path + "/" + std::to_string(i), node)) {
+                return false;
+            }
+            nodes.push_back(node);
+        }
+        return true;
+    }
+
+    bool constant(const JsValue &value, const std::string &path, std::uint32_t &index) {
+        index = static_cast<std::uint32_t>(out_.constants_.size());
+        switch (value.type_) {
+            case JsNodeType::Null:
+            case JsNodeType::Boolean:
+            case JsNodeType::Integer:
+            case JsNodeType::Float:
+                out_.constants_.push_back(value);
+                return true;
+            case JsNodeType::HeapString:
+            case JsNodeType::NativeString: {
+                std::string text;
+                if (!to_text(value, text)) {
+                    return error("invalid string", path);
+                }
+                string_constants_.emplace_back(index, intern(text));
+                out_.constants_.push_back(JsValue::make_undefined());
+                return true;
+            }
+            default:
+                return error("only scalar values are supported", path);
+        }
+    }
+
+    void list(Op op, const std::vector<std::uint32_t> &items, std::vector<Inst> &code) {
+        auto offset = static_cast<std::uint32_t>(out_.lists_.size());
+        out_.lists_.insert(out_.lists_.end(), items.begin(), items.end());
+        code.push_back({op, offset, static_cast<std::uint32_t>(items.size()), 0});
+    }
+
+    bool compile(const JsValue &value, std::uint32_t node, const std::string &path) {
+        const JsValue *schema = force(heap_, value);
+        if (!schema) {
+            return error("out of memory", path);
+        }
+        std::vector<Inst> code;
+        if (schema->type_ == JsNodeType::Boolean) {
+            if (!schema->b) {
+                code.push_back({Op::Fail, 0, 0, 0});
+            }
+            emit(node, code);
+            return true;
+        }
+        if (schema->type_ != JsNodeType::Object) {
+            return error("schema must be an object or a boolean", path);
+        }
+        bool has_items = false;
+        std::uint32_t items = JsonSchema::kNone;
+        std::vector<std::uint32_t> prefix;
+        bool has_members = false;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> properties;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> patterns;
+        std::uint32_t additional = JsonSchema::kNone;
+
+        const auto *obj = reinterpret_cast<const GcObject *>(schema->gc);
+        for (std::size_t cursor = 0; cursor < obj->entry_count; ++cursor) {
+            const GcObjectEntry &entry = obj->entries[cursor];
+            if (!entry.key) {
+                continue;
+            }
+            std::string keyword;
+            if (!gc_string_to_utf8(entry.key, keyword)) {
+                return error("invalid keyword", path);
+            }
+            const JsValue *arg = force(heap_, entry.value);
+            if (!arg) {
+                return error("out of memory", path);
+            }
+            std::string at = path;
+            append_segment(at, keyword);
+            double number = 0;
+            if (keyword == "type") {
+                std::uint32_t mask = 0;
+                auto add = [&](const JsValue &name) {
+                    std::string text;
+                    if (!to_text(name, text)) {
+                        return false;
+                    }
+                    for (std::size_t i = 0; i < std::size(kTypeNames); ++i) {
+                        if (text == kTypeNames[i]) {
+                            mask |= 1U << i;
+                            return true;
+                        }
+                    }
+                    return false;
+                };
+                if (arg->type_ == JsNodeType::Array) {
+                    const auto *arr = reinterpret_cast<const GcArray *>(arg->gc);
+                    for (std::size_t i = 0; i < arr->size; ++i) {
+                        if (!add(gc_array_at(arr, i))) {
+                            return error("unknown type", at + "/" + std::to_string(i));
+                        }
+                    }
+                } else if (!add(*arg)) {
+                    return error("unknown type", at);
+                }
+                // Every integer is a number.
+                if ((mask & kNumber) != 0) {
+                    mask |= kInteger;
+                }
+                code.push_back({Op::Type, mask, 0, 0});
+            } else if (keyword == "const") {
+                std::uint32_t index = 0;
+                if (!constant(*arg, at, index)) {
+                    return false;
+                }
+                code.push_back({Op::Const, index, 0, 0});
+            } else if (keyword == "enum") {
+                if (arg->type_ != JsNodeType::Array) {
+                    return error("must be an array", at);
+                }
+                const auto *arr = reinterpret_cast<const GcArray *>(arg->gc);
+                auto first = static_cast<std::uint32_t>(out_.constants_.size());
+                for (std::size_t i = 0; i < arr->size; ++i) {
+                    std::uint32_t index = 0;
+                    if (!constant(gc_array_at(arr, i), at + "/" + std::to_string(i), index)) {
+                        return false;
+                    }
+                }
+                code.push_back({Op::Enum, first, static_cast<std::uint32_t>(arr->size), 0});
+            } else if (keyword == "minimum" || keyword == "maximum" || keyword == "exclusiveMinimum" ||
+                       keyword == "exclusiveMaximum" || keyword == "multipleOf") {
+                if (!to_number(*arg, number) || (keyword == "multipleOf" && number <= 0)) {
+                    return error(keyword == "multipleOf" ? "must be a positive number" : "must be a number", at);
+                }
+                Op op = keyword == "minimum"            ? Op::Minimum
+                        : keyword == "maximum"          ? Op::Maximum
+                        : keyword == "exclusiveMinimum" ? Op::ExclusiveMinimum
+                        : keyword == "exclusiveMaximum" ? Op::ExclusiveMaximum
+                                                        : Op::MultipleOf;
+                code.push_back({op, 0, 0, number});
+            } else if (keyword == "minLength" || keyword == "maxLength" || keyword == "minItems" ||
+                       keyword == "maxItems" || keyword == "minProperties" || keyword == "maxProperties") {
+                if (!to_count(*arg, number)) {
+                    return error("must be a non-negative integer", at);
+                }
+                Op op = keyword == "minLength"       ? Op::MinLength
+                        : keyword == "maxLength"     ? Op::MaxLength
+                        : keyword == "minItems"      ? Op::MinItems
+                        : keyword == "maxItems"      ? Op::MaxItems
+                        : keyword == "minProperties" ? Op::MinProperties
+                                                     : Op::MaxProperties;
+                code.push_back({op, 0, 0, number});
+            } else if (keyword == "pattern") {
+                std::uint32_t index = 0;
+                if (!regex(*arg, at, index)) {
+                    return false;
+                }
+                code.push_back({Op::Pattern, index, 0, 0});
+            } else if (keyword == "items") {
+                has_items = true;
+                if (!subschema_or_reject(*arg, at, items)) {
+                    return false;
+                }
+            } else if (keyword == "prefixItems") {
+                has_items = true;
+                if (!subschemas(*arg, at, prefix)) {
+                    return false;
+                }
+            } else if (keyword == "uniqueItems") {
+                if (arg->type_ != JsNodeType::Boolean) {
+                    return error("must be a boolean", at);
+                }
+                if (arg->b) {
+                    code.push_back({Op::UniqueItems, 0, 0, 0});
+                    out_.streamable_ = false;
+                }
+            } else if (keyword == "properties" || keyword == "patternProperties") {
+                if (arg->type_ != JsNodeType::Object) {
+                    return error("must be an object", at);
+                }
+                has_members = true;
+                const auto *members = reinterpret_cast<const GcObject *>(arg->gc);
+                for (std::size_t it = 0; it < members->entry_count; ++it) {
+                    const GcObjectEntry &member = members->entries[it];
+                    if (!member.key) {
+                        continue;
+                    }
+                    std::string name;
+                    if (!gc_string_to_utf8(member.key, name)) {
+                        return error("invalid property name", at);
+                    }
+                    std::string member_at = at;
+                    append_segment(member_at, name);
+                    std::uint32_t sub = 0;
+                    if (!subschema(member.value, member_at, sub)) {
+                        return false;
+                    }
+                    if (keyword == "properties") {
+                        properties.emplace_back(intern(name), sub);
+                        continue;
+                    }
+                    JsValue pattern = JsValue::make_native_string(name.data(), name.size());
+                    std::uint32_t index = 0;
+                    if (!regex(pattern, member_at, index)) {
+                        return false;
+                    }
+                    patterns.emplace_back(index, sub);
+                }
+            } else if (keyword == "additionalProperties") {
+                has_members = true;
+                if (!subschema_or_reject(*arg, at, additional)) {
+                    return false;
+                }
+            } else if (keyword == "required") {
+                if (arg->type_ != JsNodeType::Array) {
+                    return error("must be an array", at);
+                }
+                const auto *arr = reinterpret_cast<const GcArray *>(arg->gc);
+                std::vector<std::uint32_t> names;
+                for (std::size_t i = 0; i < arr->size; ++i) {
+                    std::string name;
+                    if (!to_text(gc_array_at(arr, i), name)) {
+                        return error("must be a string", at + "/" + std::to_string(i));
+                    }
+                    names.push_back(intern(name));
+                }
+                if (!names.empty()) {
+                    list(Op::Required, names, code);
+                }
+            } else if (keyword == "allOf" || keyword == "anyOf" || keyword == "oneOf") {
+                std::vector<std::uint32_t> nodes;
+                if (!subschemas(*arg, at, nodes)) {
+                    return false;
+                }
+                list(keyword == "allOf" ? Op::AllOf : keyword == "anyOf" ? Op::AnyOf : Op::OneOf, nodes, code);
+            } else if (keyword == "not") {
+                std::uint32_t sub = 0;
+                if (!subschema(*arg, at, sub)) {
+                    return false;
+                }
+                code.push_back({Op::Not, sub, 0, 0});
+            } else if (keyword == "$ref") {
+                std::string ref;
+                if (!to_text(*arg, ref)) {
+                    return error("must be a string", at);
+                }
+                if (ref == "#") {
+                    code.push_back({Op::Ref, 0, 0, 0});
+                    continue;
+                }
+                auto it = defs_.find(ref);
+                if (it == defs_.end()) {
+                    return error("unsupported reference " + ref, at);
+                }
+                code.push_back({Op::Ref, it->second, 0, 0});
+            }
+        }
+
+        if (has_items) {
+            std::vector<std::uint32_t> layout;
+            layout.push_back(items);
+            layout.insert(layout.end(), prefix.begin(), prefix.end());
+            auto offset = static_cast<std::uint32_t>(out_.lists_.size());
+            out_.lists_.insert(out_.lists_.end(), layout.begin(), layout.end());
+            code.push_back({Op::Items, offset, static_cast<std::uint32_t>(prefix.size()), 0});
+        }
+        if (has_members) {
+            auto offset = static_cast<std::uint32_t>(out_.lists_.size());
+            out_.lists_.push_back(static_cast<std::uint32_t>(properties.size()));
+            for (const auto &[name, sub] : properties) {
+                out_.lists_.push_back(name);
+                out_.lists_.push_back(sub);
+            }
+            out_.lists_.push_back(static_cast<std::uint32_t>(patterns.size()));
+            for (const auto &[index, sub] : patterns) {
+                out_.lists_.push_back(index);
+                out_.lists_.push_back(sub);
+            }
+            out_.lists_.push_back(additional);
+            code.push_back({Op::Members, offset, 0, 0});
+        }
+        emit(node, code);
+        return true;
+    }
+
+    bool regex(const JsValue &value, const std::string &path, std::uint32_t &index) {
+        std::string pattern;
+        if (!to_text(value, pattern)) {
+            return error("must be a string", path);
+        }
+        auto compiled = fiber::common::Regex::compile(pattern);
+        if (!compiled) {
+            return error("invalid pattern: " + compiled.error().message, path);
+        }
+        index = static_cast<std::uint32_t>(out_.regexes_.size());
+        out_.regexes_.push_back(std::move(*compiled));
+        return true;
+    }
+
+    void emit(std::uint32_t node, const std::vector<Inst> &code) {
+        auto begin = static_cast<std::uint32_t>(out_.code_.size());
+        out_.code_.insert(out_.code_.end(), code.begin(), code.end());
+        out_.nodes_[node] = {begin, static_cast<std::uint32_t>(out_.code_.size())};
+    }
+
+    bool finish() {
+        std::size_t capacity = 0;
+        for (const std::string &name : out_.names_) {
+            capacity += gc_static_string_size(name.size());
+        }
+        out_.region_ = std::make_shared<GcStaticRegion>(capacity);
+        for (const std::string &name : out_.names_) {
+            GcString *str = gc_new_static_string(out_.region_.get(), name.data(), name.size());
+            if (!str) {
+                return error("out of memory", "");
+            }
+            out_.by_hash_.emplace_back(str->hash, static_cast<std::uint32_t>(out_.strings_.size()));
+            out_.strings_.push_back(str);
+        }
+        std::sort(out_.by_hash_.begin(), out_.by_hash_.end());
+        for (const auto &[index, name] : string_constants_) {
+            JsValue &value = out_.constants_[index];
+            value.type_ = JsNodeType::HeapString;
+            value.gc = const_cast<GcHeader *>(&out_.strings_[name]->hdr);
+        }
+        return true;
+    }
+};
+
+class SchemaTreeValidator {
+public:
+    SchemaTreeValidator(const JsonSchema &schema, GcHeap &heap, JsonSchema::Mode mode,
+                        std::vector<SchemaViolation> *out)
+        : schema_(schema), heap_(heap), mode_(mode), out_(out) {}
+
+    bool node(std::uint32_t index, const JsValue &value) {
+        const JsValue *forced = force(heap_, value);
+        if (!forced) {
+            return fail("out of memory");
+        }
+        if (depth_ >= kMaxDepth) {
+            return fail("schema nesting too deep");
+        }
+        ++depth_;
+        const JsonSchema::Node &n = schema_.nodes_[index];
+        bool ok = true;
+        for (std::uint32_t pc = n.begin; pc < n.end; ++pc) {
+            if (!check(schema_.code_[pc], *forced)) {
+                ok = false;
+                if (stop()) {
+                    break;
+                }
+            }
+        }
+        --depth_;
+        return ok;
+    }
+
+private:
+    using Inst = JsonSchema::Inst;
+    using Op = JsonSchema::Op;
+
+    struct Segment {
+        const GcString *key = nullptr;
+        std::size_t index = 0;
+    };
+
+    const JsonSchema &schema_;
+    GcHeap &heap_;
+    JsonSchema::Mode mode_;
+    std::vector<SchemaViolation> *out_;
+    // Off inside anyOf, oneOf and not, whose branches only answer yes/no.
+    bool report_ = true;
+    std::size_t depth_ = 0;
+    std::vector<Segment> path_;
+    DecodedString decoded_;
+    GcString view_;
+    std::string scratch_;
+
+    [[nodiscard]] bool stop() const {
+        return !report_ || mode_ == JsonSchema::Mode::FirstError;
+    }
+
+    bool fail(std::string message) {
+        if (report_ && out_) {
+            out_->push_back({render(), std::move(message)});
+        }
+        return false;
+    }
+
+    std::string render() {
+        std::string path;
+        std::string key;
+        for (const Segment &segment : path_) {
+            if (segment.key) {
+                (void)gc_string_to_utf8(segment.key, key);
+                append_segment(path, key);
+            } else {
+                append_segment(path, std::to_string(segment.index));
+            }
+        }
+        return path;
+    }
+
+    bool quiet(std::uint32_t index, const JsValue &value) {
+        bool saved = report_;
+        report_ = false;
+        bool ok = node(index, value);
+        report_ = saved;
+        return ok;
+    }
+
+    bool child(std::uint32_t index, const JsValue &value, Segment segment) {
+        path_.push_back(segment);
+        bool ok = node(index, value);
+        path_.pop_back();
+        return ok;
+    }
+
+    bool check(const Inst &inst, const JsValue &value) {
+        const std::vector<std::uint32_t> &lists = schema_.lists_;
+        switch (inst.op) {
+            case Op::Items:
+            case Op::MinItems:
+            case Op::MaxItems:
+            case Op::UniqueItems:
+                return value.type_ != JsNodeType::Array || check_array(inst, reinterpret_cast<GcArray *>(value.gc));
+            case Op::Members:
+            case Op::Required:
+            case Op::MinProperties:
+            case Op::MaxProperties:
+                return value.type_ != JsNodeType::Object || check_object(inst, reinterpret_cast<GcObject *>(value.gc));
+            case Op::AllOf: {
+                bool ok = true;
+                for (std::uint32_t i = 0; i < inst.b; ++i) {
+                    if (!node(lists[inst.a + i], value)) {
+                        ok = false;
+                        if (stop()) {
+                            break;
+                        }
+                    }
+                }
+                return ok;
+            }
+            case Op::AnyOf:
+                for (std::uint32_t i = 0; i < inst.b; ++i) {
+                    if (quiet(lists[inst.a + i], value)) {
+                        return true;
+                    }
+                }
+                return fail("value does not match any anyOf schema");
+            case Op::OneOf: {
+                std::uint32_t matched = 0;
+                for (std::uint32_t i = 0; i < inst.b && matched < 2; ++i) {
+                    if (quiet(lists[inst.a + i], value)) {
+                        ++matched;
+                    }
+                }
+                if (matched == 1) {
+                    return true;
+                }
+                return fail(matched == 0 ? "value does not match any oneOf schema"
+                                         : "value matches more than one oneOf schema");
+            }
+            case Op::Not:
+                return !quiet(inst.a, value) || fail("value matches the not schema");
+            case Op::Ref:
+                return node(inst.a, value);
+            default: {
+                std::uint32_t type = type_of(value);
+                const GcString *text = (type & kString) != 0 ? string_of(value, decoded_, view_) : nullptr;
+                std::string message;
+                return schema_.check_value(inst, type, &value, text, message) || fail(std::move(message));
+            }
+        }
+    }
+
+    bool check_array(const Inst &inst, GcArray *arr) {
+        switch (inst.op) {
+            case Op::MinItems:
+                return static_cast<double>(arr->size) >= inst.number ||
+                       fail("array has fewer than " + format_count(inst.number) + " items");
+            case Op::MaxItems:
+                return static_cast<double>(arr->size) <= inst.number ||
+                       fail("array has more than " + format_count(inst.number) + " items");
+            case Op::UniqueItems:
+                for (std::size_t i = 1; i < arr->size; ++i) {
+                    for (std::size_t j = 0; j < i; ++j) {
+                        if (values_equal(heap_, gc_array_at(arr, j), gc_array_at(arr, i))) {
+                            return fail("items " + std::to_string(j) + " and " + std::to_string(i) + " are equal");
+                        }
+                    }
+                }
+                return true;
+            default:
+                break;
+        }
+        const std::uint32_t *layout = schema_.lists_.data() + inst.a;
+        bool ok = true;
+        for (std::size_t i = 0; i < arr->size; ++i) {
+            std::uint32_t target = i < inst.b ? layout[1 + i] : layout[0];
+            if (target == JsonSchema::kNone) {
+                break;
+            }
+            if (target == JsonSchema::kReject) {
+                return fail("array allows at most " + std::to_string(inst.b) + " items");
+            }
+            if (!child(target, gc_array_at(arr, i), {nullptr, i})) {
+                ok = false;
+                if (stop()) {
+                    break;
+                }
+            }
+        }
+        return ok;
+    }
+
+    bool check_object(const Inst &inst, GcObject *obj) {
+        const std::vector<std::uint32_t> &lists = schema_.lists_;
+        switch (inst.op) {
+            case Op::MinProperties:
+                return static_cast<double>(obj->size) >= inst.number ||
+                       fail("object has fewer than " + format_count(inst.number) + " properties");
+            case Op::MaxProperties:
+                return static_cast<double>(obj->size) <= inst.number ||
+                       fail("object has more than " + format_count(inst.number) + " properties");
+            case Op::Required: {
+                bool ok = true;
+                for (std::uint32_t i = 0; i < inst.b; ++i) {
+                    std::uint32_t name = lists[inst.a + i];
+                    if (!gc_object_get(obj, schema_.strings_[name])) {
+                        ok = fail("missing required property \"" + schema_.names_[name] + "\"");
+                        if (stop()) {
+                            break;
+                        }
+                    }
+                }
+                return ok;
+            }
+            default:
+                break;
+        }
+        std::uint32_t at = inst.a;
+        std::uint32_t property_count = lists[at];
+        const std::uint32_t *properties = lists.data() + at + 1;
+        at += 1 + 2 * property_count;
+        std::uint32_t pattern_count = lists[at];
+        const std::uint32_t *patterns = lists.data() + at + 1;
+        std::uint32_t additional = lists[at + 1 + 2 * pattern_count];
+        bool ok = true;
+        if (pattern_count == 0 && additional == JsonSchema::kNone) {
+            // Only named properties: probe with the pre-hashed names.
+            for (std::uint32_t i = 0; i < property_count; ++i) {
+                const GcString *name = schema_.strings_[properties[2 * i]];
+                const JsValue *member = gc_object_get(obj, name);
+                if (member && !child(properties[2 * i + 1], *member, {name, 0})) {
+                    ok = false;
+                    if (stop()) {
+                        break;
+                    }
+                }
+            }
+            return ok;
+        }
+        for (std::size_t cursor = 0; cursor < obj->entry_count; ++cursor) {
+            const GcObjectEntry &entry = obj->entries[cursor];
+            if (!entry.key) {
+                continue;
+            }
+            bool matched = false;
+            std::uint32_t name = property_count > 0 ? schema_.find_string(entry.key, gc_string_hash(entry.key)) : JsonSchema::kNone;
+            for (std::uint32_t i = 0; i < property_count && name != JsonSchema::kNone; ++i) {
+                if (properties[2 * i] == name) {
+                    matched = true;
+                    ok = child(properties[2 * i + 1], entry.value, {entry.key, 0}) && ok;
+                    break;
+                }
+            }
+            std::string_view key;
+            if (pattern_count > 0 && !utf8_of(entry.key, scratch_, key)) {
+                key = {};
+            }
+            for (std::uint32_t i = 0; i < pattern_count && (ok || !stop()); ++i) {
+                if (schema_.regexes_[patterns[2 * i]].search(key)) {
+                    matched = true;
+                    ok = child(patterns[2 * i + 1], entry.value, {entry.key, 0}) && ok;
+                }
+            }
+            if (!matched && additional != JsonSchema::kNone && (ok || !stop())) {
+                if (additional == JsonSchema::kReject) {
+                    std::string text;
+                    (void)gc_string_to_utf8(entry.key, text);
+                    ok = fail("property \"" + text + "\" is not allowed");
+                } else {
+                    ok = child(additional, entry.value, {entry.key, 0}) && ok;
+                }
+            }
+            if (!ok && stop()) {
+                break;
+            }
+        }
+        return ok;
+    }
+};
+
+std::uint32_t JsonSchema::find_string(const GcString *key, std::uint64_t hash) const {
+    auto it = std::lower_bound(by_hash_.begin(), by_hash_.end(), std::make_pair(hash, std::uint32_t{0}));
+    for (; it != by_hash_.end() && it->first == hash; ++it) {
+        if (gc_string_equals(strings_[it->second], key)) {
+            return it->second;
+        }
+    }
+    return kNone;
+}
+
+bool JsonSchema::check_value(const Inst &inst, std::uint32_t type, const JsValue *scalar, const GcString *text,
+                             std::string &message) const {
+    switch (inst.op) {
+        case Op::Fail:
+            message = "value is not allowed";
+            return false;
+        case Op::Type:
+            if ((type & inst.a) != 0) {
+                return true;
+            }
+            message = "expected " + type_names((inst.a & kNumber) != 0 ? inst.a & ~kInteger : inst.a);
+            return false;
+        case Op::Const:
+            if (equals_constant(constants_[inst.a], (type & kString) != 0 ? nullptr : scalar, text)) {
+                return true;
+            }
+            message = "value does not equal const";
+            return false;
+        case Op::Enum:
+            for (std::uint32_t i = 0; i < inst.b; ++i) {
+                if (equals_constant(constants_[inst.a + i], (type & kString) != 0 ? nullptr : scalar, text)) {
+                    return true;
+                }
+            }
+            message = "value is not one of the enum values";
+            return false;
+        case Op::Minimum:
+        case Op::Maximum:
+        case Op::ExclusiveMinimum:
+        case Op::ExclusiveMaximum:
+        case Op::MultipleOf: {
+            if ((type & kNumber) == 0) {
+                return true;
+            }
+            double value = number_of(*scalar);
+            switch (inst.op) {
+                case Op::Minimum:
+                    if (value >= inst.number) {
+                        return true;
+                    }
+                    message = "value is less than " + format_number(inst.number);
+                    return false;
+                case Op::Maximum:
+                    if (value <= inst.number) {
+                        return true;
+                    }
+                    message = "value is greater than " + format_number(inst.number);
+                    return false;
+                case Op::ExclusiveMinimum:
+                    if (value > inst.number) {
+                        return true;
+                    }
+                    message = "value is not greater than " + format_number(inst.number);
+                    return false;
+                case Op::ExclusiveMaximum:
+                    if (value < inst.number) {
+                        return true;
+                    }
+                    message = "value is not less than " + format_number(inst.number);
+                    return false;
+                default:
+                    if (multiple_of(*scalar, inst.number)) {
+                        return true;
+                    }
+                    message = "value is not a multiple of " + format_number(inst.number);
+                    return false;
+            }
+        }
+        case Op::MinLength:
+        case Op::MaxLength:
+        case Op::Pattern: {
+            if ((type & kString) == 0) {
+                return true;
+            }
+            if (!text) {
+                message = "string is not valid UTF-8";
+                return false;
+            }
+            if (inst.op == Op::Pattern) {
+                std::string scratch;
+                std::string_view utf8;
+                if (utf8_of(text, scratch, utf8) && regexes_[inst.a].search(utf8)) {
+                    return true;
+                }
+                message = "string does not match pattern " + regexes_[inst.a].pattern();
+                return false;
+            }
+            auto length = static_cast<double>(code_points(text));
+            if (inst.op == Op::MinLength ? length >= inst.number : length <= inst.number) {
+                return true;
+            }
+            message = std::string(inst.op == Op::MinLength ? "string is shorter than " : "string is longer than ") +
+                      format_count(inst.number) + " characters";
+            return false;
+        }
+        default:
+            return true;
+    }
+}
+
+std::expected<JsonSchema, SchemaError> JsonSchema::compile(GcHeap &heap, const JsValue &schema) {
+    JsonSchema out;
+    SchemaCompiler compiler(heap, out);
+    if (!compiler.run(schema)) {
+        return std::unexpected(compiler.error());
+    }
+    return out;
+}
+
+std::expected<JsonSchema, SchemaError> JsonSchema::compile(std::string_view json) {
+    GcHeap heap;
+    Parser parser(heap);
+    JsValue schema;
+    if (!parser.parse(json.data(), json.size(), schema)) {
+        return std::unexpected(SchemaError{"invalid JSON: " + parser.error().message, ""});
+    }
+    return compile(heap, schema);
+}
+
+bool JsonSchema::validate(GcHeap &heap, const JsValue &value, Mode mode,
+                          std::vector<SchemaViolation> *violations) const {
+    SchemaTreeValidator validator(*this, heap, mode, violations);
+    return validator.node(0, value);
+}
+
+std::expected<std::shared_ptr<const JsonSchema>, SchemaError> json_schema_cached(std::string_view json) {
+    thread_local std::unordered_map<std::string, std::shared_ptr<const JsonSchema>> cache;
+    std::string key(json);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    auto compiled = JsonSchema::compile(json);
+    if (!compiled) {
+        return std::unexpected(std::move(compiled.error()));
+    }
+    if (cache.size() >= kSchemaCacheSize) {
+        cache.clear();
+    }
+    auto schema = std::make_shared<const JsonSchema>(std::move(*compiled));
+    cache.emplace(std::move(key), schema);
+    return schema;
+}
+
+SchemaStreamValidator::SchemaStreamValidator(const JsonSchema &schema, JsonSchema::Mode mode)
+    : schema_(schema), mode_(mode) {
+    reset();
+}
+
+void SchemaStreamValidator::reset() {
+    actives_.clear();
+    failed_.assign(1, false);
+    groups_.clear();
+    depth_ = 0;
+    violations_.clear();
+    stopped_ = false;
+}
+
+bool SchemaStreamValidator::map_open() {
+    return begin(kObject, nullptr, nullptr);
+}
+
+bool SchemaStreamValidator::map_key(const DecodedString &key) {
+    if (stopped_) {
+        return false;
+    }
+    Frame &frame = frames_[depth_ - 1];
+    frame.key = key;
+    GcString view = string_view_of(frame.key);
+    frame.key_index = schema_.find_string(&view, gc_string_hash(&view));
+    if (frame.key_index != JsonSchema::kNone) {
+        frame.seen.push_back(frame.key_index);
+    }
+    return true;
+}
+
+bool SchemaStreamValidator::map_close() {
+    return end();
+}
+
+bool SchemaStreamValidator::array_open() {
+    return begin(kArray, nullptr, nullptr);
+}
+
+bool SchemaStreamValidator::array_close() {
+    return end();
+}
+
+bool SchemaStreamValidator::string(const DecodedString &value) {
+    GcString view = string_view_of(value);
+    return begin(kString, nullptr, &view);
+}
+
+bool SchemaStreamValidator::scalar(const JsValue &value) {
+    return begin(type_of(value), &value, nullptr);
+}
+
+bool SchemaStreamValidator::begin(std::uint32_t type, const JsValue *scalar, const GcString *text) {
+    if (stopped_) {
+        return false;
+    }
+    if (!schema_.streamable()) {
+        fail(0, depth_, "uniqueItems cannot be checked while streaming");
+        stopped_ = true;
+        return false;
+    }
+    std::size_t actives = actives_.size();
+    std::size_t groups = groups_.size();
+    if (depth_ == 0) {
+        actives_.push_back({0, 0});
+    } else {
+        select(frames_[depth_ - 1]);
+    }
+    expand(actives);
+    std::string message;
+    for (std::size_t i = actives; i < actives_.size() && !stopped_; ++i) {
+        Active active = actives_[i];
+        const JsonSchema::Node &node = schema_.nodes_[active.node];
+        for (std::uint32_t pc = node.begin; pc < node.end && !dead(active.lane); ++pc) {
+            const JsonSchema::Inst &inst = schema_.code_[pc];
+            if (inst.op <= JsonSchema::Op::Pattern && !schema_.check_value(inst, type, scalar, text, message)) {
+                fail(active.lane, depth_, std::move(message));
+            }
+        }
+    }
+    if (stopped_) {
+        return false;
+    }
+    if ((type & (kObject | kArray)) == 0) {
+        value_done(actives, groups);
+        return !stopped_;
+    }
+    if (depth_ == frames_.size()) {
+        frames_.emplace_back();
+    }
+    Frame &frame = frames_[depth_++];
+    frame.object = type == kObject;
+    frame.actives = actives;
+    frame.actives_end = actives_.size();
+    frame.groups = groups;
+    frame.count = 0;
+    frame.key.clear();
+    frame.key_index = JsonSchema::kNone;
+    frame.seen.clear();
+    return true;
+}
+
+bool SchemaStreamValidator::end() {
+    if (stopped_) {
+        return false;
+    }
+    const Frame &frame = frames_[depth_ - 1];
+    const std::vector<std::uint32_t> &lists = schema_.lists_;
+    auto count = static_cast<double>(frame.count);
+    for (std::size_t i = frame.actives; i < frame.actives_end && !stopped_; ++i) {
+        Active active = actives_[i];
+        const JsonSchema::Node &node = schema_.nodes_[active.node];
+        for (std::uint32_t pc = node.begin; pc < node.end && !dead(active.lane); ++pc) {
+            const JsonSchema::Inst &inst = schema_.code_[pc];
+            switch (inst.op) {
+                case JsonSchema::Op::MinItems:
+                    if (!frame.object && count < inst.number) {
+                        fail(active.lane, depth_ - 1, "array has fewer than " + format_count(inst.number) + " items");
+                    }
+                    break;
+                case JsonSchema::Op::MaxItems:
+                    if (!frame.object && count > inst.number) {
+                        fail(active.lane, depth_ - 1, "array has more than " + format_count(inst.number) + " items");
+                    }
+                    break;
+                case JsonSchema::Op::MinProperties:
+                    if (frame.object && count < inst.number) {
+                        fail(active.lane, depth_ - 1,
+                             "object has fewer than " + format_count(inst.number) + " properties");
+                    }
+                    break;
+                case JsonSchema::Op::MaxProperties:
+                    if (frame.object && count > inst.number) {
+                        fail(active.lane, depth_ - 1,
+                             "object has more than " + format_count(inst.number) + " properties");
+                    }
+                    break;
+                case JsonSchema::Op::Required:
+                    for (std::uint32_t k = 0; frame.object && k < inst.b && !dead(active.lane); ++k) {
+                        std::uint32_t name = lists[inst.a + k];
+                        if (std::find(frame.seen.begin(), frame.seen.end(), name) == frame.seen.end()) {
+                            fail(active.lane, depth_ - 1,
+                                 "missing required property \"" + schema_.names_[name] + "\"");
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    if (stopped_) {
+        return false;
+    }
+    std::size_t actives = frame.actives;
+    std::size_t groups = frame.groups;
+    --depth_;
+    value_done(actives, groups);
+    return !stopped_;
+}
+
+// Pushes the subschemas the parent's items or members apply to its next value.
+void SchemaStreamValidator::select(const Frame &parent) {
+    const std::vector<std::uint32_t> &lists = schema_.lists_;
+    bool have_key = false;
+    std::string_view key;
+    for (std::size_t i = parent.actives; i < parent.actives_end; ++i) {
+        Active active = actives_[i];
+        const JsonSchema::Node &node = schema_.nodes_[active.node];
+        for (std::uint32_t pc = node.begin; pc < node.end && !dead(active.lane); ++pc) {
+            const JsonSchema::Inst &inst = schema_.code_[pc];
+            if (inst.op == JsonSchema::Op::Items && !parent.object) {
+                std::uint32_t target = parent.count < inst.b ? lists[inst.a + 1 + parent.count] : lists[inst.a];
+                if (target == JsonSchema::kReject) {
+                    fail(active.lane, depth_ - 1, "array allows at most " + std::to_string(inst.b) + " items");
+                } else if (target != JsonSchema::kNone) {
+                    actives_.push_back({target, active.lane});
+                }
+                continue;
+            }
+            if (inst.op != JsonSchema::Op::Members || !parent.object) {
+                continue;
+            }
+            std::uint32_t at = inst.a;
+            std::uint32_t property_count = lists[at];
+            bool matched = false;
+            for (std::uint32_t k = 0; k < property_count && parent.key_index != JsonSchema::kNone; ++k) {
+                if (lists[at + 1 + 2 * k] == parent.key_index) {
+                    actives_.push_back({lists[at + 2 + 2 * k], active.lane});
+                    matched = true;
+                    break;
+                }
+            }
+            at += 1 + 2 * property_count;
+            std::uint32_t pattern_count = lists[at];
+            if (pattern_count > 0 && !have_key) {
+                GcString view = string_view_of(parent.key);
+                if (!utf8_of(&view, scratch_, key)) {
+                    key = {};
+                }
+                have_key = true;
+            }
+            for (std::uint32_t k = 0; k < pattern_count; ++k) {
+                if (schema_.regexes_[lists[at + 1 + 2 * k]].search(key)) {
+                    actives_.push_back({lists[at + 2 + 2 * k], active.lane});
+                    matched = true;
+                }
+            }
+            std::uint32_t additional = lists[at + 1 + 2 * pattern_count];
+            if (matched || additional == JsonSchema::kNone) {
+                continue;
+            }
+            if (additional == JsonSchema::kReject) {
+                std::string text;
+                GcString view = string_view_of(parent.key);
+                (void)gc_string_to_utf8(&view, text);
+                fail(active.lane, depth_ - 1, "property \"" + text + "\" is not allowed");
+            } else {
+                actives_.push_back({additional, active.lane});
+            }
+        }
+    }
+}
+
+// Adds what allOf, $ref and the branching keywords of the active
+// subschemas from index from on bring in for the same value.
+void SchemaStreamValidator::expand(std::size_t from) {
+    const std::vector<std::uint32_t> &lists = schema_.lists_;
+    for (std::size_t i = from; i < actives_.size(); ++i) {
+        if (actives_.size() - from > kMaxActive) {
+            fail(0, depth_, "schema nesting too deep");
+            stopped_ = true;
+            return;
+        }
+        Active active = actives_[i];
+        const JsonSchema::Node &node = schema_.nodes_[active.node];
+        for (std::uint32_t pc = node.begin; pc < node.end; ++pc) {
+            const JsonSchema::Inst &inst = schema_.code_[pc];
+            switch (inst.op) {
+                case JsonSchema::Op::AllOf:
+                    for (std::uint32_t k = 0; k < inst.b; ++k) {
+                        actives_.push_back({lists[inst.a + k], active.lane});
+                    }
+                    break;
+                case JsonSchema::Op::Ref:
+                    actives_.push_back({inst.a, active.lane});
+                    break;
+                case JsonSchema::Op::AnyOf:
+                case JsonSchema::Op::OneOf:
+                case JsonSchema::Op::Not: {
+                    std::uint32_t count = inst.op == JsonSchema::Op::Not ? 1 : inst.b;
+                    auto first = static_cast<std::uint32_t>(failed_.size());
+                    groups_.push_back({inst.op, active.lane, first, count});
+                    for (std::uint32_t k = 0; k < count; ++k) {
+                        failed_.push_back(false);
+                        std::uint32_t target = inst.op == JsonSchema::Op::Not ? inst.a : lists[inst.a + k];
+                        actives_.push_back({target, first + k});
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+// Settles the branch groups opened for a value, innermost first, and drops
+// its subschemas.
+void SchemaStreamValidator::value_done(std::size_t actives, std::size_t groups) {
+    for (std::size_t g = groups_.size(); g-- > groups;) {
+        Group group = groups_[g];
+        std::uint32_t passed = 0;
+        for (std::uint32_t k = 0; k < group.count; ++k) {
+            passed += failed_[group.first + k] ? 0 : 1;
+        }
+        failed_.resize(group.first);
+        if (dead(group.lane)) {
+            continue;
+        }
+        if (group.op == JsonSchema::Op::AnyOf && passed == 0) {
+            fail(group.lane, depth_, "value does not match any anyOf schema");
+        } else if (group.op == JsonSchema::Op::OneOf && passed != 1) {
+            fail(group.lane, depth_,
+                 passed == 0 ? "value does not match any oneOf schema" : "value matches more than one oneOf schema");
+        } else if (group.op == JsonSchema::Op::Not && passed == 1) {
+            fail(group.lane, depth_, "value matches the not schema");
+        }
+    }
+    groups_.resize(groups);
+    actives_.resize(actives);
+    if (depth_ > 0) {
+        ++frames_[depth_ - 1].count;
+    }
+}
+
+// A failed branch lane has nothing left to decide; the root lane keeps
+// collecting in AllErrors mode.
+bool SchemaStreamValidator::dead(std::uint32_t lane) const {
+    return lane != 0 && failed_[lane];
+}
+
+void SchemaStreamValidator::fail(std::uint32_t lane, std::size_t depth, std::string message) {
+    failed_[lane] = true;
+    if (lane != 0) {
+        return;
+    }
+    violations_.push_back({render(depth), std::move(message)});
+    if (mode_ == JsonSchema::Mode::FirstError) {
+        stopped_ = true;
+    }
+}
+
+std::string SchemaStreamValidator::render(std::size_t depth) const {
+    std::string path;
+    std::string key;
+    for (std::size_t i = 0; i < depth; ++i) {
+        const Frame &frame = frames_[i];
+        if (frame.object) {
+            GcString view = string_view_of(frame.key);
+            (void)gc_string_to_utf8(&view, key);
+            append_segment(path, key);
+        } else {
+            append_segment(path, std::to_string(frame.count));
+        }
+    }
+    return path;
+}
+
+} // namespace fiber::json
@@ -0,0 +1,226 @@
+#ifndef FIBER_JSONSCHEMA_H
+#define FIBER_JSONSCHEMA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../Regex.h"
+#include "JsGc.h"
+#include "JsonDecode.h"
+
+namespace fiber::json {
+
+struct SchemaError {
+    std::string message;
+    // JSON pointer to the offending place in the schema.
+    std::string path;
+};
+
+struct SchemaViolation {
+    // JSON pointer to the offending place in the instance.
+    std::string path;
+    std::string message;
+};
+
+// A JSON Schema (draft 2020-12 subset) compiled to a flat program: each
+// subschema is a contiguous run of checks, property names and string
+// constants are pre-hashed static strings, and patterns use
+// fiber::common::Regex. Understood keywords: type, const, enum, minimum,
+// maximum, exclusiveMinimum, exclusiveMaximum, multipleOf, minLength,
+// maxLength, pattern, prefixItems, items, minItems, maxItems, uniqueItems,
+// properties, patternProperties, additionalProperties, required,
+// minProperties, maxProperties, allOf, anyOf, oneOf, not, and $ref to "#" or
+// "#/$defs/<name>" (root $defs only). const and enum take scalars; other
+// keywords are annotations and ignored. Immutable once compiled, so one
+// schema can serve any number of threads.
+class JsonSchema {
+public:
+    enum class Mode {
+        // Stop at the first violation.
+        FirstError,
+        AllErrors,
+    };
+
+    static std::expected<JsonSchema, SchemaError> compile(GcHeap &heap, const JsValue &schema);
+    static std::expected<JsonSchema, SchemaError> compile(std::string_view json);
+
+    JsonSchema(JsonSchema &&) noexcept = default;
+    JsonSchema &operator=(JsonSchema &&) noexcept = default;
+    JsonSchema(const JsonSchema &) = delete;
+    JsonSchema &operator=(const JsonSchema &) = delete;
+
+    // Lazy documents are forced on heap. Violations are appended when
+    // violations is given.
+    [[nodiscard]] bool validate(GcHeap &heap, const JsValue &value, Mode mode = Mode::FirstError,
+                                std::vector<SchemaViolation> *violations = nullptr) const;
+
+    // False when the schema uses uniqueItems, which needs the whole array
+    // and so cannot be checked by SchemaStreamValidator.
+    [[nodiscard]] bool streamable() const {
+        return streamable_;
+    }
+
+private:
+    friend class SchemaCompiler;
+    friend class SchemaTreeValidator;
+    friend class SchemaStreamValidator;
+
+    static constexpr std::uint32_t kNone = 0xFFFFFFFF;
+    // An items or additionalProperties schema of false.
+    static constexpr std::uint32_t kReject = 0xFFFFFFFE;
+
+    enum class Op : std::uint8_t {
+        Fail,
+        Type,
+        Const,
+        Enum,
+        Minimum,
+        Maximum,
+        ExclusiveMinimum,
+        ExclusiveMaximum,
+        MultipleOf,
+        MinLength,
+        MaxLength,
+        Pattern,
+        // a: lists_ offset of [items node, prefix nodes...], b: prefix count.
+        Items,
+        MinItems,
+        MaxItems,
+        UniqueItems,
+        // a: lists_ offset of [n, (string, node) * n, m, (regex, node) * m,
+        // additional node].
+        Members,
+        // a: lists_ offset of string indices, b: count.
+        Required,
+        MinProperties,
+        MaxProperties,
+        // a: lists_ offset of nodes, b: count.
+        AllOf,
+        AnyOf,
+        OneOf,
+        Not,
+        Ref,
+    };
+
+    struct Inst {
+        Op op = Op::Fail;
+        std::uint32_t a = 0;
+        std::uint32_t b = 0;
+        double number = 0;
+    };
+
+    // [begin, end) in code_.
+    struct Node {
+        std::uint32_t begin = 0;
+        std::uint32_t end = 0;
+    };
+
+    JsonSchema() = default;
+
+    // Index of key in strings_, or kNone.
+    [[nodiscard]] std::uint32_t find_string(const GcString *key, std::uint64_t hash) const;
+    // The checks that look at a single value: type is its type mask,
+    // scalar is set for numbers, booleans and null, text for strings.
+    // Container checks pass.
+    [[nodiscard]] bool check_value(const Inst &inst, std::uint32_t type, const JsValue *scalar, const GcString *text,
+                                   std::string &message) const;
+
+    std::vector<Inst> code_;
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> lists_;
+    std::vector<JsValue> constants_;
+    std::vector<const GcString *> strings_;
+    std::vector<std::string> names_;
+    // (hash, index into strings_), sorted.
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> by_hash_;
+    std::vector<fiber::common::Regex> regexes_;
+    std::shared_ptr<GcStaticRegion> region_;
+    bool streamable_ = true;
+};
+
+// JsonSchema::compile(json), memoized per thread.
+std::expected<std::shared_ptr<const JsonSchema>, SchemaError> json_schema_cached(std::string_view json);
+
+// Validates a document as StreamParser reads it, without building the tree;
+// install with StreamParser::set_handler. In FirstError mode the first
+// violation stops the parse, which then reports an error while valid() is
+// false. The schema must be streamable() and outlive the validator.
+class SchemaStreamValidator final : public StreamHandler {
+public:
+    explicit SchemaStreamValidator(const JsonSchema &schema, JsonSchema::Mode mode = JsonSchema::Mode::FirstError);
+
+    void reset();
+    [[nodiscard]] bool valid() const {
+        return violations_.empty();
+    }
+    [[nodiscard]] const std::vector<SchemaViolation> &violations() const {
+        return violations_;
+    }
+
+    bool map_open() override;
+    bool map_key(const DecodedString &key) override;
+    bool map_close() override;
+    bool array_open() override;
+    bool array_close() override;
+    bool string(const DecodedString &value) override;
+    bool scalar(const JsValue &value) override;
+
+private:
+    // A subschema applying to the current value. Lane 0 decides validity;
+    // the branches of anyOf, oneOf and not get lanes of their own whose
+    // outcome is combined when the value ends.
+    struct Active {
+        std::uint32_t node = 0;
+        std::uint32_t lane = 0;
+    };
+
+    struct Group {
+        JsonSchema::Op op = JsonSchema::Op::AnyOf;
+        std::uint32_t lane = 0;
+        std::uint32_t first = 0;
+        std::uint32_t count = 0;
+    };
+
+    struct Frame {
+        bool object = false;
+        std::size_t actives = 0;
+        std::size_t actives_end = 0;
+        std::size_t groups = 0;
+        std::uint64_t count = 0;
+        DecodedString key;
+        std::uint32_t key_index = JsonSchema::kNone;
+        // Schema strings seen as keys, for required.
+        std::vector<std::uint32_t> seen;
+    };
+
+    const JsonSchema &schema_;
+    JsonSchema::Mode mode_;
+    std::vector<Active> actives_;
+    std::vector<bool> failed_;
+    std::vector<Group> groups_;
+    // Open containers are frames_[0, depth_); the rest are kept for reuse.
+    std::vector<Frame> frames_;
+    std::size_t depth_ = 0;
+    std::vector<SchemaViolation> violations_;
+    bool stopped_ = false;
+    std::string scratch_;
+
+    [[nodiscard]] bool begin(std::uint32_t type, const JsValue *scalar, const GcString *text);
+    [[nodiscard]] bool end();
+    void select(const Frame &parent);
+    void expand(std::size_t from);
+    void value_done(std::size_t actives, std::size_t groups);
+    [[nodiscard]] bool dead(std::uint32_t lane) const;
+    void fail(std::uint32_t lane, std::size_t depth, std::string message);
+    [[nodiscard]] std::string render(std::size_t depth) const;
+};
+
+} // namespace fiber::json
+
+#endif // FIBER_JSONSCHEMA_H
@@ -4,7 +4,58 @@
 
 #include "Utf.h"
 
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace fiber::json {
+namespace {
+
+// Length of the leading ASCII run.
+std::size_t ascii_prefix(const char *data, std::size_t len) {
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i))) != 0) {
+            return i;
+        }
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + i, sizeof(word));
+        if ((word & 0x8080808080808080ull) != 0) {
+            break;
+        }
+    }
+    while (i < len && static_cast<unsigned char>(data[i]) < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+void widen_ascii(const char *data, std::size_t len, char16_t *dst) {
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(block, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(block, zero));
+    }
+#endif
+    for (; i < len; ++i) {
+        dst[i] = static_cast<char16_t>(static_cast<unsigned char>(data[i]));
+    }
+}
+
+bool is_ascii(const char *data, std::size_t pos) {
+    return static_cast<unsigned char>(data[pos]) < 0x80;
+}
+
+} // namespace
 
 bool utf8_next_codepoint(const char *data, std::size_t len, std::size_t &pos, std::uint32_t &codepoint) {
     unsigned char ch = static_cast<unsigned char>(data[pos]);
@@ -59,6 +110,14 @@ bool utf8_scan(const char *data, std::size_t len, Utf8ScanResult &out) {
     }
     std::size_t pos = 0;
     while (pos < len) {
+        if (is_ascii(data, pos)) {
+            std::size_t run = ascii_prefix(data + pos, len - pos);
+            pos += run;
+            out.utf16_len += run;
+            if (pos == len) {
+                break;
+            }
+        }
         std::uint32_t codepoint = 0;
         if (!utf8_next_codepoint(data, len, pos, codepoint)) {
             return false;
@@ -86,6 +145,20 @@ bool utf8_write_bytes(const char *data, std::size_t len, std::uint8_t *dst, std:
     std::size_t pos = 0;
     std::size_t out_pos = 0;
     while (pos < len) {
+        if (is_ascii(data, pos)) {
+            std::size_t run = ascii_prefix(data + pos, len - pos);
+            if (run > dst_len - out_pos) {
+                return false;
+            }
+            if (run > 0) {
+                std::memcpy(dst + out_pos, data + pos, run);
+            }
+            pos += run;
+            out_pos += run;
+            if (pos == len) {
+                break;
+            }
+        }
         std::uint32_t codepoint = 0;
         if (!utf8_next_codepoint(data, len, pos, codepoint)) {
             return false;
@@ -111,6 +184,18 @@ bool utf8_write_utf16(const char *data, std::size_t len, char16_t *dst, std::siz
     std::size_t pos = 0;
     std::size_t out_pos = 0;
     while (pos < len) {
+        if (is_ascii(data, pos)) {
+            std::size_t run = ascii_prefix(data + pos, len - pos);
+            if (run > dst_len - out_pos) {
+                return false;
+            }
+            widen_ascii(data + pos, run, dst + out_pos);
+            pos += run;
+            out_pos += run;
+            if (pos == len) {
+                break;
+            }
+        }
         std::uint32_t codepoint = 0;
         if (!utf8_next_codepoint(data, len, pos, codepoint)) {
             return false;
@@ -17,6 +17,11 @@ public:
     virtual const fiber::json::JsValue &root() const = 0;
     virtual void *attach() const = 0;
     virtual const fiber::json::JsValue &arg_value(std::size_t index) const = 0;
+    // Like arg_value, but LazyJson arguments are passed through instead of
+    // being materialized, for functions that handle them (JSON.stringify).
+    virtual const fiber::json::JsValue &raw_arg_value(std::size_t index) const {
+        return arg_value(index);
+    }
     virtual std::size_t arg_count() const = 0;
 };
 
@@ -1,6 +1,7 @@
 #ifndef FIBER_SCRIPT_LIBRARY_H
 #define FIBER_SCRIPT_LIBRARY_H
 
+#include <cstdint>
 #include <expected>
 #include <string_view>
 #include <vector>
@@ -47,6 +48,12 @@ public:
 
     virtual ~Library() = default;
 
+    // Identifies the set of symbols scripts can link against. Serialized
+    // bytecode is only reused when this matches the value it was built with.
+    virtual std::uint64_t version() const {
+        return 0;
+    }
+
     virtual void mark_root_prop(std::string_view prop_name) {
         (void)prop_name;
     }
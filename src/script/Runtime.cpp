@@ -48,13 +48,24 @@ GcRootGuard::GcRootGuard(ScriptRuntime &runtime, fiber::json::JsValue *value)
 
 TempRootScope::TempRootScope(ScriptRuntime &runtime)
     : roots_(&runtime.roots()) {
+    roots_->push_frame();
+}
+
+TempRootScope::TempRootScope(TempRootScope &&other) noexcept
+    : roots_(other.roots_) {
+    other.roots_ = nullptr;
+}
+
+TempRootScope::~TempRootScope() {
+    if (roots_) {
+        roots_->pop_frame();
+    }
 }
 
 void TempRootScope::add(fiber::json::JsValue *value) {
-    if (!roots_ || !value) {
-        return;
+    if (roots_) {
+        roots_->add_stack_root(value);
     }
-    handles_.emplace_back(*roots_, value);
 }
 
 } // namespace fiber::script
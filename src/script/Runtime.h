@@ -3,7 +3,6 @@
 
 #include <cstddef>
 #include <utility>
-#include <vector>
 
 #include "../common/json/JsGc.h"
 
@@ -45,21 +44,22 @@ private:
     fiber::json::GcRootHandle handle_;
 };
 
+// Roots any number of values until the scope ends, as a frame of the
+// root set's stack roots; scopes must nest.
 class TempRootScope {
 public:
     explicit TempRootScope(ScriptRuntime &runtime);
 
     TempRootScope(const TempRootScope &) = delete;
     TempRootScope &operator=(const TempRootScope &) = delete;
-    TempRootScope(TempRootScope &&) noexcept = default;
-    TempRootScope &operator=(TempRootScope &&) noexcept = default;
-    ~TempRootScope() = default;
+    TempRootScope(TempRootScope &&other) noexcept;
+    TempRootScope &operator=(TempRootScope &&) = delete;
+    ~TempRootScope();
 
     void add(fiber::json::JsValue *value);
 
 private:
     fiber::json::GcRootSet *roots_ = nullptr;
-    std::vector<fiber::json::GcRootHandle> handles_;
 };
 
 } // namespace fiber::script
@@ -6,6 +6,7 @@
 
 #include "../common/Assert.h"
 #include "../common/json/JsGc.h"
+#include "../event/EventLoop.h"
 #include "Runtime.h"
 #include "run/InterpreterVm.h"
 #include "run/VmError.h"
@@ -80,6 +81,30 @@ ScriptRun::Result ScriptRun::operator()() {
     return to_result(std::move(vm_out));
 }
 
+// A yielded run re-posts itself through one of these. It is heap-allocated
+// so a canceled entry drained after the awaiter is gone touches only itself.
+struct ScriptRun::Awaiter::Slice {
+    fiber::event::EventLoop::DeferEntry entry;
+    fiber::event::EventLoop *loop = nullptr;
+    Awaiter *owner = nullptr;
+
+    static void run(Slice *slice) {
+        Awaiter *owner = slice->owner;
+        delete slice;
+        if (owner) {
+            owner->slice_ = nullptr;
+            owner->resume_if_complete();
+        }
+    }
+
+    static void cancel(Slice *slice) {
+        if (slice->owner) {
+            slice->owner->slice_ = nullptr;
+        }
+        delete slice;
+    }
+};
+
 ScriptRun::Awaiter::Awaiter(ScriptRun &&run)
     : run_(std::move(run)) {
     if (run_.vm_) {
@@ -88,6 +113,10 @@ ScriptRun::Awaiter::Awaiter(ScriptRun &&run)
 }
 
 ScriptRun::Awaiter::~Awaiter() {
+    if (slice_) {
+        slice_->owner = nullptr;
+        slice_->loop->cancel(slice_->entry);
+    }
     if (run_.vm_) {
         run_.vm_->set_resume_callback(nullptr, nullptr);
     }
@@ -129,14 +158,33 @@ bool ScriptRun::Awaiter::pump() {
         result_ = fiber::json::JsValue::make_undefined();
         return true;
     }
-    run::VmResult vm_out = fiber::json::JsValue::make_undefined();
-    auto state = run_.vm_->iterate(vm_out);
-    if (state == run::InterpreterVm::VmState::Success || state == run::InterpreterVm::VmState::Error) {
-        result_ = run_.to_result(std::move(vm_out));
-        run_.vm_->set_resume_callback(nullptr, nullptr);
-        return true;
+    for (;;) {
+        run::VmResult vm_out = fiber::json::JsValue::make_undefined();
+        auto state = run_.vm_->iterate(vm_out);
+        if (state == run::InterpreterVm::VmState::Success || state == run::InterpreterVm::VmState::Error) {
+            result_ = run_.to_result(std::move(vm_out));
+            run_.vm_->set_resume_callback(nullptr, nullptr);
+            return true;
+        }
+        // Off-loop there is nobody to hand the slice to; keep running.
+        if (run_.vm_->yielded() && !schedule_slice()) {
+            continue;
+        }
+        return false;
     }
-    return false;
+}
+
+bool ScriptRun::Awaiter::schedule_slice() {
+    auto *loop = fiber::event::EventLoop::current_or_null();
+    if (!loop) {
+        return false;
+    }
+    auto *slice = new Slice();
+    slice->loop = loop;
+    slice->owner = this;
+    slice_ = slice;
+    loop->post<Slice, &Slice::entry, &Slice::run, &Slice::cancel>(*slice);
+    return true;
 }
 
 void ScriptRun::Awaiter::resume_if_complete() {
@@ -164,6 +212,18 @@ bool ScriptRun::valid() const {
     return static_cast<bool>(vm_);
 }
 
+void ScriptRun::set_budget(const run::ExecBudget &budget) {
+    if (vm_) {
+        vm_->set_budget(budget);
+    }
+}
+
+void ScriptRun::set_profiler(run::VmProfiler *profiler) {
+    if (vm_) {
+        vm_->set_profiler(profiler);
+    }
+}
+
 ScriptRun::Result ScriptRun::to_result(run::VmResult result) {
     if (result) {
         return result.value();
@@ -193,6 +253,14 @@ bool ScriptSyncRun::valid() const {
     return run_.valid();
 }
 
+void ScriptSyncRun::set_budget(const run::ExecBudget &budget) {
+    run_.set_budget(budget);
+}
+
+void ScriptSyncRun::set_profiler(run::VmProfiler *profiler) {
+    run_.set_profiler(profiler);
+}
+
 ScriptAsyncRun::ScriptAsyncRun(ScriptRun run)
     : run_(std::move(run)) {
 }
@@ -205,6 +273,14 @@ bool ScriptAsyncRun::valid() const {
     return run_.valid();
 }
 
+void ScriptAsyncRun::set_budget(const run::ExecBudget &budget) {
+    run_.set_budget(budget);
+}
+
+void ScriptAsyncRun::set_profiler(run::VmProfiler *profiler) {
+    run_.set_profiler(profiler);
+}
+
 Script::Script(std::shared_ptr<ir::Compiled> compiled)
     : compiled_(std::move(compiled)) {
 }
@@ -9,6 +9,7 @@
 #include "../common/json/JsNode.h"
 #include "async/Task.h"
 #include "ir/Compiled.h"
+#include "run/ExecBudget.h"
 #include "run/VmError.h"
 
 namespace fiber::json {
@@ -21,6 +22,7 @@ namespace fiber::script {
 class ScriptRuntime;
 namespace run {
 class InterpreterVm;
+class VmProfiler;
 } // namespace run
 
 class ScriptRun {
@@ -41,6 +43,8 @@ public:
     Awaiter operator co_await() &&;
 
     bool valid() const;
+    void set_budget(const run::ExecBudget &budget);
+    void set_profiler(run::VmProfiler *profiler);
 
 private:
     friend class Script;
@@ -72,14 +76,18 @@ public:
     Result await_resume();
 
 private:
+    struct Slice;
+
     static void resume_callback(void *context);
     bool pump();
     void resume_if_complete();
+    bool schedule_slice();
 
     ScriptRun run_;
     std::optional<Result> result_;
     std::coroutine_handle<> continuation_ = nullptr;
     bool resuming_ = false;
+    Slice *slice_ = nullptr;
 };
 
 class ScriptSyncRun {
@@ -96,6 +104,8 @@ public:
     Result operator()();
     ScriptRun::Awaiter operator co_await() &&;
     bool valid() const;
+    void set_budget(const run::ExecBudget &budget);
+    void set_profiler(run::VmProfiler *profiler);
 
 private:
     friend class Script;
@@ -117,6 +127,8 @@ public:
 
     ScriptRun::Awaiter operator co_await() &&;
     bool valid() const;
+    void set_budget(const run::ExecBudget &budget);
+    void set_profiler(run::VmProfiler *profiler);
 
 private:
     friend class Script;
@@ -150,6 +162,10 @@ public:
 
     bool contains_async() const;
 
+    const std::shared_ptr<ir::Compiled> &compiled() const {
+        return compiled_;
+    }
+
 private:
     std::shared_ptr<ir::Compiled> compiled_;
 };
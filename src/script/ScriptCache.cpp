@@ -0,0 +1,156 @@
+#include "ScriptCache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <span>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ScriptCompiler.h"
+#include "../common/Sha256.h"
+
+namespace fiber::script {
+
+namespace {
+
+constexpr std::uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+bool write_all(int fd, const char *data, std::size_t len) {
+    while (len > 0) {
+        ssize_t rc = ::write(fd, data, len);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += rc;
+        len -= static_cast<std::size_t>(rc);
+    }
+    return true;
+}
+
+} // namespace
+
+ScriptCache::ScriptCache(Library &library, std::string directory)
+    : library_(library), directory_(std::move(directory)), library_version_(library.version()) {
+}
+
+std::uint64_t ScriptCache::hash_source(std::string_view script, bool allow_assign) {
+    std::uint64_t hash = kFnvOffsetBasis;
+    for (unsigned char ch : script) {
+        hash ^= ch;
+        hash *= kFnvPrime;
+    }
+    hash ^= allow_assign ? 1 : 0;
+    hash *= kFnvPrime;
+    return hash;
+}
+
+std::array<std::uint8_t, 32> ScriptCache::digest_source(std::string_view script, bool allow_assign) {
+    std::string input;
+    input.reserve(script.size() + 1);
+    input.push_back(allow_assign ? '\1' : '\0');
+    input.append(script);
+    return common::sha256_digest(reinterpret_cast<const std::uint8_t *>(input.data()), input.size());
+}
+
+std::expected<Script, parse::ParseError> ScriptCache::compile(std::string_view script, bool allow_assign) {
+    std::uint64_t hash = hash_source(script, allow_assign);
+    auto it = entries_.find(hash);
+    if (it != entries_.end() && it->second.allow_assign == allow_assign && it->second.source == script) {
+        ++hits_;
+        return Script(it->second.compiled);
+    }
+
+    ir::BytecodeKey key{digest_source(script, allow_assign), library_version_};
+    std::shared_ptr<ir::Compiled> compiled = load(key);
+    if (compiled) {
+        ++disk_hits_;
+    } else {
+        ++misses_;
+        auto result = compile_script(library_, script, allow_assign);
+        if (!result) {
+            return std::unexpected(result.error());
+        }
+        compiled = result->compiled();
+        store(key, *compiled);
+    }
+    entries_[hash] = Entry{std::string(script), allow_assign, compiled};
+    return Script(std::move(compiled));
+}
+
+void ScriptCache::clear() {
+    entries_.clear();
+}
+
+std::string ScriptCache::path_for(const ir::BytecodeKey &key) const {
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string path = directory_;
+    if (!path.empty() && path.back() != '/') {
+        path.push_back('/');
+    }
+    for (std::uint8_t byte : key.source_digest) {
+        path.push_back(kHex[byte >> 4]);
+        path.push_back(kHex[byte & 0xF]);
+    }
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), "-%016llx.fbc", static_cast<unsigned long long>(key.library_version));
+    path.append(suffix);
+    return path;
+}
+
+std::shared_ptr<ir::Compiled> ScriptCache::load(const ir::BytecodeKey &key) const {
+    if (directory_.empty()) {
+        return nullptr;
+    }
+    std::string path = path_for(key);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    auto compiled = ir::read_bytecode(std::span<const std::uint8_t>(static_cast<const std::uint8_t *>(addr), size),
+                                      library_,
+                                      key);
+    ::munmap(addr, size);
+    return compiled;
+}
+
+void ScriptCache::store(const ir::BytecodeKey &key, const ir::Compiled &compiled) const {
+    if (directory_.empty()) {
+        return;
+    }
+    std::string image = ir::write_bytecode(compiled, key);
+    if (image.empty()) {
+        return;
+    }
+    std::string path = path_for(key);
+    std::string tmp = path + ".tmp." + std::to_string(::getpid());
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    bool ok = write_all(fd, image.data(), image.size());
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+    }
+}
+
+} // namespace fiber::script
@@ -0,0 +1,74 @@
+#ifndef FIBER_SCRIPT_SCRIPT_CACHE_H
+#define FIBER_SCRIPT_SCRIPT_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Library.h"
+#include "Script.h"
+#include "ir/Bytecode.h"
+#include "parse/ParseError.h"
+
+namespace fiber::script {
+
+// Memoizes compile_script() by source content. Entries are keyed by a hash of
+// the source plus Library::version(); with a directory set, compiled bytecode
+// is also persisted there, named and tagged with the SHA-256 digest_source(),
+// and mapped back in on later misses, skipping the parser, optimiser and
+// compiler entirely. Not thread-safe.
+class ScriptCache {
+public:
+    explicit ScriptCache(Library &library, std::string directory = {});
+
+    std::expected<Script, parse::ParseError> compile(std::string_view script, bool allow_assign = true);
+
+    void clear();
+
+    std::size_t size() const {
+        return entries_.size();
+    }
+
+    std::size_t hits() const {
+        return hits_;
+    }
+
+    std::size_t disk_hits() const {
+        return disk_hits_;
+    }
+
+    std::size_t misses() const {
+        return misses_;
+    }
+
+    static std::uint64_t hash_source(std::string_view script, bool allow_assign);
+    static std::array<std::uint8_t, 32> digest_source(std::string_view script, bool allow_assign);
+
+private:
+    struct Entry {
+        std::string source;
+        bool allow_assign = true;
+        std::shared_ptr<ir::Compiled> compiled;
+    };
+
+    std::string path_for(const ir::BytecodeKey &key) const;
+    std::shared_ptr<ir::Compiled> load(const ir::BytecodeKey &key) const;
+    void store(const ir::BytecodeKey &key, const ir::Compiled &compiled) const;
+
+    Library &library_;
+    std::string directory_;
+    std::uint64_t library_version_ = 0;
+    std::unordered_map<std::uint64_t, Entry> entries_;
+    std::size_t hits_ = 0;
+    std::size_t disk_hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+} // namespace fiber::script
+
+#endif // FIBER_SCRIPT_SCRIPT_CACHE_H
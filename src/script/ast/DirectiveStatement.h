@@ -2,9 +2,11 @@
 #define FIBER_SCRIPT_AST_DIRECTIVE_STATEMENT_H
 
 #include <memory>
+#include <vector>
 
 #include "Statement.h"
 #include "Identifier.h"
+#include "Literal.h"
 #include "../Library.h"
 
 namespace fiber::script::ast {
@@ -15,8 +17,13 @@ public:
                        std::int32_t end,
                        std::unique_ptr<Identifier> type,
                        std::unique_ptr<Identifier> name,
+                       std::vector<Literal> literals,
                        Library::DirectiveDef *def)
-        : Statement(start, end), type_(std::move(type)), name_(std::move(name)), def_(def) {
+        : Statement(start, end),
+          type_(std::move(type)),
+          name_(std::move(name)),
+          literals_(std::move(literals)),
+          def_(def) {
     }
 
     const Identifier *type() const {
@@ -27,6 +34,10 @@ public:
         return name_.get();
     }
 
+    const std::vector<Literal> &literals() const {
+        return literals_;
+    }
+
     Library::DirectiveDef *directive_def() const {
         return def_;
     }
@@ -34,6 +45,7 @@ public:
 private:
     std::unique_ptr<Identifier> type_;
     std::unique_ptr<Identifier> name_;
+    std::vector<Literal> literals_;
     Library::DirectiveDef *def_ = nullptr;
 };
 
@@ -10,6 +10,8 @@
 
 namespace fiber::script::ast {
 
+class DirectiveStatement;
+
 class FunctionCall : public Expression {
 public:
     FunctionCall(std::int32_t start,
@@ -17,12 +19,14 @@ public:
                  std::string name,
                  Library::Function *func,
                  Library::AsyncFunction *async_func,
-                 std::vector<std::unique_ptr<Expression>> args)
+                 std::vector<std::unique_ptr<Expression>> args,
+                 std::shared_ptr<const DirectiveStatement> directive = nullptr)
         : Expression(start, end),
           name_(std::move(name)),
           func_(func),
           async_func_(async_func),
-          args_(std::move(args)) {
+          args_(std::move(args)),
+          directive_(std::move(directive)) {
     }
 
     const std::string &name() const {
@@ -45,11 +49,17 @@ public:
         return args_;
     }
 
+    // Set when the function was provided by a directive rather than the library.
+    const DirectiveStatement *directive() const {
+        return directive_.get();
+    }
+
 private:
     std::string name_;
     Library::Function *func_ = nullptr;
     Library::AsyncFunction *async_func_ = nullptr;
     std::vector<std::unique_ptr<Expression>> args_;
+    std::shared_ptr<const DirectiveStatement> directive_;
 };
 
 } // namespace fiber::script::ast
@@ -0,0 +1,433 @@
+#include "Bytecode.h"
+
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../Library.h"
+
+namespace fiber::script::ir {
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x43534246; // "FBSC"
+constexpr std::uint32_t kFormatVersion = 3;
+
+constexpr std::uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+enum class OperandTag : std::uint8_t {
+    Const,
+    String,
+    Symbol,
+    Regex,
+};
+
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t format;
+    std::uint8_t source_digest[32];
+    std::uint64_t library_version;
+    std::uint64_t body_size;
+    std::uint64_t body_hash;
+};
+
+std::uint64_t hash_bytes(const std::uint8_t *data, std::size_t len) {
+    std::uint64_t hash = kFnvOffsetBasis;
+    for (std::size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+class Writer {
+public:
+    template <typename T>
+    void pod(T value) {
+        const auto *bytes = reinterpret_cast<const char *>(&value);
+        out_.append(bytes, sizeof(T));
+    }
+
+    void str(std::string_view text) {
+        pod<std::uint32_t>(static_cast<std::uint32_t>(text.size()));
+        out_.append(text.data(), text.size());
+    }
+
+    template <typename T>
+    void array(const std::vector<T> &values) {
+        pod<std::uint32_t>(static_cast<std::uint32_t>(values.size()));
+        if (!values.empty()) {
+            out_.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+        }
+    }
+
+    void const_value(const Compiled::ConstValue &cv) {
+        pod<std::uint8_t>(static_cast<std::uint8_t>(cv.kind));
+        switch (cv.kind) {
+            case Compiled::ConstValue::Kind::Undefined:
+            case Compiled::ConstValue::Kind::Null:
+                break;
+            case Compiled::ConstValue::Kind::Boolean:
+                pod<std::uint8_t>(cv.bool_value ? 1 : 0);
+                break;
+            case Compiled::ConstValue::Kind::Integer:
+                pod<std::int64_t>(cv.int_value);
+                break;
+            case Compiled::ConstValue::Kind::Float:
+                pod<double>(cv.float_value);
+                break;
+            case Compiled::ConstValue::Kind::String:
+                str(cv.text);
+                break;
+            case Compiled::ConstValue::Kind::Binary:
+                array(cv.bytes);
+                break;
+        }
+    }
+
+    std::string &out() {
+        return out_;
+    }
+
+private:
+    std::string out_;
+};
+
+class Reader {
+public:
+    explicit Reader(std::span<const std::uint8_t> data) : data_(data) {
+    }
+
+    template <typename T>
+    bool pod(T &value) {
+        if (data_.size() - pos_ < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool str(std::string &text) {
+        std::uint32_t len = 0;
+        if (!pod(len) || data_.size() - pos_ < len) {
+            return false;
+        }
+        text.assign(reinterpret_cast<const char *>(data_.data() + pos_), len);
+        pos_ += len;
+        return true;
+    }
+
+    template <typename T>
+    bool array(std::vector<T> &values) {
+        std::uint32_t count = 0;
+        if (!pod(count) || (data_.size() - pos_) / sizeof(T) < count) {
+            return false;
+        }
+        values.resize(count);
+        if (count > 0) {
+            std::memcpy(values.data(), data_.data() + pos_, count * sizeof(T));
+        }
+        pos_ += count * sizeof(T);
+        return true;
+    }
+
+    bool const_value(Compiled::ConstValue &cv) {
+        std::uint8_t kind = 0;
+        if (!pod(kind) || kind > static_cast<std::uint8_t>(Compiled::ConstValue::Kind::Binary)) {
+            return false;
+        }
+        cv.kind = static_cast<Compiled::ConstValue::Kind>(kind);
+        switch (cv.kind) {
+            case Compiled::ConstValue::Kind::Undefined:
+            case Compiled::ConstValue::Kind::Null:
+                return true;
+            case Compiled::ConstValue::Kind::Boolean: {
+                std::uint8_t flag = 0;
+                if (!pod(flag)) {
+                    return false;
+                }
+                cv.bool_value = flag != 0;
+                return true;
+            }
+            case Compiled::ConstValue::Kind::Integer:
+                return pod(cv.int_value);
+            case Compiled::ConstValue::Kind::Float:
+                return pod(cv.float_value);
+            case Compiled::ConstValue::Kind::String:
+                return str(cv.text);
+            case Compiled::ConstValue::Kind::Binary:
+                return array(cv.bytes);
+        }
+        return false;
+    }
+
+    bool done() const {
+        return pos_ == data_.size();
+    }
+
+private:
+    std::span<const std::uint8_t> data_;
+    std::size_t pos_ = 0;
+};
+
+fiber::json::JsValue literal_value(const Compiled::ConstValue &cv) {
+    switch (cv.kind) {
+        case Compiled::ConstValue::Kind::Null:
+            return fiber::json::JsValue::make_null();
+        case Compiled::ConstValue::Kind::Boolean:
+            return fiber::json::JsValue::make_boolean(cv.bool_value);
+        case Compiled::ConstValue::Kind::Integer:
+            return fiber::json::JsValue::make_integer(cv.int_value);
+        case Compiled::ConstValue::Kind::Float:
+            return fiber::json::JsValue::make_float(cv.float_value);
+        case Compiled::ConstValue::Kind::String:
+            return fiber::json::JsValue::make_native_string(const_cast<char *>(cv.text.data()), cv.text.size());
+        default:
+            return fiber::json::JsValue::make_undefined();
+    }
+}
+
+void *resolve_symbol(const Compiled::Symbol &symbol,
+                     const std::vector<Library::DirectiveDef *> &defs,
+                     const Compiled &compiled,
+                     Library &library) {
+    if (symbol.directive >= 0) {
+        auto index = static_cast<std::size_t>(symbol.directive);
+        if (index >= defs.size()) {
+            return nullptr;
+        }
+        const std::string &prefix = compiled.directives[index].name;
+        switch (symbol.kind) {
+            case Compiled::Symbol::Kind::Function:
+                return defs[index]->find_func(prefix, symbol.name);
+            case Compiled::Symbol::Kind::AsyncFunction:
+                return defs[index]->find_async_func(prefix, symbol.name);
+            default:
+                return nullptr;
+        }
+    }
+    switch (symbol.kind) {
+        case Compiled::Symbol::Kind::Function:
+            return library.find_func(symbol.name);
+        case Compiled::Symbol::Kind::AsyncFunction:
+            return library.find_async_func(symbol.name);
+        case Compiled::Symbol::Kind::Constant:
+            return library.find_constant(symbol.name, symbol.key);
+        case Compiled::Symbol::Kind::AsyncConstant:
+            return library.find_async_constant(symbol.name, symbol.key);
+    }
+    return nullptr;
+}
+
+} // namespace
+
+std::string write_bytecode(const Compiled &compiled, const BytecodeKey &key) {
+    std::unordered_map<const void *, const Compiled::ConstValue *> consts;
+    for (const auto &cv : compiled.const_pool) {
+        consts.emplace(cv.get(), cv.get());
+    }
+    std::unordered_map<const void *, const std::string *> strings;
+    for (const auto &text : compiled.string_pool) {
+        strings.emplace(text.get(), text.get());
+    }
+    std::unordered_map<const void *, const fiber::common::Regex *> regexes;
+    for (const auto &regex : compiled.regex_pool) {
+        regexes.emplace(regex.get(), regex.get());
+    }
+    std::unordered_map<std::size_t, std::size_t> symbols;
+    for (std::size_t i = 0; i < compiled.symbols.size(); ++i) {
+        symbols.emplace(compiled.symbols[i].operand, i);
+    }
+
+    Writer body;
+    body.pod<std::uint64_t>(compiled.stack_size);
+    body.pod<std::uint64_t>(compiled.var_table_size);
+    body.array(compiled.codes);
+    body.array(compiled.positions);
+    body.array(compiled.exception_table);
+
+    body.pod<std::uint32_t>(static_cast<std::uint32_t>(compiled.directives.size()));
+    for (const auto &directive : compiled.directives) {
+        body.str(directive.type);
+        body.str(directive.name);
+        body.pod<std::uint32_t>(static_cast<std::uint32_t>(directive.literals.size()));
+        for (const auto &literal : directive.literals) {
+            body.const_value(literal);
+        }
+    }
+
+    body.pod<std::uint32_t>(static_cast<std::uint32_t>(compiled.operands.size()));
+    for (std::size_t i = 0; i < compiled.operands.size(); ++i) {
+        const void *operand = compiled.operands[i];
+        if (auto it = symbols.find(i); it != symbols.end()) {
+            const auto &symbol = compiled.symbols[it->second];
+            body.pod<std::uint8_t>(static_cast<std::uint8_t>(OperandTag::Symbol));
+            body.pod<std::uint8_t>(static_cast<std::uint8_t>(symbol.kind));
+            body.pod<std::int32_t>(symbol.directive);
+            body.str(symbol.name);
+            body.str(symbol.key);
+        } else if (auto cit = consts.find(operand); cit != consts.end()) {
+            body.pod<std::uint8_t>(static_cast<std::uint8_t>(OperandTag::Const));
+            body.const_value(*cit->second);
+        } else if (auto sit = strings.find(operand); sit != strings.end()) {
+            body.pod<std::uint8_t>(static_cast<std::uint8_t>(OperandTag::String));
+            body.str(*sit->second);
+        } else if (auto rit = regexes.find(operand); rit != regexes.end()) {
+            body.pod<std::uint8_t>(static_cast<std::uint8_t>(OperandTag::Regex));
+            body.str(rit->second->pattern());
+        } else {
+            // Operand without a symbolic identity; the image would not relink.
+            return {};
+        }
+    }
+
+    Header header{};
+    header.magic = kMagic;
+    header.format = kFormatVersion;
+    std::memcpy(header.source_digest, key.source_digest.data(), sizeof(header.source_digest));
+    header.library_version = key.library_version;
+    header.body_size = body.out().size();
+    header.body_hash = hash_bytes(reinterpret_cast<const std::uint8_t *>(body.out().data()), body.out().size());
+
+    std::string out;
+    out.reserve(sizeof(Header) + body.out().size());
+    out.append(reinterpret_cast<const char *>(&header), sizeof(Header));
+    out.append(body.out());
+    return out;
+}
+
+std::shared_ptr<Compiled> read_bytecode(std::span<const std::uint8_t> data,
+                                        Library &library,
+                                        const BytecodeKey &key) {
+    Header header{};
+    if (data.size() < sizeof(Header)) {
+        return nullptr;
+    }
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (header.magic != kMagic || header.format != kFormatVersion ||
+        std::memcmp(header.source_digest, key.source_digest.data(), sizeof(header.source_digest)) != 0 ||
+        header.library_version != key.library_version ||
+        header.body_size != data.size() - sizeof(Header)) {
+        return nullptr;
+    }
+    auto body = data.subspan(sizeof(Header));
+    if (hash_bytes(body.data(), body.size()) != header.body_hash) {
+        return nullptr;
+    }
+
+    auto compiled = std::make_shared<Compiled>();
+    Reader in(body);
+    std::uint64_t stack_size = 0;
+    std::uint64_t var_table_size = 0;
+    if (!in.pod(stack_size) || !in.pod(var_table_size) ||
+        !in.array(compiled->codes) || !in.array(compiled->positions) || !in.array(compiled->exception_table)) {
+        return nullptr;
+    }
+    compiled->stack_size = static_cast<std::size_t>(stack_size);
+    compiled->var_table_size = static_cast<std::size_t>(var_table_size);
+
+    std::uint32_t directive_count = 0;
+    if (!in.pod(directive_count)) {
+        return nullptr;
+    }
+    std::vector<Library::DirectiveDef *> defs;
+    for (std::uint32_t i = 0; i < directive_count; ++i) {
+        Compiled::Directive directive;
+        std::uint32_t literal_count = 0;
+        if (!in.str(directive.type) || !in.str(directive.name) || !in.pod(literal_count)) {
+            return nullptr;
+        }
+        std::vector<fiber::json::JsValue> literals;
+        for (std::uint32_t j = 0; j < literal_count; ++j) {
+            Compiled::ConstValue cv;
+            if (!in.const_value(cv)) {
+                return nullptr;
+            }
+            directive.literals.push_back(std::move(cv));
+        }
+        for (const auto &literal : directive.literals) {
+            literals.push_back(literal_value(literal));
+        }
+        Library::DirectiveDef *def = library.find_directive_def(directive.type, directive.name, literals);
+        if (!def) {
+            return nullptr;
+        }
+        defs.push_back(def);
+        compiled->directives.push_back(std::move(directive));
+    }
+
+    std::uint32_t operand_count = 0;
+    if (!in.pod(operand_count)) {
+        return nullptr;
+    }
+    compiled->operands.reserve(operand_count);
+    for (std::uint32_t i = 0; i < operand_count; ++i) {
+        std::uint8_t tag = 0;
+        if (!in.pod(tag)) {
+            return nullptr;
+        }
+        switch (static_cast<OperandTag>(tag)) {
+            case OperandTag::Const: {
+                auto cv = std::make_unique<Compiled::ConstValue>();
+                if (!in.const_value(*cv)) {
+                    return nullptr;
+                }
+                compiled->operands.push_back(cv.get());
+                compiled->const_pool.push_back(std::move(cv));
+                break;
+            }
+            case OperandTag::String: {
+                auto text = std::make_unique<std::string>();
+                if (!in.str(*text)) {
+                    return nullptr;
+                }
+                compiled->operands.push_back(text.get());
+                compiled->string_pool.push_back(std::move(text));
+                break;
+            }
+            case OperandTag::Regex: {
+                std::string pattern;
+                if (!in.str(pattern)) {
+                    return nullptr;
+                }
+                auto regex = fiber::common::Regex::compile(pattern);
+                if (!regex) {
+                    return nullptr;
+                }
+                auto stored = std::make_unique<fiber::common::Regex>(std::move(*regex));
+                compiled->operands.push_back(stored.get());
+                compiled->regex_pool.push_back(std::move(stored));
+                break;
+            }
+            case OperandTag::Symbol: {
+                Compiled::Symbol symbol;
+                std::uint8_t kind = 0;
+                if (!in.pod(kind) || kind > static_cast<std::uint8_t>(Compiled::Symbol::Kind::AsyncConstant) ||
+                    !in.pod(symbol.directive) || !in.str(symbol.name) || !in.str(symbol.key)) {
+                    return nullptr;
+                }
+                symbol.kind = static_cast<Compiled::Symbol::Kind>(kind);
+                symbol.operand = compiled->operands.size();
+                void *ptr = resolve_symbol(symbol, defs, *compiled, library);
+                if (!ptr) {
+                    return nullptr;
+                }
+                compiled->operands.push_back(ptr);
+                compiled->symbols.push_back(std::move(symbol));
+                break;
+            }
+            default:
+                return nullptr;
+        }
+    }
+    if (!in.done() || !compiled->materialize_constants()) {
+        return nullptr;
+    }
+    return compiled;
+}
+
+} // namespace fiber::script::ir
@@ -0,0 +1,40 @@
+#ifndef FIBER_SCRIPT_IR_BYTECODE_H
+#define FIBER_SCRIPT_IR_BYTECODE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "Compiled.h"
+
+namespace fiber::script {
+class Library;
+}
+
+namespace fiber::script::ir {
+
+// Identity of a serialized script. Both halves must match for a blob to load.
+// source_digest is ScriptCache::digest_source(): SHA-256 over the source and
+// its compile flags, so a different script never maps onto the same image.
+struct BytecodeKey {
+    std::array<std::uint8_t, 32> source_digest{};
+    std::uint64_t library_version = 0;
+
+    bool operator==(const BytecodeKey &) const = default;
+};
+
+// Writes a relocatable image of compiled: no pointers are stored, library
+// operands are recorded by name and re-resolved by read_bytecode().
+std::string write_bytecode(const Compiled &compiled, const BytecodeKey &key);
+
+// Rebuilds a Compiled from data. Returns nullptr when the blob is malformed,
+// was written for a different key, or references a symbol library lacks.
+std::shared_ptr<Compiled> read_bytecode(std::span<const std::uint8_t> data,
+                                        Library &library,
+                                        const BytecodeKey &key);
+
+} // namespace fiber::script::ir
+
+#endif // FIBER_SCRIPT_IR_BYTECODE_H
@@ -43,6 +43,8 @@ struct Code {
     static constexpr std::uint8_t BOP_NE = 37;
     static constexpr std::uint8_t BOP_SNE = 38;
     static constexpr std::uint8_t BOP_IN = 39;
+    // BOP_MATCH against a pattern precompiled into the operand table.
+    static constexpr std::uint8_t BOP_MATCH_CONST = 40;
 
     static constexpr std::uint8_t UNARY_PLUS = 43;
     static constexpr std::uint8_t UNARY_MINUS = 44;
@@ -0,0 +1,69 @@
+#include "Compiled.h"
+
+namespace fiber::script::ir {
+
+bool Compiled::materialize_constants() {
+    if (!static_region) {
+        std::size_t capacity = 0;
+        for (const auto &cv : const_pool) {
+            if (!cv) {
+                continue;
+            }
+            if (cv->kind == ConstValue::Kind::String) {
+                capacity += fiber::json::gc_static_string_size(cv->text.size());
+            } else if (cv->kind == ConstValue::Kind::Binary) {
+                capacity += fiber::json::gc_static_binary_size(cv->bytes.size());
+            }
+        }
+        static_region = std::make_shared<fiber::json::GcStaticRegion>(capacity);
+    }
+    bool ok = true;
+    for (auto &cv : const_pool) {
+        if (!cv || cv->materialized) {
+            continue;
+        }
+        switch (cv->kind) {
+            case ConstValue::Kind::Undefined:
+                cv->value = fiber::json::JsValue::make_undefined();
+                break;
+            case ConstValue::Kind::Null:
+                cv->value = fiber::json::JsValue::make_null();
+                break;
+            case ConstValue::Kind::Boolean:
+                cv->value = fiber::json::JsValue::make_boolean(cv->bool_value);
+                break;
+            case ConstValue::Kind::Integer:
+                cv->value = fiber::json::JsValue::make_integer(cv->int_value);
+                break;
+            case ConstValue::Kind::Float:
+                cv->value = fiber::json::JsValue::make_float(cv->float_value);
+                break;
+            case ConstValue::Kind::String: {
+                fiber::json::GcString *str =
+                    fiber::json::gc_new_static_string(static_region.get(), cv->text.data(), cv->text.size());
+                if (!str) {
+                    ok = false;
+                    continue;
+                }
+                cv->value.type_ = fiber::json::JsNodeType::HeapString;
+                cv->value.gc = &str->hdr;
+                break;
+            }
+            case ConstValue::Kind::Binary: {
+                fiber::json::GcBinary *bin =
+                    fiber::json::gc_new_static_binary(static_region.get(), cv->bytes.data(), cv->bytes.size());
+                if (!bin) {
+                    ok = false;
+                    continue;
+                }
+                cv->value.type_ = fiber::json::JsNodeType::HeapBinary;
+                cv->value.gc = &bin->hdr;
+                break;
+            }
+        }
+        cv->materialized = true;
+    }
+    return ok;
+}
+
+} // namespace fiber::script::ir
@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "../../common/Regex.h"
+#include "../../common/json/JsGc.h"
 #include "Code.h"
 
 namespace fiber::script::ir {
@@ -28,6 +30,34 @@ struct Compiled {
         double float_value = 0.0;
         std::string text;
         std::vector<std::uint8_t> bytes;
+        // Filled by materialize_constants(); heap kinds point into static_region.
+        fiber::json::JsValue value;
+        bool materialized = false;
+    };
+
+    // Symbolic identity of a library-provided operand, so a serialized script
+    // can be relinked against a live Library instead of carrying raw pointers.
+    struct Symbol {
+        enum class Kind : std::uint8_t {
+            Function,
+            AsyncFunction,
+            Constant,
+            AsyncConstant,
+        };
+
+        Kind kind = Kind::Function;
+        std::size_t operand = 0;
+        // Function: full dotted name, or the method name when directive >= 0.
+        // Constant: namespace and key.
+        std::string name;
+        std::string key;
+        std::int32_t directive = -1;
+    };
+
+    struct Directive {
+        std::string type;
+        std::string name;
+        std::vector<ConstValue> literals;
     };
 
     std::size_t stack_size = 0;
@@ -37,7 +67,13 @@ struct Compiled {
     std::vector<void *> operands;
     std::vector<std::unique_ptr<ConstValue>> const_pool;
     std::vector<std::unique_ptr<std::string>> string_pool;
+    std::vector<std::unique_ptr<fiber::common::Regex>> regex_pool;
     std::vector<std::int32_t> exception_table;
+    std::vector<Symbol> symbols;
+    std::vector<Directive> directives;
+    std::shared_ptr<fiber::json::GcStaticRegion> static_region;
+
+    bool materialize_constants();
 
     bool contains_async() const {
         for (std::int32_t code : codes) {
@@ -58,6 +58,7 @@ public:
         pop_scope();
         compiled_.stack_size = max_stack_ > 0 ? static_cast<std::size_t>(max_stack_) : 1;
         compiled_.var_table_size = next_var_index_;
+        compiled_.materialize_constants();
         return std::move(compiled_);
     }
 
@@ -82,6 +83,8 @@ private:
     std::vector<LoopContext> loops_;
     std::unordered_map<void *, std::size_t> operand_cache_;
     std::unordered_map<std::string, std::size_t> string_operands_;
+    std::unordered_map<std::string, std::size_t> regex_operands_;
+    std::unordered_map<const ast::DirectiveStatement *, std::int32_t> directive_index_;
     std::optional<std::size_t> undef_const_;
     std::optional<std::size_t> null_const_;
     std::optional<std::size_t> true_const_;
@@ -176,6 +179,85 @@ private:
         return index;
     }
 
+    std::size_t add_symbol_operand(void *ptr, Compiled::Symbol symbol) {
+        std::size_t before = compiled_.operands.size();
+        std::size_t index = add_operand(ptr);
+        if (index == before) {
+            symbol.operand = index;
+            compiled_.symbols.push_back(std::move(symbol));
+        }
+        return index;
+    }
+
+    std::int32_t add_directive(const ast::DirectiveStatement &directive) {
+        auto it = directive_index_.find(&directive);
+        if (it != directive_index_.end()) {
+            return it->second;
+        }
+        Compiled::Directive entry;
+        entry.type = directive.type()->name();
+        entry.name = directive.name()->name();
+        for (const auto &literal : directive.literals()) {
+            Compiled::ConstValue cv;
+            switch (literal.kind()) {
+                case ast::Literal::Kind::NullValue:
+                    cv.kind = Compiled::ConstValue::Kind::Null;
+                    break;
+                case ast::Literal::Kind::Boolean:
+                    cv.kind = Compiled::ConstValue::Kind::Boolean;
+                    cv.bool_value = literal.bool_value();
+                    break;
+                case ast::Literal::Kind::Integer:
+                    cv.kind = Compiled::ConstValue::Kind::Integer;
+                    cv.int_value = literal.int_value();
+                    break;
+                case ast::Literal::Kind::Float:
+                    cv.kind = Compiled::ConstValue::Kind::Float;
+                    cv.float_value = literal.float_value();
+                    break;
+                case ast::Literal::Kind::String:
+                    cv.kind = Compiled::ConstValue::Kind::String;
+                    cv.text = literal.string_value();
+                    break;
+            }
+            entry.literals.push_back(std::move(cv));
+        }
+        compiled_.directives.push_back(std::move(entry));
+        auto index = static_cast<std::int32_t>(compiled_.directives.size() - 1);
+        directive_index_.emplace(&directive, index);
+        return index;
+    }
+
+    std::size_t add_function_operand(const ast::FunctionCall &call) {
+        Compiled::Symbol symbol;
+        symbol.kind = call.is_async() ? Compiled::Symbol::Kind::AsyncFunction : Compiled::Symbol::Kind::Function;
+        if (call.directive()) {
+            symbol.directive = add_directive(*call.directive());
+            auto dot = call.name().rfind('.');
+            symbol.name = dot == std::string::npos ? call.name() : call.name().substr(dot + 1);
+        } else {
+            symbol.name = call.name();
+        }
+        void *func_ptr = call.is_async()
+            ? reinterpret_cast<void *>(call.async_func())
+            : reinterpret_cast<void *>(call.func());
+        return add_symbol_operand(func_ptr, std::move(symbol));
+    }
+
+    std::size_t add_constant_operand(const ast::ConstantVal &constant) {
+        Compiled::Symbol symbol;
+        symbol.kind = constant.is_async() ? Compiled::Symbol::Kind::AsyncConstant : Compiled::Symbol::Kind::Constant;
+        auto dot = constant.name().find('.');
+        symbol.name = constant.name().substr(0, dot);
+        if (dot != std::string::npos) {
+            symbol.key = constant.name().substr(dot + 1);
+        }
+        void *ptr = constant.is_async()
+            ? reinterpret_cast<void *>(constant.async_constant())
+            : reinterpret_cast<void *>(constant.constant());
+        return add_symbol_operand(ptr, std::move(symbol));
+    }
+
     std::size_t add_string_operand(const std::string &value) {
         auto it = string_operands_.find(value);
         if (it != string_operands_.end()) {
@@ -190,6 +272,24 @@ private:
         return index;
     }
 
+    // Invalid patterns are left to BOP_MATCH so the error surfaces at run time.
+    std::optional<std::size_t> add_regex_operand(const std::string &pattern) {
+        auto it = regex_operands_.find(pattern);
+        if (it != regex_operands_.end()) {
+            return it->second;
+        }
+        auto compiled = fiber::common::Regex::compile(pattern);
+        if (!compiled) {
+            return std::nullopt;
+        }
+        auto stored = std::make_unique<fiber::common::Regex>(std::move(*compiled));
+        compiled_.operands.push_back(stored.get());
+        compiled_.regex_pool.push_back(std::move(stored));
+        std::size_t index = compiled_.operands.size() - 1;
+        regex_operands_.emplace(pattern, index);
+        return index;
+    }
+
     std::size_t add_const_value(Compiled::ConstValue value) {
         auto stored = std::make_unique<Compiled::ConstValue>(std::move(value));
         auto *ptr = stored.get();
@@ -461,13 +561,8 @@ private:
             return;
         }
         if (auto *constant = dynamic_cast<const ast::ConstantVal *>(&expr)) {
-            if (constant->is_async()) {
-                std::size_t idx = add_operand(reinterpret_cast<void *>(constant->async_constant()));
-                emit_op(Code::CALL_ASYNC_CONST, idx, expr.start_pos(), 1);
-            } else {
-                std::size_t idx = add_operand(reinterpret_cast<void *>(constant->constant()));
-                emit_op(Code::CALL_CONST, idx, expr.start_pos(), 1);
-            }
+            std::size_t idx = add_constant_operand(*constant);
+            emit_op(constant->is_async() ? Code::CALL_ASYNC_CONST : Code::CALL_CONST, idx, expr.start_pos(), 1);
             return;
         }
         if (auto *call = dynamic_cast<const ast::FunctionCall *>(&expr)) {
@@ -484,10 +579,7 @@ private:
                         compile_expression(*arg);
                     }
                 }
-                void *func_ptr = call->is_async()
-                    ? reinterpret_cast<void *>(call->async_func())
-                    : reinterpret_cast<void *>(call->func());
-                std::size_t idx = add_operand(func_ptr);
+                std::size_t idx = add_function_operand(*call);
                 std::size_t arg_count = call->args().size();
                 std::int32_t code = static_cast<std::int32_t>(call->is_async() ? Code::CALL_ASYNC_FUNC : Code::CALL_FUNC) |
                                     (static_cast<std::int32_t>(arg_count & 0xFF) << 8) |
@@ -511,10 +603,7 @@ private:
                     emit_raw(static_cast<std::int32_t>(Code::PUSH_ARRAY), expr.start_pos(), -1);
                 }
             }
-            void *func_ptr = call->is_async()
-                ? reinterpret_cast<void *>(call->async_func())
-                : reinterpret_cast<void *>(call->func());
-            std::size_t idx = add_operand(func_ptr);
+            std::size_t idx = add_function_operand(*call);
             emit_op(call->is_async() ? Code::CALL_ASYNC_FUNC_SPREAD : Code::CALL_FUNC_SPREAD, idx, expr.start_pos(), 0);
             return;
         }
@@ -590,6 +679,16 @@ private:
             return;
         }
         if (auto *binary = dynamic_cast<const ast::BinaryOperator *>(&expr)) {
+            if (binary->op() == ast::Operator::Match) {
+                auto *pattern = dynamic_cast<const ast::Literal *>(binary->right());
+                if (pattern && pattern->kind() == ast::Literal::Kind::String) {
+                    if (auto idx = add_regex_operand(pattern->string_value())) {
+                        compile_expression(*binary->left());
+                        emit_op(Code::BOP_MATCH_CONST, *idx, expr.start_pos(), 0);
+                        return;
+                    }
+                }
+            }
             compile_expression(*binary->left());
             compile_expression(*binary->right());
             std::uint8_t op = Code::BOP_PLUS;
@@ -49,7 +49,6 @@ std::expected<std::unique_ptr<ast::Block>, ParseError> Parser::parse_script(std:
     tokens_ = tokenizer.tokens();
     pos_ = 0;
     directive_map_.clear();
-    directive_statements_.clear();
 
     if (!has_more()) {
         return std::unexpected(make_error("unexpected end of input", nullptr));
@@ -73,7 +72,6 @@ std::expected<std::unique_ptr<ast::Expression>, ParseError> Parser::parse_expres
     tokens_ = tokenizer.tokens();
     pos_ = 0;
     directive_map_.clear();
-    directive_statements_.clear();
 
     if (!has_more()) {
         return std::unexpected(make_error("empty expression", nullptr));
@@ -455,6 +453,7 @@ std::expected<std::unique_ptr<ast::Statement>, ParseError> Parser::parse_directi
                                                           end,
                                                           std::make_unique<ast::Identifier>(std::move(type_result.value())),
                                                           std::make_unique<ast::Identifier>(std::move(name_result.value())),
+                                                          std::move(literals),
                                                           def);
     return stmt;
 }
@@ -494,9 +493,8 @@ std::expected<std::unique_ptr<ast::Block>, ParseError> Parser::parse_block(bool
         auto stmt = std::move(stmt_result.value());
         if (auto *directive = dynamic_cast<ast::DirectiveStatement *>(stmt.get())) {
             auto directive_ptr =
-                std::unique_ptr<ast::DirectiveStatement>(static_cast<ast::DirectiveStatement *>(stmt.release()));
-            directive_map_[directive_ptr->name()->name()] = directive_ptr.get();
-            directive_statements_.push_back(std::move(directive_ptr));
+                std::shared_ptr<ast::DirectiveStatement>(static_cast<ast::DirectiveStatement *>(stmt.release()));
+            directive_map_[directive_ptr->name()->name()] = std::move(directive_ptr);
             continue;
         }
         if (!has_statement) {
@@ -1153,6 +1151,7 @@ std::expected<std::unique_ptr<ast::Expression>, ParseError> Parser::parse_functi
             }
             Library::Function *func = library_.find_func(name);
             Library::AsyncFunction *async_func = library_.find_async_func(name);
+            std::shared_ptr<const ast::DirectiveStatement> directive;
             if (!func && !async_func && dot_size == 1) {
                 auto it = directive_map_.find(prefix.name());
                 if (it != directive_map_.end()) {
@@ -1160,6 +1159,7 @@ std::expected<std::unique_ptr<ast::Expression>, ParseError> Parser::parse_functi
                     if (def) {
                         func = def->find_func(prefix.name(), token.text);
                         async_func = def->find_async_func(prefix.name(), token.text);
+                        directive = it->second;
                     }
                 }
             }
@@ -1176,7 +1176,8 @@ std::expected<std::unique_ptr<ast::Expression>, ParseError> Parser::parse_functi
                                                        name,
                                                        func,
                                                        async_func,
-                                                       std::move(args_result.value()));
+                                                       std::move(args_result.value()),
+                                                       std::move(directive));
         }
     }
     pos_ = saved;
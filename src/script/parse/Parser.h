@@ -109,8 +109,7 @@ private:
     bool allow_assign_ = true;
     std::vector<Token> tokens_;
     std::size_t pos_ = 0;
-    std::unordered_map<std::string, ast::DirectiveStatement *> directive_map_;
-    std::vector<std::unique_ptr<ast::DirectiveStatement>> directive_statements_;
+    std::unordered_map<std::string, std::shared_ptr<ast::DirectiveStatement>> directive_map_;
 };
 
 } // namespace fiber::script::parse
@@ -1,5 +1,6 @@
 #include "Access.h"
 
+#include "../../common/json/JsonDecode.h"
 #include "../../common/json/Utf.h"
 #include "../Runtime.h"
 
@@ -28,6 +29,10 @@ VmError index_error(std::string message) {
     return make_error("EXEC_INDEX_ERROR", std::move(message));
 }
 
+VmError frozen_error() {
+    return make_error("EXEC_FROZEN", "cannot modify a frozen value");
+}
+
 bool get_index(const fiber::json::JsValue &key, std::int64_t &out) {
     if (key.type_ == fiber::json::JsNodeType::Integer) {
         out = key.i;
@@ -49,7 +54,7 @@ fiber::json::GcString *ensure_heap_string(fiber::json::GcHeap *heap,
         error = heap_required_error();
         return nullptr;
     }
-    fiber::json::GcString *str = fiber::json::gc_new_string(heap, value.ns.data, value.ns.len);
+    fiber::json::GcString *str = fiber::json::gc_atom(heap, value.ns().data, value.ns().len);
     if (!str) {
         error = oom_error();
         return nullptr;
@@ -75,7 +80,7 @@ bool string_length(const fiber::json::JsValue &value, std::size_t &out, VmError
     }
     if (value.type_ == fiber::json::JsNodeType::NativeString) {
         fiber::json::Utf8ScanResult scan;
-        if (!fiber::json::utf8_scan(value.ns.data, value.ns.len, scan)) {
+        if (!fiber::json::utf8_scan(value.ns().data, value.ns().len, scan)) {
             error = make_error("EXEC_INVALID_UTF8", "invalid utf-8");
             return false;
         }
@@ -99,7 +104,7 @@ VmResult string_char_at(fiber::json::GcHeap *heap,
     if (value.type_ == fiber::json::JsNodeType::HeapString) {
         str = reinterpret_cast<fiber::json::GcString *>(value.gc);
     } else if (value.type_ == fiber::json::JsNodeType::NativeString) {
-        str = fiber::json::gc_new_string(heap, value.ns.data, value.ns.len);
+        str = fiber::json::gc_new_string(heap, value.ns().data, value.ns().len);
     }
     if (!str) {
         return std::unexpected(oom_error());
@@ -124,11 +129,45 @@ VmResult string_char_at(fiber::json::GcHeap *heap,
     return make_heap_string_value(out);
 }
 
+fiber::json::GcLazyJson *as_lazy(const fiber::json::JsValue &value) {
+    return reinterpret_cast<fiber::json::GcLazyJson *>(value.gc);
+}
+
+VmResult lazy_result(bool ok, fiber::json::JsValue &value) {
+    if (!ok) {
+        return std::unexpected(oom_error());
+    }
+    return std::move(value);
+}
+
 } // namespace
 
+VmResult Access::resolve(const fiber::json::JsValue &value, ScriptRuntime &runtime) {
+    if (value.type_ != fiber::json::JsNodeType::LazyJson) {
+        return value;
+    }
+    const fiber::json::JsValue *forced = fiber::json::lazy_json_force(runtime.heap(), as_lazy(value));
+    if (!forced) {
+        return std::unexpected(oom_error());
+    }
+    return *forced;
+}
+
 VmResult Access::expand_object(const fiber::json::JsValue &target,
                                const fiber::json::JsValue &addition,
                                ScriptRuntime &runtime) {
+    if (target.type_ == fiber::json::JsNodeType::LazyJson || addition.type_ == fiber::json::JsNodeType::LazyJson) {
+        VmResult resolved_target = resolve(target, runtime);
+        VmResult resolved_addition = resolve(addition, runtime);
+        if (!resolved_target || !resolved_addition) {
+            return std::unexpected(oom_error());
+        }
+        VmResult result = expand_object(*resolved_target, *resolved_addition, runtime);
+        if (!result) {
+            return result;
+        }
+        return target;
+    }
     if (target.type_ != fiber::json::JsNodeType::Object ||
         addition.type_ != fiber::json::JsNodeType::Object) {
         return target;
@@ -140,9 +179,9 @@ VmResult Access::expand_object(const fiber::json::JsValue &target,
     if (!target_obj || !add_obj) {
         return target;
     }
-    for (std::size_t i = 0; i < add_obj->size; ++i) {
-        const fiber::json::GcObjectEntry *entry = fiber::json::gc_object_entry_at(add_obj, i);
-        if (!entry || !entry->occupied || !entry->key) {
+    for (std::size_t i = 0; i < add_obj->entry_count; ++i) {
+        const fiber::json::GcObjectEntry *entry = &add_obj->entries[i];
+        if (!entry->key) {
             continue;
         }
         if (!fiber::json::gc_object_set(heap, target_obj, entry->key, entry->value)) {
@@ -155,6 +194,18 @@ VmResult Access::expand_object(const fiber::json::JsValue &target,
 VmResult Access::expand_array(const fiber::json::JsValue &target,
                               const fiber::json::JsValue &addition,
                               ScriptRuntime &runtime) {
+    if (target.type_ == fiber::json::JsNodeType::LazyJson || addition.type_ == fiber::json::JsNodeType::LazyJson) {
+        VmResult resolved_target = resolve(target, runtime);
+        VmResult resolved_addition = resolve(addition, runtime);
+        if (!resolved_target || !resolved_addition) {
+            return std::unexpected(oom_error());
+        }
+        VmResult result = expand_array(*resolved_target, *resolved_addition, runtime);
+        if (!result) {
+            return result;
+        }
+        return target;
+    }
     if (target.type_ != fiber::json::JsNodeType::Array) {
         return target;
     }
@@ -174,8 +225,7 @@ VmResult Access::expand_array(const fiber::json::JsValue &target,
             return target;
         }
         for (std::size_t i = 0; i < add_arr->size; ++i) {
-            const fiber::json::JsValue *item = fiber::json::gc_array_get(add_arr, i);
-            if (!fiber::json::gc_array_push(heap, target_arr, item ? *item : fiber::json::JsValue::make_undefined())) {
+            if (!fiber::json::gc_array_push(heap, target_arr, fiber::json::gc_array_at(add_arr, i))) {
                 return std::unexpected(oom_error());
             }
         }
@@ -185,9 +235,9 @@ VmResult Access::expand_array(const fiber::json::JsValue &target,
     if (!add_obj) {
         return target;
     }
-    for (std::size_t i = 0; i < add_obj->size; ++i) {
-        const fiber::json::GcObjectEntry *entry = fiber::json::gc_object_entry_at(add_obj, i);
-        if (!entry || !entry->occupied) {
+    for (std::size_t i = 0; i < add_obj->entry_count; ++i) {
+        const fiber::json::GcObjectEntry *entry = &add_obj->entries[i];
+        if (!entry->key) {
             continue;
         }
         if (!fiber::json::gc_array_push(heap, target_arr, entry->value)) {
@@ -200,6 +250,17 @@ VmResult Access::expand_array(const fiber::json::JsValue &target,
 VmResult Access::push_array(const fiber::json::JsValue &target,
                             const fiber::json::JsValue &addition,
                             ScriptRuntime &runtime) {
+    if (target.type_ == fiber::json::JsNodeType::LazyJson) {
+        VmResult resolved = resolve(target, runtime);
+        if (!resolved) {
+            return resolved;
+        }
+        VmResult result = push_array(*resolved, addition, runtime);
+        if (!result) {
+            return result;
+        }
+        return target;
+    }
     if (target.type_ != fiber::json::JsNodeType::Array) {
         return target;
     }
@@ -209,6 +270,9 @@ VmResult Access::push_array(const fiber::json::JsValue &target,
     if (!arr) {
         return target;
     }
+    if (fiber::json::gc_is_static(&arr->hdr)) {
+        return std::unexpected(frozen_error());
+    }
     if (!fiber::json::gc_array_push(heap, arr, addition)) {
         return std::unexpected(oom_error());
     }
@@ -218,6 +282,28 @@ VmResult Access::push_array(const fiber::json::JsValue &target,
 VmResult Access::index_get(const fiber::json::JsValue &parent,
                            const fiber::json::JsValue &key,
                            ScriptRuntime &runtime) {
+    if (parent.type_ == fiber::json::JsNodeType::LazyJson) {
+        runtime.maybe_collect();
+        fiber::json::GcHeap *heap = &runtime.heap();
+        fiber::json::JsValue found;
+        std::int64_t idx = 0;
+        if (get_index(key, idx)) {
+            if (idx < 0) {
+                return found;
+            }
+            bool ok = fiber::json::lazy_json_at(*heap, as_lazy(parent), static_cast<std::size_t>(idx), found);
+            return lazy_result(ok, found);
+        }
+        VmError error;
+        fiber::json::GcString *key_str = ensure_heap_string(heap, key, error);
+        if (!key_str && error.name.size()) {
+            return std::unexpected(error);
+        }
+        if (!key_str) {
+            return found;
+        }
+        return lazy_result(fiber::json::lazy_json_get(*heap, as_lazy(parent), key_str, found), found);
+    }
     if (parent.type_ == fiber::json::JsNodeType::Array) {
         std::int64_t idx = 0;
         if (!get_index(key, idx)) {
@@ -227,8 +313,10 @@ VmResult Access::index_get(const fiber::json::JsValue &parent,
             return fiber::json::JsValue::make_undefined();
         }
         auto *arr = reinterpret_cast<const fiber::json::GcArray *>(parent.gc);
-        const fiber::json::JsValue *found = arr ? fiber::json::gc_array_get(arr, static_cast<std::size_t>(idx)) : nullptr;
-        return found ? *found : fiber::json::JsValue::make_undefined();
+        if (!arr || static_cast<std::size_t>(idx) >= arr->size) {
+            return fiber::json::JsValue::make_undefined();
+        }
+        return fiber::json::gc_array_at(arr, static_cast<std::size_t>(idx));
     }
     if (parent.type_ == fiber::json::JsNodeType::Object) {
         runtime.maybe_collect();
@@ -262,6 +350,13 @@ VmResult Access::index_set(const fiber::json::JsValue &parent,
                            const fiber::json::JsValue &key,
                            const fiber::json::JsValue &value,
                            ScriptRuntime &runtime) {
+    if (parent.type_ == fiber::json::JsNodeType::LazyJson) {
+        VmResult resolved = resolve(parent, runtime);
+        if (!resolved) {
+            return resolved;
+        }
+        return index_set(*resolved, key, value, runtime);
+    }
     if (parent.type_ == fiber::json::JsNodeType::Array) {
         std::int64_t idx = 0;
         if (!get_index(key, idx)) {
@@ -271,6 +366,9 @@ VmResult Access::index_set(const fiber::json::JsValue &parent,
         if (!arr || idx < 0 || idx >= static_cast<std::int64_t>(arr->size)) {
             return std::unexpected(index_error("array index out of bounds"));
         }
+        if (fiber::json::gc_is_static(&arr->hdr)) {
+            return std::unexpected(frozen_error());
+        }
         runtime.maybe_collect();
         fiber::json::GcHeap *heap = &runtime.heap();
         if (!fiber::json::gc_array_set(heap, arr, static_cast<std::size_t>(idx), value)) {
@@ -290,6 +388,9 @@ VmResult Access::index_set(const fiber::json::JsValue &parent,
             return std::unexpected(index_error("object key must be string"));
         }
         auto *obj = reinterpret_cast<fiber::json::GcObject *>(parent.gc);
+        if (fiber::json::gc_is_static(parent.gc)) {
+            return std::unexpected(frozen_error());
+        }
         if (!fiber::json::gc_object_set(heap, obj, key_str, value)) {
             return std::unexpected(oom_error());
         }
@@ -312,6 +413,25 @@ VmResult Access::index_set1(const fiber::json::JsValue &parent,
 VmResult Access::prop_get(const fiber::json::JsValue &parent,
                           const fiber::json::JsValue &key,
                           ScriptRuntime &runtime) {
+    if (parent.type_ == fiber::json::JsNodeType::LazyJson) {
+        fiber::json::GcLazyJson *lazy = as_lazy(parent);
+        if (fiber::json::lazy_json_is_array(lazy)) {
+            std::size_t size = fiber::json::lazy_json_size(runtime.heap(), lazy);
+            return fiber::json::JsValue::make_integer(static_cast<std::int64_t>(size));
+        }
+        runtime.maybe_collect();
+        fiber::json::GcHeap *heap = &runtime.heap();
+        VmError error;
+        fiber::json::GcString *key_str = ensure_heap_string(heap, key, error);
+        if (!key_str && error.name.size()) {
+            return std::unexpected(error);
+        }
+        fiber::json::JsValue found;
+        if (!key_str) {
+            return found;
+        }
+        return lazy_result(fiber::json::lazy_json_get(*heap, lazy, key_str, found), found);
+    }
     if (parent.type_ == fiber::json::JsNodeType::Object) {
         runtime.maybe_collect();
         fiber::json::GcHeap *heap = &runtime.heap();
@@ -348,6 +468,13 @@ VmResult Access::prop_set(const fiber::json::JsValue &parent,
                           const fiber::json::JsValue &value,
                           const fiber::json::JsValue &key,
                           ScriptRuntime &runtime) {
+    if (parent.type_ == fiber::json::JsNodeType::LazyJson) {
+        VmResult resolved = resolve(parent, runtime);
+        if (!resolved) {
+            return resolved;
+        }
+        return prop_set(*resolved, value, key, runtime);
+    }
     if (parent.type_ != fiber::json::JsNodeType::Object) {
         return std::unexpected(index_error("property set not supported"));
     }
@@ -362,6 +489,9 @@ VmResult Access::prop_set(const fiber::json::JsValue &parent,
         return std::unexpected(index_error("property key must be string"));
     }
     auto *obj = reinterpret_cast<fiber::json::GcObject *>(parent.gc);
+    if (fiber::json::gc_is_static(parent.gc)) {
+        return std::unexpected(frozen_error());
+    }
     if (!fiber::json::gc_object_set(heap, obj, key_str, value)) {
         return std::unexpected(oom_error());
     }
@@ -12,6 +12,11 @@ namespace fiber::script::run {
 
 class Access {
 public:
+    // What operations that need a real container should work on: the
+    // materialized GcObject/GcArray of a LazyJson value, forcing it if
+    // needed, and any other value as is.
+    static VmResult resolve(const fiber::json::JsValue &value, ScriptRuntime &runtime);
+
     static VmResult expand_object(const fiber::json::JsValue &target,
                                   const fiber::json::JsValue &addition,
                                   ScriptRuntime &runtime);
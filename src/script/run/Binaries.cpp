@@ -5,6 +5,7 @@
 
 #include "../../common/json/JsValueOps.h"
 #include "../Runtime.h"
+#include "Access.h"
 #include "Compares.h"
 
 namespace fiber::script::run {
@@ -53,7 +54,7 @@ VmResult from_js_result(const fiber::json::JsOpResult &result, std::string_view
 
 bool value_to_string(const fiber::json::JsValue &value, std::string &out) {
     if (value.type_ == fiber::json::JsNodeType::NativeString) {
-        out.assign(value.ns.data, value.ns.len);
+        out.assign(value.ns().data, value.ns().len);
         return true;
     }
     if (value.type_ == fiber::json::JsNodeType::HeapString) {
@@ -108,10 +109,33 @@ VmResult Binaries::matches(const fiber::json::JsValue &a,
                            const fiber::json::JsValue &b,
                            ScriptRuntime &runtime) {
     runtime.maybe_collect();
-    (void)a;
-    (void)b;
+    std::string pattern;
+    if (!value_to_string(b, pattern)) {
+        return make_bool(false);
+    }
+    auto regex = fiber::common::regex_cached(pattern);
+    if (!regex) {
+        VmError error;
+        error.status = 500;
+        error.name = "EXEC_INVALID_REGEX";
+        error.message = "invalid regex in operator ~";
+        return std::unexpected(std::move(error));
+    }
+    return matches(a, *regex, runtime);
+}
+
+VmResult Binaries::matches(const fiber::json::JsValue &a,
+                           const fiber::common::Regex &regex,
+                           ScriptRuntime &runtime) {
     (void)runtime;
-    return make_bool(false);
+    if (a.type_ == fiber::json::JsNodeType::NativeString) {
+        return make_bool(regex.full_match(std::string_view(a.ns().data, a.ns().len)));
+    }
+    std::string text;
+    if (!value_to_string(a, text)) {
+        return make_bool(false);
+    }
+    return make_bool(regex.full_match(text));
 }
 
 VmResult Binaries::lt(const fiber::json::JsValue &a,
@@ -174,6 +198,19 @@ VmResult Binaries::in(const fiber::json::JsValue &a,
                       const fiber::json::JsValue &b,
                       ScriptRuntime &runtime) {
     runtime.maybe_collect();
+    if (b.type_ == fiber::json::JsNodeType::LazyJson) {
+        auto *lazy = reinterpret_cast<const fiber::json::GcLazyJson *>(b.gc);
+        if (lazy->forced.type_ == fiber::json::JsNodeType::Undefined) {
+            // JSON has no undefined members, so a lookup answers without
+            // materializing the container.
+            VmResult found = Access::index_get(b, a, runtime);
+            if (!found) {
+                return found;
+            }
+            return fiber::json::JsValue::make_boolean(found->type_ != fiber::json::JsNodeType::Undefined);
+        }
+        return Compares::in(a, lazy->forced);
+    }
     return Compares::in(a, b);
 }
 
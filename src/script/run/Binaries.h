@@ -1,6 +1,7 @@
 #ifndef FIBER_SCRIPT_RUN_BINARIES_H
 #define FIBER_SCRIPT_RUN_BINARIES_H
 
+#include "../../common/Regex.h"
 #include "../../common/json/JsGc.h"
 #include "VmError.h"
 
@@ -19,6 +20,7 @@ public:
     static VmResult modulo(const fiber::json::JsValue &a, const fiber::json::JsValue &b, ScriptRuntime &runtime);
 
     static VmResult matches(const fiber::json::JsValue &a, const fiber::json::JsValue &b, ScriptRuntime &runtime);
+    static VmResult matches(const fiber::json::JsValue &a, const fiber::common::Regex &regex, ScriptRuntime &runtime);
     static VmResult lt(const fiber::json::JsValue &a, const fiber::json::JsValue &b, ScriptRuntime &runtime);
     static VmResult lte(const fiber::json::JsValue &a, const fiber::json::JsValue &b, ScriptRuntime &runtime);
     static VmResult gt(const fiber::json::JsValue &a, const fiber::json::JsValue &b, ScriptRuntime &runtime);
@@ -127,10 +127,10 @@ VmResult Compares::in(const fiber::json::JsValue &a, const fiber::json::JsValue
             return make_bool(found != nullptr);
         }
         if (a.type_ == fiber::json::JsNodeType::NativeString) {
-            std::string key(a.ns.data, a.ns.len);
-            for (std::size_t i = 0; i < obj->size; ++i) {
-                const fiber::json::GcObjectEntry *entry = fiber::json::gc_object_entry_at(obj, i);
-                if (!entry || !entry->occupied || !entry->key) {
+            std::string key(a.ns().data, a.ns().len);
+            for (std::size_t i = 0; i < obj->entry_count; ++i) {
+                const fiber::json::GcObjectEntry *entry = &obj->entries[i];
+                if (!entry->key) {
                     continue;
                 }
                 std::string entry_key;
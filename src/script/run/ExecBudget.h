@@ -0,0 +1,28 @@
+#ifndef FIBER_SCRIPT_RUN_EXEC_BUDGET_H
+#define FIBER_SCRIPT_RUN_EXEC_BUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fiber::script::run {
+
+// Per-execution limits. Instructions are charged at loop back-edges (the
+// length of the loop body) and at library calls, so straight-line code is
+// never interrupted and the hot path only pays when a budget is set. A zero
+// field disables that limit.
+struct ExecBudget {
+    // Instructions run before an awaited script yields back to its loop.
+    std::uint64_t slice_instructions = 0;
+    // Instructions after which the run fails with EXEC_BUDGET_EXCEEDED.
+    std::uint64_t max_instructions = 0;
+    // Heap bytes the run may allocate before failing with EXEC_BUDGET_EXCEEDED.
+    std::size_t max_alloc_bytes = 0;
+
+    bool enabled() const {
+        return slice_instructions != 0 || max_instructions != 0 || max_alloc_bytes != 0;
+    }
+};
+
+} // namespace fiber::script::run
+
+#endif // FIBER_SCRIPT_RUN_EXEC_BUDGET_H
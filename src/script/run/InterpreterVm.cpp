@@ -11,7 +11,9 @@
 #include "Binaries.h"
 #include "Compares.h"
 #include "../../common/json/JsGc.h"
+#include "../../common/json/JsonDecode.h"
 #include "Unaries.h"
+#include "VmProfiler.h"
 #include "../Runtime.h"
 
 namespace fiber::script::run {
@@ -38,6 +40,70 @@ VmError make_throw_error() {
     return error;
 }
 
+template <bool Enabled>
+class ProfileCursor {
+public:
+    explicit ProfileCursor(ScriptProfile *profile) {
+        (void)profile;
+    }
+
+    void step(std::size_t pc) {
+        (void)pc;
+    }
+
+    std::uint64_t begin_call() {
+        return 0;
+    }
+
+    void end_call(std::uint64_t start) {
+        (void)start;
+    }
+};
+
+// Charges the cycles between two steps to the earlier pc; the last sample is
+// flushed on every exit from the loop.
+template <>
+class ProfileCursor<true> {
+public:
+    explicit ProfileCursor(ScriptProfile *profile) : profile_(profile), start_(read_cycles()) {}
+
+    ~ProfileCursor() {
+        flush(read_cycles());
+    }
+
+    void step(std::size_t pc) {
+        std::uint64_t now = read_cycles();
+        flush(now);
+        pc_ = pc;
+        start_ = now;
+    }
+
+    std::uint64_t begin_call() {
+        return read_cycles();
+    }
+
+    void end_call(std::uint64_t start) {
+        if (pc_ < profile_->pcs.size()) {
+            profile_->pcs[pc_].call_cycles += read_cycles() - start;
+        }
+    }
+
+private:
+    void flush(std::uint64_t now) {
+        if (pc_ >= profile_->pcs.size()) {
+            return;
+        }
+        auto &stat = profile_->pcs[pc_];
+        ++stat.count;
+        stat.cycles += now - start_;
+        pc_ = static_cast<std::size_t>(-1);
+    }
+
+    ScriptProfile *profile_;
+    std::size_t pc_ = static_cast<std::size_t>(-1);
+    std::uint64_t start_;
+};
+
 } // namespace
 
 InterpreterVm::InterpreterVm(const ir::Compiled &compiled,
@@ -58,9 +124,8 @@ InterpreterVm::InterpreterVm(const ir::Compiled &compiled,
     }
     arg_ptr_ = stack_ ? stack_ : &undefined_;
     arg_cnt_ = 0;
-    const_cache_.resize(compiled_.operands.size());
-    const_cache_valid_.resize(compiled_.operands.size(), false);
     build_exception_index();
+    fiber::json::gc_pin_static(runtime_.heap(), compiled_.static_region);
     runtime_.roots().add_provider(this);
 }
 
@@ -81,6 +146,7 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
         state_ = VmState::Suspend;
         return state_;
     }
+    alloc_mark_ = runtime_.heap().allocated;
     if (async_pending_ && async_ready_) {
         if (!apply_async_ready(out)) {
             state_ = VmState::Error;
@@ -90,12 +156,36 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
     state_ = VmState::Running;
     in_iterate_ = true;
     resume_pending_ = false;
+    yielded_ = false;
+    VmState state = profile_ ? execute<true>(out) : execute<false>(out);
+    if (budget_enabled_) {
+        account_alloc();
+    }
+    return state;
+}
+
+template <bool Profiled>
+InterpreterVm::VmState InterpreterVm::execute(VmResult &out) {
+    ProfileCursor<Profiled> cursor(profile_);
     auto finish_error = [&](VmError error) {
         finalize_error(error, out);
         in_iterate_ = false;
         state_ = VmState::Error;
         return state_;
     };
+    // Budget failures bypass handle_error so a script cannot catch its way
+    // past the limit.
+    auto stop_for_budget = [&](BudgetAction action, std::size_t epc) {
+        if (action == BudgetAction::Yield) {
+            yielded_ = true;
+            in_iterate_ = false;
+            state_ = VmState::Suspend;
+            return state_;
+        }
+        const char *message = action == BudgetAction::AllocLimit ? "allocation budget exceeded"
+                                                                 : "instruction budget exceeded";
+        return finish_error(make_error("EXEC_BUDGET_EXCEEDED", message, compiled_.positions[epc]));
+    };
     const auto &codes = compiled_.codes;
     while (pc_ < codes.size()) {
         if (async_pending_ && async_ready_) {
@@ -105,24 +195,38 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
                 return state_;
             }
         }
+        cursor.step(pc_);
         std::int32_t instr = codes[pc_++];
         std::uint8_t op = static_cast<std::uint8_t>(instr & 0xFF);
+        if (budget_enabled_ && op >= ir::Code::CALL_FUNC && op <= ir::Code::CALL_ASYNC_CONST) {
+            if (call_charged_) {
+                call_charged_ = false;
+            } else {
+                BudgetAction action = charge_budget(1);
+                if (action != BudgetAction::Continue) {
+                    // Re-run the call itself once resumed, without charging it again.
+                    call_charged_ = action == BudgetAction::Yield;
+                    --pc_;
+                    return stop_for_budget(action, pc_);
+                }
+            }
+        }
         switch (op) {
             case ir::Code::NOOP:
                 break;
             case ir::Code::LOAD_CONST: {
                 std::size_t idx = static_cast<std::size_t>(instr >> 8);
-                VmResult loaded = load_const(idx);
-                if (!loaded) {
-                    if (!handle_error(loaded.error(), pc_ - 1)) {
-                        finalize_error(loaded.error(), out);
-                        in_iterate_ = false;
-                        state_ = VmState::Error;
-                        return state_;
+                FIBER_ASSERT(idx < compiled_.operands.size());
+                const auto *cv = static_cast<const ir::Compiled::ConstValue *>(compiled_.operands[idx]);
+                FIBER_ASSERT(cv);
+                if (!cv->materialized) {
+                    VmError error = make_oom(compiled_.positions[pc_ - 1]);
+                    if (!handle_error(error, pc_ - 1)) {
+                        return finish_error(error);
                     }
                     continue;
                 }
-                stack_[sp_++] = loaded.value();
+                stack_[sp_++] = cv->value;
                 break;
             }
             case ir::Code::LOAD_ROOT:
@@ -239,6 +343,23 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
                     stack_[sp_ - 1] = result.value();
                 }
                 break;
+            case ir::Code::BOP_MATCH_CONST: {
+                std::size_t idx = static_cast<std::size_t>(instr >> 8);
+                FIBER_ASSERT(idx < compiled_.operands.size());
+                const auto *regex = static_cast<const fiber::common::Regex *>(compiled_.operands[idx]);
+                VmResult result = Binaries::matches(stack_[sp_ - 1], *regex, runtime_);
+                if (!result) {
+                    if (!handle_error(result.error(), pc_ - 1)) {
+                        finalize_error(result.error(), out);
+                        in_iterate_ = false;
+                        state_ = VmState::Error;
+                        return state_;
+                    }
+                    continue;
+                }
+                stack_[sp_ - 1] = result.value();
+                break;
+            }
             case ir::Code::BOP_LT:
                 --sp_;
                 {
@@ -428,7 +549,7 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
             }
             case ir::Code::NEW_ARRAY: {
                 maybe_collect();
-                fiber::json::JsValue arr = fiber::json::JsValue::make_array(runtime_.heap(), 0);
+                fiber::json::JsValue arr = fiber::json::JsValue::make_packed_array(runtime_.heap(), 0);
                 if (arr.type_ != fiber::json::JsNodeType::Array) {
                     VmError error = make_oom(compiled_.positions[pc_ - 1]);
                     if (!handle_error(error, pc_ - 1)) {
@@ -579,7 +700,9 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
                 FIBER_ASSERT(function);
                 sp_ -= arg_count;
                 set_args_for_ctx(sp_, arg_count);
+                std::uint64_t call_start = cursor.begin_call();
                 auto result = function->call(*this);
+                cursor.end_call(call_start);
                 if (!result) {
                     pending_value_ = result.error();
                     pending_value_kind_ = PendingValueKind::Thrown;
@@ -597,8 +720,16 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
                 FIBER_ASSERT(func_index < compiled_.operands.size());
                 auto *function = static_cast<Library::Function *>(compiled_.operands[func_index]);
                 FIBER_ASSERT(function);
-                set_args_for_spread(sp_ - 1);
+                if (!set_args_for_spread(sp_ - 1)) {
+                    VmError error = make_oom(compiled_.positions[pc_ - 1]);
+                    if (!handle_error(error, pc_ - 1)) {
+                        return finish_error(error);
+                    }
+                    continue;
+                }
+                std::uint64_t call_start = cursor.begin_call();
                 auto result = function->call(*this);
+                cursor.end_call(call_start);
                 clear_args();
                 if (!result) {
                     pending_value_ = result.error();
@@ -642,7 +773,13 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
                 FIBER_ASSERT(func_index < compiled_.operands.size());
                 auto *function = static_cast<Library::AsyncFunction *>(compiled_.operands[func_index]);
                 FIBER_ASSERT(function);
-                set_args_for_spread(sp_ - 1);
+                if (!set_args_for_spread(sp_ - 1)) {
+                    VmError error = make_oom(compiled_.positions[pc_ - 1]);
+                    if (!handle_error(error, pc_ - 1)) {
+                        return finish_error(error);
+                    }
+                    continue;
+                }
                 async_pending_ = true;
                 async_ready_ = false;
                 async_resume_kind_ = AsyncResumeKind::ReplaceTop;
@@ -665,7 +802,9 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
                 FIBER_ASSERT(const_index < compiled_.operands.size());
                 auto *constant = static_cast<Library::Constant *>(compiled_.operands[const_index]);
                 FIBER_ASSERT(constant);
+                std::uint64_t call_start = cursor.begin_call();
                 auto result = constant->get(*this);
+                cursor.end_call(call_start);
                 if (!result) {
                     pending_value_ = result.error();
                     pending_value_kind_ = PendingValueKind::Thrown;
@@ -700,9 +839,17 @@ InterpreterVm::VmState InterpreterVm::iterate(VmResult &out) {
                 }
                 break;
             }
-            case ir::Code::JUMP:
+            case ir::Code::JUMP: {
+                std::size_t from = pc_;
                 pc_ = static_cast<std::size_t>(instr >> 8);
+                if (budget_enabled_ && pc_ < from) {
+                    BudgetAction action = charge_budget(from - pc_);
+                    if (action != BudgetAction::Continue) {
+                        return stop_for_budget(action, from - 1);
+                    }
+                }
                 break;
+            }
             case ir::Code::JUMP_IF_FALSE: {
                 fiber::json::JsValue cond = stack_[--sp_];
                 if (!Compares::logic(cond)) {
@@ -825,6 +972,24 @@ void InterpreterVm::set_resume_callback(ResumeCallback callback, void *context)
     }
 }
 
+void InterpreterVm::set_budget(const ExecBudget &budget) {
+    budget_ = budget;
+    budget_enabled_ = budget.enabled();
+    executed_ = 0;
+    slice_used_ = 0;
+    alloc_used_ = 0;
+    alloc_mark_ = runtime_.heap().allocated;
+    call_charged_ = false;
+}
+
+void InterpreterVm::set_profiler(VmProfiler *profiler) {
+    profile_ = profiler ? &profiler->attach(compiled_) : nullptr;
+}
+
+bool InterpreterVm::yielded() const {
+    return state_ == VmState::Suspend && yielded_;
+}
+
 ScriptRuntime &InterpreterVm::runtime() {
     return runtime_;
 }
@@ -838,6 +1003,17 @@ void *InterpreterVm::attach() const {
 }
 
 const fiber::json::JsValue &InterpreterVm::arg_value(std::size_t index) const {
+    const fiber::json::JsValue &value = raw_arg_value(index);
+    if (value.type_ != fiber::json::JsNodeType::LazyJson) {
+        return value;
+    }
+    // Library functions expect real containers; materialize on first read.
+    const fiber::json::JsValue *forced =
+        fiber::json::lazy_json_force(runtime_.heap(), reinterpret_cast<fiber::json::GcLazyJson *>(value.gc));
+    return forced ? *forced : undefined_;
+}
+
+const fiber::json::JsValue &InterpreterVm::raw_arg_value(std::size_t index) const {
     if (!arg_ptr_) {
         if (arg_spread_slot_ >= stack_size_) {
             return undefined_;
@@ -846,9 +1022,9 @@ const fiber::json::JsValue &InterpreterVm::arg_value(std::size_t index) const {
         if (args.type_ != fiber::json::JsNodeType::Array || !args.gc) {
             return undefined_;
         }
+        // set_args_for_spread left it a Values array.
         auto *arr = reinterpret_cast<const fiber::json::GcArray *>(args.gc);
-        const fiber::json::JsValue *found = fiber::json::gc_array_get(arr, index);
-        return found ? *found : undefined_;
+        return index < arr->size ? arr->elems[index] : undefined_;
     }
     if (index >= arg_cnt_) {
         return undefined_;
@@ -916,11 +1092,6 @@ void InterpreterVm::visit_roots(fiber::json::GcRootSet::RootVisitor &visitor) {
     visitor.visit(&root_);
     visitor.visit_range(stack_, sp_);
     visitor.visit_range(vars_, var_count_);
-    for (std::size_t i = 0; i < const_cache_.size(); ++i) {
-        if (const_cache_valid_[i]) {
-            visitor.visit(&const_cache_[i]);
-        }
-    }
     if (has_error_) {
         if (pending_value_kind_ == PendingValueKind::Thrown) {
             visitor.visit(&pending_value_);
@@ -957,6 +1128,34 @@ void InterpreterVm::notify_resume() {
     resume_callback_(resume_context_);
 }
 
+InterpreterVm::BudgetAction InterpreterVm::charge_budget(std::uint64_t cost) {
+    executed_ += cost;
+    if (budget_.max_instructions != 0 && executed_ > budget_.max_instructions) {
+        return BudgetAction::InstructionLimit;
+    }
+    account_alloc();
+    if (budget_.max_alloc_bytes != 0 && alloc_used_ > budget_.max_alloc_bytes) {
+        return BudgetAction::AllocLimit;
+    }
+    if (budget_.slice_instructions == 0) {
+        return BudgetAction::Continue;
+    }
+    slice_used_ += cost;
+    if (slice_used_ <= budget_.slice_instructions) {
+        return BudgetAction::Continue;
+    }
+    slice_used_ = 0;
+    // Only an awaiting owner can reschedule us; a plain synchronous run keeps
+    // going and is bounded by the hard limits alone.
+    return resume_callback_ ? BudgetAction::Yield : BudgetAction::Continue;
+}
+
+void InterpreterVm::account_alloc() {
+    std::size_t allocated = runtime_.heap().allocated;
+    alloc_used_ += allocated - alloc_mark_;
+    alloc_mark_ = allocated;
+}
+
 void InterpreterVm::set_args_for_ctx(std::size_t off, std::size_t count) {
     if (stack_ && off < stack_size_) {
         arg_ptr_ = stack_ + off;
@@ -966,9 +1165,16 @@ void InterpreterVm::set_args_for_ctx(std::size_t off, std::size_t count) {
     arg_cnt_ = count;
 }
 
-void InterpreterVm::set_args_for_spread(std::size_t slot) {
+bool InterpreterVm::set_args_for_spread(std::size_t slot) {
+    // Arguments are read by reference, so a packed argument array is widened first.
+    const fiber::json::JsValue &args = stack_[slot];
+    if (args.type_ == fiber::json::JsNodeType::Array && args.gc &&
+        !fiber::json::gc_array_unpack(&runtime_.heap(), reinterpret_cast<fiber::json::GcArray *>(args.gc))) {
+        return false;
+    }
     arg_ptr_ = nullptr;
     arg_spread_slot_ = slot;
+    return true;
 }
 
 void InterpreterVm::clear_args() {
@@ -1062,52 +1268,6 @@ bool InterpreterVm::handle_error(VmError error, std::size_t epc) {
     return catch_for_exception(epc);
 }
 
-VmResult InterpreterVm::load_const(std::size_t operand_index) {
-    FIBER_ASSERT(operand_index < compiled_.operands.size());
-    if (const_cache_valid_[operand_index]) {
-        return const_cache_[operand_index];
-    }
-    const auto *cv = static_cast<const ir::Compiled::ConstValue *>(compiled_.operands[operand_index]);
-    FIBER_ASSERT(cv);
-    fiber::json::JsValue value = fiber::json::JsValue::make_undefined();
-    switch (cv->kind) {
-        case ir::Compiled::ConstValue::Kind::Undefined:
-            value = fiber::json::JsValue::make_undefined();
-            break;
-        case ir::Compiled::ConstValue::Kind::Null:
-            value = fiber::json::JsValue::make_null();
-            break;
-        case ir::Compiled::ConstValue::Kind::Boolean:
-            value = fiber::json::JsValue::make_boolean(cv->bool_value);
-            break;
-        case ir::Compiled::ConstValue::Kind::Integer:
-            value = fiber::json::JsValue::make_integer(cv->int_value);
-            break;
-        case ir::Compiled::ConstValue::Kind::Float:
-            value = fiber::json::JsValue::make_float(cv->float_value);
-            break;
-        case ir::Compiled::ConstValue::Kind::String: {
-            maybe_collect();
-            value = fiber::json::JsValue::make_string(runtime_.heap(), cv->text.data(), cv->text.size());
-            if (value.type_ != fiber::json::JsNodeType::HeapString) {
-                return std::unexpected(make_oom(-1));
-            }
-            break;
-        }
-        case ir::Compiled::ConstValue::Kind::Binary: {
-            maybe_collect();
-            value = fiber::json::JsValue::make_binary(runtime_.heap(), cv->bytes.data(), cv->bytes.size());
-            if (value.type_ != fiber::json::JsNodeType::HeapBinary) {
-                return std::unexpected(make_oom(-1));
-            }
-            break;
-        }
-    }
-    const_cache_[operand_index] = value;
-    const_cache_valid_[operand_index] = true;
-    return value;
-}
-
 VmResult InterpreterVm::make_exception_value(const VmError &error) {
     maybe_collect();
     std::string name = error.name.empty() ? "EXEC_ERROR" : error.name;
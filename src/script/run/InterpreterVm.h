@@ -8,6 +8,7 @@
 #include "../../common/json/JsGc.h"
 #include "../async/AsyncExecutionContext.h"
 #include "../ir/Compiled.h"
+#include "ExecBudget.h"
 #include "VmError.h"
 
 namespace fiber::script {
@@ -16,6 +17,9 @@ class ScriptRuntime;
 
 namespace fiber::script::run {
 
+class VmProfiler;
+struct ScriptProfile;
+
 class InterpreterVm final : public AsyncExecutionContext, public fiber::json::GcRootSet::RootProvider {
 public:
     enum class VmState {
@@ -36,11 +40,17 @@ public:
 
     VmState iterate(VmResult &out);
     void set_resume_callback(ResumeCallback callback, void *context);
+    void set_budget(const ExecBudget &budget);
+    void set_profiler(VmProfiler *profiler);
+    // True while suspended because the instruction slice ran out rather than
+    // on an async call; the owner reschedules iterate() itself.
+    bool yielded() const;
 
     ScriptRuntime &runtime() override;
     const fiber::json::JsValue &root() const override;
     void *attach() const override;
     const fiber::json::JsValue &arg_value(std::size_t index) const override;
+    const fiber::json::JsValue &raw_arg_value(std::size_t index) const override;
     std::size_t arg_count() const override;
     void return_value(const fiber::json::JsValue &value) override;
     void throw_value(const fiber::json::JsValue &value) override;
@@ -64,8 +74,6 @@ private:
     fiber::json::JsValue *vars_ = nullptr;
     std::size_t stack_size_ = 0;
     std::size_t var_count_ = 0;
-    std::vector<fiber::json::JsValue> const_cache_;
-    std::vector<bool> const_cache_valid_;
     std::vector<std::int32_t> exp_ins_;
     std::size_t sp_ = 0;
     std::size_t pc_ = 0;
@@ -98,21 +106,44 @@ private:
     bool resume_pending_ = false;
     ResumeCallback resume_callback_ = nullptr;
     void *resume_context_ = nullptr;
+    ExecBudget budget_{};
+    bool budget_enabled_ = false;
+    bool yielded_ = false;
+    std::uint64_t executed_ = 0;
+    std::uint64_t slice_used_ = 0;
+    // Heap bytes allocated while this VM ran: the shared heap's counter is
+    // sampled into alloc_mark_ on entering iterate() and the difference added
+    // at each charge and when the slice ends, so other scripts' allocations
+    // while this one is suspended are not charged to it.
+    std::size_t alloc_used_ = 0;
+    std::size_t alloc_mark_ = 0;
+    // The call that yielded was charged before it ran; skip it on resume.
+    bool call_charged_ = false;
+    ScriptProfile *profile_ = nullptr;
 
     void finalize_error(const VmError &error, VmResult &out);
     void notify_resume();
     void set_args_for_ctx(std::size_t off, std::size_t count);
-    void set_args_for_spread(std::size_t slot);
+    bool set_args_for_spread(std::size_t slot);
     void clear_args();
 
     bool catch_for_exception(std::size_t epc);
     int search_catch(std::size_t epc) const;
     void build_exception_index();
     bool handle_error(VmError error, std::size_t epc);
-    VmResult load_const(std::size_t operand_index);
     VmResult make_exception_value(const VmError &error);
     bool maybe_collect();
     bool apply_async_ready(VmResult &out);
+    template <bool Profiled>
+    VmState execute(VmResult &out);
+    enum class BudgetAction {
+        Continue,
+        Yield,
+        InstructionLimit,
+        AllocLimit
+    };
+    BudgetAction charge_budget(std::uint64_t cost);
+    void account_alloc();
 };
 
 } // namespace fiber::script::run
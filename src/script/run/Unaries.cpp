@@ -1,7 +1,9 @@
 #include "Unaries.h"
 
 #include "../../common/json/JsValueOps.h"
+#include "../../common/json/JsonDecode.h"
 #include "../Runtime.h"
+#include "Access.h"
 
 #include <cstring>
 #include <string_view>
@@ -95,11 +97,23 @@ VmResult Unaries::typeof_op(const fiber::json::JsValue &value, ScriptRuntime &ru
         case fiber::json::JsNodeType::NativeBinary:
         case fiber::json::JsNodeType::HeapBinary:
             return make_typeof_value("binary");
+        case fiber::json::JsNodeType::LazyJson:
+            return make_typeof_value(
+                fiber::json::lazy_json_is_array(reinterpret_cast<const fiber::json::GcLazyJson *>(value.gc))
+                    ? "array"
+                    : "object");
     }
     return make_typeof_value("undefined");
 }
 
 VmResult Unaries::iterate(const fiber::json::JsValue &value, ScriptRuntime &runtime) {
+    if (value.type_ == fiber::json::JsNodeType::LazyJson) {
+        VmResult resolved = Access::resolve(value, runtime);
+        if (!resolved) {
+            return resolved;
+        }
+        return iterate(*resolved, runtime);
+    }
     fiber::json::GcHeap *heap = &runtime.heap();
     runtime.maybe_collect();
     fiber::json::GcIterator *iter = nullptr;
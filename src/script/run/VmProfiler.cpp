@@ -0,0 +1,385 @@
+#include "VmProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <utility>
+
+#include "../ir/Code.h"
+
+namespace fiber::script::run {
+
+namespace {
+
+std::string symbol_display_name(const ir::Compiled &compiled, const ir::Compiled::Symbol &symbol) {
+    switch (symbol.kind) {
+        case ir::Compiled::Symbol::Kind::Constant:
+        case ir::Compiled::Symbol::Kind::AsyncConstant:
+            return symbol.key.empty() ? symbol.name : symbol.name + "." + symbol.key;
+        case ir::Compiled::Symbol::Kind::Function:
+        case ir::Compiled::Symbol::Kind::AsyncFunction:
+            if (symbol.directive >= 0 && static_cast<std::size_t>(symbol.directive) < compiled.directives.size()) {
+                return compiled.directives[symbol.directive].name + "." + symbol.name;
+            }
+            return symbol.name;
+    }
+    return symbol.name;
+}
+
+std::size_t callee_operand(std::int32_t instr) {
+    switch (static_cast<std::uint8_t>(instr & 0xFF)) {
+        case ir::Code::CALL_FUNC:
+        case ir::Code::CALL_ASYNC_FUNC:
+            return static_cast<std::size_t>(instr >> 16);
+        default:
+            return static_cast<std::size_t>(instr >> 8);
+    }
+}
+
+bool is_call(std::uint8_t op) {
+    return op >= ir::Code::CALL_FUNC && op <= ir::Code::CALL_ASYNC_CONST;
+}
+
+void append_json_string(std::string &out, std::string_view value) {
+    out.push_back('"');
+    for (char ch : value) {
+        switch (ch) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(ch));
+                    out += buf;
+                } else {
+                    out.push_back(ch);
+                }
+                break;
+        }
+    }
+    out.push_back('"');
+}
+
+// Folded-stack frames must not contain ';' or end with the sample count.
+std::string frame_name(std::string_view name) {
+    std::string out(name);
+    std::replace(out.begin(), out.end(), ';', ':');
+    std::replace(out.begin(), out.end(), ' ', '_');
+    return out;
+}
+
+std::string line_frame(const ScriptProfile &profile, std::size_t pc) {
+    std::size_t line = profile.line_of(pc);
+    if (line != 0) {
+        return "line " + std::to_string(line);
+    }
+    return "pos " + std::to_string(profile.positions[pc]);
+}
+
+} // namespace
+
+std::size_t ScriptProfile::line_of(std::size_t pc) const {
+    if (line_starts.empty() || pc >= positions.size() || positions[pc] < 0) {
+        return 0;
+    }
+    auto pos = static_cast<std::size_t>(positions[pc]);
+    auto it = std::upper_bound(line_starts.begin(), line_starts.end(), pos);
+    return static_cast<std::size_t>(it - line_starts.begin());
+}
+
+ScriptProfile &VmProfiler::attach(const ir::Compiled &compiled) {
+    auto &slot = scripts_[&compiled];
+    if (slot) {
+        return *slot;
+    }
+    slot = std::make_unique<ScriptProfile>();
+    order_.push_back(&compiled);
+    ScriptProfile &profile = *slot;
+    profile.name = "script#" + std::to_string(order_.size());
+    std::size_t size = compiled.codes.size();
+    profile.ops.resize(size);
+    profile.positions.assign(compiled.positions.begin(), compiled.positions.end());
+    profile.positions.resize(size, -1);
+    profile.callees.resize(size);
+    profile.pcs.resize(size);
+    for (std::size_t pc = 0; pc < size; ++pc) {
+        std::int32_t instr = compiled.codes[pc];
+        auto op = static_cast<std::uint8_t>(instr & 0xFF);
+        profile.ops[pc] = op;
+        if (!is_call(op)) {
+            continue;
+        }
+        std::size_t operand = callee_operand(instr);
+        for (const auto &symbol : compiled.symbols) {
+            if (symbol.operand == operand) {
+                profile.callees[pc] = symbol_display_name(compiled, symbol);
+                break;
+            }
+        }
+    }
+    return profile;
+}
+
+void VmProfiler::label(const ir::Compiled &compiled, std::string name, std::string_view source) {
+    ScriptProfile &profile = attach(compiled);
+    profile.name = std::move(name);
+    profile.line_starts.clear();
+    if (source.empty()) {
+        return;
+    }
+    profile.line_starts.push_back(0);
+    for (std::size_t i = 0; i < source.size(); ++i) {
+        if (source[i] == '\n') {
+            profile.line_starts.push_back(i + 1);
+        }
+    }
+}
+
+void VmProfiler::reset() {
+    for (auto &entry : scripts_) {
+        std::fill(entry.second->pcs.begin(), entry.second->pcs.end(), ScriptProfile::PcStat{});
+    }
+}
+
+std::uint64_t VmProfiler::total_cycles() const {
+    std::uint64_t total = 0;
+    for (const auto &entry : scripts_) {
+        for (const auto &stat : entry.second->pcs) {
+            total += stat.cycles;
+        }
+    }
+    return total;
+}
+
+std::string VmProfiler::folded() const {
+    std::map<std::string, std::uint64_t> stacks;
+    for (const ir::Compiled *compiled : order_) {
+        const ScriptProfile &profile = *scripts_.at(compiled);
+        std::string script = frame_name(profile.name);
+        for (std::size_t pc = 0; pc < profile.pcs.size(); ++pc) {
+            const auto &stat = profile.pcs[pc];
+            if (stat.count == 0) {
+                continue;
+            }
+            std::string stack = script + ";" + frame_name(line_frame(profile, pc)) + ";" +
+                                std::string(opcode_name(profile.ops[pc]));
+            std::uint64_t self = stat.cycles > stat.call_cycles ? stat.cycles - stat.call_cycles : 0;
+            if (self > 0) {
+                stacks[stack] += self;
+            }
+            if (stat.call_cycles > 0) {
+                std::string callee = profile.callees[pc].empty() ? "?" : frame_name(profile.callees[pc]);
+                stacks[stack + ";" + callee] += stat.call_cycles;
+            }
+        }
+    }
+    std::string out;
+    for (const auto &[stack, cycles] : stacks) {
+        out += stack;
+        out.push_back(' ');
+        out += std::to_string(cycles);
+        out.push_back('\n');
+    }
+    return out;
+}
+
+std::string VmProfiler::summary_json() const {
+    struct Totals {
+        std::uint64_t count = 0;
+        std::uint64_t cycles = 0;
+    };
+    Totals opcodes[256];
+    std::map<std::pair<std::string, std::string>, Totals> lines;
+    std::map<std::string, Totals> functions;
+    std::uint64_t total = 0;
+    for (const ir::Compiled *compiled : order_) {
+        const ScriptProfile &profile = *scripts_.at(compiled);
+        for (std::size_t pc = 0; pc < profile.pcs.size(); ++pc) {
+            const auto &stat = profile.pcs[pc];
+            if (stat.count == 0) {
+                continue;
+            }
+            total += stat.cycles;
+            Totals &op = opcodes[profile.ops[pc]];
+            op.count += stat.count;
+            op.cycles += stat.cycles;
+            Totals &line = lines[{profile.name, line_frame(profile, pc)}];
+            line.count += stat.count;
+            line.cycles += stat.cycles;
+            if (!profile.callees[pc].empty()) {
+                Totals &function = functions[profile.callees[pc]];
+                function.count += stat.count;
+                function.cycles += stat.call_cycles;
+            }
+        }
+    }
+
+    auto append_totals = [](std::string &out, const Totals &totals, const char *count_key) {
+        out += ",\"";
+        out += count_key;
+        out += "\":";
+        out += std::to_string(totals.count);
+        out += ",\"cycles\":";
+        out += std::to_string(totals.cycles);
+        out.push_back('}');
+    };
+
+    std::string out = "{\"total_cycles\":" + std::to_string(total) + ",\"opcodes\":[";
+    bool first = true;
+    for (std::size_t op = 0; op < 256; ++op) {
+        if (opcodes[op].count == 0) {
+            continue;
+        }
+        out += first ? "{\"op\":" : ",{\"op\":";
+        first = false;
+        append_json_string(out, opcode_name(static_cast<std::uint8_t>(op)));
+        append_totals(out, opcodes[op], "count");
+    }
+    out += "],\"lines\":[";
+    first = true;
+    for (const auto &[key, totals] : lines) {
+        out += first ? "{\"script\":" : ",{\"script\":";
+        first = false;
+        append_json_string(out, key.first);
+        out += ",\"at\":";
+        append_json_string(out, key.second);
+        append_totals(out, totals, "count");
+    }
+    out += "],\"functions\":[";
+    first = true;
+    for (const auto &[name, totals] : functions) {
+        out += first ? "{\"name\":" : ",{\"name\":";
+        first = false;
+        append_json_string(out, name);
+        append_totals(out, totals, "calls");
+    }
+    out += "]}";
+    return out;
+}
+
+std::string_view VmProfiler::opcode_name(std::uint8_t op) {
+    switch (op) {
+        case ir::Code::NOOP:
+            return "NOOP";
+        case ir::Code::LOAD_CONST:
+            return "LOAD_CONST";
+        case ir::Code::LOAD_ROOT:
+            return "LOAD_ROOT";
+        case ir::Code::DUMP:
+            return "DUMP";
+        case ir::Code::POP:
+            return "POP";
+        case ir::Code::LOAD_VAR:
+            return "LOAD_VAR";
+        case ir::Code::STORE_VAR:
+            return "STORE_VAR";
+        case ir::Code::NEW_OBJECT:
+            return "NEW_OBJECT";
+        case ir::Code::NEW_ARRAY:
+            return "NEW_ARRAY";
+        case ir::Code::EXP_OBJECT:
+            return "EXP_OBJECT";
+        case ir::Code::EXP_ARRAY:
+            return "EXP_ARRAY";
+        case ir::Code::PUSH_ARRAY:
+            return "PUSH_ARRAY";
+        case ir::Code::IDX_GET:
+            return "IDX_GET";
+        case ir::Code::IDX_SET:
+            return "IDX_SET";
+        case ir::Code::IDX_SET_1:
+            return "IDX_SET_1";
+        case ir::Code::PROP_GET:
+            return "PROP_GET";
+        case ir::Code::PROP_SET:
+            return "PROP_SET";
+        case ir::Code::PROP_SET_1:
+            return "PROP_SET_1";
+        case ir::Code::BOP_PLUS:
+            return "BOP_PLUS";
+        case ir::Code::BOP_MINUS:
+            return "BOP_MINUS";
+        case ir::Code::BOP_MULTIPLY:
+            return "BOP_MULTIPLY";
+        case ir::Code::BOP_DIVIDE:
+            return "BOP_DIVIDE";
+        case ir::Code::BOP_MOD:
+            return "BOP_MOD";
+        case ir::Code::BOP_MATCH:
+            return "BOP_MATCH";
+        case ir::Code::BOP_LT:
+            return "BOP_LT";
+        case ir::Code::BOP_LTE:
+            return "BOP_LTE";
+        case ir::Code::BOP_GT:
+            return "BOP_GT";
+        case ir::Code::BOP_GTE:
+            return "BOP_GTE";
+        case ir::Code::BOP_EQ:
+            return "BOP_EQ";
+        case ir::Code::BOP_SEQ:
+            return "BOP_SEQ";
+        case ir::Code::BOP_NE:
+            return "BOP_NE";
+        case ir::Code::BOP_SNE:
+            return "BOP_SNE";
+        case ir::Code::BOP_IN:
+            return "BOP_IN";
+        case ir::Code::BOP_MATCH_CONST:
+            return "BOP_MATCH_CONST";
+        case ir::Code::UNARY_PLUS:
+            return "UNARY_PLUS";
+        case ir::Code::UNARY_MINUS:
+            return "UNARY_MINUS";
+        case ir::Code::UNARY_NEG:
+            return "UNARY_NEG";
+        case ir::Code::UNARY_TYPEOF:
+            return "UNARY_TYPEOF";
+        case ir::Code::CALL_FUNC:
+            return "CALL_FUNC";
+        case ir::Code::CALL_FUNC_SPREAD:
+            return "CALL_FUNC_SPREAD";
+        case ir::Code::CALL_ASYNC_FUNC:
+            return "CALL_ASYNC_FUNC";
+        case ir::Code::CALL_ASYNC_FUNC_SPREAD:
+            return "CALL_ASYNC_FUNC_SPREAD";
+        case ir::Code::CALL_CONST:
+            return "CALL_CONST";
+        case ir::Code::CALL_ASYNC_CONST:
+            return "CALL_ASYNC_CONST";
+        case ir::Code::JUMP:
+            return "JUMP";
+        case ir::Code::JUMP_IF_FALSE:
+            return "JUMP_IF_FALSE";
+        case ir::Code::JUMP_IF_TRUE:
+            return "JUMP_IF_TRUE";
+        case ir::Code::ITERATE_INTO:
+            return "ITERATE_INTO";
+        case ir::Code::ITERATE_NEXT:
+            return "ITERATE_NEXT";
+        case ir::Code::ITERATE_KEY:
+            return "ITERATE_KEY";
+        case ir::Code::ITERATE_VALUE:
+            return "ITERATE_VALUE";
+        case ir::Code::INTO_CATCH:
+            return "INTO_CATCH";
+        case ir::Code::THROW_EXP:
+            return "THROW_EXP";
+        case ir::Code::END_RETURN:
+            return "END_RETURN";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+} // namespace fiber::script::run
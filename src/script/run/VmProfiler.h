@@ -0,0 +1,82 @@
+#ifndef FIBER_SCRIPT_RUN_VM_PROFILER_H
+#define FIBER_SCRIPT_RUN_VM_PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../ir/Compiled.h"
+
+namespace fiber::script::run {
+
+// Cycle counter used for profiling; falls back to the steady clock in
+// nanoseconds where rdtsc is not available.
+inline std::uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Per-instruction samples for one Compiled, indexed by pc so the VM only
+// pays a vector index per opcode while profiling.
+struct ScriptProfile {
+    struct PcStat {
+        std::uint64_t count = 0;
+        std::uint64_t cycles = 0;
+        // Part of cycles spent inside the library callee of a CALL_* op.
+        std::uint64_t call_cycles = 0;
+    };
+
+    std::string name;
+    std::vector<std::uint8_t> ops;
+    std::vector<std::int64_t> positions;
+    // Display name of the library symbol called at each pc, empty otherwise.
+    std::vector<std::string> callees;
+    std::vector<std::size_t> line_starts;
+    std::vector<PcStat> pcs;
+
+    // 1-based source line of pc, or 0 when no source was labelled.
+    std::size_t line_of(std::size_t pc) const;
+};
+
+// Collects opcode counts, rdtsc cycles, per-line hotness and library call
+// time across every run it is attached to (ScriptRun::set_profiler). Runs
+// without a profiler execute an uninstrumented instantiation of the VM loop,
+// so keeping this in production builds costs nothing until it is switched on.
+// Not thread-safe: use one per loop. Attached scripts must outlive it.
+class VmProfiler {
+public:
+    ScriptProfile &attach(const ir::Compiled &compiled);
+    // Names a script in reports; with its source, positions become lines.
+    void label(const ir::Compiled &compiled, std::string name, std::string_view source = {});
+    void reset();
+
+    std::uint64_t total_cycles() const;
+
+    // One "script;line N;OPCODE[;callee] cycles" line per distinct stack, the
+    // input format of flamegraph.pl and compatible tools.
+    std::string folded() const;
+    // Opcode, line and library-function tables as a JSON object.
+    std::string summary_json() const;
+
+    static std::string_view opcode_name(std::uint8_t op);
+
+private:
+    std::unordered_map<const ir::Compiled *, std::unique_ptr<ScriptProfile>> scripts_;
+    std::vector<const ir::Compiled *> order_;
+};
+
+} // namespace fiber::script::run
+
+#endif // FIBER_SCRIPT_RUN_VM_PROFILER_H
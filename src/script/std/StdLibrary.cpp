@@ -1,10 +1,42 @@
 #include "StdLibrary.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace fiber::script::std_lib {
 
 void register_std_library(StdLibrary &library);
 
 namespace {
+// Bump when a registered function changes behaviour without changing its name.
+constexpr std::uint64_t kStdLibraryAbi = 1;
+
+constexpr std::uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+std::uint64_t fnv1a(std::uint64_t hash, std::string_view text) {
+    for (unsigned char ch : text) {
+        hash ^= ch;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+template <typename Map>
+std::uint64_t hash_names(std::uint64_t hash, char tag, const Map &map) {
+    std::vector<std::string_view> names;
+    names.reserve(map.size());
+    for (const auto &entry : map) {
+        names.push_back(entry.first);
+    }
+    std::sort(names.begin(), names.end());
+    for (std::string_view name : names) {
+        hash = fnv1a(hash, std::string_view(&tag, 1));
+        hash = fnv1a(hash, name);
+    }
+    return hash;
+}
+
 std::string make_constant_key(std::string_view ns, std::string_view key) {
     std::string name;
     name.reserve(ns.size() + 1 + key.size());
@@ -24,6 +56,15 @@ StdLibrary::StdLibrary() {
     register_std_library(*this);
 }
 
+std::uint64_t StdLibrary::version() const {
+    std::uint64_t hash = kFnvOffsetBasis ^ kStdLibraryAbi;
+    hash = hash_names(hash, 'f', functions_);
+    hash = hash_names(hash, 'a', async_functions_);
+    hash = hash_names(hash, 'c', constants_);
+    hash = hash_names(hash, 'k', async_constants_);
+    return hash;
+}
+
 Library::Function *StdLibrary::find_func(std::string_view name) {
     auto it = functions_.find(std::string(name));
     if (it == functions_.end()) {
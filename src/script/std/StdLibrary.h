@@ -1,6 +1,7 @@
 #ifndef FIBER_SCRIPT_STD_LIBRARY_H
 #define FIBER_SCRIPT_STD_LIBRARY_H
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -12,6 +13,8 @@ class StdLibrary : public Library {
 public:
     static StdLibrary &instance();
 
+    std::uint64_t version() const override;
+
     Function *find_func(std::string_view name) override;
     AsyncFunction *find_async_func(std::string_view name) override;
     Constant *find_constant(std::string_view namespace_name, std::string_view key) override;
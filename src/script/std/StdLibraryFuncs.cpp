@@ -1,15 +1,21 @@
 #include "StdLibrary.h"
 
+#include "../../common/Regex.h"
+#include "../../common/Sha256.h"
+#include "../../common/json/BinaryCodec.h"
 #include "../../common/json/JsGc.h"
 #include "../../common/json/JsValueOps.h"
 #include "../../common/json/JsonDecode.h"
 #include "../../common/json/JsonEncode.h"
+#include "../../common/json/JsonPath.h"
+#include "../../common/json/JsonSchema.h"
 #include "../../common/json/JsValueEncode.h"
 #include "../../common/json/Utf.h"
 #include "../Runtime.h"
 
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <chrono>
 #include <cctype>
 #include <cmath>
@@ -20,7 +26,6 @@
 #include <iomanip>
 #include <limits>
 #include <random>
-#include <regex>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -31,6 +36,7 @@ namespace fiber::script::std_lib {
 namespace {
 
 using fiber::json::GcArray;
+using fiber::json::GcArrayKind;
 using fiber::json::GcBinary;
 using fiber::json::GcObject;
 using fiber::json::GcObjectEntry;
@@ -70,6 +76,8 @@ std::string_view type_name(JsNodeType type) {
         case JsNodeType::NativeBinary:
         case JsNodeType::HeapBinary:
             return "Binary";
+        case JsNodeType::LazyJson:
+            return "Object";
     }
     return "Unknown";
 }
@@ -89,16 +97,16 @@ bool is_number_type(const JsValue &value) {
 bool get_utf8_string(const JsValue &value, std::string &out) {
     out.clear();
     if (value.type_ == JsNodeType::NativeString) {
-        if (value.ns.len == 0) {
+        if (value.ns().len == 0) {
             return true;
         }
-        if (!value.ns.data) {
+        if (!value.ns().data) {
             return false;
         }
-        if (!fiber::json::utf8_validate(value.ns.data, value.ns.len)) {
+        if (!fiber::json::utf8_validate(value.ns().data, value.ns().len)) {
             return false;
         }
-        out.assign(value.ns.data, value.ns.len);
+        out.assign(value.ns().data, value.ns().len);
         return true;
     }
     if (value.type_ == JsNodeType::HeapString) {
@@ -126,15 +134,15 @@ bool get_u16_string(const JsValue &value, std::u16string &out) {
         return true;
     }
     if (value.type_ == JsNodeType::NativeString) {
-        if (value.ns.len == 0) {
+        if (value.ns().len == 0) {
             return true;
         }
         fiber::json::Utf8ScanResult scan;
-        if (!fiber::json::utf8_scan(value.ns.data, value.ns.len, scan)) {
+        if (!fiber::json::utf8_scan(value.ns().data, value.ns().len, scan)) {
             return false;
         }
         out.resize(scan.utf16_len);
-        if (!fiber::json::utf8_write_utf16(value.ns.data, value.ns.len, out.data(), scan.utf16_len)) {
+        if (!fiber::json::utf8_write_utf16(value.ns().data, value.ns().len, out.data(), scan.utf16_len)) {
             return false;
         }
         return true;
@@ -154,7 +162,7 @@ bool string_length(const JsValue &value, std::size_t &out) {
     }
     if (value.type_ == JsNodeType::NativeString) {
         fiber::json::Utf8ScanResult scan;
-        if (!fiber::json::utf8_scan(value.ns.data, value.ns.len, scan)) {
+        if (!fiber::json::utf8_scan(value.ns().data, value.ns().len, scan)) {
             return false;
         }
         out = scan.utf16_len;
@@ -167,8 +175,8 @@ bool get_binary_data(const JsValue &value, const std::uint8_t *&data, std::size_
     data = nullptr;
     len = 0;
     if (value.type_ == JsNodeType::NativeBinary) {
-        data = value.nb.data;
-        len = value.nb.len;
+        data = value.nb().data;
+        len = value.nb().len;
         return true;
     }
     if (value.type_ == JsNodeType::HeapBinary) {
@@ -246,6 +254,7 @@ std::string as_text(const JsValue &value, std::string_view default_value) {
         case JsNodeType::Exception:
         case JsNodeType::NativeBinary:
         case JsNodeType::HeapBinary:
+        case JsNodeType::LazyJson:
             return std::string(default_value);
     }
     return std::string(default_value);
@@ -276,10 +285,14 @@ std::string jsonutil_to_string(const JsValue &value) {
         case JsNodeType::Object:
         case JsNodeType::Exception:
             return std::string(kObjectText);
+        case JsNodeType::LazyJson:
+            return fiber::json::lazy_json_is_array(reinterpret_cast<const fiber::json::GcLazyJson *>(value.gc))
+                       ? std::string(kArrayText)
+                       : std::string(kObjectText);
         case JsNodeType::Interator:
             return std::string(kArrayText);
         case JsNodeType::NativeBinary:
-            return std::string(reinterpret_cast<const char *>(value.nb.data), value.nb.len);
+            return std::string(reinterpret_cast<const char *>(value.nb().data), value.nb().len);
         case JsNodeType::HeapBinary: {
             auto *bin = reinterpret_cast<const GcBinary *>(value.gc);
             if (!bin) {
@@ -367,6 +380,10 @@ Library::FunctionResult make_oom_error(ExecutionContext &context) {
     return make_error(context, "out of memory");
 }
 
+Library::FunctionResult make_frozen_error(ExecutionContext &context) {
+    return make_error(context, "cannot modify a frozen value");
+}
+
 Library::FunctionResult make_type_error(ExecutionContext &context, std::string_view prefix, const JsValue &value) {
     std::string message(prefix);
     message.append(type_name(value.type_));
@@ -809,97 +826,6 @@ std::array<std::uint8_t, 20> sha1_digest(const std::uint8_t *data, std::size_t l
     return out;
 }
 
-std::uint32_t sha256_rotr(std::uint32_t x, std::uint32_t n) {
-    return (x >> n) | (x << (32 - n));
-}
-
-std::array<std::uint8_t, 32> sha256_digest(const std::uint8_t *data, std::size_t len) {
-    static constexpr std::array<std::uint32_t, 64> k = {
-        0x428a2f98u, 0x71374491u, 0xb5c0fbcfu, 0xe9b5dba5u, 0x3956c25bu, 0x59f111f1u, 0x923f82a4u,
-        0xab1c5ed5u, 0xd807aa98u, 0x12835b01u, 0x243185beu, 0x550c7dc3u, 0x72be5d74u, 0x80deb1feu,
-        0x9bdc06a7u, 0xc19bf174u, 0xe49b69c1u, 0xefbe4786u, 0x0fc19dc6u, 0x240ca1ccu, 0x2de92c6fu,
-        0x4a7484aau, 0x5cb0a9dcu, 0x76f988dau, 0x983e5152u, 0xa831c66du, 0xb00327c8u, 0xbf597fc7u,
-        0xc6e00bf3u, 0xd5a79147u, 0x06ca6351u, 0x14292967u, 0x27b70a85u, 0x2e1b2138u, 0x4d2c6dfcu,
-        0x53380d13u, 0x650a7354u, 0x766a0abbu, 0x81c2c92eu, 0x92722c85u, 0xa2bfe8a1u, 0xa81a664bu,
-        0xc24b8b70u, 0xc76c51a3u, 0xd192e819u, 0xd6990624u, 0xf40e3585u, 0x106aa070u, 0x19a4c116u,
-        0x1e376c08u, 0x2748774cu, 0x34b0bcb5u, 0x391c0cb3u, 0x4ed8aa4au, 0x5b9cca4fu, 0x682e6ff3u,
-        0x748f82eeu, 0x78a5636fu, 0x84c87814u, 0x8cc70208u, 0x90befffau, 0xa4506cebu, 0xbef9a3f7u,
-        0xc67178f2u};
-
-    std::array<std::uint32_t, 8> h = {
-        0x6a09e667u, 0xbb67ae85u, 0x3c6ef372u, 0xa54ff53au,
-        0x510e527fu, 0x9b05688cu, 0x1f83d9abu, 0x5be0cd19u};
-
-    std::size_t new_len = len + 1;
-    while ((new_len % 64) != 56) {
-        ++new_len;
-    }
-    std::vector<std::uint8_t> buffer(new_len + 8);
-    std::memcpy(buffer.data(), data, len);
-    buffer[len] = 0x80;
-    std::uint64_t bits_len = static_cast<std::uint64_t>(len) * 8;
-    for (int i = 0; i < 8; ++i) {
-        buffer[new_len + 7 - i] = static_cast<std::uint8_t>((bits_len >> (8 * i)) & 0xFFu);
-    }
-
-    for (std::size_t offset = 0; offset < buffer.size(); offset += 64) {
-        std::uint32_t w[64];
-        for (int i = 0; i < 16; ++i) {
-            std::size_t idx = offset + static_cast<std::size_t>(i) * 4;
-            w[i] = (static_cast<std::uint32_t>(buffer[idx]) << 24) |
-                   (static_cast<std::uint32_t>(buffer[idx + 1]) << 16) |
-                   (static_cast<std::uint32_t>(buffer[idx + 2]) << 8) |
-                   static_cast<std::uint32_t>(buffer[idx + 3]);
-        }
-        for (int i = 16; i < 64; ++i) {
-            std::uint32_t s0 = sha256_rotr(w[i - 15], 7) ^ sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
-            std::uint32_t s1 = sha256_rotr(w[i - 2], 17) ^ sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
-            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
-        }
-        std::uint32_t a = h[0];
-        std::uint32_t b = h[1];
-        std::uint32_t c = h[2];
-        std::uint32_t d = h[3];
-        std::uint32_t e = h[4];
-        std::uint32_t f = h[5];
-        std::uint32_t g = h[6];
-        std::uint32_t hh = h[7];
-        for (int i = 0; i < 64; ++i) {
-            std::uint32_t S1 = sha256_rotr(e, 6) ^ sha256_rotr(e, 11) ^ sha256_rotr(e, 25);
-            std::uint32_t ch = (e & f) ^ ((~e) & g);
-            std::uint32_t temp1 = hh + S1 + ch + k[i] + w[i];
-            std::uint32_t S0 = sha256_rotr(a, 2) ^ sha256_rotr(a, 13) ^ sha256_rotr(a, 22);
-            std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
-            std::uint32_t temp2 = S0 + maj;
-            hh = g;
-            g = f;
-            f = e;
-            e = d + temp1;
-            d = c;
-            c = b;
-            b = a;
-            a = temp1 + temp2;
-        }
-        h[0] += a;
-        h[1] += b;
-        h[2] += c;
-        h[3] += d;
-        h[4] += e;
-        h[5] += f;
-        h[6] += g;
-        h[7] += hh;
-    }
-
-    std::array<std::uint8_t, 32> out{};
-    for (int i = 0; i < 8; ++i) {
-        out[i * 4] = static_cast<std::uint8_t>((h[i] >> 24) & 0xFF);
-        out[i * 4 + 1] = static_cast<std::uint8_t>((h[i] >> 16) & 0xFF);
-        out[i * 4 + 2] = static_cast<std::uint8_t>((h[i] >> 8) & 0xFF);
-        out[i * 4 + 3] = static_cast<std::uint8_t>(h[i] & 0xFF);
-    }
-    return out;
-}
-
 bool format_time_pattern(std::string_view pattern, const std::tm &tm, int millis, std::string &out) {
     auto append_number = [&](int value, int width) {
         std::ostringstream oss;
@@ -1120,12 +1046,8 @@ public:
             const JsValue &arg = context.arg_value(i);
             bool found = false;
             for (std::size_t j = 0; j < arr->size; ++j) {
-                const JsValue *elem = fiber::json::gc_array_get(arr, j);
-                if (!elem) {
-                    continue;
-                }
                 fiber::json::JsOpResult cmp = fiber::json::js_binary_op(
-                    fiber::json::JsBinaryOp::StrictEq, *elem, arg, nullptr);
+                    fiber::json::JsBinaryOp::StrictEq, fiber::json::gc_array_at(arr, j), arg, nullptr);
                 if (cmp.error == fiber::json::JsOpError::None && cmp.value.b) {
                     found = true;
                     break;
@@ -1155,16 +1077,35 @@ public:
             delimiter = as_text(context.arg_value(1), "");
         }
         std::string out;
-        if (arr) {
-            for (std::size_t i = 0; i < arr->size; ++i) {
-                if (i > 0) {
-                    out.append(delimiter);
-                }
-                const JsValue *item = fiber::json::gc_array_get(arr, i);
-                if (item) {
-                    out.append(as_text(*item, ""));
+        std::size_t size = arr ? arr->size : 0;
+        switch (arr ? arr->kind : GcArrayKind::Values) {
+            case GcArrayKind::Int64: {
+                char digits[24];
+                for (std::size_t i = 0; i < size; ++i) {
+                    if (i > 0) {
+                        out.append(delimiter);
+                    }
+                    auto end = std::to_chars(digits, digits + sizeof(digits), arr->ints[i]).ptr;
+                    out.append(digits, end);
                 }
+                break;
             }
+            case GcArrayKind::Float64:
+                for (std::size_t i = 0; i < size; ++i) {
+                    if (i > 0) {
+                        out.append(delimiter);
+                    }
+                    out.append(double_to_string(arr->floats[i]));
+                }
+                break;
+            case GcArrayKind::Values:
+                for (std::size_t i = 0; i < size; ++i) {
+                    if (i > 0) {
+                        out.append(delimiter);
+                    }
+                    out.append(as_text(arr->elems[i], ""));
+                }
+                break;
         }
         JsValue result = make_heap_string_value(context.runtime(), out);
         if (result.type_ == JsNodeType::Undefined) {
@@ -1185,6 +1126,9 @@ public:
             return make_type_error(context, "array pop require array but get ", arg);
         }
         auto *arr = reinterpret_cast<GcArray *>(arg.gc);
+        if (fiber::json::gc_is_static(arg.gc)) {
+            return make_frozen_error(context);
+        }
         if (!arr || arr->size == 0) {
             return JsValue::make_null();
         }
@@ -1210,6 +1154,9 @@ public:
         if (!arr) {
             return arg;
         }
+        if (fiber::json::gc_is_static(arg.gc)) {
+            return make_frozen_error(context);
+        }
         ScriptRuntime &runtime = context.runtime();
         for (std::size_t i = 1; i < context.arg_count(); ++i) {
             if (!fiber::json::gc_array_push(&runtime.heap(), arr, context.arg_value(i))) {
@@ -1225,8 +1172,8 @@ GcString *ensure_heap_string(ScriptRuntime &runtime, const JsValue &value) {
         return reinterpret_cast<GcString *>(value.gc);
     }
     if (value.type_ == JsNodeType::NativeString) {
-        auto *str = runtime.alloc_with_gc(value.ns.len, [&]() {
-            return fiber::json::gc_new_string(&runtime.heap(), value.ns.data, value.ns.len);
+        auto *str = runtime.alloc_with_gc(value.ns().len, [&]() {
+            return fiber::json::gc_new_string(&runtime.heap(), value.ns().data, value.ns().len);
         });
         return str;
     }
@@ -1250,6 +1197,9 @@ public:
         if (!target) {
             return arg;
         }
+        if (fiber::json::gc_is_static(arg.gc)) {
+            return make_frozen_error(context);
+        }
         ScriptRuntime &runtime = context.runtime();
         fiber::json::GcHeap *heap = &runtime.heap();
         for (std::size_t i = 1; i < context.arg_count(); ++i) {
@@ -1261,9 +1211,9 @@ public:
             if (!obj) {
                 continue;
             }
-            for (std::size_t idx = 0; idx < obj->size; ++idx) {
-                const GcObjectEntry *entry = fiber::json::gc_object_entry_at(obj, idx);
-                if (!entry || !entry->occupied || !entry->key) {
+            for (std::size_t idx = 0; idx < obj->entry_count; ++idx) {
+                const GcObjectEntry *entry = &obj->entries[idx];
+                if (!entry->key) {
                     continue;
                 }
                 if (!fiber::json::gc_object_set(heap, target, entry->key, entry->value)) {
@@ -1295,9 +1245,9 @@ public:
         GcRootGuard guard(runtime, &array);
         auto *arr = reinterpret_cast<GcArray *>(array.gc);
         if (obj && arr) {
-            for (std::size_t idx = 0; idx < obj->size; ++idx) {
-                const GcObjectEntry *entry = fiber::json::gc_object_entry_at(obj, idx);
-                if (!entry || !entry->occupied || !entry->key) {
+            for (std::size_t idx = 0; idx < obj->entry_count; ++idx) {
+                const GcObjectEntry *entry = &obj->entries[idx];
+                if (!entry->key) {
                     continue;
                 }
                 JsValue key;
@@ -1325,16 +1275,16 @@ public:
         ScriptRuntime &runtime = context.runtime();
         auto *obj = reinterpret_cast<const GcObject *>(arg.gc);
         std::size_t capacity = obj ? obj->size : 0;
-        JsValue array = JsValue::make_array(runtime.heap(), capacity);
+        JsValue array = JsValue::make_packed_array(runtime.heap(), capacity);
         if (array.type_ != JsNodeType::Array) {
             return make_oom_error(context);
         }
         GcRootGuard guard(runtime, &array);
         auto *arr = reinterpret_cast<GcArray *>(array.gc);
         if (obj && arr) {
-            for (std::size_t idx = 0; idx < obj->size; ++idx) {
-                const GcObjectEntry *entry = fiber::json::gc_object_entry_at(obj, idx);
-                if (!entry || !entry->occupied) {
+            for (std::size_t idx = 0; idx < obj->entry_count; ++idx) {
+                const GcObjectEntry *entry = &obj->entries[idx];
+                if (!entry->key) {
                     continue;
                 }
                 if (!fiber::json::gc_array_push(&runtime.heap(), arr, entry->value)) {
@@ -1360,6 +1310,9 @@ public:
         if (!obj) {
             return arg;
         }
+        if (fiber::json::gc_is_static(arg.gc)) {
+            return make_frozen_error(context);
+        }
         ScriptRuntime &runtime = context.runtime();
         for (std::size_t i = 1; i < context.arg_count(); ++i) {
             const JsValue &key_val = context.arg_value(i);
@@ -1617,10 +1570,8 @@ public:
         if (!get_utf8_string(context.arg_value(1), pattern)) {
             return JsValue::make_null();
         }
-        std::regex re;
-        try {
-            re = std::regex(pattern);
-        } catch (const std::regex_error &) {
+        auto re = fiber::common::regex_cached(pattern);
+        if (!re) {
             return make_error(context, "invalid regex");
         }
         ScriptRuntime &runtime = context.runtime();
@@ -1630,10 +1581,11 @@ public:
         }
         GcRootGuard guard(runtime, &array);
         auto *arr = reinterpret_cast<GcArray *>(array.gc);
-        std::string::const_iterator search_start = text.cbegin();
-        std::smatch match;
-        while (std::regex_search(search_start, text.cend(), match, re)) {
-            std::string value = match.str();
+        std::size_t from = 0;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        while (from <= text.size() && re->find(text, from, begin, end)) {
+            std::string value = text.substr(begin, end - begin);
             JsValue item = make_heap_string_value(runtime, value);
             if (item.type_ == JsNodeType::Undefined) {
                 return make_oom_error(context);
@@ -1641,7 +1593,14 @@ public:
             if (!fiber::json::gc_array_push(&runtime.heap(), arr, item)) {
                 return make_oom_error(context);
             }
-            search_start = match.suffix().first;
+            from = end;
+            if (begin == end) {
+                // Step over one code point so empty matches make progress.
+                ++from;
+                while (from < text.size() && (static_cast<unsigned char>(text[from]) & 0xC0) == 0x80) {
+                    ++from;
+                }
+            }
         }
         return array;
     }
@@ -1825,12 +1784,11 @@ public:
         if (!get_utf8_string(context.arg_value(1), pattern)) {
             return JsValue::make_boolean(false);
         }
-        try {
-            std::regex re(pattern);
-            return JsValue::make_boolean(std::regex_match(text, re));
-        } catch (const std::regex_error &) {
+        auto re = fiber::common::regex_cached(pattern);
+        if (!re) {
             return make_error(context, "invalid regex");
         }
+        return JsValue::make_boolean(re->full_match(text));
     }
 };
 
@@ -1840,57 +1798,62 @@ public:
         if (context.arg_count() == 0) {
             return JsValue::make_null();
         }
-        std::u16string src;
-        if (!get_u16_string(context.arg_value(0), src)) {
+        const JsValue &value = context.arg_value(0);
+        std::size_t len = 0;
+        if (!is_string_type(value) || !string_length(value, len)) {
             return JsValue::make_null();
         }
         if (context.arg_count() == 1) {
-            return context.arg_value(0);
+            return value;
         }
         std::int64_t i = to_int64_default(context.arg_value(1));
-        std::size_t len = src.size();
+        std::size_t end = len;
         if (context.arg_count() == 2) {
             if (i <= 0) {
-                return context.arg_value(0);
+                return value;
             }
-            if (static_cast<std::size_t>(i) >= len) {
-                JsValue out = make_heap_string_value(context.runtime(), "");
-                if (out.type_ == JsNodeType::Undefined) {
-                    return make_oom_error(context);
-                }
-                return out;
+        } else {
+            std::int64_t j = to_int64_default(context.arg_value(2));
+            if (i < 0) {
+                i = 0;
             }
-            std::u16string sub = src.substr(static_cast<std::size_t>(i));
-            JsValue out = make_heap_string_value_u16(context.runtime(), sub);
-            if (out.type_ == JsNodeType::Undefined) {
-                return make_oom_error(context);
+            if (j <= i) {
+                return make_substring(context, value, 0, 0);
+            }
+            if (static_cast<std::uint64_t>(j) < end) {
+                end = static_cast<std::size_t>(j);
             }
-            return out;
-        }
-        std::int64_t j = to_int64_default(context.arg_value(2));
-        if (i < 0) {
-            i = 0;
         }
         if (static_cast<std::size_t>(i) >= len) {
-            JsValue out = make_heap_string_value(context.runtime(), "");
-            if (out.type_ == JsNodeType::Undefined) {
-                return make_oom_error(context);
-            }
-            return out;
+            return make_substring(context, value, 0, 0);
         }
-        if (j <= i) {
-            JsValue out = make_heap_string_value(context.runtime(), "");
-            if (out.type_ == JsNodeType::Undefined) {
-                return make_oom_error(context);
+        return make_substring(context, value, static_cast<std::size_t>(i), end);
+    }
+
+private:
+    // Heap strings are sliced in place (gc_new_string_slice); native ones
+    // are decoded first.
+    static FunctionResult make_substring(ExecutionContext &context,
+                                         const JsValue &value,
+                                         std::size_t start,
+                                         std::size_t end) {
+        JsValue out;
+        if (value.type_ == JsNodeType::HeapString) {
+            auto *parent = reinterpret_cast<const GcString *>(value.gc);
+            auto *str = context.runtime().alloc_with_gc(sizeof(GcString), [&]() {
+                return fiber::json::gc_new_string_slice(&context.runtime().heap(), parent, start, end - start);
+            });
+            if (str) {
+                out.type_ = JsNodeType::HeapString;
+                out.gc = &str->hdr;
             }
-            return out;
-        }
-        std::size_t end = static_cast<std::size_t>(j);
-        if (end > len) {
-            end = len;
+        } else {
+            std::u16string src;
+            if (!get_u16_string(value, src)) {
+                return JsValue::make_null();
+            }
+            out = make_heap_string_value_u16(context.runtime(), src.substr(start, end - start));
         }
-        std::u16string sub = src.substr(static_cast<std::size_t>(i), end - static_cast<std::size_t>(i));
-        JsValue out = make_heap_string_value_u16(context.runtime(), sub);
         if (out.type_ == JsNodeType::Undefined) {
             return make_oom_error(context);
         }
@@ -1925,6 +1888,107 @@ public:
     }
 };
 
+// An empty string whose buffer reserves room, so appending to it (with + or
+// strings.append) fills the buffer in place.
+class BuilderFunc final : public Library::Function {
+public:
+    FunctionResult call(ExecutionContext &context) override {
+        constexpr std::int64_t kDefaultCapacity = 256;
+        constexpr std::int64_t kMaxCapacity = 1 << 20;
+        std::int64_t capacity = kDefaultCapacity;
+        if (context.arg_count() > 0) {
+            const JsValue &arg = context.arg_value(0);
+            if (!is_number_type(arg)) {
+                return make_type_error(context, "strings.builder require number but get ", arg);
+            }
+            capacity = std::clamp<std::int64_t>(to_int64_default(arg), 0, kMaxCapacity);
+        }
+        ScriptRuntime &runtime = context.runtime();
+        auto *str = runtime.alloc_with_gc(static_cast<std::size_t>(capacity), [&]() {
+            return fiber::json::gc_string_reserve(&runtime.heap(), nullptr, static_cast<std::size_t>(capacity));
+        });
+        if (!str) {
+            return make_oom_error(context);
+        }
+        JsValue out;
+        out.type_ = JsNodeType::HeapString;
+        out.gc = &str->hdr;
+        return out;
+    }
+};
+
+// The first argument followed by the text of the others, appended in one
+// step.
+class AppendFunc final : public Library::Function {
+public:
+    FunctionResult call(ExecutionContext &context) override {
+        if (context.arg_count() == 0) {
+            return make_error(context, "strings.append require string but get none");
+        }
+        const JsValue &arg = context.arg_value(0);
+        if (!is_string_type(arg)) {
+            return make_type_error(context, "strings.append require string but get ", arg);
+        }
+        std::u16string tail;
+        std::u16string part;
+        for (std::size_t i = 1; i < context.arg_count(); ++i) {
+            const JsValue &value = context.arg_value(i);
+            if (is_string_type(value)) {
+                if (!get_u16_string(value, part)) {
+                    return make_error(context, "strings.append invalid utf-8");
+                }
+            } else {
+                std::string text = as_text(value, "");
+                part.clear();
+                fiber::json::Utf8ScanResult scan;
+                if (!text.empty()) {
+                    if (!fiber::json::utf8_scan(text.data(), text.size(), scan)) {
+                        return make_error(context, "strings.append invalid utf-8");
+                    }
+                    part.resize(scan.utf16_len);
+                    if (!fiber::json::utf8_write_utf16(text.data(), text.size(), part.data(), scan.utf16_len)) {
+                        return make_error(context, "strings.append invalid utf-8");
+                    }
+                }
+            }
+            tail.append(part);
+        }
+        ScriptRuntime &runtime = context.runtime();
+        GcString *prefix = ensure_heap_string(runtime, arg);
+        if (!prefix) {
+            return make_oom_error(context);
+        }
+        JsValue prefix_value;
+        prefix_value.type_ = JsNodeType::HeapString;
+        prefix_value.gc = &prefix->hdr;
+        GcRootGuard guard(runtime, &prefix_value);
+        bool all_byte = std::all_of(tail.begin(), tail.end(), [](char16_t ch) {
+            return ch <= 0xFF;
+        });
+        std::size_t unit = all_byte && prefix->encoding == fiber::json::GcStringEncoding::Byte ? 1 : 2;
+        auto *str = runtime.alloc_with_gc(tail.size() * unit, [&]() {
+            return fiber::json::gc_string_extend(&runtime.heap(), prefix, tail.size(),
+                                                 all_byte ? fiber::json::GcStringEncoding::Byte
+                                                          : fiber::json::GcStringEncoding::Utf16);
+        });
+        if (!str) {
+            return make_oom_error(context);
+        }
+        if (str->encoding == fiber::json::GcStringEncoding::Byte) {
+            std::uint8_t *dst = str->data8 + prefix->len;
+            for (std::size_t i = 0; i < tail.size(); ++i) {
+                dst[i] = static_cast<std::uint8_t>(tail[i]);
+            }
+        } else if (!tail.empty()) {
+            std::memcpy(str->data16 + prefix->len, tail.data(), sizeof(char16_t) * tail.size());
+        }
+        JsValue out;
+        out.type_ = JsNodeType::HeapString;
+        out.gc = &str->hdr;
+        return out;
+    }
+};
+
 class JsonParseFunc final : public Library::Function {
 public:
     FunctionResult call(ExecutionContext &context) override {
@@ -1936,6 +2000,7 @@ public:
             return make_type_error(context, "parseJson not support ", context.arg_value(0));
         }
         fiber::json::Parser parser(context.runtime().heap());
+        parser.set_pack_arrays(true);
         JsValue out;
         if (!parser.parse(text, out)) {
             std::string message = "cannot parseJson: ";
@@ -1946,27 +2011,41 @@ public:
     }
 };
 
+class JsonParseLazyFunc final : public Library::Function {
+public:
+    FunctionResult call(ExecutionContext &context) override {
+        if (context.arg_count() == 0) {
+            return make_error(context, "parseJson not support Undefined");
+        }
+        std::string text;
+        if (!get_utf8_string(context.arg_value(0), text)) {
+            return make_type_error(context, "parseJson not support ", context.arg_value(0));
+        }
+        fiber::json::Parser parser(context.runtime().heap());
+        parser.set_pack_arrays(true);
+        JsValue out;
+        if (!parser.parse_lazy(text, out)) {
+            std::string message = "cannot parseJson: ";
+            message.append(parser.error().message);
+            return make_error(context, message);
+        }
+        return out;
+    }
+};
+
 class JsonStringifyFunc final : public Library::Function {
 public:
     FunctionResult call(ExecutionContext &context) override {
         if (context.arg_count() == 0) {
             return make_error(context, "error invoke jsonStringify: empty args");
         }
-        class StringSink final : public fiber::json::OutputSink {
-        public:
-            bool write(const char *data, size_t len) override {
-                out.append(data, len);
-                return true;
-            }
-            std::string out;
-        };
-        StringSink sink;
-        fiber::json::Generator gen(sink);
-        fiber::json::Generator::Result result = fiber::json::encode_js_value(gen, context.arg_value(0));
-        if (result != fiber::json::Generator::Result::OK) {
+        fiber::json::BufferSink sink;
+        fiber::json::BufferGenerator gen(sink);
+        fiber::json::GeneratorBase::Result result = fiber::json::encode_js_value(gen, context.raw_arg_value(0));
+        if (result != fiber::json::GeneratorBase::Result::OK) {
             return make_error(context, "error invoke jsonStringify: encode failed");
         }
-        JsValue out = make_heap_string_value(context.runtime(), sink.out);
+        JsValue out = make_heap_string_value(context.runtime(), sink.view());
         if (out.type_ == JsNodeType::Undefined) {
             return make_oom_error(context);
         }
@@ -1974,6 +2053,221 @@ public:
     }
 };
 
+// JSON.validate(value, schema[, allErrors]): the violations as
+// [{path, message}], empty when value conforms. The schema is an object or
+// its JSON text; compiled schemas are cached by text.
+class JsonValidateFunc final : public Library::Function {
+public:
+    FunctionResult call(ExecutionContext &context) override {
+        if (context.arg_count() < 2) {
+            return make_error(context, "error invoke JSON.validate: need value and schema");
+        }
+        std::string text;
+        const JsValue &schema_arg = context.raw_arg_value(1);
+        if (schema_arg.type_ == JsNodeType::HeapString || schema_arg.type_ == JsNodeType::NativeString) {
+            if (!get_utf8_string(schema_arg, text)) {
+                return make_type_error(context, "JSON.validate not support schema ", schema_arg);
+            }
+        } else {
+            fiber::json::BufferSink sink;
+            fiber::json::BufferGenerator gen(sink);
+            if (fiber::json::encode_js_value(gen, schema_arg) != fiber::json::GeneratorBase::Result::OK) {
+                return make_type_error(context, "JSON.validate not support schema ", schema_arg);
+            }
+            text.assign(sink.view());
+        }
+        auto schema = fiber::json::json_schema_cached(text);
+        if (!schema) {
+            std::string message = "invalid schema";
+            if (!schema.error().path.empty()) {
+                message.append(" at ").append(schema.error().path);
+            }
+            message.append(": ").append(schema.error().message);
+            return make_error(context, message);
+        }
+        auto mode = fiber::json::JsonSchema::Mode::FirstError;
+        if (context.arg_count() > 2 && context.arg_value(2).type_ == JsNodeType::Boolean && context.arg_value(2).b) {
+            mode = fiber::json::JsonSchema::Mode::AllErrors;
+        }
+        ScriptRuntime &runtime = context.runtime();
+        std::vector<fiber::json::SchemaViolation> violations;
+        (void)(*schema)->validate(runtime.heap(), context.raw_arg_value(0), mode, &violations);
+
+        JsValue out = JsValue::make_array(runtime.heap(), violations.size());
+        if (out.type_ != JsNodeType::Array) {
+            return make_oom_error(context);
+        }
+        GcRootGuard guard(runtime, &out);
+        auto *arr = reinterpret_cast<GcArray *>(out.gc);
+        for (const auto &violation : violations) {
+            JsValue item = runtime.alloc_with_gc(0, [&]() { return JsValue::make_object(runtime.heap(), 2); });
+            if (item.type_ != JsNodeType::Object || !fiber::json::gc_array_push(&runtime.heap(), arr, item)) {
+                return make_oom_error(context);
+            }
+            auto *obj = reinterpret_cast<GcObject *>(item.gc);
+            for (const auto &[name, value] : {std::pair<std::string_view, std::string_view>{"path", violation.path},
+                                              {"message", violation.message}}) {
+                JsValue value_val = make_heap_string_value(runtime, value);
+                if (value_val.type_ == JsNodeType::Undefined) {
+                    return make_oom_error(context);
+                }
+                GcRootGuard value_guard(runtime, &value_val);
+                auto *key = runtime.alloc_with_gc(name.size(), [&]() {
+                    return fiber::json::gc_new_string(&runtime.heap(), name.data(), name.size());
+                });
+                if (!key || !fiber::json::gc_object_set(&runtime.heap(), obj, key, value_val)) {
+                    return make_oom_error(context);
+                }
+            }
+        }
+        return out;
+    }
+};
+
+// JSON.pointer(value, pointer) / JSON.path(value, path): the value at a JSON
+// Pointer, or undefined, and the array of JSONPath matches. Given an array of
+// pointers or paths, one result per entry in a single call. Compiled queries
+// are cached by text; lazy documents are walked without being parsed whole.
+class JsonQueryFunc final : public Library::Function {
+public:
+    JsonQueryFunc(fiber::json::JsonPath::Syntax syntax, const char *name)
+        : syntax_(syntax), name_(name) {}
+
+    FunctionResult call(ExecutionContext &context) override {
+        if (context.arg_count() < 2) {
+            return make_error(context, std::string("error invoke ") + name_ + ": need value and query");
+        }
+        ScriptRuntime &runtime = context.runtime();
+        const JsValue &root = context.raw_arg_value(0);
+        const JsValue &query_arg = context.raw_arg_value(1);
+        if (query_arg.type_ != JsNodeType::Array) {
+            JsValue out;
+            std::string error;
+            if (!run(context, root, query_arg, out, error)) {
+                return error.empty() ? make_oom_error(context) : make_error(context, error);
+            }
+            return out;
+        }
+        const auto *queries = reinterpret_cast<const GcArray *>(query_arg.gc);
+        JsValue out = runtime.alloc_with_gc(0, [&]() { return JsValue::make_array(runtime.heap(), queries->size); });
+        if (out.type_ != JsNodeType::Array) {
+            return make_oom_error(context);
+        }
+        GcRootGuard guard(runtime, &out);
+        std::string error;
+        for (std::size_t i = 0; i < queries->size; ++i) {
+            JsValue item;
+            if (!run(context, root, fiber::json::gc_array_at(queries, i), item, error)) {
+                return error.empty() ? make_oom_error(context) : make_error(context, error);
+            }
+            if (!fiber::json::gc_array_push(&runtime.heap(), reinterpret_cast<GcArray *>(out.gc), item)) {
+                return make_oom_error(context);
+            }
+        }
+        return out;
+    }
+
+private:
+    fiber::json::JsonPath::Syntax syntax_;
+    const char *name_;
+
+    // On failure error is set for a bad query and left empty when out of
+    // memory.
+    bool run(ExecutionContext &context, const JsValue &root, const JsValue &query_arg, JsValue &out,
+             std::string &error) const {
+        std::string text;
+        if ((query_arg.type_ != JsNodeType::HeapString && query_arg.type_ != JsNodeType::NativeString) ||
+            !get_utf8_string(query_arg, text)) {
+            error.append(name_).append(" not support query ").append(type_name(query_arg.type_));
+            return false;
+        }
+        auto path = fiber::json::json_path_cached(text, syntax_);
+        if (!path) {
+            error = "invalid query at " + std::to_string(path.error().position) + ": " + path.error().message;
+            return false;
+        }
+        fiber::json::GcHeap &heap = context.runtime().heap();
+        if (syntax_ == fiber::json::JsonPath::Syntax::Pointer) {
+            return (*path)->get(heap, root, out);
+        }
+        // Nothing below collects, so the matches need no roots until they
+        // are in the result array.
+        std::vector<JsValue> matches;
+        if (!(*path)->query(heap, root, matches)) {
+            return false;
+        }
+        out = JsValue::make_array(heap, matches.size());
+        if (out.type_ != JsNodeType::Array) {
+            return false;
+        }
+        for (const JsValue &match : matches) {
+            if (!fiber::json::gc_array_push(&heap, reinterpret_cast<GcArray *>(out.gc), match)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// msgpack.encode / cbor.encode: value to binary.
+class BinaryCodecEncodeFunc final : public Library::Function {
+public:
+    BinaryCodecEncodeFunc(fiber::json::BinaryFormat format, const char *name)
+        : format_(format), name_(name) {}
+
+    FunctionResult call(ExecutionContext &context) override {
+        if (context.arg_count() == 0) {
+            return make_error(context, std::string("error invoke ") + name_ + ": empty args");
+        }
+        fiber::json::BufferSink sink;
+        fiber::json::GeneratorBase::Result result =
+            fiber::json::encode_binary(context.runtime().heap(), format_, context.raw_arg_value(0), sink);
+        if (result != fiber::json::GeneratorBase::Result::OK) {
+            return make_error(context, std::string("error invoke ") + name_ + ": encode failed");
+        }
+        JsValue out = make_heap_binary_value(context.runtime(), reinterpret_cast<const std::uint8_t *>(sink.data()),
+                                             sink.size());
+        if (out.type_ == JsNodeType::Undefined) {
+            return make_oom_error(context);
+        }
+        return out;
+    }
+
+private:
+    fiber::json::BinaryFormat format_;
+    const char *name_;
+};
+
+// msgpack.decode / cbor.decode: binary to value.
+class BinaryCodecDecodeFunc final : public Library::Function {
+public:
+    BinaryCodecDecodeFunc(fiber::json::BinaryFormat format, const char *name)
+        : format_(format), name_(name) {}
+
+    FunctionResult call(ExecutionContext &context) override {
+        if (context.arg_count() == 0) {
+            return make_error(context, std::string("error invoke ") + name_ + ": empty args");
+        }
+        const std::uint8_t *data = nullptr;
+        std::size_t len = 0;
+        if (!get_binary_data(context.arg_value(0), data, len)) {
+            return make_type_error(context, std::string(name_) + " not support ", context.arg_value(0));
+        }
+        JsValue out;
+        fiber::json::ParseError error;
+        if (!fiber::json::decode_binary(context.runtime().heap(), format_, data, len, out, error)) {
+            std::string message = std::string("cannot ") + name_ + ": ";
+            message.append(error.message);
+            return make_error(context, message);
+        }
+        return out;
+    }
+
+private:
+    fiber::json::BinaryFormat format_;
+    const char *name_;
+};
+
 class MathFloorFunc final : public Library::Function {
 public:
     FunctionResult call(ExecutionContext &context) override {
@@ -2011,6 +2305,57 @@ public:
     }
 };
 
+// Adds the numbers of an array as a chain of + would, integers overflowing
+// into floats. Packed arrays are summed straight off their payloads.
+class MathSumFunc final : public Library::Function {
+public:
+    FunctionResult call(ExecutionContext &context) override {
+        if (context.arg_count() == 0 || context.arg_value(0).type_ != JsNodeType::Array) {
+            return make_error(context, "math.sum require array of numbers");
+        }
+        auto *arr = reinterpret_cast<const GcArray *>(context.arg_value(0).gc);
+        std::size_t size = arr ? arr->size : 0;
+        if (size == 0) {
+            return JsValue::make_integer(0);
+        }
+        switch (arr->kind) {
+            case GcArrayKind::Int64: {
+                std::int64_t sum = arr->ints[0];
+                for (std::size_t i = 1; i < size; ++i) {
+                    std::int64_t next = 0;
+                    if (__builtin_add_overflow(sum, arr->ints[i], &next)) {
+                        double total = static_cast<double>(sum);
+                        for (; i < size; ++i) {
+                            total += static_cast<double>(arr->ints[i]);
+                        }
+                        return JsValue::make_float(total);
+                    }
+                    sum = next;
+                }
+                return JsValue::make_integer(sum);
+            }
+            case GcArrayKind::Float64: {
+                double total = arr->floats[0];
+                for (std::size_t i = 1; i < size; ++i) {
+                    total += arr->floats[i];
+                }
+                return JsValue::make_float(total);
+            }
+            case GcArrayKind::Values:
+                break;
+        }
+        JsValue total;
+        for (std::size_t i = 0; i < size; ++i) {
+            const JsValue &item = arr->elems[i];
+            if (!is_number_type(item)) {
+                return make_type_error(context, "math.sum require numbers but get ", item);
+            }
+            total = i == 0 ? item : fiber::json::js_binary_op(fiber::json::JsBinaryOp::Add, total, item, nullptr).value;
+        }
+        return total;
+    }
+};
+
 class BinaryBase64EncodeFunc final : public Library::Function {
 public:
     FunctionResult call(ExecutionContext &context) override {
@@ -2221,7 +2566,7 @@ public:
             if (!get_utf8_string(arg, text)) {
                 return make_error(context, "invalid utf-8");
             }
-            auto digest = sha256_digest(reinterpret_cast<const std::uint8_t *>(text.data()), text.size());
+            auto digest = fiber::common::sha256_digest(reinterpret_cast<const std::uint8_t *>(text.data()), text.size());
             std::string hex = hex_encode(digest.data(), digest.size());
             JsValue out = make_heap_string_value(context.runtime(), hex);
             if (out.type_ == JsNodeType::Undefined) {
@@ -2235,7 +2580,7 @@ public:
             if (!get_binary_data(arg, data, len)) {
                 return make_error(context, "invalid binary");
             }
-            auto digest = sha256_digest(data, len);
+            auto digest = fiber::common::sha256_digest(data, len);
             std::string hex = hex_encode(digest.data(), digest.size());
             JsValue out = make_heap_string_value(context.runtime(), hex);
             if (out.type_ == JsNodeType::Undefined) {
@@ -2532,27 +2877,20 @@ public:
         std::string value;
         std::string encoded_key;
         std::string encoded_val;
-        int32_t cursor = obj->head;
-        while (cursor != -1) {
-            const GcObjectEntry &entry = obj->entries[cursor];
-            if (!entry.occupied || !entry.key) {
-                cursor = entry.next_order;
+        for (std::size_t idx = 0; idx < obj->entry_count; ++idx) {
+            const GcObjectEntry &entry = obj->entries[idx];
+            if (!entry.key) {
                 continue;
             }
             key.clear();
             if (!fiber::json::gc_string_to_utf8(entry.key, key)) {
-                cursor = entry.next_order;
                 continue;
             }
             if (entry.value.type_ == JsNodeType::Array) {
                 auto *arr = reinterpret_cast<const GcArray *>(entry.value.gc);
                 if (arr) {
                     for (std::size_t i = 0; i < arr->size; ++i) {
-                        const JsValue *elem = fiber::json::gc_array_get(arr, i);
-                        if (!elem) {
-                            continue;
-                        }
-                        value = jsonutil_to_string(*elem);
+                        value = jsonutil_to_string(fiber::json::gc_array_at(arr, i));
                         url_encode(key, encoded_key);
                         url_encode(value, encoded_val);
                         out.append(encoded_key);
@@ -2570,7 +2908,6 @@ public:
                 out.append(encoded_val);
                 out.push_back('&');
             }
-            cursor = entry.next_order;
         }
         if (!out.empty() && out.back() == '&') {
             out.pop_back();
@@ -2614,10 +2951,21 @@ void register_std_library(StdLibrary &library) {
     static MatchFunc strings_match;
     static SubstringFunc strings_substring;
     static ToStringFunc strings_to_string;
+    static BuilderFunc strings_builder;
+    static AppendFunc strings_append;
     static JsonParseFunc json_parse;
+    static JsonParseLazyFunc json_parse_lazy;
     static JsonStringifyFunc json_stringify;
+    static JsonValidateFunc json_validate;
+    static JsonQueryFunc json_pointer(fiber::json::JsonPath::Syntax::Pointer, "JSON.pointer");
+    static JsonQueryFunc json_path(fiber::json::JsonPath::Syntax::Path, "JSON.path");
+    static BinaryCodecEncodeFunc msgpack_encode(fiber::json::BinaryFormat::MsgPack, "msgpack.encode");
+    static BinaryCodecDecodeFunc msgpack_decode(fiber::json::BinaryFormat::MsgPack, "msgpack.decode");
+    static BinaryCodecEncodeFunc cbor_encode(fiber::json::BinaryFormat::Cbor, "cbor.encode");
+    static BinaryCodecDecodeFunc cbor_decode(fiber::json::BinaryFormat::Cbor, "cbor.decode");
     static MathFloorFunc math_floor;
     static MathAbsFunc math_abs;
+    static MathSumFunc math_sum;
     static BinaryBase64EncodeFunc bin_b64_encode;
     static BinaryBase64DecodeFunc bin_b64_decode;
     static BinaryHexFunc bin_hex;
@@ -2664,10 +3012,21 @@ void register_std_library(StdLibrary &library) {
     library.register_func("strings.match", &strings_match);
     library.register_func("strings.substring", &strings_substring);
     library.register_func("strings.toString", &strings_to_string);
+    library.register_func("strings.builder", &strings_builder);
+    library.register_func("strings.append", &strings_append);
     library.register_func("JSON.parse", &json_parse);
+    library.register_func("JSON.parseLazy", &json_parse_lazy);
     library.register_func("JSON.stringify", &json_stringify);
+    library.register_func("JSON.validate", &json_validate);
+    library.register_func("JSON.pointer", &json_pointer);
+    library.register_func("JSON.path", &json_path);
+    library.register_func("msgpack.encode", &msgpack_encode);
+    library.register_func("msgpack.decode", &msgpack_decode);
+    library.register_func("cbor.encode", &cbor_encode);
+    library.register_func("cbor.decode", &cbor_decode);
     library.register_func("math.floor", &math_floor);
     library.register_func("math.abs", &math_abs);
+    library.register_func("math.sum", &math_sum);
     library.register_func("binary.base64Encode", &bin_b64_encode);
     library.register_func("binary.base64Decode", &bin_b64_decode);
     library.register_func("binary.hex", &bin_hex);
@@ -3,6 +3,7 @@
 #include "common/json/JsGc.h"
 
 using fiber::json::GcArray;
+using fiber::json::GcArrayKind;
 using fiber::json::GcHeap;
 using fiber::json::JsNodeType;
 using fiber::json::JsValue;
@@ -16,21 +17,21 @@ TEST(ArrayTest, PushPopSetGet) {
     EXPECT_TRUE(fiber::json::gc_array_push(&heap, arr, JsValue::make_integer(2)));
     ASSERT_EQ(arr->size, 2u);
 
-    const JsValue *v0 = fiber::json::gc_array_get(arr, 0);
-    ASSERT_NE(v0, nullptr);
+    auto v0 = fiber::json::gc_array_get(arr, 0);
+    ASSERT_TRUE(v0.has_value());
     EXPECT_EQ(v0->type_, JsNodeType::Integer);
     EXPECT_EQ(v0->i, 1);
 
     EXPECT_TRUE(fiber::json::gc_array_set(&heap, arr, 1, JsValue::make_integer(5)));
-    const JsValue *v1 = fiber::json::gc_array_get(arr, 1);
-    ASSERT_NE(v1, nullptr);
+    auto v1 = fiber::json::gc_array_get(arr, 1);
+    ASSERT_TRUE(v1.has_value());
     EXPECT_EQ(v1->type_, JsNodeType::Integer);
     EXPECT_EQ(v1->i, 5);
 
     EXPECT_TRUE(fiber::json::gc_array_set(&heap, arr, 3, JsValue::make_integer(7)));
     EXPECT_EQ(arr->size, 4u);
-    const JsValue *v2 = fiber::json::gc_array_get(arr, 2);
-    ASSERT_NE(v2, nullptr);
+    auto v2 = fiber::json::gc_array_get(arr, 2);
+    ASSERT_TRUE(v2.has_value());
     EXPECT_EQ(v2->type_, JsNodeType::Undefined);
 
     JsValue popped;
@@ -39,7 +40,7 @@ TEST(ArrayTest, PushPopSetGet) {
     EXPECT_EQ(popped.i, 7);
     EXPECT_EQ(arr->size, 3u);
 
-    EXPECT_EQ(fiber::json::gc_array_get(arr, 9), nullptr);
+    EXPECT_FALSE(fiber::json::gc_array_get(arr, 9).has_value());
 }
 
 TEST(ArrayTest, InsertRemove) {
@@ -51,12 +52,12 @@ TEST(ArrayTest, InsertRemove) {
     EXPECT_TRUE(fiber::json::gc_array_push(&heap, arr, JsValue::make_integer(3)));
     EXPECT_TRUE(fiber::json::gc_array_insert(&heap, arr, 1, JsValue::make_integer(2)));
 
-    const JsValue *v0 = fiber::json::gc_array_get(arr, 0);
-    const JsValue *v1 = fiber::json::gc_array_get(arr, 1);
-    const JsValue *v2 = fiber::json::gc_array_get(arr, 2);
-    ASSERT_NE(v0, nullptr);
-    ASSERT_NE(v1, nullptr);
-    ASSERT_NE(v2, nullptr);
+    auto v0 = fiber::json::gc_array_get(arr, 0);
+    auto v1 = fiber::json::gc_array_get(arr, 1);
+    auto v2 = fiber::json::gc_array_get(arr, 2);
+    ASSERT_TRUE(v0.has_value());
+    ASSERT_TRUE(v1.has_value());
+    ASSERT_TRUE(v2.has_value());
     EXPECT_EQ(v0->i, 1);
     EXPECT_EQ(v1->i, 2);
     EXPECT_EQ(v2->i, 3);
@@ -69,9 +70,140 @@ TEST(ArrayTest, InsertRemove) {
 
     EXPECT_TRUE(fiber::json::gc_array_insert(&heap, arr, 10, JsValue::make_integer(4)));
     EXPECT_EQ(arr->size, 3u);
-    const JsValue *v3 = fiber::json::gc_array_get(arr, 2);
-    ASSERT_NE(v3, nullptr);
+    auto v3 = fiber::json::gc_array_get(arr, 2);
+    ASSERT_TRUE(v3.has_value());
     EXPECT_EQ(v3->i, 4);
 
     EXPECT_FALSE(fiber::json::gc_array_remove(arr, 9, nullptr));
 }
+
+TEST(ArrayTest, InlineStorageSpillsAndBlocksAreRecycled) {
+    GcHeap heap;
+    GcArray *arr = fiber::json::gc_new_array(&heap, 2);
+    ASSERT_NE(arr, nullptr);
+    EXPECT_EQ(arr->inline_capacity, 2u);
+    EXPECT_EQ(reinterpret_cast<void *>(arr->elems), reinterpret_cast<void *>(arr + 1));
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(fiber::json::gc_array_push(&heap, arr, JsValue::make_integer(i)));
+    }
+    EXPECT_NE(reinterpret_cast<void *>(arr->elems), reinterpret_cast<void *>(arr + 1));
+    EXPECT_EQ(fiber::json::gc_array_get(arr, 4)->i, 4);
+
+    fiber::json::GcString *str = fiber::json::gc_new_string(&heap, "abc", 3);
+    ASSERT_NE(str, nullptr);
+    EXPECT_EQ(reinterpret_cast<void *>(str->data8), reinterpret_cast<void *>(str + 1));
+    EXPECT_EQ(str->data8[3], 0);
+
+    // Nothing is rooted: once collection reaches them the cells go back to
+    // the free lists and the next cell of the same size class reuses one.
+    void *old_str = str;
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    EXPECT_EQ(heap.head, nullptr);
+    EXPECT_GT(heap.free_bytes, 0u);
+    EXPECT_EQ(static_cast<void *>(fiber::json::gc_new_string(&heap, "xyz", 3)), old_str);
+}
+
+TEST(ArrayTest, PackedArraysWidenOnFirstMixedStore) {
+    GcHeap heap;
+    GcArray *arr = fiber::json::gc_new_packed_array(&heap, 0);
+    ASSERT_NE(arr, nullptr);
+    EXPECT_TRUE(fiber::json::gc_array_push(&heap, arr, JsValue::make_float(0.5)));
+    EXPECT_EQ(arr->kind, GcArrayKind::Float64);
+    JsValue popped;
+    EXPECT_TRUE(fiber::json::gc_array_pop(arr, &popped));
+    EXPECT_EQ(popped.type_, JsNodeType::Float);
+    EXPECT_DOUBLE_EQ(popped.f, 0.5);
+
+    // Empty again, so the first integer retypes it.
+    for (int i = 0; i < 40; ++i) {
+        EXPECT_TRUE(fiber::json::gc_array_push(&heap, arr, JsValue::make_integer(i)));
+    }
+    EXPECT_EQ(arr->kind, GcArrayKind::Int64);
+    EXPECT_EQ(fiber::json::gc_array_get(arr, 0)->i, 0);
+    EXPECT_TRUE(fiber::json::gc_array_insert(&heap, arr, 0, JsValue::make_integer(-1)));
+    JsValue removed;
+    EXPECT_TRUE(fiber::json::gc_array_remove(arr, 10, &removed));
+    EXPECT_EQ(removed.i, 9);
+    EXPECT_TRUE(fiber::json::gc_array_set(&heap, arr, 1, JsValue::make_integer(100)));
+    ASSERT_EQ(arr->size, 40u);
+    EXPECT_EQ(arr->kind, GcArrayKind::Int64);
+    EXPECT_EQ(fiber::json::gc_array_at(arr, 0).i, -1);
+    EXPECT_EQ(fiber::json::gc_array_at(arr, 1).i, 100);
+    EXPECT_EQ(fiber::json::gc_array_at(arr, 10).i, 10);
+    EXPECT_EQ(fiber::json::gc_array_at(arr, 39).i, 39);
+
+    EXPECT_TRUE(fiber::json::gc_array_set(&heap, arr, 2, JsValue::make_float(2.5)));
+    EXPECT_EQ(arr->kind, GcArrayKind::Values);
+    EXPECT_EQ(fiber::json::gc_array_get(arr, 1)->i, 100);
+    EXPECT_DOUBLE_EQ(fiber::json::gc_array_get(arr, 2)->f, 2.5);
+    EXPECT_EQ(fiber::json::gc_array_get(arr, 39)->i, 39);
+    EXPECT_EQ(arr->elems[arr->capacity - 1].type_, JsNodeType::Undefined);
+}
+
+TEST(ArrayTest, InlinePackedArraysWidenInPlace) {
+    GcHeap heap;
+    GcArray *arr = fiber::json::gc_new_packed_array(&heap, 8);
+    ASSERT_NE(arr, nullptr);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(fiber::json::gc_array_push(&heap, arr, JsValue::make_integer(i * 3)));
+    }
+    EXPECT_EQ(reinterpret_cast<void *>(arr->ints), reinterpret_cast<void *>(arr + 1));
+    // A hole can only hold undefined.
+    EXPECT_TRUE(fiber::json::gc_array_set(&heap, arr, 9, JsValue::make_integer(27)));
+    EXPECT_EQ(arr->kind, GcArrayKind::Values);
+    ASSERT_EQ(arr->size, 10u);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(fiber::json::gc_array_get(arr, i)->i, i * 3);
+    }
+    EXPECT_EQ(fiber::json::gc_array_get(arr, 8)->type_, JsNodeType::Undefined);
+
+    GcArray *small = fiber::json::gc_new_packed_array(&heap, 4);
+    ASSERT_NE(small, nullptr);
+    EXPECT_TRUE(fiber::json::gc_array_push(&heap, small, JsValue::make_integer(1)));
+    EXPECT_TRUE(fiber::json::gc_array_push(&heap, small, JsValue::make_integer(2)));
+    EXPECT_TRUE(fiber::json::gc_array_push(&heap, small, JsValue::make_null()));
+    EXPECT_EQ(small->kind, GcArrayKind::Values);
+    EXPECT_EQ(reinterpret_cast<void *>(small->elems), reinterpret_cast<void *>(small + 1));
+    EXPECT_EQ(fiber::json::gc_array_get(small, 0)->i, 1);
+    EXPECT_EQ(fiber::json::gc_array_get(small, 1)->i, 2);
+    EXPECT_EQ(fiber::json::gc_array_get(small, 2)->type_, JsNodeType::Null);
+    EXPECT_EQ(small->elems[3].type_, JsNodeType::Undefined);
+}
+
+TEST(ArrayTest, PackHomogeneousArraysAndSurviveCollection) {
+    GcHeap heap;
+    GcArray *mixed = fiber::json::gc_new_array(&heap, 2);
+    ASSERT_NE(mixed, nullptr);
+    EXPECT_FALSE(fiber::json::gc_array_pack(&heap, mixed));
+    EXPECT_TRUE(fiber::json::gc_array_push(&heap, mixed, JsValue::make_integer(1)));
+    EXPECT_TRUE(fiber::json::gc_array_push(&heap, mixed, JsValue::make_float(1.5)));
+    EXPECT_FALSE(fiber::json::gc_array_pack(&heap, mixed));
+    EXPECT_EQ(mixed->kind, GcArrayKind::Values);
+
+    GcArray *floats = fiber::json::gc_new_array(&heap, 0);
+    ASSERT_NE(floats, nullptr);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(fiber::json::gc_array_push(&heap, floats, JsValue::make_float(i * 0.25)));
+    }
+    EXPECT_TRUE(fiber::json::gc_array_pack(&heap, floats));
+    EXPECT_EQ(floats->kind, GcArrayKind::Float64);
+    JsValue child;
+    child.type_ = JsNodeType::Array;
+    child.gc = &floats->hdr;
+    EXPECT_TRUE(fiber::json::gc_array_set(&heap, mixed, 0, child));
+
+    JsValue root;
+    root.type_ = JsNodeType::Array;
+    root.gc = &mixed->hdr;
+    JsValue *roots[] = {&root};
+    fiber::json::gc_collect(&heap, roots, 1);
+    fiber::json::gc_collect(&heap, roots, 1);
+    ASSERT_EQ(floats->size, 100u);
+    EXPECT_DOUBLE_EQ(fiber::json::gc_array_at(floats, 99).f, 24.75);
+
+    // Unrooted, the packed buffer is returned with its own size.
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    EXPECT_EQ(heap.head, nullptr);
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/json/BinaryCodec.h"
+#include "common/json/JsGc.h"
+#include "common/json/JsValueEncode.h"
+#include "common/json/JsonDecode.h"
+
+using fiber::json::BinaryFormat;
+using fiber::json::BinaryStreamParser;
+using fiber::json::BufferSink;
+using fiber::json::GcHeap;
+using fiber::json::GeneratorBase;
+using fiber::json::JsNodeType;
+using fiber::json::JsValue;
+using fiber::json::ParseError;
+
+namespace {
+
+std::vector<std::uint8_t> from_hex(const std::string &hex) {
+    std::vector<std::uint8_t> out;
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out.push_back(static_cast<std::uint8_t>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+    }
+    return out;
+}
+
+std::string to_hex(const char *data, std::size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (std::size_t i = 0; i < len; ++i) {
+        auto byte = static_cast<std::uint8_t>(data[i]);
+        out += digits[byte >> 4];
+        out += digits[byte & 0x0F];
+    }
+    return out;
+}
+
+std::string encode_hex(GcHeap &heap, BinaryFormat format, const JsValue &value) {
+    BufferSink sink;
+    EXPECT_EQ(fiber::json::encode_binary(heap, format, value, sink), GeneratorBase::Result::OK);
+    return to_hex(sink.data(), sink.size());
+}
+
+// JSON text of the value, binaries as base64.
+std::string to_json(const JsValue &value) {
+    BufferSink sink;
+    fiber::json::BufferGenerator gen(sink);
+    EXPECT_EQ(fiber::json::encode_js_value(gen, value), GeneratorBase::Result::OK);
+    return std::string(sink.view());
+}
+
+JsValue decode_hex(GcHeap &heap, BinaryFormat format, const std::string &hex) {
+    std::vector<std::uint8_t> bytes = from_hex(hex);
+    JsValue out;
+    ParseError error;
+    EXPECT_TRUE(fiber::json::decode_binary(heap, format, bytes.data(), bytes.size(), out, error))
+        << hex << ": " << error.message;
+    return out;
+}
+
+JsValue parse_json(GcHeap &heap, const std::string &text) {
+    fiber::json::Parser parser(heap);
+    JsValue out;
+    EXPECT_TRUE(parser.parse(text, out)) << text;
+    return out;
+}
+
+} // namespace
+
+TEST(BinaryCodecTest, MsgPackIntegerAndLengthForms) {
+    GcHeap heap;
+    struct Case {
+        std::int64_t value;
+        const char *hex;
+    };
+    const Case cases[] = {
+        {0, "00"},
+        {127, "7f"},
+        {128, "cc80"},
+        {256, "cd0100"},
+        {65536, "ce00010000"},
+        {4294967296LL, "cf0000000100000000"},
+        {-1, "ff"},
+        {-32, "e0"},
+        {-33, "d0df"},
+        {-129, "d1ff7f"},
+        {-32769, "d2ffff7fff"},
+        {std::numeric_limits<std::int64_t>::min(), "d38000000000000000"},
+    };
+    for (const Case &c : cases) {
+        EXPECT_EQ(encode_hex(heap, BinaryFormat::MsgPack, JsValue::make_integer(c.value)), c.hex) << c.value;
+        JsValue back = decode_hex(heap, BinaryFormat::MsgPack, c.hex);
+        ASSERT_EQ(back.type_, JsNodeType::Integer);
+        EXPECT_EQ(back.i, c.value);
+    }
+    EXPECT_EQ(encode_hex(heap, BinaryFormat::MsgPack, JsValue::make_float(1.5)), "ca3fc00000");
+    EXPECT_EQ(encode_hex(heap, BinaryFormat::MsgPack, JsValue::make_float(0.1)), "cb3fb999999999999a");
+    EXPECT_EQ(encode_hex(heap, BinaryFormat::MsgPack, parse_json(heap, "{\"a\":[true,null,\"xy\"]}")),
+              "81a16193c3c0a27879");
+    std::string long_text(40, 'z');
+    EXPECT_EQ(encode_hex(heap, BinaryFormat::MsgPack, JsValue::make_string(heap, long_text.data(), 40)).substr(0, 6),
+              "d9287a");
+
+    std::uint8_t raw[] = {1, 2, 3};
+    EXPECT_EQ(encode_hex(heap, BinaryFormat::MsgPack, JsValue::make_binary(heap, raw, 3)), "c403010203");
+    JsValue bin = decode_hex(heap, BinaryFormat::MsgPack, "c403010203");
+    EXPECT_EQ(bin.type_, JsNodeType::HeapBinary);
+}
+
+TEST(BinaryCodecTest, CborMatchesRfcVectors) {
+    GcHeap heap;
+    const std::pair<const char *, const char *> encoded[] = {
+        {"0", "00"},
+        {"23", "17"},
+        {"24", "1818"},
+        {"1000000", "1a000f4240"},
+        {"1000000000000", "1b000000e8d4a51000"},
+        {"-1", "20"},
+        {"-1000", "3903e7"},
+        {"\"a\"", "6161"},
+        {"\"\\u00fc\"", "62c3bc"},
+        {"[1,[2,3],[4,5]]", "8301820203820405"},
+        {"{\"a\":1,\"b\":[2,3]}", "a26161016162820203"},
+        {"[false,true,null]", "83f4f5f6"},
+    };
+    for (const auto &[json, hex] : encoded) {
+        EXPECT_EQ(encode_hex(heap, BinaryFormat::Cbor, parse_json(heap, json)), hex) << json;
+        EXPECT_EQ(to_json(decode_hex(heap, BinaryFormat::Cbor, hex)), to_json(parse_json(heap, json))) << hex;
+    }
+    const std::pair<const char *, const char *> decoded[] = {
+        {"f93c00", "1"},
+        {"f97bff", "65504"},
+        {"f90001", "5.960464477539063e-08"},
+        {"fb3ff199999999999a", "1.1"},
+        {"9fff", "[]"},
+        {"9f018202039f0405ffff", "[1,[2,3],[4,5]]"},
+        {"bf61610161629f0203ffff", "{\"a\":1,\"b\":[2,3]}"},
+        {"7f657374726561646d696e67ff", "\"streaming\""},
+        {"c074323031332d30332d32315432303a30343a30305a", "\"2013-03-21T20:04:00Z\""},
+        {"a201020304", "{\"1\":2,\"3\":4}"},
+    };
+    for (const auto &[hex, json] : decoded) {
+        EXPECT_EQ(to_json(decode_hex(heap, BinaryFormat::Cbor, hex)), json) << hex;
+    }
+    JsValue joined = decode_hex(heap, BinaryFormat::Cbor, "5f42010243030405ff");
+    ASSERT_EQ(joined.type_, JsNodeType::HeapBinary);
+    EXPECT_EQ(reinterpret_cast<const fiber::json::GcBinary *>(joined.gc)->len, 5u);
+}
+
+TEST(BinaryCodecTest, StreamedChunksRoundTrip) {
+    GcHeap heap;
+    std::string text = "{\"id\":123456789,\"name\":\"" + std::string(300, 'n') +
+                       "\",\"tags\":[\"a\",\"\\u00e9\\u65e5\",-7,0.25,1e300],\"nested\":{\"deep\":[[[]],{}]},\"none\":null}";
+    JsValue value = parse_json(heap, text);
+    for (BinaryFormat format : {BinaryFormat::MsgPack, BinaryFormat::Cbor}) {
+        BufferSink sink;
+        ASSERT_EQ(fiber::json::encode_binary(heap, format, value, sink), GeneratorBase::Result::OK);
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(sink.data());
+        for (std::size_t step : {1, 2, 5, 64, 4096}) {
+            BinaryStreamParser parser(heap, format);
+            BinaryStreamParser::Status status = BinaryStreamParser::Status::NeedMore;
+            for (std::size_t at = 0; at < sink.size(); at += step) {
+                status = parser.parse(bytes + at, std::min(step, sink.size() - at));
+                ASSERT_NE(status, BinaryStreamParser::Status::Error) << parser.error().message;
+            }
+            EXPECT_EQ(status, BinaryStreamParser::Status::Complete);
+            EXPECT_EQ(to_json(parser.root()), to_json(value)) << "step " << step;
+        }
+    }
+}
+
+TEST(BinaryCodecTest, RejectsMalformedInput) {
+    GcHeap heap;
+    auto fails = [&](BinaryFormat format, const std::string &hex, const char *message) {
+        std::vector<std::uint8_t> bytes = from_hex(hex);
+        JsValue out;
+        ParseError error;
+        EXPECT_FALSE(fiber::json::decode_binary(heap, format, bytes.data(), bytes.size(), out, error)) << hex;
+        EXPECT_EQ(error.message, message) << hex;
+    };
+    fails(BinaryFormat::MsgPack, "c1", "invalid MessagePack type byte");
+    fails(BinaryFormat::MsgPack, "d40100", "unsupported MessagePack extension");
+    fails(BinaryFormat::MsgPack, "9201", "premature end of input");
+    fails(BinaryFormat::MsgPack, "cd01", "premature end of input");
+    fails(BinaryFormat::MsgPack, "0101", "trailing bytes after value");
+    fails(BinaryFormat::MsgPack, "819001", "map key must be a string or integer");
+    fails(BinaryFormat::MsgPack, "cfffffffffffffffff", "integer overflow");
+    fails(BinaryFormat::MsgPack, "a2c328", "invalid UTF-8 string");
+    fails(BinaryFormat::Cbor, "ff", "unexpected break");
+    fails(BinaryFormat::Cbor, "5f6161ff", "invalid chunk in indefinite-length string");
+    fails(BinaryFormat::Cbor, "1c", "invalid CBOR additional information");
+    fails(BinaryFormat::Cbor, "bf6161ff", "map key without value");
+
+    std::string deep(2 * BinaryStreamParser::kMaxDepth + 2, '9');
+    for (std::size_t i = 1; i < deep.size(); i += 2) {
+        deep[i] = '1';
+    }
+    fails(BinaryFormat::MsgPack, deep, "nesting too deep");
+
+    BufferSink sink;
+    EXPECT_EQ(fiber::json::encode_binary(heap, BinaryFormat::Cbor, JsValue::make_undefined(), sink),
+              GeneratorBase::Result::InvalidValue);
+}
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/json/GcWorkers.h"
+#include "common/json/JsGc.h"
+
+using fiber::json::GcArray;
+using fiber::json::GcHeap;
+using fiber::json::GcObject;
+using fiber::json::JsValue;
+
+namespace {
+
+// A deterministic mix of arrays, objects and strings that share members,
+// with every third top-level value left unrooted.
+std::vector<JsValue> build_graph(GcHeap &heap, std::size_t count) {
+    std::vector<JsValue> values;
+    std::uint64_t seed = 88172645463325252ull;
+    auto next = [&]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        JsValue value;
+        switch (next() % 3) {
+            case 0: {
+                std::string text = "value-" + std::to_string(i);
+                value = JsValue::make_string(heap, text.data(), text.size());
+                break;
+            }
+            case 1: {
+                value = JsValue::make_array(heap, 4);
+                auto *arr = reinterpret_cast<GcArray *>(value.gc);
+                for (int k = 0; k < 4 && !values.empty(); ++k) {
+                    fiber::json::gc_array_push(&heap, arr, values[next() % values.size()]);
+                }
+                break;
+            }
+            default: {
+                value = JsValue::make_object(heap, 2);
+                auto *obj = reinterpret_cast<GcObject *>(value.gc);
+                std::string key = "k" + std::to_string(i % 17);
+                fiber::json::gc_object_set(&heap, obj, fiber::json::gc_new_string(&heap, key.data(), key.size()),
+                                           values.empty() ? JsValue::make_integer(1) : values[next() % values.size()]);
+                break;
+            }
+        }
+        values.push_back(value);
+    }
+    return values;
+}
+
+std::size_t linked_cells(const GcHeap &heap) {
+    std::size_t count = 0;
+    for (const fiber::json::GcHeader *cell = heap.head; cell; cell = cell->next) {
+        ++count;
+    }
+    return count;
+}
+
+std::size_t segment_cells(const GcHeap &heap) {
+    std::size_t count = heap.top_cells;
+    for (const fiber::json::GcSegment &segment : heap.segments) {
+        count += segment.cells;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(CollectTest, DeepNestingMarksIteratively) {
+    GcHeap heap;
+    JsValue root = JsValue::make_array(heap, 1);
+    for (int i = 0; i < 200000; ++i) {
+        JsValue outer = JsValue::make_array(heap, 1);
+        fiber::json::gc_array_push(&heap, reinterpret_cast<GcArray *>(outer.gc), root);
+        root = outer;
+    }
+    std::size_t bytes = heap.bytes;
+    JsValue *roots[] = {&root};
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_EQ(heap.bytes, bytes);
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    EXPECT_EQ(heap.bytes, 0u);
+    EXPECT_EQ(heap.head, nullptr);
+}
+
+TEST(CollectTest, WorkersCollectWhatASingleThreadDoes) {
+    fiber::json::GcWorkers workers(3);
+    EXPECT_EQ(workers.size(), 4u);
+    GcHeap serial;
+    GcHeap parallel;
+    fiber::json::gc_set_workers(parallel, &workers, 0);
+
+    std::vector<JsValue> serial_values;
+    std::vector<JsValue> parallel_values;
+    for (int round = 0; round < 3; ++round) {
+        for (JsValue &value : build_graph(serial, 30000)) {
+            serial_values.push_back(value);
+        }
+        for (JsValue &value : build_graph(parallel, 30000)) {
+            parallel_values.push_back(value);
+        }
+        ASSERT_EQ(serial.bytes, parallel.bytes);
+        std::vector<JsValue *> serial_roots;
+        std::vector<JsValue *> parallel_roots;
+        for (std::size_t i = round; i < serial_values.size(); i += 3) {
+            serial_roots.push_back(&serial_values[i]);
+            parallel_roots.push_back(&parallel_values[i]);
+        }
+        fiber::json::gc_collect(&serial, serial_roots.data(), serial_roots.size());
+        fiber::json::gc_collect(&parallel, parallel_roots.data(), parallel_roots.size());
+        EXPECT_EQ(serial.bytes, parallel.bytes);
+        EXPECT_EQ(linked_cells(parallel), segment_cells(parallel));
+        EXPECT_GT(parallel.segments.size(), 1u);
+
+        // Keep only what this round rooted for the next one.
+        std::vector<JsValue> kept_serial;
+        std::vector<JsValue> kept_parallel;
+        for (std::size_t i = 0; i < serial_roots.size(); ++i) {
+            kept_serial.push_back(*serial_roots[i]);
+            kept_parallel.push_back(*parallel_roots[i]);
+        }
+        serial_values = std::move(kept_serial);
+        parallel_values = std::move(kept_parallel);
+    }
+    fiber::json::gc_collect(&parallel, nullptr, 0);
+    EXPECT_EQ(parallel.bytes, 0u);
+    EXPECT_EQ(parallel.head, nullptr);
+    EXPECT_TRUE(parallel.segments.empty());
+}
+
+TEST(CollectTest, StatsCountKindsPausesAndSurvival) {
+    using fiber::json::GcKind;
+    GcHeap heap;
+    fiber::json::GcStats start = fiber::json::gc_stats(heap);
+    JsValue kept = JsValue::make_array(heap, 10);
+    for (int i = 0; i < 110; ++i) {
+        std::string text = "value-" + std::to_string(i);
+        JsValue value = JsValue::make_string(heap, text.data(), text.size());
+        if (i % 11 == 0) {
+            fiber::json::gc_array_push(&heap, reinterpret_cast<GcArray *>(kept.gc), value);
+        }
+    }
+    fiber::json::GcStats built = fiber::json::gc_stats(heap);
+    fiber::json::GcStats delta = fiber::json::gc_stats_since(start, built);
+    auto kind = [](const fiber::json::GcStats &stats, GcKind kind) {
+        return stats.kinds[static_cast<std::size_t>(kind)];
+    };
+    EXPECT_EQ(kind(delta, GcKind::String).allocated_cells, 110u);
+    EXPECT_EQ(kind(delta, GcKind::Array).allocated_cells, 1u);
+    EXPECT_EQ(delta.allocated, built.bytes);
+    EXPECT_EQ(delta.collections, 0u);
+    EXPECT_EQ(fiber::json::gc_survival_ratio(delta), 0.0);
+    EXPECT_EQ(fiber::json::gc_pause_quantile(delta, 0.5), 0u);
+
+    // Cells survive the collection they were allocated before; the second
+    // one frees the garbage.
+    JsValue *roots[] = {&kept};
+    fiber::json::gc_collect(&heap, roots, 1);
+    fiber::json::GcStats aged = fiber::json::gc_stats(heap);
+    EXPECT_EQ(fiber::json::gc_survival_ratio(aged), 1.0);
+    fiber::json::gc_collect(&heap, roots, 1);
+    fiber::json::GcStats collected = fiber::json::gc_stats(heap);
+    delta = fiber::json::gc_stats_since(aged, collected);
+    EXPECT_EQ(delta.collections, 1u);
+    EXPECT_EQ(delta.allocated, 0u);
+    EXPECT_EQ(kind(delta, GcKind::String).freed_cells, 100u);
+    EXPECT_EQ(kind(delta, GcKind::Array).freed_cells, 0u);
+    EXPECT_EQ(delta.collected_bytes, built.bytes);
+    EXPECT_EQ(delta.survived_bytes, heap.bytes);
+    EXPECT_EQ(collected.peak_bytes, built.bytes);
+    double survival = fiber::json::gc_survival_ratio(delta);
+    EXPECT_GT(survival, 0.0);
+    EXPECT_LT(survival, 0.5);
+    std::size_t pauses = 0;
+    for (std::size_t count : delta.pauses) {
+        pauses += count;
+    }
+    EXPECT_EQ(pauses, 1u);
+    EXPECT_GT(fiber::json::gc_pause_quantile(delta, 1.0), 0u);
+    EXPECT_GE(fiber::json::gc_pause_quantile(delta, 1.0), delta.pause_ns);
+
+    fiber::json::GcStats before;
+    fiber::json::GcStats after;
+    after.taken_ns = 2'000'000'000;
+    after.allocated = 8192;
+    EXPECT_DOUBLE_EQ(fiber::json::gc_allocation_rate(before, after), 4096.0);
+}
+
+TEST(CollectTest, AdaptiveThresholdFollowsSurvival) {
+    GcHeap heap;
+    fiber::json::GcThresholdPolicy policy;
+    policy.adaptive = true;
+    policy.min_threshold = 0;
+    policy.base_growth = 2.0;
+    policy.survival_growth = 4.0;
+    fiber::json::gc_set_threshold_policy(heap, policy);
+
+    JsValue kept = JsValue::make_array(heap, 4);
+    for (int i = 0; i < 4; ++i) {
+        fiber::json::gc_array_push(&heap, reinterpret_cast<GcArray *>(kept.gc), JsValue::make_string(heap, "kept", 4));
+    }
+    JsValue *roots[] = {&kept};
+    // Everything survives: the threshold grows by base + survival growth.
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_EQ(fiber::json::gc_threshold(heap), heap.bytes * 6);
+
+    // Half the heap is garbage once it has aged past one collection.
+    std::size_t live = heap.bytes;
+    while (heap.bytes < 2 * live) {
+        JsValue::make_string(heap, "gone", 4);
+    }
+    std::size_t before = heap.bytes;
+    fiber::json::gc_collect(&heap, roots, 1);
+    ASSERT_EQ(heap.bytes, before);
+    fiber::json::gc_collect(&heap, roots, 1);
+    ASSERT_EQ(heap.bytes, live);
+    double survival = static_cast<double>(live) / static_cast<double>(before);
+    EXPECT_EQ(fiber::json::gc_threshold(heap), static_cast<std::size_t>(static_cast<double>(live) * (2.0 + 4.0 * survival)));
+
+    policy.max_threshold = 64;
+    fiber::json::gc_set_threshold_policy(heap, policy);
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_EQ(fiber::json::gc_threshold(heap), 64u);
+
+    // An empty heap never adapts its threshold down to 0, which would stop
+    // collection altogether.
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    EXPECT_EQ(fiber::json::gc_threshold(heap), 1u);
+}
@@ -4,9 +4,14 @@
 #include <cstdint>
 #include <string>
 
+#include "common/json/JsGc.h"
 #include "common/json/JsonEncode.h"
 
+using fiber::json::BufferGenerator;
+using fiber::json::BufferSink;
 using fiber::json::CallbackSink;
+using fiber::json::GcHeap;
+using fiber::json::GcString;
 using fiber::json::Generator;
 using fiber::json::OutputSink;
 
@@ -118,3 +123,82 @@ TEST(GeneratorTest, BinaryBase64) {
     EXPECT_EQ(gen.binary(data, sizeof(data)), Generator::Result::OK);
     EXPECT_EQ(sink.output, "\"TWFu\"");
 }
+
+TEST(GeneratorTest, BufferSinkMatchesVirtualSink) {
+    auto emit = [](auto &gen) {
+        gen.set_option(Generator::Option::Beauty, true);
+        gen.set_indent_string("  ");
+        EXPECT_EQ(gen.map_open(), Generator::Result::OK);
+        EXPECT_EQ(gen.string("name", 4), Generator::Result::OK);
+        EXPECT_EQ(gen.string("fiber", 5), Generator::Result::OK);
+        EXPECT_EQ(gen.string("list", 4), Generator::Result::OK);
+        EXPECT_EQ(gen.array_open(), Generator::Result::OK);
+        for (int i = 0; i < 200; ++i) {
+            EXPECT_EQ(gen.integer(i), Generator::Result::OK);
+            EXPECT_EQ(gen.double_value(i + 0.5), Generator::Result::OK);
+        }
+        EXPECT_EQ(gen.array_close(), Generator::Result::OK);
+        EXPECT_EQ(gen.map_close(), Generator::Result::OK);
+    };
+    StringSink sink;
+    Generator gen(sink);
+    emit(gen);
+    BufferSink buffer;
+    BufferGenerator buffered(buffer);
+    emit(buffered);
+    EXPECT_EQ(buffer.view(), sink.output);
+    EXPECT_GT(buffer.size(), 2000u);
+}
+
+TEST(GeneratorTest, EscapesInsideLongStrings) {
+    std::string text(40, 'a');
+    text += "\"quote\\slash/\n\t\x01";
+    text += std::string(70, 'b');
+    text += "tail/";
+    std::string expected = "\"" + std::string(40, 'a') + "\\\"quote\\\\slash/\\n\\t\\u0001" +
+                           std::string(70, 'b') + "tail/\"";
+
+    StringSink sink;
+    Generator gen(sink);
+    EXPECT_EQ(gen.string(text), Generator::Result::OK);
+    EXPECT_EQ(sink.output, expected);
+
+    BufferSink buffer;
+    BufferGenerator escaped(buffer);
+    escaped.set_option(Generator::Option::EscapeSolidus, true);
+    EXPECT_EQ(escaped.string(text), Generator::Result::OK);
+    std::string with_solidus;
+    for (std::size_t pos = 0; pos < expected.size(); ++pos) {
+        if (expected[pos] == '/') {
+            with_solidus += '\\';
+        }
+        with_solidus += expected[pos];
+    }
+    EXPECT_EQ(buffer.view(), with_solidus);
+}
+
+TEST(GeneratorTest, EncodesGcStringStorage) {
+    GcHeap heap;
+    std::string latin1 = std::string(20, 'x') + "caf\xC3\xA9 \"ok\"" + std::string(20, 'y');
+    GcString *bytes = fiber::json::gc_new_string(&heap, latin1.data(), latin1.size());
+    std::string wide_text = "\xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x98\x80\t";
+    GcString *wide = fiber::json::gc_new_string(&heap, wide_text.data(), wide_text.size());
+    ASSERT_NE(bytes, nullptr);
+    ASSERT_NE(wide, nullptr);
+
+    BufferSink buffer;
+    BufferGenerator gen(buffer);
+    EXPECT_EQ(gen.array_open(), Generator::Result::OK);
+    EXPECT_EQ(gen.string(bytes), Generator::Result::OK);
+    EXPECT_EQ(gen.string(wide), Generator::Result::OK);
+    EXPECT_EQ(gen.array_close(), Generator::Result::OK);
+    EXPECT_EQ(buffer.view(), "[\"" + std::string(20, 'x') + "caf\xC3\xA9 \\\"ok\\\"" + std::string(20, 'y') +
+                                 "\",\"\xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x98\x80\\t\"]");
+
+    const char16_t lone[] = {u'a', 0xD800, u'b'};
+    GcString *bad = fiber::json::gc_new_string_utf16(&heap, lone, 3);
+    ASSERT_NE(bad, nullptr);
+    StringSink sink;
+    Generator invalid(sink);
+    EXPECT_EQ(invalid.string(bad), Generator::Result::InvalidString);
+}
@@ -92,6 +92,20 @@ TEST(JsValueOpsTest, ConcatHeapAndNative) {
     EXPECT_EQ(string_to_utf8(result.value), expected);
 }
 
+TEST(JsValueOpsTest, NativeStringLengthIsBounded) {
+    char bytes[] = {'a', 'b'};
+    JsValue value = JsValue::make_native_string(bytes, sizeof(bytes));
+    ASSERT_EQ(value.type_, JsNodeType::NativeString);
+    EXPECT_EQ(value.ns().data, bytes);
+    EXPECT_EQ(value.ns().len, 2u);
+
+    JsValue copy = value;
+    EXPECT_EQ(copy.ns().len, 2u);
+    EXPECT_EQ(JsValue::make_native_string(bytes, JsValue::kMaxNativeLength + 1).type_, JsNodeType::Undefined);
+    EXPECT_EQ(JsValue::make_native_binary(reinterpret_cast<std::uint8_t *>(bytes), JsValue::kMaxNativeLength + 1).type_,
+              JsNodeType::Undefined);
+}
+
 TEST(JsValueOpsTest, AddInteger) {
     JsValue lhs = JsValue::make_integer(3);
     JsValue rhs = JsValue::make_integer(4);
@@ -220,3 +234,35 @@ TEST(JsValueOpsTest, CompareInvalidUtf8) {
     auto eq = fiber::json::js_binary_op(JsBinaryOp::Eq, bad, good, nullptr);
     EXPECT_EQ(eq.error, JsOpError::InvalidUtf8);
 }
+
+TEST(JsValueOpsTest, StringSliceSharesParentStorage) {
+    GcHeap heap;
+    std::string text(64, 'a');
+    text += "0123456789abcdefghijklmnopqrstuvwxyz";
+    GcString *parent = fiber::json::gc_new_string(&heap, text.data(), text.size());
+    ASSERT_NE(parent, nullptr);
+
+    GcString *tail = fiber::json::gc_new_string_slice(&heap, parent, 64, 36);
+    ASSERT_NE(tail, nullptr);
+    EXPECT_EQ(tail->owner, &parent->hdr);
+    EXPECT_EQ(tail->data8, parent->data8 + 64);
+    GcString *nested = fiber::json::gc_new_string_slice(&heap, tail, 0, 36);
+    ASSERT_NE(nested, nullptr);
+    EXPECT_EQ(nested->owner, &parent->hdr);
+    GcString *short_slice = fiber::json::gc_new_string_slice(&heap, parent, 64, 4);
+    ASSERT_NE(short_slice, nullptr);
+    EXPECT_EQ(short_slice->owner, nullptr);
+    EXPECT_EQ(fiber::json::gc_new_string_slice(&heap, parent, 90, 20), nullptr);
+
+    JsValue kept;
+    kept.type_ = JsNodeType::HeapString;
+    kept.gc = &nested->hdr;
+    JsValue *roots[] = {&kept};
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_EQ(string_to_utf8(kept), "0123456789abcdefghijklmnopqrstuvwxyz");
+
+    JsValue copy = JsValue::make_string(heap, "0123456789abcdefghijklmnopqrstuvwxyz", 36);
+    auto equal = fiber::json::js_binary_op(JsBinaryOp::StrictEq, kept, copy, &heap);
+    ASSERT_EQ(equal.error, JsOpError::None);
+    EXPECT_TRUE(equal.value.b);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <system_error>
+
+#include "common/json/JsonNumber.h"
+
+using fiber::json::kMaxNumberChars;
+using fiber::json::parse_json_double;
+using fiber::json::parse_json_int64;
+using fiber::json::write_double;
+using fiber::json::write_int64;
+
+namespace {
+
+std::errc parse_double(const std::string &text, double &out) {
+    return parse_json_double(text.data(), text.data() + text.size(), out);
+}
+
+std::errc parse_int(const std::string &text, std::int64_t &out) {
+    return parse_json_int64(text.data(), text.data() + text.size(), out);
+}
+
+std::string int_text(std::int64_t value) {
+    char buf[kMaxNumberChars];
+    return {buf, write_int64(buf, value)};
+}
+
+std::string double_text(double value) {
+    char buf[kMaxNumberChars];
+    return {buf, write_double(buf, value)};
+}
+
+} // namespace
+
+TEST(JsonNumberTest, Int64RangeAndOverflow) {
+    std::int64_t value = 0;
+    EXPECT_EQ(parse_int("0", value), std::errc());
+    EXPECT_EQ(value, 0);
+    EXPECT_EQ(parse_int("-42", value), std::errc());
+    EXPECT_EQ(value, -42);
+    EXPECT_EQ(parse_int("1234567890123", value), std::errc());
+    EXPECT_EQ(value, 1234567890123);
+    EXPECT_EQ(parse_int("9223372036854775807", value), std::errc());
+    EXPECT_EQ(value, std::numeric_limits<std::int64_t>::max());
+    EXPECT_EQ(parse_int("-9223372036854775808", value), std::errc());
+    EXPECT_EQ(value, std::numeric_limits<std::int64_t>::min());
+    EXPECT_EQ(parse_int("9223372036854775808", value), std::errc::result_out_of_range);
+    EXPECT_EQ(parse_int("-9223372036854775809", value), std::errc::result_out_of_range);
+    EXPECT_EQ(parse_int("123456789012345678901234", value), std::errc::result_out_of_range);
+    EXPECT_EQ(parse_int("-", value), std::errc::invalid_argument);
+}
+
+TEST(JsonNumberTest, WriteInt64) {
+    EXPECT_EQ(int_text(0), "0");
+    EXPECT_EQ(int_text(7), "7");
+    EXPECT_EQ(int_text(10), "10");
+    EXPECT_EQ(int_text(-99), "-99");
+    EXPECT_EQ(int_text(100), "100");
+    EXPECT_EQ(int_text(1000000000000000000), "1000000000000000000");
+    EXPECT_EQ(int_text(std::numeric_limits<std::int64_t>::max()), "9223372036854775807");
+    EXPECT_EQ(int_text(std::numeric_limits<std::int64_t>::min()), "-9223372036854775808");
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 10000; ++i) {
+        auto value = static_cast<std::int64_t>(rng() >> (rng() % 64));
+        EXPECT_EQ(int_text(value), std::to_string(value));
+    }
+}
+
+TEST(JsonNumberTest, DoubleMatchesStrtod) {
+    const char *cases[] = {
+        "0.0", "-0.0", "1.5", "-2.25", "0.1", "3.14159", "1e10", "1E-5", "6.02214076e23", "123e30",
+        "9007199254740993.0", "0.30000000000000004", "2.2250738585072014e-308", "4.9e-324",
+        "1.7976931348623157e308", "0.000000000000000000000000001", "123456789012345678901234567890.5",
+        "1e22", "1e23", "5e-22", "8.98846567431158e307",
+    };
+    for (const char *text : cases) {
+        double value = 0;
+        ASSERT_EQ(parse_double(text, value), std::errc()) << text;
+        EXPECT_EQ(value, std::strtod(text, nullptr)) << text;
+        EXPECT_EQ(std::signbit(value), text[0] == '-') << text;
+    }
+    std::mt19937_64 rng(11);
+    for (int i = 0; i < 20000; ++i) {
+        std::string text = std::to_string(rng() % 100000000) + "." + std::to_string(rng() % 1000000);
+        if (i % 3 == 0) {
+            text += "e" + std::to_string(static_cast<int>(rng() % 80) - 40);
+        }
+        double value = 0;
+        ASSERT_EQ(parse_double(text, value), std::errc()) << text;
+        EXPECT_EQ(value, std::strtod(text.c_str(), nullptr)) << text;
+    }
+    double value = 0;
+    EXPECT_EQ(parse_double("1e400", value), std::errc::result_out_of_range);
+    EXPECT_EQ(parse_double("-1e400", value), std::errc::result_out_of_range);
+}
+
+TEST(JsonNumberTest, WriteDoubleIsShortestRoundTrip) {
+    EXPECT_EQ(double_text(0.1), "0.1");
+    EXPECT_EQ(double_text(2.5), "2.5");
+    EXPECT_EQ(double_text(-1.25e-7), "-1.25e-07");
+    EXPECT_EQ(double_text(100.0), "100");
+    std::mt19937_64 rng(3);
+    for (int i = 0; i < 20000; ++i) {
+        std::uint64_t bits = rng();
+        double value = 0;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (!std::isfinite(value)) {
+            continue;
+        }
+        std::string text = double_text(value);
+        double back = 0;
+        ASSERT_EQ(parse_double(text, back), std::errc()) << text;
+        EXPECT_EQ(back, value) << text;
+    }
+}
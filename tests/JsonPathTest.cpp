@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "common/json/JsGc.h"
+#include "common/json/JsonDecode.h"
+#include "common/json/JsonPath.h"
+
+using fiber::json::GcHeap;
+using fiber::json::JsNodeType;
+using fiber::json::JsonPath;
+using fiber::json::JsValue;
+
+namespace {
+
+const char *kStore = R"({
+    "store": {
+        "book": [
+            {"title": "Sayings", "price": 8.95, "tags": ["quotes"]},
+            {"title": "Sword", "price": 12.99, "isbn": "0-553"},
+            {"title": "Moby", "price": 8, "isbn": "0-395"},
+            {"title": "Rings", "price": 22.99}
+        ],
+        "bicycle": {"color": "red", "price": 19.95}
+    },
+    "a/b": 1,
+    "m~n": 2,
+    "": 3
+})";
+
+JsValue parse_json(GcHeap &heap, const std::string &text) {
+    fiber::json::Parser parser(heap);
+    JsValue out;
+    EXPECT_TRUE(parser.parse(text, out)) << text;
+    return out;
+}
+
+JsonPath compile(std::string_view text, JsonPath::Syntax syntax = JsonPath::Syntax::Path) {
+    auto path = JsonPath::compile(text, syntax);
+    EXPECT_TRUE(path.has_value()) << text << ": " << (path ? "" : path.error().message);
+    return std::move(*path);
+}
+
+std::string text_of(const JsValue &value) {
+    std::string out;
+    EXPECT_EQ(value.type_, JsNodeType::HeapString);
+    EXPECT_TRUE(fiber::json::gc_string_to_utf8(reinterpret_cast<const fiber::json::GcString *>(value.gc), out));
+    return out;
+}
+
+std::vector<std::string> titles(GcHeap &heap, const JsValue &root, std::string_view query) {
+    JsonPath path = compile(query);
+    std::vector<JsValue> matches;
+    EXPECT_TRUE(path.query(heap, root, matches));
+    JsonPath title = compile("$.title");
+    std::vector<std::string> out;
+    for (const JsValue &match : matches) {
+        JsValue value;
+        EXPECT_TRUE(title.get(heap, match, value));
+        out.push_back(text_of(value));
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(JsonPathTest, PointerResolvesEscapesAndIndices) {
+    GcHeap heap;
+    JsValue root = parse_json(heap, kStore);
+    auto at = [&](std::string_view pointer) {
+        JsonPath path = compile(pointer, JsonPath::Syntax::Pointer);
+        EXPECT_TRUE(path.singular());
+        JsValue out;
+        EXPECT_TRUE(path.get(heap, root, out));
+        return out;
+    };
+    EXPECT_EQ(at("").type_, JsNodeType::Object);
+    EXPECT_EQ(text_of(at("/store/book/1/title")), "Sword");
+    EXPECT_EQ(at("/a~1b").i, 1);
+    EXPECT_EQ(at("/m~0n").i, 2);
+    EXPECT_EQ(at("/").i, 3);
+    EXPECT_EQ(at("/store/book/4").type_, JsNodeType::Undefined);
+    EXPECT_EQ(at("/store/book/01").type_, JsNodeType::Undefined);
+    EXPECT_EQ(at("/store/missing/0").type_, JsNodeType::Undefined);
+}
+
+TEST(JsonPathTest, PathMembersWildcardsAndIndices) {
+    GcHeap heap;
+    JsValue root = parse_json(heap, kStore);
+    EXPECT_EQ(titles(heap, root, "$.store.book[*]"), (std::vector<std::string>{"Sayings", "Sword", "Moby", "Rings"}));
+    EXPECT_EQ(titles(heap, root, "$['store'][\"book\"][-1]"), (std::vector<std::string>{"Rings"}));
+
+    JsonPath prices = compile("$.store.*.price");
+    EXPECT_FALSE(prices.singular());
+    std::vector<JsValue> matches;
+    ASSERT_TRUE(prices.query(heap, root, matches));
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_DOUBLE_EQ(matches[0].f, 19.95);
+
+    JsValue first;
+    ASSERT_TRUE(compile("$.store.book[*].isbn").get(heap, root, first));
+    EXPECT_EQ(text_of(first), "0-553");
+}
+
+TEST(JsonPathTest, FiltersCompareAndCombine) {
+    GcHeap heap;
+    JsValue root = parse_json(heap, kStore);
+    EXPECT_EQ(titles(heap, root, "$.store.book[?(@.price < 10)]"), (std::vector<std::string>{"Sayings", "Moby"}));
+    EXPECT_EQ(titles(heap, root, "$.store.book[?@.isbn]"), (std::vector<std::string>{"Sword", "Moby"}));
+    EXPECT_EQ(titles(heap, root, "$.store.book[?(!@.isbn && @.price > 9)]"), (std::vector<std::string>{"Rings"}));
+    EXPECT_EQ(titles(heap, root, "$.store.book[?(@.title == 'Moby' || @.tags[0] == \"quotes\")]"),
+              (std::vector<std::string>{"Sayings", "Moby"}));
+    EXPECT_EQ(titles(heap, root, "$.store.book[?(@.price >= 8 && @.price != 8.95)]"),
+              (std::vector<std::string>{"Sword", "Moby", "Rings"}));
+    EXPECT_EQ(titles(heap, root, "$.store.book[?(@.title > 'S')]"), (std::vector<std::string>{"Sayings", "Sword"}));
+    // Mismatched types never order.
+    EXPECT_TRUE(titles(heap, root, "$.store.book[?(@.title < 5)]").empty());
+}
+
+TEST(JsonPathTest, LazyDocumentsAreWalkedInPlace) {
+    GcHeap heap;
+    fiber::json::Parser parser(heap);
+    JsValue root;
+    ASSERT_TRUE(parser.parse_lazy(std::string(kStore), root));
+    ASSERT_EQ(root.type_, JsNodeType::LazyJson);
+    auto *lazy = reinterpret_cast<fiber::json::GcLazyJson *>(root.gc);
+
+    JsValue title;
+    ASSERT_TRUE(compile("/store/book/2/title", JsonPath::Syntax::Pointer).get(heap, root, title));
+    EXPECT_EQ(text_of(title), "Moby");
+    EXPECT_EQ(lazy->forced.type_, JsNodeType::Undefined);
+
+    EXPECT_EQ(titles(heap, root, "$.store.book[?(@.price > 20)]"), (std::vector<std::string>{"Rings"}));
+    EXPECT_EQ(lazy->forced.type_, JsNodeType::Undefined);
+}
+
+TEST(JsonPathTest, CompileErrorsReportPosition) {
+    auto error = [](std::string_view text, JsonPath::Syntax syntax = JsonPath::Syntax::Path) {
+        auto path = JsonPath::compile(text, syntax);
+        EXPECT_FALSE(path.has_value()) << text;
+        return path ? fiber::json::PathError{} : path.error();
+    };
+    EXPECT_EQ(error("a/b", JsonPath::Syntax::Pointer).message, "pointer must start with /");
+    EXPECT_EQ(error("/a~2", JsonPath::Syntax::Pointer).message, "invalid ~ escape");
+    EXPECT_EQ(error("store").message, "path must start with $");
+    EXPECT_EQ(error("$..book").message, "recursive descent is not supported");
+    EXPECT_EQ(error("$.book[0,1]").message, "unions are not supported");
+    EXPECT_EQ(error("$.book[0:2]").message, "slices are not supported");
+    auto unclosed = error("$.book[?(@.price < 10]");
+    EXPECT_EQ(unclosed.message, "expected )");
+    EXPECT_EQ(unclosed.position, 21u);
+    for (const char *filter : {"$[?(@.a == 1e)]", "$[?(@.a == 1.)]", "$[?(@.a == 1e-)]", "$[?(@.a == 1.e5)]",
+                               "$[?(@.a == 01.5)]", "$[?(@.a == -)]"}) {
+        auto bad = error(filter);
+        EXPECT_EQ(bad.message, "invalid number") << filter;
+        EXPECT_EQ(bad.position, 11u) << filter;
+    }
+    EXPECT_TRUE(JsonPath::compile("$[?(@.a == -0.5e+3 || @.a == 10 || @.a == 2E-1)]", JsonPath::Syntax::Path));
+
+    auto cached = fiber::json::json_path_cached("$.a", JsonPath::Syntax::Path);
+    ASSERT_TRUE(cached.has_value());
+    EXPECT_EQ(cached->get(), fiber::json::json_path_cached("$.a", JsonPath::Syntax::Path)->get());
+    EXPECT_NE(cached->get(), fiber::json::json_path_cached("$.a", JsonPath::Syntax::Pointer).value_or(nullptr).get());
+}
@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common/json/JsGc.h"
+#include "common/json/JsonDecode.h"
+#include "common/json/JsonSchema.h"
+
+using fiber::json::GcHeap;
+using fiber::json::JsonSchema;
+using fiber::json::JsValue;
+using fiber::json::SchemaStreamValidator;
+using fiber::json::SchemaViolation;
+using fiber::json::StreamParser;
+
+namespace {
+
+const char *kOrderSchema = R"({
+    "$defs": {
+        "sku": {"type": "string", "pattern": "^[A-Z]{3}-[0-9]+$"},
+        "line": {
+            "type": "object",
+            "required": ["sku", "qty"],
+            "properties": {
+                "sku": {"$ref": "#/$defs/sku"},
+                "qty": {"type": "integer", "minimum": 1, "maximum": 100},
+                "price": {"type": "number", "exclusiveMinimum": 0, "multipleOf": 0.01}
+            },
+            "additionalProperties": false
+        }
+    },
+    "type": "object",
+    "required": ["id", "lines"],
+    "properties": {
+        "id": {"type": "string", "minLength": 4, "maxLength": 8},
+        "status": {"enum": ["open", "paid", null]},
+        "lines": {"type": "array", "items": {"$ref": "#/$defs/line"}, "minItems": 1, "maxItems": 3},
+        "note": {"anyOf": [{"type": "string"}, {"type": "null"}]},
+        "tags": {"type": "array", "prefixItems": [{"const": "v1"}], "items": {"type": "string"}}
+    },
+    "patternProperties": {"^x-": {"type": "string"}},
+    "additionalProperties": {"not": {"type": "object"}}
+})";
+
+JsValue parse_json(GcHeap &heap, const std::string &text) {
+    fiber::json::Parser parser(heap);
+    JsValue out;
+    EXPECT_TRUE(parser.parse(text, out)) << text;
+    return out;
+}
+
+std::vector<SchemaViolation> check(const JsonSchema &schema, const std::string &text,
+                                   JsonSchema::Mode mode = JsonSchema::Mode::AllErrors) {
+    GcHeap heap;
+    std::vector<SchemaViolation> out;
+    bool valid = schema.validate(heap, parse_json(heap, text), mode, &out);
+    EXPECT_EQ(valid, out.empty()) << text;
+    return out;
+}
+
+// Violations as lines; the stream validator reports checks that need the
+// whole container when it closes, so comparisons across the two sort them.
+std::string describe(const std::vector<SchemaViolation> &violations, bool sorted = false) {
+    std::vector<std::string> lines;
+    for (const auto &violation : violations) {
+        lines.push_back((violation.path.empty() ? "(root)" : violation.path) + ": " + violation.message + "\n");
+    }
+    if (sorted) {
+        std::sort(lines.begin(), lines.end());
+    }
+    std::string out;
+    for (const auto &line : lines) {
+        out += line;
+    }
+    return out;
+}
+
+// The stream validator's violations for text fed in chunks of step bytes.
+std::vector<SchemaViolation> stream_check(const JsonSchema &schema, const std::string &text, std::size_t step,
+                                          JsonSchema::Mode mode = JsonSchema::Mode::AllErrors) {
+    GcHeap heap;
+    SchemaStreamValidator validator(schema, mode);
+    StreamParser parser(heap);
+    parser.set_handler(&validator);
+    StreamParser::Status status = StreamParser::Status::NeedMore;
+    for (std::size_t at = 0; at < text.size() && status != StreamParser::Status::Error; at += step) {
+        status = parser.parse(text.data() + at, std::min(step, text.size() - at));
+    }
+    if (status != StreamParser::Status::Error) {
+        status = parser.finish();
+    }
+    if (mode == JsonSchema::Mode::FirstError) {
+        EXPECT_EQ(status == StreamParser::Status::Complete, validator.valid()) << text;
+    } else {
+        EXPECT_EQ(status, StreamParser::Status::Complete) << text;
+    }
+    EXPECT_EQ(parser.root().type_, fiber::json::JsNodeType::Undefined);
+    return validator.violations();
+}
+
+} // namespace
+
+TEST(JsonSchemaTest, ValidatesOrderDocuments) {
+    auto schema = JsonSchema::compile(kOrderSchema);
+    ASSERT_TRUE(schema) << schema.error().path << ": " << schema.error().message;
+    EXPECT_TRUE(schema->streamable());
+
+    EXPECT_EQ(describe(check(*schema, R"({"id":"A-17","lines":[{"sku":"ABC-1","qty":2,"price":9.99}],
+                                        "status":null,"note":"leave at door","tags":["v1","gift"],
+                                        "x-trace":"abc","extra":[1,2]})")),
+              "");
+    EXPECT_EQ(describe(check(*schema, R"({"id":"A1","lines":[]})")),
+              "/id: string is shorter than 4 characters\n/lines: array has fewer than 1 items\n");
+    EXPECT_EQ(describe(check(*schema, R"({"lines":[{"sku":"abc-1","qty":0.5,"price":0,"gift":true}]})")),
+              "(root): missing required property \"id\"\n"
+              "/lines/0/sku: string does not match pattern ^[A-Z]{3}-[0-9]+$\n"
+              "/lines/0/qty: expected integer\n"
+              "/lines/0/qty: value is less than 1\n"
+              "/lines/0/price: value is not greater than 0\n"
+              "/lines/0: property \"gift\" is not allowed\n");
+    EXPECT_EQ(describe(check(*schema, R"({"id":"B-200","lines":[{"sku":"XYZ-9","qty":1,"price":1.005}],
+                                        "status":"lost","note":7,"tags":["v2",3],"x-a":1,"extra":{}})")),
+              "/lines/0/price: value is not a multiple of 0.01\n"
+              "/status: value is not one of the enum values\n"
+              "/note: value does not match any anyOf schema\n"
+              "/tags/0: value does not equal const\n"
+              "/tags/1: expected string\n"
+              "/x-a: expected string\n"
+              "/extra: value matches the not schema\n");
+    EXPECT_EQ(describe(check(*schema, "[]")), "(root): expected object\n");
+
+    // FirstError stops at the first violation.
+    EXPECT_EQ(describe(check(*schema, R"({"id":"A1","lines":[]})", JsonSchema::Mode::FirstError)),
+              "/id: string is shorter than 4 characters\n");
+    GcHeap heap;
+    EXPECT_FALSE(schema->validate(heap, parse_json(heap, R"({"id":"A1"})")));
+}
+
+TEST(JsonSchemaTest, RecursiveRefsAndBranches) {
+    auto schema = JsonSchema::compile(R"({
+        "$defs": {"node": {"type": "object", "required": ["v"], "properties": {
+            "v": {"oneOf": [{"type": "integer"}, {"type": "number", "minimum": 10}]},
+            "kids": {"type": "array", "items": {"$ref": "#/$defs/node"}}}}},
+        "$ref": "#/$defs/node"
+    })");
+    ASSERT_TRUE(schema) << schema.error().message;
+    EXPECT_EQ(describe(check(*schema, R"({"v":1,"kids":[{"v":12.5,"kids":[{"v":3},{"w":1}]}]})")),
+              "/kids/0/kids/1: missing required property \"v\"\n");
+    // 12 is both an integer and a number >= 10.
+    EXPECT_EQ(describe(check(*schema, R"({"v":12})")), "/v: value matches more than one oneOf schema\n");
+    EXPECT_EQ(describe(check(*schema, R"({"v":12.5})")), "");
+    EXPECT_EQ(describe(check(*schema, R"({"v":"x"})")), "/v: value does not match any oneOf schema\n");
+
+    auto looping = JsonSchema::compile(R"({"$defs":{"a":{"$ref":"#/$defs/a"}},"$ref":"#/$defs/a"})");
+    ASSERT_TRUE(looping);
+    EXPECT_NE(describe(check(*looping, "1")).find("schema nesting too deep"), std::string::npos);
+}
+
+TEST(JsonSchemaTest, UnicodeLengthsKeysAndUniqueItems) {
+    auto schema = JsonSchema::compile(R"({
+        "properties": {"näme": {"maxLength": 2}, "a/b~c": {"const": "日"}},
+        "additionalProperties": false,
+        "patternProperties": {"^é": true},
+        "propertyNames": "ignored annotation",
+        "maxProperties": 3
+    })");
+    ASSERT_TRUE(schema) << schema.error().message;
+    // Two code points, one a surrogate pair.
+    EXPECT_EQ(describe(check(*schema, R"({"näme":"a😀","a/b~c":"日","été":1})")), "");
+    EXPECT_EQ(describe(check(*schema, R"({"näme":"abc","a/b~c":"x","zz":1,"é":2})")),
+              "(root): object has more than 3 properties\n"
+              "/n\xc3\xa4me: string is longer than 2 characters\n"
+              "/a~1b~0c: value does not equal const\n"
+              "(root): property \"zz\" is not allowed\n");
+
+    auto unique = JsonSchema::compile(R"({"uniqueItems": true})");
+    ASSERT_TRUE(unique);
+    EXPECT_FALSE(unique->streamable());
+    EXPECT_EQ(describe(check(*unique, R"([1,{"a":[1.0]},"x",{"a":[1]}])")), "(root): items 1 and 3 are equal\n");
+    EXPECT_EQ(describe(check(*unique, R"([1,"1",[1],{"a":1}])")), "");
+}
+
+TEST(JsonSchemaTest, RejectsUnsupportedSchemas) {
+    auto fails = [](const char *text, const char *path, const char *message) {
+        auto schema = JsonSchema::compile(text);
+        ASSERT_FALSE(schema) << text;
+        EXPECT_EQ(schema.error().path, path) << text;
+        EXPECT_EQ(schema.error().message, message) << text;
+    };
+    fails("3", "", "schema must be an object or a boolean");
+    fails(R"({"type":"int"})", "/type", "unknown type");
+    fails(R"({"properties":{"a":{"minLength":-1}}})", "/properties/a/minLength", "must be a non-negative integer");
+    fails(R"({"items":{"pattern":"(a"}})", "/items/pattern", "invalid pattern: missing ')'");
+    fails(R"({"$ref":"other.json#/x"})", "/$ref", "unsupported reference other.json#/x");
+    fails(R"({"const":[1]})", "/const", "only scalar values are supported");
+    fails(R"({"anyOf":[]})", "/anyOf", "must be a non-empty array");
+    fails("{", "", "invalid JSON: unexpected end of input");
+
+    auto anything = JsonSchema::compile("true");
+    ASSERT_TRUE(anything);
+    EXPECT_EQ(describe(check(*anything, R"({"a":[1]})")), "");
+    auto nothing = JsonSchema::compile("false");
+    ASSERT_TRUE(nothing);
+    EXPECT_EQ(describe(check(*nothing, "null")), "(root): value is not allowed\n");
+}
+
+TEST(JsonSchemaTest, StreamValidatorMatchesTree) {
+    auto schema = JsonSchema::compile(kOrderSchema);
+    ASSERT_TRUE(schema);
+    const char *documents[] = {
+        R"({"id":"A-17","lines":[{"sku":"ABC-1","qty":2,"price":9.99}],"status":null,"tags":["v1","gift"]})",
+        R"({"id":"A1","lines":[]})",
+        R"({"lines":[{"sku":"abc-1","qty":0.5,"price":0,"gift":true}]})",
+        R"({"id":"B-200","lines":[{"sku":"XYZ-9","qty":1,"price":1.005}],"status":"lost","note":7,
+            "tags":["v2",3],"x-a":1,"extra":{}})",
+        R"({"id":"C-300","lines":[{"sku":"XYZ-9","qty":1},{"sku":"XYZ-9","qty":1},{"sku":"XYZ-9","qty":1},
+            {"sku":"XYZ-9","qty":1}],"note":null})",
+        "[]",
+    };
+    for (const char *text : documents) {
+        std::string expected = describe(check(*schema, text), true);
+        for (std::size_t step : {1, 3, 7, 4096}) {
+            EXPECT_EQ(describe(stream_check(*schema, text, step), true), expected) << text << " step " << step;
+        }
+    }
+
+    auto tree = JsonSchema::compile(R"({"$defs": {"node": {"type": "object", "required": ["v"], "properties": {
+        "v": {"oneOf": [{"type": "integer"}, {"type": "number", "minimum": 10}], "not": {"const": 7}},
+        "kids": {"type": "array", "items": {"$ref": "#/$defs/node"}}}}}, "$ref": "#/$defs/node"})");
+    ASSERT_TRUE(tree);
+    for (const char *text : {R"({"v":1,"kids":[{"v":12.5,"kids":[{"v":3},{"w":1},{"v":7}]},{"v":12}]})",
+                             R"({"v":"x","kids":[{"v":2.5}]})"}) {
+        std::string expected = describe(check(*tree, text), true);
+        EXPECT_EQ(describe(stream_check(*tree, text, 2), true), expected) << text;
+    }
+
+    // FirstError stops the parse at the offending value.
+    std::vector<SchemaViolation> first =
+        stream_check(*schema, R"({"id":"A1","lines":[]})", 5, JsonSchema::Mode::FirstError);
+    EXPECT_EQ(describe(first), "/id: string is shorter than 4 characters\n");
+
+    auto unique = JsonSchema::compile(R"({"uniqueItems": true})");
+    ASSERT_TRUE(unique);
+    EXPECT_EQ(describe(stream_check(*unique, "[1,2]", 4096, JsonSchema::Mode::FirstError)),
+              "(root): uniqueItems cannot be checked while streaming\n");
+}
+
+TEST(JsonSchemaTest, ValidatesLazyDocuments) {
+    auto schema = fiber::json::json_schema_cached(kOrderSchema);
+    ASSERT_TRUE(schema);
+    EXPECT_EQ(fiber::json::json_schema_cached(kOrderSchema).value(), *schema);
+    GcHeap heap;
+    fiber::json::Parser parser(heap);
+    JsValue lazy;
+    ASSERT_TRUE(parser.parse_lazy(std::string(R"({"id":"A-17","lines":[{"sku":"ABC-1","qty":200}]})"), lazy));
+    ASSERT_EQ(lazy.type_, fiber::json::JsNodeType::LazyJson);
+    std::vector<SchemaViolation> out;
+    EXPECT_FALSE((*schema)->validate(heap, lazy, JsonSchema::Mode::AllErrors, &out));
+    EXPECT_EQ(describe(out), "/lines/0/qty: value is greater than 100\n");
+}
@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "common/json/JsGc.h"
+
+using fiber::json::GcHeap;
+using fiber::json::GcIterator;
+using fiber::json::GcIteratorMode;
+using fiber::json::GcObject;
+using fiber::json::GcString;
+using fiber::json::JsValue;
+
+namespace {
+
+GcString *make_key(GcHeap &heap, const std::string &text) {
+    return fiber::json::gc_new_string(&heap, text.data(), text.size());
+}
+
+std::vector<std::string> keys_of(const GcObject *obj) {
+    std::vector<std::string> out;
+    for (std::size_t i = 0; i < obj->size; ++i) {
+        const fiber::json::GcObjectEntry *entry = fiber::json::gc_object_entry_at(obj, i);
+        std::string key;
+        EXPECT_TRUE(entry && fiber::json::gc_string_to_utf8(entry->key, key));
+        out.push_back(key);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(ObjectTest, GrowsPastInlineStorageAndKeepsOrder) {
+    GcHeap heap;
+    GcObject *obj = fiber::json::gc_new_object(&heap, 4);
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(obj->inline_capacity, 4u);
+    EXPECT_EQ(reinterpret_cast<void *>(obj->entries), reinterpret_cast<void *>(obj + 1));
+    std::vector<GcString *> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(make_key(heap, "k" + std::to_string(i)));
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, keys.back(), JsValue::make_integer(i)));
+    }
+    EXPECT_EQ(obj->size, 1000u);
+    EXPECT_GE(obj->slot_count - obj->slot_count / 8, obj->size);
+    for (int i = 0; i < 1000; ++i) {
+        // A different cell with the same text finds the member.
+        const JsValue *found = fiber::json::gc_object_get(obj, make_key(heap, "k" + std::to_string(i)));
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(found->i, i);
+    }
+    EXPECT_EQ(fiber::json::gc_object_get(obj, make_key(heap, "k1000")), nullptr);
+
+    ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, keys[0], JsValue::make_integer(-1)));
+    EXPECT_EQ(obj->size, 1000u);
+    EXPECT_EQ(fiber::json::gc_object_entry_at(obj, 0)->value.i, -1);
+    EXPECT_EQ(fiber::json::gc_object_entry_at(obj, 999)->key, keys[999]);
+}
+
+TEST(ObjectTest, RemoveLeavesTombstonesUntilCompaction) {
+    GcHeap heap;
+    GcObject *obj = fiber::json::gc_new_object(&heap, 0);
+    ASSERT_NE(obj, nullptr);
+    std::vector<GcString *> keys;
+    for (int i = 0; i < 8; ++i) {
+        keys.push_back(make_key(heap, std::string(1, static_cast<char>('a' + i))));
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, keys.back(), JsValue::make_integer(i)));
+    }
+    EXPECT_TRUE(fiber::json::gc_object_remove(obj, keys[1]));
+    EXPECT_FALSE(fiber::json::gc_object_remove(obj, keys[1]));
+    EXPECT_TRUE(fiber::json::gc_object_remove(obj, keys[3]));
+    EXPECT_EQ(obj->size, 6u);
+    EXPECT_EQ(obj->entry_count, 8u);
+    EXPECT_EQ(keys_of(obj), (std::vector<std::string>{"a", "c", "e", "f", "g", "h"}));
+
+    // Trailing tombstones are trimmed at once.
+    EXPECT_TRUE(fiber::json::gc_object_remove(obj, keys[7]));
+    EXPECT_EQ(obj->entry_count, 7u);
+
+    // Once tombstones outnumber members the entries are compacted in place.
+    EXPECT_TRUE(fiber::json::gc_object_remove(obj, keys[0]));
+    EXPECT_TRUE(fiber::json::gc_object_remove(obj, keys[4]));
+    EXPECT_EQ(obj->size, 3u);
+    EXPECT_EQ(obj->entry_count, 3u);
+    EXPECT_EQ(keys_of(obj), (std::vector<std::string>{"c", "f", "g"}));
+    EXPECT_EQ(fiber::json::gc_object_get(obj, keys[6])->i, 6);
+    EXPECT_EQ(fiber::json::gc_object_get(obj, keys[0]), nullptr);
+
+    // A removed key comes back at the end.
+    ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, keys[0], JsValue::make_integer(10)));
+    EXPECT_EQ(keys_of(obj), (std::vector<std::string>{"c", "f", "g", "a"}));
+}
+
+TEST(ObjectTest, FullHashCollisionsStillCompareKeys) {
+    GcHeap heap;
+    GcObject *obj = fiber::json::gc_new_object(&heap, 0);
+    ASSERT_NE(obj, nullptr);
+    // Probes trust a matching stored hash up to the character check, so force
+    // every key onto one hash.
+    auto colliding = [&](const std::string &text) {
+        GcString *key = make_key(heap, text);
+        key->hash = 0x5EED;
+        key->hash_valid = true;
+        return key;
+    };
+    for (int i = 0; i < 20; ++i) {
+        GcString *key = colliding("c" + std::to_string(i));
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, key, JsValue::make_integer(i)));
+    }
+    EXPECT_EQ(obj->size, 20u);
+    for (int i = 0; i < 20; ++i) {
+        const JsValue *found = fiber::json::gc_object_get(obj, colliding("c" + std::to_string(i)));
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(found->i, i);
+    }
+    EXPECT_EQ(fiber::json::gc_object_get(obj, colliding("c20")), nullptr);
+    EXPECT_TRUE(fiber::json::gc_object_remove(obj, colliding("c0")));
+    EXPECT_EQ(fiber::json::gc_object_get(obj, colliding("c0")), nullptr);
+    EXPECT_EQ(fiber::json::gc_object_get(obj, colliding("c19"))->i, 19);
+}
+
+TEST(ObjectTest, ChurnReusesTableAndIteratorSkipsRemoved) {
+    GcHeap heap;
+    GcObject *obj = fiber::json::gc_new_object(&heap, 8);
+    ASSERT_NE(obj, nullptr);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, make_key(heap, std::to_string(i)), JsValue::make_integer(i)));
+    }
+    GcIterator *iter = fiber::json::gc_new_object_iterator(&heap, obj, GcIteratorMode::Values);
+    ASSERT_NE(iter, nullptr);
+    JsValue out;
+    bool done = false;
+    ASSERT_TRUE(fiber::json::gc_iterator_next(&heap, iter, out, done));
+    EXPECT_EQ(out.i, 0);
+
+    // Delete every other member while iterating; the removed ones are not
+    // visited.
+    for (int i = 1; i < 8; i += 2) {
+        EXPECT_TRUE(fiber::json::gc_object_remove(obj, make_key(heap, std::to_string(i))));
+    }
+    std::vector<std::int64_t> seen;
+    while (true) {
+        ASSERT_TRUE(fiber::json::gc_iterator_next(&heap, iter, out, done));
+        if (done) {
+            break;
+        }
+        seen.push_back(out.i);
+    }
+    EXPECT_EQ(seen, (std::vector<std::int64_t>{2, 4, 6}));
+
+    // Insert/remove churn at a fixed size stays in the inline table.
+    const std::uint8_t *ctrl = obj->ctrl;
+    for (int i = 100; i < 1100; ++i) {
+        GcString *key = make_key(heap, std::to_string(i));
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, key, JsValue::make_integer(i)));
+        ASSERT_TRUE(fiber::json::gc_object_remove(obj, key));
+    }
+    EXPECT_EQ(obj->ctrl, ctrl);
+    EXPECT_EQ(obj->slot_count, fiber::json::kGcObjectGroupWidth);
+    EXPECT_EQ(obj->size, 4u);
+    EXPECT_EQ(fiber::json::gc_object_get(obj, make_key(heap, "6"))->i, 6);
+}
+
+TEST(ObjectTest, FreezeCopiesGraphIntoReadOnlyRegion) {
+    fiber::json::GcSnapshot snapshot;
+    {
+        GcHeap heap;
+        JsValue root = JsValue::make_object(heap, 4);
+        auto *obj = reinterpret_cast<GcObject *>(root.gc);
+        JsValue shared = JsValue::make_array(heap, 2);
+        auto *arr = reinterpret_cast<fiber::json::GcArray *>(shared.gc);
+        ASSERT_TRUE(fiber::json::gc_array_push(&heap, arr, JsValue::make_string(heap, "x", 1)));
+        ASSERT_TRUE(fiber::json::gc_array_push(&heap, arr, root));
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, make_key(heap, "a"), shared));
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, make_key(heap, "gone"), JsValue::make_integer(0)));
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, make_key(heap, "b"), shared));
+        ASSERT_TRUE(fiber::json::gc_object_remove(obj, make_key(heap, "gone")));
+        static char text[] = "native";
+        ASSERT_TRUE(fiber::json::gc_object_set(&heap, obj, make_key(heap, "c"), JsValue::make_native_string(text, 6)));
+        ASSERT_TRUE(fiber::json::gc_freeze(root, snapshot));
+
+        // Exceptions are not frozen.
+        JsValue error;
+        error.type_ = fiber::json::JsNodeType::Exception;
+        error.gc = &fiber::json::gc_new_exception(&heap, 0, "E", 1, "m", 1)->hdr;
+        fiber::json::GcSnapshot failed;
+        EXPECT_FALSE(fiber::json::gc_freeze(error, failed));
+    }
+
+    GcHeap heap;
+    JsValue root = fiber::json::gc_snapshot_root(heap, snapshot);
+    ASSERT_EQ(heap.static_pins.size(), 1u);
+    auto *obj = reinterpret_cast<GcObject *>(root.gc);
+    EXPECT_TRUE(fiber::json::gc_is_static(&obj->hdr));
+    EXPECT_EQ(keys_of(obj), (std::vector<std::string>{"a", "b", "c"}));
+    EXPECT_EQ(obj->entry_count, 3u);
+
+    const JsValue *a = fiber::json::gc_object_get(obj, make_key(heap, "a"));
+    const JsValue *b = fiber::json::gc_object_get(obj, make_key(heap, "b"));
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(a->gc, b->gc);
+    auto *arr = reinterpret_cast<fiber::json::GcArray *>(a->gc);
+    ASSERT_EQ(arr->size, 2u);
+    EXPECT_EQ(arr->elems[1].gc, root.gc);
+    const JsValue *c = fiber::json::gc_object_get(obj, make_key(heap, "c"));
+    ASSERT_TRUE(c);
+    EXPECT_EQ(c->type_, fiber::json::JsNodeType::HeapString);
+    EXPECT_TRUE(fiber::json::gc_is_static(c->gc));
+    EXPECT_EQ(fiber::json::gc_object_get(obj, make_key(heap, "gone")), nullptr);
+
+    EXPECT_FALSE(fiber::json::gc_object_set(&heap, obj, make_key(heap, "d"), JsValue::make_integer(1)));
+    EXPECT_FALSE(fiber::json::gc_object_remove(obj, make_key(heap, "a")));
+    EXPECT_FALSE(fiber::json::gc_array_push(&heap, arr, JsValue::make_integer(1)));
+    EXPECT_FALSE(fiber::json::gc_array_set(&heap, arr, 0, JsValue::make_integer(1)));
+    EXPECT_EQ(keys_of(obj), (std::vector<std::string>{"a", "b", "c"}));
+
+    // The heap keeps the region alive while it can reach it.
+    std::size_t used = snapshot.region->used;
+    EXPECT_EQ(used, snapshot.region->capacity);
+    snapshot = {};
+    JsValue *roots[] = {&root};
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_EQ(heap.static_pins.size(), 1u);
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    EXPECT_TRUE(heap.static_pins.empty());
+}
+
+TEST(ObjectTest, OrphanRegionsKeptOnlyWhileReachable) {
+    GcHeap source;
+    std::vector<fiber::json::GcSnapshot> snapshots(16);
+    for (std::size_t i = 0; i < snapshots.size(); ++i) {
+        JsValue root = JsValue::make_array(source, 1);
+        ASSERT_TRUE(fiber::json::gc_array_push(&source, reinterpret_cast<fiber::json::GcArray *>(root.gc),
+                                               JsValue::make_string(source, "v", 1)));
+        ASSERT_TRUE(fiber::json::gc_freeze(root, snapshots[i]));
+    }
+
+    GcHeap heap;
+    std::vector<JsValue> kept;
+    for (std::size_t i = 0; i < snapshots.size(); ++i) {
+        JsValue root = fiber::json::gc_snapshot_root(heap, snapshots[i]);
+        // Pinning again is a no-op.
+        (void)fiber::json::gc_snapshot_root(heap, snapshots[i]);
+        if (i % 3 == 1) {
+            // Keep an inner cell rather than the root.
+            kept.push_back(reinterpret_cast<fiber::json::GcArray *>(root.gc)->elems[0]);
+        }
+    }
+    EXPECT_EQ(heap.static_pins.size(), snapshots.size());
+    std::vector<const fiber::json::GcStaticRegion *> expected;
+    for (std::size_t i = 1; i < snapshots.size(); i += 3) {
+        expected.push_back(snapshots[i].region.get());
+    }
+
+    snapshots.clear();
+    std::vector<JsValue *> roots;
+    for (auto &value : kept) {
+        roots.push_back(&value);
+    }
+    fiber::json::gc_collect(&heap, roots.data(), roots.size());
+    std::vector<const fiber::json::GcStaticRegion *> pinned;
+    for (const auto &pin : heap.static_pins) {
+        pinned.push_back(pin.region.get());
+    }
+    EXPECT_EQ(pinned, expected);
+    EXPECT_EQ(heap.static_pinned.size(), expected.size());
+    for (const auto &value : kept) {
+        EXPECT_TRUE(fiber::json::gc_is_static(value.gc));
+    }
+}
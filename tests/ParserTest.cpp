@@ -1,9 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "common/json/JsonDecode.h"
+#include "common/json/JsonIndex.h"
 #include "common/json/JsGc.h"
 
 using fiber::json::GcArray;
@@ -86,6 +91,39 @@ TEST(ParserTest, ParseObjectAndArray) {
     EXPECT_EQ(arr->elems[3].type_, JsNodeType::Null);
 }
 
+TEST(ParserTest, PacksHomogeneousArraysOnlyWhenAsked) {
+    const std::string text = R"({"ints": [1, 2, 3], "floats": [0.5, 1.5], "mixed": [1, 2.5]})";
+    for (auto backend : {Parser::Backend::Indexed, Parser::Backend::Scalar}) {
+        GcHeap heap;
+        Parser parser(heap, backend);
+        JsValue plain;
+        ASSERT_TRUE(parser.parse(text, plain));
+        const GcArray *ints = as_array(entry_at(as_object(plain), 0)->value);
+        EXPECT_EQ(ints->kind, fiber::json::GcArrayKind::Values);
+        EXPECT_EQ(ints->elems[2].i, 3);
+
+        parser.set_pack_arrays(true);
+        JsValue packed;
+        ASSERT_TRUE(parser.parse(text, packed));
+        const GcObject *obj = as_object(packed);
+        EXPECT_EQ(as_array(entry_at(obj, 0)->value)->kind, fiber::json::GcArrayKind::Int64);
+        EXPECT_EQ(as_array(entry_at(obj, 1)->value)->kind, fiber::json::GcArrayKind::Float64);
+        EXPECT_EQ(as_array(entry_at(obj, 2)->value)->kind, fiber::json::GcArrayKind::Values);
+        EXPECT_EQ(fiber::json::gc_array_get(as_array(entry_at(obj, 0)->value), 2)->i, 3);
+        EXPECT_DOUBLE_EQ(fiber::json::gc_array_get(as_array(entry_at(obj, 1)->value), 1)->f, 1.5);
+        EXPECT_FALSE(fiber::json::gc_array_get(as_array(entry_at(obj, 0)->value), 3).has_value());
+    }
+
+    GcHeap heap;
+    StreamParser stream(heap);
+    ASSERT_EQ(stream.parse(text.data(), text.size()), StreamParser::Status::Complete);
+    EXPECT_EQ(as_array(entry_at(as_object(stream.root()), 0)->value)->kind, fiber::json::GcArrayKind::Values);
+    stream.reset();
+    stream.set_pack_arrays(true);
+    ASSERT_EQ(stream.parse(text.data(), text.size()), StreamParser::Status::Complete);
+    EXPECT_EQ(as_array(entry_at(as_object(stream.root()), 0)->value)->kind, fiber::json::GcArrayKind::Int64);
+}
+
 TEST(ParserTest, ParseStringEscapes) {
     GcHeap heap;
     Parser parser(heap);
@@ -223,3 +261,445 @@ TEST(ParserTest, RemoveKeysKeepsOrder) {
     const JsValue *missing = fiber::json::gc_object_get(obj, key_b);
     EXPECT_EQ(missing, nullptr);
 }
+
+namespace {
+
+bool same_string(const GcString *a, const GcString *b) {
+    if (a->encoding != b->encoding || a->len != b->len) {
+        return false;
+    }
+    if (a->encoding == fiber::json::GcStringEncoding::Byte) {
+        return std::memcmp(a->data8, b->data8, a->len) == 0;
+    }
+    return std::memcmp(a->data16, b->data16, a->len * sizeof(char16_t)) == 0;
+}
+
+bool same_tree(const JsValue &a, const JsValue &b) {
+    if (a.type_ != b.type_) {
+        return false;
+    }
+    switch (a.type_) {
+        case JsNodeType::Boolean:
+            return a.b == b.b;
+        case JsNodeType::Integer:
+            return a.i == b.i;
+        case JsNodeType::Float:
+            return std::memcmp(&a.f, &b.f, sizeof(double)) == 0;
+        case JsNodeType::HeapString:
+            return same_string(as_string(a), as_string(b));
+        case JsNodeType::Array: {
+            const GcArray *lhs = as_array(a);
+            const GcArray *rhs = as_array(b);
+            if (lhs->size != rhs->size) {
+                return false;
+            }
+            for (std::size_t i = 0; i < lhs->size; ++i) {
+                if (!same_tree(fiber::json::gc_array_at(lhs, i), fiber::json::gc_array_at(rhs, i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case JsNodeType::Object: {
+            const GcObject *lhs = as_object(a);
+            const GcObject *rhs = as_object(b);
+            if (lhs->size != rhs->size) {
+                return false;
+            }
+            for (std::size_t i = 0; i < lhs->size; ++i) {
+                const GcObjectEntry *left = entry_at(lhs, i);
+                const GcObjectEntry *right = entry_at(rhs, i);
+                if (!same_string(left->key, right->key) || !same_tree(left->value, right->value)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+void expect_backends_agree(const std::string &input) {
+    GcHeap heap;
+    Parser indexed(heap, Parser::Backend::Indexed);
+    Parser scalar(heap, Parser::Backend::Scalar);
+    JsValue indexed_value;
+    JsValue scalar_value;
+    bool indexed_ok = indexed.parse(input, indexed_value);
+    bool scalar_ok = scalar.parse(input, scalar_value);
+    ASSERT_EQ(indexed_ok, scalar_ok) << input;
+    if (scalar_ok) {
+        EXPECT_TRUE(same_tree(indexed_value, scalar_value)) << input;
+    } else {
+        EXPECT_EQ(indexed.error().message, scalar.error().message) << input;
+        EXPECT_EQ(indexed.error().offset, scalar.error().offset) << input;
+    }
+}
+
+std::vector<std::uint32_t> index_with(const std::string &input, fiber::json::IndexKernel kernel, bool &ok) {
+    std::vector<std::uint32_t> out;
+    ok = fiber::json::build_structural_index(input.data(), input.size(), out, kernel);
+    return out;
+}
+
+} // namespace
+
+TEST(ParserTest, IndexedBackendMatchesScalar) {
+    std::vector<std::string> corpus = {
+        "{}",
+        "[]",
+        " [ 1 , -2.5e3 , true , false , null , \"x\" ] ",
+        "{\"a\":{\"b\":[{\"c\":\"d\"},[],{}]},\"e\":0}",
+        "\"esc \\\" \\\\ \\/ \\b \\f \\n \\r \\t \\u00e9 \\ud83d\\ude00\"",
+        "{\"caf\xc3\xa9\":\"\xe2\x82\xac\"}",
+        "\"\\\\\\\\\\\"\"",
+        "123456789012345678901234567890",
+        "1.7976931348623157e309",
+        "9223372036854775807",
+        "-0",
+        "01",
+        "1.",
+        "-",
+        "truex",
+        "nul",
+        "[1 2]",
+        "{\"a\" 1}",
+        "{\"a\":1,}",
+        "[1,]",
+        "{1:2}",
+        "\"unterminated",
+        "\"ctrl\x01\"",
+        "\"bad \xff utf8\"",
+        "[\"a\"\"b\"]",
+        "{\"a\":1}}",
+        "",
+        "   ",
+        "[[[[[[[[[[]]]]]]]]]]",
+        "\"\\x\"",
+        "\"\\u12\"",
+        "\"\\udc00\"",
+        "[1,\"a\":2]",
+        "{\"a\":1:2}",
+    };
+    std::string long_escapes = "[";
+    for (int i = 0; i < 200; ++i) {
+        long_escapes += "\"" + std::string(static_cast<std::size_t>(i % 7), '\\') + std::string(i % 7 % 2, 'n') +
+                        std::string(static_cast<std::size_t>(i % 13), 'x') + "\",";
+    }
+    long_escapes += "0]";
+    corpus.push_back(long_escapes);
+
+    std::uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    auto next = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+    const std::string base = corpus[3];
+    const char alphabet[] = "{}[]:,\"\\ 0-1etruafn.\x01\xc3";
+    for (int i = 0; i < 2000; ++i) {
+        std::string mutated = i % 2 ? base : long_escapes;
+        for (int edits = 0; edits < 3; ++edits) {
+            std::size_t at = next() % mutated.size();
+            char ch = alphabet[next() % (sizeof(alphabet) - 1)];
+            switch (next() % 3) {
+                case 0:
+                    mutated[at] = ch;
+                    break;
+                case 1:
+                    mutated.insert(at, 1, ch);
+                    break;
+                default:
+                    mutated.erase(at, 1);
+                    break;
+            }
+            if (mutated.empty()) {
+                mutated = "0";
+            }
+        }
+        corpus.push_back(mutated);
+    }
+    for (const auto &input : corpus) {
+        expect_backends_agree(input);
+    }
+}
+
+TEST(ParserTest, StructuralIndexKernelsAgree) {
+    std::vector<std::string> inputs;
+    for (std::size_t run = 0; run < 6; ++run) {
+        for (std::size_t shift = 55; shift < 70; ++shift) {
+            std::string input = "[\"" + std::string(shift, 'a') + std::string(run, '\\') + "\\\"b\", 12, true]";
+            inputs.push_back(input);
+        }
+    }
+    inputs.push_back("{\"k\": [1, 2.5, \"\xc3\xa9\", null]}");
+    inputs.push_back("\"open");
+    inputs.push_back("\"\xc3\"");
+
+    for (const auto &input : inputs) {
+        bool scalar_ok = false;
+        bool sse2_ok = false;
+        bool avx2_ok = false;
+        auto scalar = index_with(input, fiber::json::IndexKernel::Scalar, scalar_ok);
+        auto sse2 = index_with(input, fiber::json::IndexKernel::Sse2, sse2_ok);
+        auto avx2 = index_with(input, fiber::json::IndexKernel::Avx2, avx2_ok);
+        EXPECT_EQ(scalar_ok, sse2_ok) << input;
+        EXPECT_EQ(scalar_ok, avx2_ok) << input;
+        EXPECT_EQ(scalar, sse2) << input;
+        EXPECT_EQ(scalar, avx2) << input;
+    }
+
+    bool ok = false;
+    auto index = index_with("{\"a\\\"\": [10, \"x\"]}", fiber::json::IndexKernel::Scalar, ok);
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(index, (std::vector<std::uint32_t>{0, 1, 5, 6, 8, 9, 11, 13, 15, 16, 17}));
+    index_with("\"a\\\"", fiber::json::IndexKernel::Scalar, ok);
+    EXPECT_FALSE(ok);
+}
+
+TEST(ParserTest, LazyDocumentDecodesOnAccess) {
+    GcHeap heap;
+    Parser parser(heap);
+    const std::string input = " {\"a\": [1, {\"b\": \"x\"}], \"caf\\u00e9\": true, \"d\": 1, \"d\": 2} ";
+    JsValue root;
+    ASSERT_TRUE(parser.parse_lazy(input, root));
+    ASSERT_EQ(root.type_, JsNodeType::LazyJson);
+    auto *lazy = reinterpret_cast<fiber::json::GcLazyJson *>(root.gc);
+    EXPECT_FALSE(fiber::json::lazy_json_is_array(lazy));
+    EXPECT_EQ(fiber::json::lazy_json_size(heap, lazy), 3u);
+
+    const char *text = nullptr;
+    std::size_t len = 0;
+    ASSERT_TRUE(fiber::json::lazy_json_text(lazy, text, len));
+    EXPECT_EQ(std::string(text, len), input.substr(1, input.size() - 2));
+
+    JsValue d;
+    ASSERT_TRUE(fiber::json::lazy_json_get(heap, lazy, make_key(heap, "d"), d));
+    EXPECT_EQ(d.i, 2);
+    JsValue accented;
+    ASSERT_TRUE(fiber::json::lazy_json_get(heap, lazy, make_key(heap, "caf\xc3\xa9"), accented));
+    EXPECT_EQ(accented.type_, JsNodeType::Boolean);
+    JsValue missing;
+    ASSERT_TRUE(fiber::json::lazy_json_get(heap, lazy, make_key(heap, "zz"), missing));
+    EXPECT_EQ(missing.type_, JsNodeType::Undefined);
+
+    JsValue a;
+    ASSERT_TRUE(fiber::json::lazy_json_get(heap, lazy, make_key(heap, "a"), a));
+    ASSERT_EQ(a.type_, JsNodeType::LazyJson);
+    auto *arr = reinterpret_cast<fiber::json::GcLazyJson *>(a.gc);
+    JsValue again;
+    ASSERT_TRUE(fiber::json::lazy_json_get(heap, lazy, make_key(heap, "a"), again));
+    EXPECT_EQ(again.gc, a.gc);
+    JsValue inner;
+    ASSERT_TRUE(fiber::json::lazy_json_at(heap, arr, 1, inner));
+    ASSERT_EQ(inner.type_, JsNodeType::LazyJson);
+
+    JsValue *roots[] = {&root};
+    fiber::json::gc_collect(&heap, roots, 1);
+
+    const JsValue *forced_inner = fiber::json::lazy_json_force(heap, reinterpret_cast<fiber::json::GcLazyJson *>(inner.gc));
+    ASSERT_NE(forced_inner, nullptr);
+    EXPECT_FALSE(fiber::json::lazy_json_text(lazy, text, len));
+    const JsValue *forced = fiber::json::lazy_json_force(heap, lazy);
+    ASSERT_NE(forced, nullptr);
+    ASSERT_EQ(forced->type_, JsNodeType::Object);
+    const JsValue *forced_a = fiber::json::gc_object_get(as_object(*forced), make_key(heap, "a"));
+    ASSERT_NE(forced_a, nullptr);
+    EXPECT_EQ(as_array(*forced_a)->elems[1].gc, forced_inner->gc);
+
+    JsValue expected;
+    ASSERT_TRUE(parser.parse(input, expected));
+    EXPECT_TRUE(same_tree(*forced, expected));
+
+    for (const char *bad : {"{\"a\":}", "[1,,2]", "{\"a\":1", "\"x"}) {
+        JsValue eager;
+        JsValue deferred;
+        Parser reference(heap);
+        EXPECT_FALSE(reference.parse(bad, eager));
+        EXPECT_FALSE(parser.parse_lazy(bad, deferred)) << bad;
+        EXPECT_EQ(parser.error().message, reference.error().message) << bad;
+        EXPECT_EQ(parser.error().offset, reference.error().offset) << bad;
+    }
+    JsValue scalar;
+    ASSERT_TRUE(parser.parse_lazy("42", scalar));
+    EXPECT_EQ(scalar.type_, JsNodeType::Integer);
+}
+
+TEST(ParserTest, LazyObjectSizeCountsDuplicateKeysOnce) {
+    GcHeap heap;
+    Parser parser(heap);
+    const std::pair<const char *, std::size_t> cases[] = {
+        {"{\"a\": 1, \"a\": 2}", 1},
+        {"{\"a\": 1, \"b\": 2, \"\\u0061\": 3, \"b\": [4]}", 2},
+        {"{\"caf\\u00e9\": 1, \"caf\xc3\xa9\": 2, \"\\u4e2d\": 3, \"\xe4\xb8\xad\": 4}", 2},
+    };
+    for (const auto &[input, size] : cases) {
+        JsValue root;
+        ASSERT_TRUE(parser.parse_lazy(input, root)) << input;
+        auto *lazy = reinterpret_cast<fiber::json::GcLazyJson *>(root.gc);
+        EXPECT_EQ(fiber::json::lazy_json_size(heap, lazy), size) << input;
+        const JsValue *forced = fiber::json::lazy_json_force(heap, lazy);
+        ASSERT_NE(forced, nullptr);
+        EXPECT_EQ(as_object(*forced)->size, size) << input;
+        EXPECT_EQ(fiber::json::lazy_json_size(heap, lazy), size) << input;
+    }
+}
+
+TEST(ParserTest, BorrowedStringsPinInput) {
+    GcHeap heap;
+    Parser parser(heap);
+    auto input = std::make_shared<const std::string>("{\"plain\":\"hello\",\"esc\":\"a\\nb\",\"list\":[\"x\"]}");
+    JsValue root;
+    ASSERT_TRUE(parser.parse_borrowed(input, root));
+
+    const JsValue *plain = fiber::json::gc_object_get(as_object(root), make_key(heap, "plain"));
+    ASSERT_NE(plain, nullptr);
+    const GcString *plain_str = as_string(*plain);
+    EXPECT_NE(plain_str->owner, nullptr);
+    EXPECT_EQ(reinterpret_cast<const char *>(plain_str->data8), input->data() + 10);
+    EXPECT_EQ(to_string(plain_str), "hello");
+
+    const JsValue *esc = fiber::json::gc_object_get(as_object(root), make_key(heap, "esc"));
+    ASSERT_NE(esc, nullptr);
+    EXPECT_EQ(as_string(*esc)->owner, nullptr);
+    EXPECT_EQ(to_string(as_string(*esc)), "a\nb");
+
+    std::weak_ptr<const std::string> watch = input;
+    input.reset();
+    JsValue kept = *plain;
+    root = JsValue::make_undefined();
+    JsValue *roots[] = {&kept};
+    fiber::json::gc_collect(&heap, roots, 1);
+    ASSERT_FALSE(watch.expired());
+    EXPECT_EQ(to_string(as_string(kept)), "hello");
+
+    kept = JsValue::make_undefined();
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_TRUE(watch.expired());
+
+    JsValue invalid;
+    EXPECT_FALSE(parser.parse_borrowed(std::make_shared<const std::string>("[\"a\",]"), invalid));
+    EXPECT_FALSE(parser.error().message.empty());
+}
+
+TEST(ParserTest, StreamChunkBoundariesMatchParser) {
+    const std::vector<std::string> corpus = {
+        " [ 1 , -2.5e3 , true , false , null , \"x\" ] ",
+        "{\"a\":{\"b\":[{\"c\":\"d\"},[],{}]},\"e\":0}",
+        "\"esc \\\" \\\\ \\/ \\b \\f \\n \\r \\t \\u00e9 \\ud83d\\ude00\"",
+        "{\"caf\xc3\xa9\":\"\xe2\x82\xac\",\"long\":\"" + std::string(300, 'z') + "\\\"" + std::string(50, 'q') + "\"}",
+        "[123456789012345,0.125,-0,1e-7,9223372036854775807]",
+        "[\"\\\\\",\"\\\\\\\"\\\\\", \"\\\\\\\\\\\"\"]",
+    };
+    for (const auto &input : corpus) {
+        GcHeap heap;
+        Parser parser(heap);
+        JsValue expected;
+        ASSERT_TRUE(parser.parse(input, expected)) << input;
+        for (std::size_t step : {1, 2, 3, 7, 64}) {
+            StreamParser stream(heap);
+            StreamParser::Status status = StreamParser::Status::NeedMore;
+            for (std::size_t at = 0; at < input.size(); at += step) {
+                status = stream.parse(input.data() + at, std::min(step, input.size() - at));
+                ASSERT_NE(status, StreamParser::Status::Error) << input << " step " << step;
+            }
+            ASSERT_EQ(stream.finish(), StreamParser::Status::Complete) << input << " step " << step;
+            EXPECT_TRUE(same_tree(stream.root(), expected)) << input << " step " << step;
+        }
+    }
+}
+
+TEST(ParserTest, StreamLongEscapedStringAcrossChunks) {
+    // One string crossing every chunk, with an escaped quote every three
+    // bytes: the carry must be scanned once, not re-lexed per quote.
+    std::string body;
+    for (int i = 0; i < 128 * 1024; ++i) {
+        body += "ab\\\"";
+    }
+    std::string input = "[\"" + body + "\"]";
+    GcHeap heap;
+    StreamParser stream(heap);
+    const std::size_t chunk = 64 * 1024;
+    for (std::size_t at = 0; at < input.size(); at += chunk) {
+        ASSERT_NE(stream.parse(input.data() + at, std::min(chunk, input.size() - at)), StreamParser::Status::Error);
+    }
+    ASSERT_EQ(stream.finish(), StreamParser::Status::Complete);
+    const GcArray *arr = as_array(stream.root());
+    ASSERT_EQ(arr->size, 1u);
+    const GcString *str = as_string(arr->elems[0]);
+    ASSERT_EQ(str->len, 128u * 1024 * 3);
+    EXPECT_EQ(to_string(str).substr(0, 6), "ab\"ab\"");
+}
+
+TEST(ParserTest, StreamErrorOffsetAcrossChunks) {
+    GcHeap heap;
+    StreamParser parser(heap);
+    const char *chunk1 = "[1,\n tru";
+    const char *chunk2 = "x]";
+    EXPECT_EQ(parser.parse(chunk1, std::strlen(chunk1)), StreamParser::Status::NeedMore);
+    EXPECT_EQ(parser.parse(chunk2, std::strlen(chunk2)), StreamParser::Status::Error);
+    EXPECT_EQ(parser.error().offset, 8u);
+}
+
+namespace {
+
+class EventLog final : public fiber::json::StreamHandler {
+public:
+    bool map_open() override {
+        out += '{';
+        return true;
+    }
+    bool map_key(const fiber::json::DecodedString &key) override {
+        out += std::string(key.bytes.begin(), key.bytes.end()) + ':';
+        return true;
+    }
+    bool map_close() override {
+        out += '}';
+        return true;
+    }
+    bool array_open() override {
+        out += '[';
+        return true;
+    }
+    bool array_close() override {
+        out += ']';
+        return true;
+    }
+    bool string(const fiber::json::DecodedString &value) override {
+        out += '\'' + std::string(value.bytes.begin(), value.bytes.end()) + '\'';
+        return value.size() < 8;
+    }
+    bool scalar(const JsValue &value) override {
+        out += value.type_ == JsNodeType::Integer ? std::to_string(value.i) : "s";
+        return true;
+    }
+
+    std::string out;
+};
+
+} // namespace
+
+TEST(ParserTest, StreamHandlerReceivesEvents) {
+    GcHeap heap;
+    EventLog log;
+    StreamParser parser(heap);
+    parser.set_handler(&log);
+    const std::string input = "{\"ab\":[12,true,\"xy\"],\"c\":{}}";
+    for (std::size_t at = 0; at < input.size(); at += 2) {
+        ASSERT_NE(parser.parse(input.data() + at, std::min<std::size_t>(2, input.size() - at)),
+                  StreamParser::Status::Error);
+    }
+    EXPECT_EQ(parser.finish(), StreamParser::Status::Complete);
+    EXPECT_TRUE(parser.has_result());
+    EXPECT_EQ(parser.root().type_, JsNodeType::Undefined);
+    EXPECT_EQ(log.out, "{ab:[12s'xy']c:{}}");
+
+    log.out.clear();
+    parser.reset();
+    const char *stop = "[\"too long for the handler\",1]";
+    EXPECT_EQ(parser.parse(stop, std::strlen(stop)), StreamParser::Status::Error);
+    EXPECT_EQ(parser.error().offset, 1u);
+    EXPECT_EQ(log.out, "['too long for the handler'");
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "common/Regex.h"
+
+namespace {
+
+fiber::common::Regex compile(std::string_view pattern) {
+    auto regex = fiber::common::Regex::compile(pattern);
+    EXPECT_TRUE(regex.has_value()) << pattern << ": " << (regex ? "" : regex.error().message);
+    return std::move(*regex);
+}
+
+std::string find_first(const fiber::common::Regex &regex, std::string_view text) {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    if (!regex.find(text, 0, begin, end)) {
+        return "<none>";
+    }
+    return std::string(text.substr(begin, end - begin));
+}
+
+} // namespace
+
+TEST(RegexTest, FullMatchAndSearch) {
+    auto re = compile("a+b+c+");
+    EXPECT_TRUE(re.full_match("aaabbbbccc"));
+    EXPECT_FALSE(re.full_match("aaabbbbcccd"));
+    EXPECT_FALSE(re.full_match("xabc"));
+    EXPECT_TRUE(re.search("xxabcxx"));
+    EXPECT_FALSE(re.search("xxacbxx"));
+
+    auto path = compile("^/api/v[0-9]+/users/\\d+$");
+    EXPECT_TRUE(path.full_match("/api/v2/users/42"));
+    EXPECT_TRUE(path.search("/api/v10/users/7"));
+    EXPECT_FALSE(path.search("x/api/v10/users/7"));
+    EXPECT_FALSE(path.search("/api/v10/users/7/"));
+
+    auto alt = compile("(?:get|post|put)_(\\w+)");
+    EXPECT_TRUE(alt.full_match("post_item"));
+    EXPECT_FALSE(alt.full_match("delete_item"));
+
+    auto counted = compile("x{2,3}y?");
+    EXPECT_FALSE(counted.full_match("x"));
+    EXPECT_TRUE(counted.full_match("xx"));
+    EXPECT_TRUE(counted.full_match("xxxy"));
+    EXPECT_FALSE(counted.full_match("xxxxy"));
+
+    auto empty = compile("");
+    EXPECT_TRUE(empty.full_match(""));
+    EXPECT_TRUE(empty.search("abc"));
+}
+
+TEST(RegexTest, ClassesEscapesAndUtf8) {
+    auto cls = compile("[^a-c\\s]+");
+    EXPECT_TRUE(cls.full_match("xyz"));
+    EXPECT_FALSE(cls.full_match("xaz"));
+    EXPECT_FALSE(cls.full_match("x z"));
+
+    auto dot = compile("a.c");
+    EXPECT_TRUE(dot.full_match("abc"));
+    EXPECT_TRUE(dot.full_match("a\xE4\xB8\xAD" "c"));
+    EXPECT_FALSE(dot.full_match("a\nc"));
+
+    auto cjk = compile("[\\u4e00-\\u9fff]{2}");
+    EXPECT_TRUE(cjk.full_match("\xE4\xB8\xAD\xE6\x96\x87"));
+    EXPECT_FALSE(cjk.full_match("ab"));
+
+    auto word = compile("\\bcat\\b");
+    EXPECT_TRUE(word.search("a cat sat"));
+    EXPECT_FALSE(word.search("concatenate"));
+
+    auto escaped = compile("a\\.b\\x41\\u0042");
+    EXPECT_TRUE(escaped.full_match("a.bAB"));
+    EXPECT_FALSE(escaped.full_match("axbAB"));
+}
+
+TEST(RegexTest, FindIsLeftmostFirst) {
+    EXPECT_EQ(find_first(compile("a+"), "baaac"), "aaa");
+    EXPECT_EQ(find_first(compile("a+?"), "baaac"), "a");
+    EXPECT_EQ(find_first(compile("ab|abc"), "xabcx"), "ab");
+    EXPECT_EQ(find_first(compile("\\d+"), "no digits"), "<none>");
+    EXPECT_EQ(find_first(compile("x*"), "abc"), "");
+
+    auto re = compile("[0-9]+");
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    ASSERT_TRUE(re.find("a1b22c333", 3, begin, end));
+    EXPECT_EQ(begin, 3u);
+    EXPECT_EQ(end, 5u);
+}
+
+TEST(RegexTest, RejectsUnsupportedSyntax) {
+    EXPECT_FALSE(fiber::common::Regex::compile("(a").has_value());
+    EXPECT_FALSE(fiber::common::Regex::compile("a)").has_value());
+    EXPECT_FALSE(fiber::common::Regex::compile("[a").has_value());
+    EXPECT_FALSE(fiber::common::Regex::compile("*a").has_value());
+    EXPECT_FALSE(fiber::common::Regex::compile("(a)\\1").has_value());
+    EXPECT_FALSE(fiber::common::Regex::compile("a(?=b)").has_value());
+    EXPECT_FALSE(fiber::common::Regex::compile("[z-a]").has_value());
+    EXPECT_FALSE(fiber::common::Regex::compile("a{3,2}").has_value());
+}
+
+TEST(RegexTest, PathologicalPatternStaysLinear) {
+    auto re = compile("(a+)+$");
+    std::string text(4096, 'a');
+    text.push_back('!');
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(re.full_match(text));
+    EXPECT_FALSE(re.search(text));
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    EXPECT_FALSE(re.find(text, 0, begin, end));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::seconds>(elapsed).count(), 2);
+}
+
+TEST(RegexTest, LargeAutomataAreBuiltOnlyAsMatchingNeedsThem) {
+    auto start = std::chrono::steady_clock::now();
+    auto nested = compile("(.*.){300}");
+    auto wide = compile("[\\s\\S]*.{1000}");
+    auto counted = compile(".{1000}");
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 250);
+
+    // These outgrow the DFA budget part way through and finish on the NFA.
+    std::string text(1200, 'x');
+    std::string broken = std::string(600, 'x') + "\n" + std::string(600, 'x');
+    EXPECT_TRUE(nested.full_match(text));
+    EXPECT_FALSE(nested.full_match(std::string(299, 'x')));
+    EXPECT_TRUE(wide.full_match(text));
+    EXPECT_FALSE(wide.search(broken));
+    EXPECT_TRUE(counted.search(text));
+    EXPECT_FALSE(counted.search(broken));
+    EXPECT_FALSE(counted.full_match(text));
+}
+
+TEST(RegexTest, CachedCompileReusesInstance) {
+    auto first = fiber::common::regex_cached("ab+");
+    auto second = fiber::common::regex_cached("ab+");
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(fiber::common::regex_cached("(ab"), nullptr);
+}
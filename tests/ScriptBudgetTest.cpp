@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/json/JsGc.h"
+#include "event/EventLoop.h"
+#include "script/Library.h"
+#include "script/Runtime.h"
+#include "script/Script.h"
+#include "script/ir/Compiler.h"
+#include "script/parse/Parser.h"
+#include "TestHelpers.h"
+
+namespace {
+
+class EmptyLibrary final : public fiber::script::Library {
+public:
+    Function *find_func(std::string_view name) override {
+        (void)name;
+        return nullptr;
+    }
+
+    AsyncFunction *find_async_func(std::string_view name) override {
+        (void)name;
+        return nullptr;
+    }
+
+    Constant *find_constant(std::string_view namespace_name, std::string_view key) override {
+        (void)namespace_name;
+        (void)key;
+        return nullptr;
+    }
+
+    AsyncConstant *find_async_constant(std::string_view namespace_name, std::string_view key) override {
+        (void)namespace_name;
+        (void)key;
+        return nullptr;
+    }
+
+    DirectiveDef *find_directive_def(std::string_view type,
+                                     std::string_view name,
+                                     const std::vector<fiber::json::JsValue> &literals) override {
+        (void)type;
+        (void)name;
+        (void)literals;
+        return nullptr;
+    }
+};
+
+class DetachedTask {
+public:
+    struct promise_type {
+        DetachedTask get_return_object() {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {
+        }
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+// 1000 iterations of the innermost body.
+constexpr std::string_view kNestedLoops =
+    "let a = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10];\n"
+    "let n = 0;\n"
+    "for (let i, x of a) { for (let j, y of a) { for (let k, z of a) { n = n + 1; } } }\n"
+    "return n;\n";
+
+fiber::script::Script make_script(std::string_view source) {
+    EmptyLibrary library;
+    fiber::script::parse::Parser parser(library, true);
+    auto parsed = parser.parse_script(source);
+    EXPECT_TRUE(parsed.has_value()) << parsed.error().message;
+    auto compiled = fiber::script::ir::Compiler::compile(*parsed.value());
+    return fiber::script::Script(std::make_shared<fiber::script::ir::Compiled>(std::move(compiled)));
+}
+
+std::string error_name(const fiber::script::ScriptRun::Result &result) {
+    if (result.has_value() || result.error().type_ != fiber::json::JsNodeType::Exception) {
+        return {};
+    }
+    auto *exc = reinterpret_cast<const fiber::json::GcException *>(result.error().gc);
+    std::string name;
+    if (!exc->name || !fiber::json::gc_string_to_utf8(exc->name, name)) {
+        return {};
+    }
+    return name;
+}
+
+DetachedTask run_budgeted(fiber::script::Script &script,
+                          fiber::script::ScriptRuntime &runtime,
+                          const fiber::script::run::ExecBudget &budget,
+                          std::optional<fiber::script::ScriptRun::Result> *out,
+                          int *running = nullptr) {
+    auto run = script.exec_async(fiber::json::JsValue::make_undefined(), nullptr, runtime);
+    run.set_budget(budget);
+    *out = co_await std::move(run);
+    if (!running || --*running == 0) {
+        fiber::event::EventLoop::current().stop();
+    }
+}
+
+} // namespace
+
+TEST(ScriptBudgetTest, InstructionLimitKillsRun) {
+    fiber::json::GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime(heap, roots);
+
+    auto script = make_script(kNestedLoops);
+    auto unlimited = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime)();
+    ASSERT_TRUE(unlimited.has_value());
+    EXPECT_EQ(unlimited->i, 1000);
+
+    fiber::script::run::ExecBudget budget;
+    budget.max_instructions = 500;
+    auto run = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime);
+    run.set_budget(budget);
+    EXPECT_EQ(error_name(run()), "EXEC_BUDGET_EXCEEDED");
+
+    auto guarded = make_script("try {\n" + std::string(kNestedLoops) + "} catch (e) { return -1; }\n");
+    auto guarded_run = guarded.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime);
+    guarded_run.set_budget(budget);
+    EXPECT_EQ(error_name(guarded_run()), "EXEC_BUDGET_EXCEEDED");
+}
+
+TEST(ScriptBudgetTest, AllocationLimitKillsRun) {
+    fiber::json::GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime(heap, roots);
+
+    auto script = make_script("let a = [1, 2, 3, 4, 5, 6, 7, 8];\n"
+                              "let o = {};\n"
+                              "for (let i, x of a) { for (let j, y of a) { o = {next: o}; } }\n"
+                              "return 1;\n");
+    fiber::script::run::ExecBudget budget;
+    budget.max_alloc_bytes = 1024;
+    auto run = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime);
+    run.set_budget(budget);
+    EXPECT_EQ(error_name(run()), "EXEC_BUDGET_EXCEEDED");
+
+    budget.max_alloc_bytes = 1 << 20;
+    auto roomy = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime);
+    roomy.set_budget(budget);
+    auto result = roomy();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->i, 1);
+}
+
+TEST(ScriptBudgetTest, SliceYieldsToLoop) {
+    fiber::json::GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime(heap, roots);
+    auto script = make_script(kNestedLoops);
+
+    fiber::event::EventLoop loop;
+    std::optional<fiber::script::ScriptRun::Result> result;
+    int ticks = 0;
+    struct Ticker {
+        fiber::event::EventLoop *loop;
+        std::optional<fiber::script::ScriptRun::Result> *result;
+        int *ticks;
+
+        void operator()() const {
+            ++*ticks;
+            if (!result->has_value()) {
+                fiber::test::post_task(*loop, Ticker{*this});
+            }
+        }
+    };
+
+    fiber::script::run::ExecBudget budget;
+    budget.slice_instructions = 200;
+    fiber::test::post_task(loop, [&]() { run_budgeted(script, runtime, budget, &result); });
+    fiber::test::post_task(loop, Ticker{&loop, &result, &ticks});
+    loop.run();
+
+    ASSERT_TRUE(result.has_value());
+    ASSERT_TRUE(result->has_value());
+    EXPECT_EQ((*result)->i, 1000);
+    EXPECT_GT(ticks, 10);
+}
+
+TEST(ScriptBudgetTest, YieldingRunStillHitsHardLimit) {
+    fiber::json::GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime(heap, roots);
+    auto script = make_script(kNestedLoops);
+
+    fiber::event::EventLoop loop;
+    std::optional<fiber::script::ScriptRun::Result> result;
+    fiber::script::run::ExecBudget budget;
+    budget.slice_instructions = 100;
+    budget.max_instructions = 2000;
+    fiber::test::post_task(loop, [&]() { run_budgeted(script, runtime, budget, &result); });
+    loop.run();
+
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(error_name(*result), "EXEC_BUDGET_EXCEEDED");
+}
+
+TEST(ScriptBudgetTest, AllocationsWhileSuspendedAreNotCharged) {
+    fiber::json::GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime(heap, roots);
+    auto allocating = make_script("let a = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10];\n"
+                                  "let o = {};\n"
+                                  "for (let i, x of a) { for (let j, y of a) { for (let k, z of a) { o = {next: o}; } } }\n"
+                                  "return 1;\n");
+    auto counting = make_script(kNestedLoops);
+
+    // What counting allocates on its own, with room to spare.
+    std::size_t before = heap.allocated;
+    ASSERT_TRUE(counting.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime)().has_value());
+    std::size_t own = heap.allocated - before;
+    before = heap.allocated;
+    ASSERT_TRUE(allocating.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime)().has_value());
+    ASSERT_GT(heap.allocated - before, 8 * own);
+
+    fiber::event::EventLoop loop;
+    std::optional<fiber::script::ScriptRun::Result> allocating_result;
+    std::optional<fiber::script::ScriptRun::Result> counting_result;
+    int running = 2;
+    fiber::script::run::ExecBudget roomy;
+    roomy.slice_instructions = 50;
+    fiber::script::run::ExecBudget tight = roomy;
+    tight.max_alloc_bytes = 2 * own;
+    fiber::test::post_task(loop, [&]() { run_budgeted(counting, runtime, tight, &counting_result, &running); });
+    fiber::test::post_task(loop, [&]() { run_budgeted(allocating, runtime, roomy, &allocating_result, &running); });
+    loop.run();
+
+    ASSERT_TRUE(allocating_result.has_value());
+    ASSERT_TRUE(allocating_result->has_value());
+    ASSERT_TRUE(counting_result.has_value());
+    ASSERT_TRUE(counting_result->has_value()) << error_name(*counting_result);
+    EXPECT_EQ((*counting_result)->i, 1000);
+}
@@ -0,0 +1,294 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include "common/json/JsGc.h"
+#include "script/Library.h"
+#include "script/Runtime.h"
+#include "script/Script.h"
+#include "script/ScriptCache.h"
+#include "script/ir/Bytecode.h"
+
+namespace {
+
+class AddFunc final : public fiber::script::Library::Function {
+public:
+    fiber::script::Library::FunctionResult call(fiber::script::ExecutionContext &context) override {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i < context.arg_count(); ++i) {
+            sum += context.arg_value(i).i;
+        }
+        return fiber::json::JsValue::make_integer(sum);
+    }
+};
+
+class AnswerConstant final : public fiber::script::Library::Constant {
+public:
+    fiber::script::Library::FunctionResult get(fiber::script::ExecutionContext &context) override {
+        (void)context;
+        return fiber::json::JsValue::make_integer(41);
+    }
+};
+
+class DoubleFunc final : public fiber::script::Library::Function {
+public:
+    fiber::script::Library::FunctionResult call(fiber::script::ExecutionContext &context) override {
+        return fiber::json::JsValue::make_integer(context.arg_value(0).i * 2);
+    }
+};
+
+class MathDirective final : public fiber::script::Library::DirectiveDef {
+public:
+    explicit MathDirective(fiber::script::Library::Function *twice) : twice_(twice) {}
+
+    fiber::script::Library::Function *find_func(std::string_view directive, std::string_view function) override {
+        if (directive == "m" && function == "twice") {
+            return twice_;
+        }
+        return nullptr;
+    }
+
+    fiber::script::Library::AsyncFunction *find_async_func(std::string_view directive,
+                                                           std::string_view function) override {
+        (void)directive;
+        (void)function;
+        return nullptr;
+    }
+
+private:
+    fiber::script::Library::Function *twice_ = nullptr;
+};
+
+class CacheLibrary final : public fiber::script::Library {
+public:
+    CacheLibrary() : directive_(&twice_) {}
+
+    std::uint64_t version() const override {
+        return version_;
+    }
+
+    Function *find_func(std::string_view name) override {
+        return name == "add" ? &add_ : nullptr;
+    }
+
+    AsyncFunction *find_async_func(std::string_view name) override {
+        (void)name;
+        return nullptr;
+    }
+
+    Constant *find_constant(std::string_view namespace_name, std::string_view key) override {
+        if (namespace_name == "$test" && key == "answer") {
+            return &answer_;
+        }
+        return nullptr;
+    }
+
+    AsyncConstant *find_async_constant(std::string_view namespace_name, std::string_view key) override {
+        (void)namespace_name;
+        (void)key;
+        return nullptr;
+    }
+
+    DirectiveDef *find_directive_def(std::string_view type,
+                                     std::string_view name,
+                                     const std::vector<fiber::json::JsValue> &literals) override {
+        if (type == "math" && name == "m" && literals.size() == 1 &&
+            literals[0].type_ == fiber::json::JsNodeType::NativeString &&
+            std::string_view(literals[0].ns().data, literals[0].ns().len) == "v1") {
+            return &directive_;
+        }
+        return nullptr;
+    }
+
+    std::uint64_t version_ = 1;
+
+private:
+    AddFunc add_;
+    AnswerConstant answer_;
+    DoubleFunc twice_;
+    MathDirective directive_;
+};
+
+constexpr std::string_view kScript =
+    "directive m from math \"v1\";\n"
+    "let s = \"abc\";\n"
+    "return {sum: add(1, 2), answer: $test.answer, twice: m.twice(4), s: s, f: 1.5};\n";
+
+struct TestEnv {
+    fiber::json::GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime;
+
+    TestEnv() : runtime(heap, roots) {}
+};
+
+std::int64_t object_int(const fiber::json::JsValue &obj, std::string_view key) {
+    auto *object = reinterpret_cast<const fiber::json::GcObject *>(obj.gc);
+    for (std::size_t i = 0; i < object->size; ++i) {
+        const fiber::json::GcObjectEntry *entry = fiber::json::gc_object_entry_at(object, i);
+        std::string entry_key;
+        if (entry && entry->key && fiber::json::gc_string_to_utf8(entry->key, entry_key) &&
+            entry_key == key) {
+            return entry->value.i;
+        }
+    }
+    return -1;
+}
+
+void expect_script_result(fiber::script::Script &script) {
+    TestEnv env;
+    auto result = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, env.runtime)();
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result->type_, fiber::json::JsNodeType::Object);
+    EXPECT_EQ(object_int(*result, "sum"), 3);
+    EXPECT_EQ(object_int(*result, "answer"), 41);
+    EXPECT_EQ(object_int(*result, "twice"), 8);
+}
+
+std::string make_temp_dir() {
+    char path[] = "/tmp/fiber_script_cache_XXXXXX";
+    char *dir = ::mkdtemp(path);
+    return dir ? std::string(dir) : std::string();
+}
+
+} // namespace
+
+TEST(ScriptCacheTest, MemoryHitSharesCompiled) {
+    CacheLibrary library;
+    fiber::script::ScriptCache cache(library);
+    auto first = cache.compile(kScript);
+    auto second = cache.compile(kScript);
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(first->compiled(), second->compiled());
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.hits(), 1u);
+    expect_script_result(*second);
+
+    auto other = cache.compile("return 1;");
+    ASSERT_TRUE(other.has_value());
+    EXPECT_NE(other->compiled(), first->compiled());
+    EXPECT_EQ(cache.size(), 2u);
+
+    auto error = cache.compile("return (;");
+    EXPECT_FALSE(error.has_value());
+}
+
+TEST(ScriptCacheTest, BytecodeRoundTripRelinks) {
+    CacheLibrary library;
+    fiber::script::ScriptCache cache(library);
+    auto script = cache.compile(kScript);
+    ASSERT_TRUE(script.has_value());
+    const auto &compiled = *script->compiled();
+    EXPECT_EQ(compiled.symbols.size(), 3u);
+    ASSERT_EQ(compiled.directives.size(), 1u);
+
+    fiber::script::ir::BytecodeKey key{fiber::script::ScriptCache::digest_source(kScript, true), library.version()};
+    std::string image = fiber::script::ir::write_bytecode(compiled, key);
+    ASSERT_FALSE(image.empty());
+    std::span<const std::uint8_t> bytes(reinterpret_cast<const std::uint8_t *>(image.data()), image.size());
+
+    auto loaded = fiber::script::ir::read_bytecode(bytes, library, key);
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(loaded->codes, compiled.codes);
+    EXPECT_EQ(loaded->positions, compiled.positions);
+    ASSERT_EQ(loaded->operands.size(), compiled.operands.size());
+    for (const auto &symbol : compiled.symbols) {
+        EXPECT_EQ(loaded->operands[symbol.operand], compiled.operands[symbol.operand]);
+    }
+    fiber::script::Script reloaded(loaded);
+    expect_script_result(reloaded);
+
+    fiber::script::ir::BytecodeKey stale = key;
+    stale.library_version += 1;
+    EXPECT_EQ(fiber::script::ir::read_bytecode(bytes, library, stale), nullptr);
+
+    fiber::script::ir::BytecodeKey other_flags = key;
+    other_flags.source_digest = fiber::script::ScriptCache::digest_source(kScript, false);
+    EXPECT_EQ(fiber::script::ir::read_bytecode(bytes, library, other_flags), nullptr);
+    fiber::script::ir::BytecodeKey other_source = key;
+    other_source.source_digest = fiber::script::ScriptCache::digest_source("return 1;", true);
+    EXPECT_EQ(fiber::script::ir::read_bytecode(bytes, library, other_source), nullptr);
+
+    std::string corrupt = image;
+    corrupt.back() ^= 0x5A;
+    std::span<const std::uint8_t> corrupt_bytes(reinterpret_cast<const std::uint8_t *>(corrupt.data()),
+                                                corrupt.size());
+    EXPECT_EQ(fiber::script::ir::read_bytecode(corrupt_bytes, library, key), nullptr);
+    EXPECT_EQ(fiber::script::ir::read_bytecode(bytes.first(bytes.size() - 1), library, key), nullptr);
+}
+
+TEST(ScriptCacheTest, DiskCacheSkipsCompile) {
+    std::string dir = make_temp_dir();
+    ASSERT_FALSE(dir.empty());
+    CacheLibrary library;
+    {
+        fiber::script::ScriptCache cache(library, dir);
+        auto script = cache.compile(kScript);
+        ASSERT_TRUE(script.has_value());
+        EXPECT_EQ(cache.misses(), 1u);
+    }
+    {
+        fiber::script::ScriptCache cache(library, dir);
+        auto script = cache.compile(kScript);
+        ASSERT_TRUE(script.has_value());
+        EXPECT_EQ(cache.misses(), 0u);
+        EXPECT_EQ(cache.disk_hits(), 1u);
+        expect_script_result(*script);
+    }
+    library.version_ = 2;
+    {
+        fiber::script::ScriptCache cache(library, dir);
+        auto script = cache.compile(kScript);
+        ASSERT_TRUE(script.has_value());
+        EXPECT_EQ(cache.disk_hits(), 0u);
+        EXPECT_EQ(cache.misses(), 1u);
+    }
+    std::string cmd = "rm -rf '" + dir + "'";
+    EXPECT_EQ(std::system(cmd.c_str()), 0);
+}
+
+TEST(ScriptCacheTest, DiskCacheRejectsImageOfOtherSource) {
+    std::string dir = make_temp_dir();
+    ASSERT_FALSE(dir.empty());
+    CacheLibrary library;
+    {
+        fiber::script::ScriptCache cache(library, dir);
+        ASSERT_TRUE(cache.compile(kScript).has_value());
+    }
+
+    // Plant kScript's image under the name "return 1;" would be stored as.
+    std::string_view other = "return 1;";
+    auto digest = fiber::script::ScriptCache::digest_source(other, true);
+    std::string name;
+    for (std::uint8_t byte : digest) {
+        char hex[3];
+        std::snprintf(hex, sizeof(hex), "%02x", byte);
+        name.append(hex);
+    }
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), "-%016llx.fbc", static_cast<unsigned long long>(library.version()));
+    name.append(suffix);
+    std::string cmd = "cp '" + dir + "'/*.fbc '" + dir + "/" + name + "'";
+    ASSERT_EQ(std::system(cmd.c_str()), 0);
+
+    {
+        fiber::script::ScriptCache cache(library, dir);
+        auto script = cache.compile(other);
+        ASSERT_TRUE(script.has_value());
+        EXPECT_EQ(cache.disk_hits(), 0u);
+        EXPECT_EQ(cache.misses(), 1u);
+        EXPECT_TRUE(script->compiled()->symbols.empty());
+    }
+    cmd = "rm -rf '" + dir + "'";
+    EXPECT_EQ(std::system(cmd.c_str()), 0);
+}
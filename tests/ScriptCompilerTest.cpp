@@ -158,3 +158,23 @@ TEST(ScriptCompilerTest, EmitsForeachLoopWithBreakContinue) {
     EXPECT_TRUE(has_break_jump);
     EXPECT_LE(loop_end, compiled.codes.size());
 }
+
+TEST(ScriptCompilerTest, PrecompilesConstantMatchPattern) {
+    auto compiled = compile_script("let p = \"x\"; p ~ \"a+\"; p ~ p;");
+    auto ops = extract_opcodes(compiled);
+    std::size_t const_match = 0;
+    std::size_t dynamic_match = 0;
+    for (std::size_t i = 0; i < ops.size(); ++i) {
+        if (ops[i] == fiber::script::ir::Code::BOP_MATCH_CONST) {
+            ++const_match;
+            ASSERT_LT(operand_at(compiled, i), compiled.operands.size());
+            EXPECT_EQ(compiled.operands[operand_at(compiled, i)], compiled.regex_pool.front().get());
+        } else if (ops[i] == fiber::script::ir::Code::BOP_MATCH) {
+            ++dynamic_match;
+        }
+    }
+    EXPECT_EQ(const_match, 1u);
+    EXPECT_EQ(dynamic_match, 1u);
+    ASSERT_EQ(compiled.regex_pool.size(), 1u);
+    EXPECT_EQ(compiled.regex_pool.front()->pattern(), "a+");
+}
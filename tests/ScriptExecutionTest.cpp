@@ -5,6 +5,7 @@
 #include <string_view>
 
 #include "common/json/JsGc.h"
+#include "common/json/JsonDecode.h"
 #include "script/Library.h"
 #include "script/Runtime.h"
 #include "script/Script.h"
@@ -95,7 +96,7 @@ fiber::script::ir::Compiled compile_script(std::string_view script, fiber::scrip
 
 std::string value_to_string(const fiber::json::JsValue &value) {
     if (value.type_ == fiber::json::JsNodeType::NativeString) {
-        return std::string(value.ns.data, value.ns.len);
+        return std::string(value.ns().data, value.ns().len);
     }
     if (value.type_ == fiber::json::JsNodeType::HeapString) {
         std::string out;
@@ -166,3 +167,89 @@ TEST(ScriptExecutionTest, RunFunctionThrowCaught) {
     ASSERT_TRUE(result.has_value());
     EXPECT_EQ(value_to_string(result.value()), "boom");
 }
+
+TEST(ScriptExecutionTest, StringConstantsSharedAcrossHeaps) {
+    TestFunction func;
+    ThrowFunction boom;
+    TestConstant constant;
+    TestLibrary library(&func, &boom, &constant);
+
+    auto compiled = compile_script("return \"shared\";", library);
+    auto compiled_ptr = std::make_shared<fiber::script::ir::Compiled>(std::move(compiled));
+    fiber::script::Script script(compiled_ptr);
+
+    fiber::json::GcHeap heap_a;
+    fiber::json::GcRootSet roots_a;
+    fiber::script::ScriptRuntime runtime_a(heap_a, roots_a);
+    auto result_a = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime_a)();
+
+    fiber::json::GcHeap heap_b;
+    fiber::json::GcRootSet roots_b;
+    fiber::script::ScriptRuntime runtime_b(heap_b, roots_b);
+    auto result_b = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime_b)();
+
+    ASSERT_TRUE(result_a.has_value());
+    ASSERT_TRUE(result_b.has_value());
+    EXPECT_EQ(result_a.value().gc, result_b.value().gc);
+    EXPECT_TRUE(fiber::json::gc_is_static(result_a.value().gc));
+    EXPECT_EQ(fiber::json::gc_bytes_used(heap_a), 0u);
+
+    fiber::json::JsValue kept = result_a.value();
+    roots_a.add_global(&kept);
+    script = fiber::script::Script();
+    compiled_ptr.reset();
+    fiber::json::gc_collect(heap_a, roots_a);
+    EXPECT_EQ(value_to_string(kept), "shared");
+    EXPECT_EQ(heap_a.static_pins.size(), 1u);
+
+    roots_a.remove_global(&kept);
+    fiber::json::gc_collect(heap_a, roots_a);
+    EXPECT_TRUE(heap_a.static_pins.empty());
+}
+
+TEST(ScriptExecutionTest, FrozenSnapshotsSharedAcrossHeaps) {
+    TestFunction func;
+    ThrowFunction boom;
+    TestConstant constant;
+    TestLibrary library(&func, &boom, &constant);
+
+    fiber::json::GcSnapshot config;
+    {
+        fiber::json::GcHeap source;
+        fiber::json::Parser parser(source);
+        fiber::json::JsValue parsed;
+        ASSERT_TRUE(parser.parse(R"({"routes": [{"name": "api"}, {"name": "web"}], "flags": {"debug": false}})",
+                                 parsed));
+        ASSERT_TRUE(fiber::json::gc_freeze(parsed, config));
+    }
+
+    auto read = std::make_shared<fiber::script::ir::Compiled>(compile_script("return $.routes[1].name;", library));
+    auto write = std::make_shared<fiber::script::ir::Compiled>(compile_script("$.flags.debug = true;", library));
+    auto run = [&](const std::shared_ptr<fiber::script::ir::Compiled> &compiled, fiber::script::ScriptRuntime &runtime) {
+        fiber::script::Script script(compiled);
+        fiber::json::JsValue root = fiber::json::gc_snapshot_root(runtime.heap(), config);
+        return script.exec_sync(root, nullptr, runtime)();
+    };
+
+    fiber::json::GcHeap heap_a;
+    fiber::json::GcRootSet roots_a;
+    fiber::script::ScriptRuntime runtime_a(heap_a, roots_a);
+    fiber::json::GcHeap heap_b;
+    fiber::json::GcRootSet roots_b;
+    fiber::script::ScriptRuntime runtime_b(heap_b, roots_b);
+    auto result_a = run(read, runtime_a);
+    auto result_b = run(read, runtime_b);
+    ASSERT_TRUE(result_a.has_value());
+    ASSERT_TRUE(result_b.has_value());
+    EXPECT_EQ(value_to_string(result_a.value()), "web");
+    EXPECT_EQ(result_a.value().gc, result_b.value().gc);
+    EXPECT_TRUE(fiber::json::gc_is_static(result_a.value().gc));
+
+    auto written = run(write, runtime_a);
+    ASSERT_FALSE(written.has_value());
+    ASSERT_EQ(written.error().type_, fiber::json::JsNodeType::Exception);
+    auto *exc = reinterpret_cast<const fiber::json::GcException *>(written.error().gc);
+    std::string message;
+    ASSERT_TRUE(fiber::json::gc_string_to_utf8(exc->message, message));
+    EXPECT_EQ(message, "cannot modify a frozen value");
+}
@@ -29,7 +29,7 @@ using ScriptResult = fiber::script::ScriptSyncRun::Result;
 
 std::string value_to_string(const JsValue &value) {
     if (value.type_ == JsNodeType::NativeString) {
-        return std::string(value.ns.data, value.ns.len);
+        return std::string(value.ns().data, value.ns().len);
     }
     if (value.type_ == JsNodeType::HeapString) {
         std::string out;
@@ -71,7 +71,7 @@ const JsValue *object_value(const JsValue &obj, std::string_view key) {
     }
     for (std::size_t i = 0; i < obj_ptr->size; ++i) {
         const GcObjectEntry *entry = fiber::json::gc_object_entry_at(obj_ptr, i);
-        if (!entry || !entry->occupied || !entry->key) {
+        if (!entry || !entry->key) {
             continue;
         }
         std::string entry_key;
@@ -95,25 +95,13 @@ const JsValue &object_value_or_default(const JsValue &obj, std::string_view key)
     return *value;
 }
 
-const JsValue *array_value(const JsValue &arr, std::size_t index) {
-    if (arr.type_ != JsNodeType::Array) {
-        return nullptr;
-    }
-    auto *arr_ptr = reinterpret_cast<const GcArray *>(arr.gc);
-    if (!arr_ptr) {
-        return nullptr;
-    }
-    return fiber::json::gc_array_get(arr_ptr, index);
-}
-
-const JsValue &array_value_or_default(const JsValue &arr, std::size_t index) {
-    const JsValue *value = array_value(arr, index);
-    if (!value) {
+JsValue array_value_or_default(const JsValue &arr, std::size_t index) {
+    auto *arr_ptr = arr.type_ == JsNodeType::Array ? reinterpret_cast<const GcArray *>(arr.gc) : nullptr;
+    if (!arr_ptr || index >= arr_ptr->size) {
         ADD_FAILURE() << "missing array index: " << index;
-        static JsValue missing = JsValue::make_undefined();
-        return missing;
+        return JsValue::make_undefined();
     }
-    return *value;
+    return fiber::json::gc_array_at(arr_ptr, index);
 }
 
 JsValue make_heap_string(fiber::script::ScriptRuntime &runtime, std::string_view text) {
@@ -710,6 +698,38 @@ TEST(ScriptPlanTest, ArrayPushPopJoin) {
     EXPECT_EQ(object_value_or_default(value, "len").i, 3);
 }
 
+TEST(ScriptPlanTest, PackedArraysJoinSumAndWiden) {
+    TestEnv env;
+    auto result = run_script(
+        "let ints = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17];\n"
+        "array.push(ints, 18, 19);\n"
+        "let floats = [0.5, 1.25];\n"
+        "let mixed = [1, 2];\n"
+        "mixed[1] = \"two\";\n"
+        "let big = [9223372036854775807, 1];\n"
+        "return {ints, join: array.join(ints, \",\"), fjoin: array.join(floats, \"|\"), sum: math.sum(ints),\n"
+        "        fsum: math.sum(floats), big: math.sum(big), mixed: array.join(mixed, \"-\"),\n"
+        "        at: ints[19], parsed: math.sum(JSON.parse(\"[1, 2, 3]\")), empty: math.sum([])};\n",
+        env.library,
+        env.runtime);
+    ASSERT_TRUE(result.has_value());
+    const JsValue &value = result.value();
+    ASSERT_EQ(value.type_, JsNodeType::Object);
+    const JsValue &ints = object_value_or_default(value, "ints");
+    ASSERT_EQ(ints.type_, JsNodeType::Array);
+    EXPECT_EQ(reinterpret_cast<const fiber::json::GcArray *>(ints.gc)->kind, fiber::json::GcArrayKind::Int64);
+    EXPECT_EQ(value_to_string(object_value_or_default(value, "join")),
+              "0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19");
+    EXPECT_EQ(value_to_string(object_value_or_default(value, "fjoin")), "0.5|1.25");
+    EXPECT_EQ(object_value_or_default(value, "sum").i, 190);
+    EXPECT_DOUBLE_EQ(object_value_or_default(value, "fsum").f, 1.75);
+    EXPECT_EQ(object_value_or_default(value, "big").type_, JsNodeType::Float);
+    EXPECT_EQ(value_to_string(object_value_or_default(value, "mixed")), "1-two");
+    EXPECT_EQ(object_value_or_default(value, "at").i, 19);
+    EXPECT_EQ(object_value_or_default(value, "parsed").i, 6);
+    EXPECT_EQ(object_value_or_default(value, "empty").i, 0);
+}
+
 TEST(ScriptPlanTest, ObjectAssignKeysValuesDelete) {
     TestEnv env;
     auto result = run_script(
@@ -799,6 +819,59 @@ TEST(ScriptPlanTest, StringsCoreSet) {
     EXPECT_TRUE(object_value_or_default(value, "substring").b);
 }
 
+TEST(ScriptPlanTest, StringsBuilderAndAppend) {
+    TestEnv env;
+    auto result = run_script(
+        "let url = strings.builder(64);\n"
+        "url = strings.append(url, \"https://\", \"example.com\", \"/v\", 1);\n"
+        "let base = url;\n"
+        "for (let i, part of [\"a\", \"b\", \"c\"]) { url = url + \"/\" + part; }\n"
+        "let other = base + \"/x\";\n"
+        "let wide = strings.append(base, \"/\u00e9\u4e2d\");\n"
+        "let log = \"\";\n"
+        "for (let i, v of strings.split(strings.repeat(\"0123456789,\", 40), \",\")) { log = log + v; }\n"
+        "return {url, base, other, wide, log: length(log)};\n",
+        env.library,
+        env.runtime);
+    ASSERT_TRUE(result.has_value());
+    const JsValue &value = result.value();
+    ASSERT_EQ(value.type_, JsNodeType::Object);
+    EXPECT_EQ(value_to_string(object_value_or_default(value, "url")), "https://example.com/v1/a/b/c");
+    EXPECT_EQ(value_to_string(object_value_or_default(value, "base")), "https://example.com/v1");
+    EXPECT_EQ(value_to_string(object_value_or_default(value, "other")), "https://example.com/v1/x");
+    EXPECT_EQ(value_to_string(object_value_or_default(value, "wide")), "https://example.com/v1/\u00e9\u4e2d");
+    EXPECT_EQ(object_value_or_default(value, "log").i, 400);
+}
+
+TEST(ScriptPlanTest, MatchOperatorAndFindAll) {
+    TestEnv env;
+    auto result = run_script(
+        "let path = \"/api/v2/users\";\n"
+        "let pattern = \"/api/v\\\\d+/.*\";\n"
+        "return {\n"
+        "  constant: path ~ \"/api/v[0-9]+/users\",\n"
+        "  dynamic: path ~ pattern,\n"
+        "  partial: path ~ \"users\",\n"
+        "  found: strings.findAll(\"a1b22c333\", \"[0-9]+\"),\n"
+        "  empty: strings.findAll(\"ab\", \"x*\")\n"
+        "};\n",
+        env.library,
+        env.runtime);
+    ASSERT_TRUE(result.has_value());
+    const JsValue &value = result.value();
+    EXPECT_TRUE(object_value_or_default(value, "constant").b);
+    EXPECT_TRUE(object_value_or_default(value, "dynamic").b);
+    EXPECT_FALSE(object_value_or_default(value, "partial").b);
+    const JsValue &found = object_value_or_default(value, "found");
+    EXPECT_EQ(value_to_string(array_value_or_default(found, 0)), "1");
+    EXPECT_EQ(value_to_string(array_value_or_default(found, 2)), "333");
+    auto *empty = reinterpret_cast<const GcArray *>(object_value_or_default(value, "empty").gc);
+    EXPECT_EQ(empty->size, 3u);
+
+    auto invalid = run_script("return \"a\" ~ (\"(\" + \"a\");", env.library, env.runtime);
+    EXPECT_FALSE(invalid.has_value());
+}
+
 TEST(ScriptPlanTest, BinaryAndHash) {
     TestEnv env;
     auto result = run_script(
@@ -837,10 +910,110 @@ TEST(ScriptPlanTest, JsonParseStringify) {
     EXPECT_TRUE(result.value().b);
 }
 
+TEST(ScriptPlanTest, JsonParseLazy) {
+    TestEnv env;
+    auto result = run_script(
+        "let body = JSON.parseLazy(\"{\\\"user\\\": {\\\"id\\\": 7, \\\"tags\\\": [\\\"a\\\", \\\"b\\\"]}, \\\"n\\\": 1.5}\");\n"
+        "let user = body.user;\n"
+        "let same = user === body.user;\n"
+        "let before = JSON.stringify(body);\n"
+        "user.id = 8;\n"
+        "let after = JSON.stringify(body);\n"
+        "let keys = [];\n"
+        "for (let k, v of body) { array.push(keys, k); }\n"
+        "return {\n"
+        "  a: body.user.id === 8,\n"
+        "  b: body.user.tags[1] === \"b\",\n"
+        "  c: body.user.tags.length === 2,\n"
+        "  d: typeof body === \"object\" && typeof body.user.tags === \"array\",\n"
+        "  e: \"n\" in body && !(\"x\" in body),\n"
+        "  f: same,\n"
+        "  g: before === \"{\\\"user\\\": {\\\"id\\\": 7, \\\"tags\\\": [\\\"a\\\", \\\"b\\\"]}, \\\"n\\\": 1.5}\",\n"
+        "  h: after === \"{\\\"user\\\":{\\\"id\\\":8,\\\"tags\\\":[\\\"a\\\",\\\"b\\\"]},\\\"n\\\":1.5}\",\n"
+        "  i: array.join(keys, \",\") === \"user,n\",\n"
+        "  j: length(body.user.tags) === 2\n"
+        "};\n",
+        env.library,
+        env.runtime);
+    ASSERT_TRUE(result.has_value());
+    const JsValue &value = result.value();
+    ASSERT_EQ(value.type_, JsNodeType::Object);
+    for (const char *key : {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"}) {
+        EXPECT_TRUE(object_value_or_default(value, key).b) << key;
+    }
+}
+
+TEST(ScriptPlanTest, MsgPackAndCborRoundTrip) {
+    TestEnv env;
+    auto result = run_script(
+        "let packed = msgpack.encode({a: 1, b: [true, null, 2.5], c: binary.fromHex(\"0102\")});\n"
+        "let back = msgpack.decode(packed);\n"
+        "let again = cbor.decode(cbor.encode(back));\n"
+        "return {\n"
+        "  a: binary.hex(packed) === \"83a16101a16293c3c0ca40200000a163c4020102\",\n"
+        "  b: back.a === 1 && back.b[2] === 2.5 && back.b[1] === null,\n"
+        "  c: binary.hex(again.c) === \"0102\",\n"
+        "  d: JSON.stringify(again.b) === \"[true,null,2.5]\"\n"
+        "};\n",
+        env.library,
+        env.runtime);
+    ASSERT_TRUE(result.has_value());
+    const JsValue &value = result.value();
+    ASSERT_EQ(value.type_, JsNodeType::Object);
+    for (const char *key : {"a", "b", "c", "d"}) {
+        EXPECT_TRUE(object_value_or_default(value, key).b) << key;
+    }
+}
+
+TEST(ScriptPlanTest, JsonValidate) {
+    TestEnv env;
+    auto result = run_script(
+        "let schema = {type: \"object\", required: [\"id\"], properties: {\n"
+        "  id: {type: \"integer\", minimum: 1}, tags: {type: \"array\", items: {type: \"string\"}}}};\n"
+        "let errors = JSON.validate({id: 0, tags: [\"a\", 2]}, schema, true);\n"
+        "let first = JSON.validate(JSON.parseLazy(\"{\\\"tags\\\": [1]}\"), JSON.stringify(schema));\n"
+        "return {\n"
+        "  a: length(JSON.validate({id: 3}, schema)) === 0,\n"
+        "  b: length(errors) === 2 && errors[0].path === \"/id\" && errors[1].path === \"/tags/1\",\n"
+        "  c: errors[1].message === \"expected string\",\n"
+        "  d: length(first) === 1 && first[0].message === \"missing required property \\\"id\\\"\"\n"
+        "};\n",
+        env.library,
+        env.runtime);
+    ASSERT_TRUE(result.has_value());
+    const JsValue &value = result.value();
+    ASSERT_EQ(value.type_, JsNodeType::Object);
+    for (const char *key : {"a", "b", "c", "d"}) {
+        EXPECT_TRUE(object_value_or_default(value, key).b) << key;
+    }
+}
+
+TEST(ScriptPlanTest, JsonPointerAndPath) {
+    TestEnv env;
+    auto result = run_script(
+        "let doc = JSON.parseLazy(\"{\\\"items\\\": [{\\\"id\\\": 1, \\\"qty\\\": 5}, {\\\"id\\\": 2, \\\"qty\\\": 0}], \\\"a/b\\\": true}\");\n"
+        "let picked = JSON.pointer(doc, [\"/items/1/id\", \"/a~1b\", \"/missing\"]);\n"
+        "let ids = JSON.path(doc, \"$.items[?(@.qty > 0)].id\");\n"
+        "return {\n"
+        "  a: JSON.pointer(doc, \"/items/0/qty\") === 5,\n"
+        "  b: picked[0] === 2 && picked[1] === true && picked[2] === undefined,\n"
+        "  c: length(ids) === 1 && ids[0] === 1,\n"
+        "  d: length(JSON.path(doc, [\"$.items[*]\", \"$.none\"])[0]) === 2\n"
+        "};\n",
+        env.library,
+        env.runtime);
+    ASSERT_TRUE(result.has_value());
+    const JsValue &value = result.value();
+    ASSERT_EQ(value.type_, JsNodeType::Object);
+    for (const char *key : {"a", "b", "c", "d"}) {
+        EXPECT_TRUE(object_value_or_default(value, key).b) << key;
+    }
+}
+
 TEST(ScriptPlanTest, MathHelpers) {
     TestEnv env;
     auto result = run_script(
-        "return {a: math.floor(3.9) === 3, b: math.abs(-4) === 4};",
+        "return {a: math.floor(3.9) === 3, b: math.abs(-4) === 4, c: math.sum([1, 2, 3]) === 6};",
         env.library,
         env.runtime);
     ASSERT_TRUE(result.has_value());
@@ -848,6 +1021,7 @@ TEST(ScriptPlanTest, MathHelpers) {
     ASSERT_EQ(value.type_, JsNodeType::Object);
     EXPECT_TRUE(object_value_or_default(value, "a").b);
     EXPECT_TRUE(object_value_or_default(value, "b").b);
+    EXPECT_TRUE(object_value_or_default(value, "c").b);
 }
 
 TEST(ScriptPlanTest, RandStubbed) {
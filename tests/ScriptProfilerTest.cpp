@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/json/JsGc.h"
+#include "script/Library.h"
+#include "script/Runtime.h"
+#include "script/Script.h"
+#include "script/ir/Code.h"
+#include "script/ir/Compiler.h"
+#include "script/parse/Parser.h"
+#include "script/run/VmProfiler.h"
+
+namespace {
+
+class WorkFunc final : public fiber::script::Library::Function {
+public:
+    fiber::script::Library::FunctionResult call(fiber::script::ExecutionContext &context) override {
+        ++calls;
+        return fiber::json::JsValue::make_integer(context.arg_value(0).i + 1);
+    }
+
+    int calls = 0;
+};
+
+class ProfileLibrary final : public fiber::script::Library {
+public:
+    Function *find_func(std::string_view name) override {
+        return name == "work" ? &work : nullptr;
+    }
+
+    AsyncFunction *find_async_func(std::string_view name) override {
+        (void)name;
+        return nullptr;
+    }
+
+    Constant *find_constant(std::string_view namespace_name, std::string_view key) override {
+        (void)namespace_name;
+        (void)key;
+        return nullptr;
+    }
+
+    AsyncConstant *find_async_constant(std::string_view namespace_name, std::string_view key) override {
+        (void)namespace_name;
+        (void)key;
+        return nullptr;
+    }
+
+    DirectiveDef *find_directive_def(std::string_view type,
+                                     std::string_view name,
+                                     const std::vector<fiber::json::JsValue> &literals) override {
+        (void)type;
+        (void)name;
+        (void)literals;
+        return nullptr;
+    }
+
+    WorkFunc work;
+};
+
+constexpr std::string_view kSource =
+    "let n = 0;\n"
+    "for (let i, x of [1, 2, 3, 4]) {\n"
+    "    n = work(n);\n"
+    "}\n"
+    "return n;\n";
+
+} // namespace
+
+TEST(ScriptProfilerTest, RecordsOpcodesLinesAndCalls) {
+    ProfileLibrary library;
+    fiber::script::parse::Parser parser(library, true);
+    auto parsed = parser.parse_script(kSource);
+    ASSERT_TRUE(parsed.has_value());
+    auto compiled = std::make_shared<fiber::script::ir::Compiled>(
+        fiber::script::ir::Compiler::compile(*parsed.value()));
+    fiber::script::Script script(compiled);
+
+    fiber::json::GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime(heap, roots);
+
+    fiber::script::run::VmProfiler profiler;
+    profiler.label(*compiled, "loop.fs", kSource);
+    for (int i = 0; i < 2; ++i) {
+        auto run = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime);
+        run.set_profiler(&profiler);
+        auto result = run();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result->i, 4);
+    }
+    auto plain = script.exec_sync(fiber::json::JsValue::make_undefined(), nullptr, runtime)();
+    ASSERT_TRUE(plain.has_value());
+    EXPECT_EQ(library.work.calls, 12);
+
+    auto &profile = profiler.attach(*compiled);
+    std::uint64_t calls = 0;
+    std::uint64_t returns = 0;
+    for (std::size_t pc = 0; pc < profile.pcs.size(); ++pc) {
+        if (profile.ops[pc] == fiber::script::ir::Code::CALL_FUNC) {
+            calls += profile.pcs[pc].count;
+            EXPECT_EQ(profile.callees[pc], "work");
+            EXPECT_EQ(profile.line_of(pc), 3u);
+        }
+        if (profile.ops[pc] == fiber::script::ir::Code::END_RETURN) {
+            returns += profile.pcs[pc].count;
+        }
+    }
+    EXPECT_EQ(calls, 8u);
+    EXPECT_EQ(returns, 2u);
+    EXPECT_GT(profiler.total_cycles(), 0u);
+
+    std::string folded = profiler.folded();
+    EXPECT_NE(folded.find("loop.fs;line_3;CALL_FUNC;work "), std::string::npos) << folded;
+    EXPECT_NE(folded.find("loop.fs;line_2;ITERATE_NEXT "), std::string::npos) << folded;
+
+    std::string json = profiler.summary_json();
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_NE(json.find("{\"name\":\"work\",\"calls\":8,"), std::string::npos) << json;
+    EXPECT_NE(json.find("{\"op\":\"END_RETURN\",\"count\":2,"), std::string::npos) << json;
+    EXPECT_NE(json.find("\"at\":\"line 3\""), std::string::npos) << json;
+
+    profiler.reset();
+    EXPECT_EQ(profiler.total_cycles(), 0u);
+    EXPECT_TRUE(profiler.folded().empty());
+}
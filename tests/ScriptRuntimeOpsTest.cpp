@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <memory>
+
 #include "script/Runtime.h"
 #include "script/run/Access.h"
 #include "script/run/Binaries.h"
@@ -154,3 +156,54 @@ TEST(ScriptRuntimeOpsTest, InSemanticsObject) {
     ASSERT_TRUE(miss.has_value());
     EXPECT_FALSE(miss.value().b);
 }
+
+TEST(ScriptRuntimeOpsTest, RootHandlesScopesAndProviders) {
+    GcHeap heap;
+    fiber::json::GcRootSet roots;
+    fiber::script::ScriptRuntime runtime(heap, roots);
+    auto alive = [&](const JsValue &value) {
+        return value.gc->mark_ == heap.live_mark;
+    };
+    JsValue a = JsValue::make_string(heap, "a", 1);
+    JsValue b = JsValue::make_string(heap, "b", 1);
+    JsValue c = JsValue::make_string(heap, "c", 1);
+    JsValue slots[2] = {JsValue::make_string(heap, "s0", 2), JsValue::make_string(heap, "s1", 2)};
+
+    struct Slots final : fiber::json::GcRootSet::RootProvider {
+        JsValue *base = nullptr;
+        void visit_roots(fiber::json::GcRootSet::RootVisitor &visitor) override {
+            visitor.visit_range(base, 2);
+        }
+    } provider;
+    provider.base = slots;
+    roots.add_provider(&provider);
+
+    auto guard_a = std::make_unique<fiber::script::GcRootGuard>(runtime, &a);
+    fiber::json::GcRootHandle handle_b(roots, &b);
+    fiber::json::GcRootHandle moved;
+    {
+        fiber::json::GcRootHandle handle_c(roots, &c);
+        moved = std::move(handle_c);
+    }
+    // Handles leave the list in any order, and a moved-from one roots
+    // nothing.
+    guard_a.reset();
+    fiber::json::gc_collect(heap, roots);
+    EXPECT_TRUE(alive(b));
+    EXPECT_TRUE(alive(c));
+    EXPECT_TRUE(alive(slots[0]));
+    EXPECT_TRUE(alive(slots[1]));
+
+    {
+        fiber::script::TempRootScope scope(runtime);
+        a = JsValue::make_string(heap, "a", 1);
+        scope.add(&a);
+        fiber::json::gc_collect(heap, roots);
+        EXPECT_TRUE(alive(a));
+    }
+    moved.reset();
+    roots.remove_provider(&provider);
+    handle_b.reset();
+    fiber::json::gc_collect(heap, roots);
+    EXPECT_EQ(heap.bytes, 0u);
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/json/JsGc.h"
+#include "common/json/JsValueOps.h"
+#include "common/json/JsonDecode.h"
+#include "common/json/Utf.h"
+
+using fiber::json::GcHeap;
+using fiber::json::GcString;
+using fiber::json::GcStringEncoding;
+
+namespace {
+
+std::string latin1_text(std::size_t len) {
+    std::string out;
+    for (std::size_t i = 0; i < len; ++i) {
+        out.push_back(static_cast<char>(i % 7 == 3 ? 0xE9 : 'a' + i % 26));
+    }
+    return out;
+}
+
+GcString *as_utf16(GcHeap &heap, const std::string &latin1) {
+    std::u16string units;
+    for (char ch : latin1) {
+        units.push_back(static_cast<char16_t>(static_cast<unsigned char>(ch)));
+    }
+    return fiber::json::gc_new_string_utf16(&heap, units.data(), units.size());
+}
+
+GcString *as_bytes(GcHeap &heap, const std::string &latin1) {
+    return fiber::json::gc_new_string_bytes(&heap, reinterpret_cast<const std::uint8_t *>(latin1.data()),
+                                            latin1.size());
+}
+
+} // namespace
+
+TEST(StringTest, HashAndEqualityIgnoreEncoding) {
+    GcHeap heap;
+    for (std::size_t len = 0; len <= 70; ++len) {
+        std::string text = latin1_text(len);
+        GcString *bytes = as_bytes(heap, text);
+        GcString *units = as_utf16(heap, text);
+        ASSERT_NE(bytes, nullptr);
+        ASSERT_NE(units, nullptr);
+        ASSERT_EQ(units->encoding, GcStringEncoding::Utf16);
+        EXPECT_EQ(fiber::json::gc_string_hash(bytes), fiber::json::gc_string_hash(units)) << len;
+        EXPECT_TRUE(fiber::json::gc_string_equals(bytes, units)) << len;
+        EXPECT_TRUE(fiber::json::gc_string_equals(units, bytes)) << len;
+        if (len == 0) {
+            continue;
+        }
+        // Any differing position is seen, inside blocks and in the tail.
+        for (std::size_t at : {std::size_t{0}, len / 2, len - 1}) {
+            std::string other = text;
+            other[at] = static_cast<char>(other[at] ^ 1);
+            GcString *changed = as_utf16(heap, other);
+            EXPECT_FALSE(fiber::json::gc_string_equals(bytes, changed)) << len << " at " << at;
+            EXPECT_NE(fiber::json::gc_string_hash(bytes), fiber::json::gc_string_hash(changed)) << len << " at " << at;
+        }
+    }
+    // Trailing zero code units still change the hash.
+    GcString *abc = fiber::json::gc_new_string(&heap, "abc", 3);
+    GcString *abc0 = fiber::json::gc_new_string(&heap, "abc\0", 4);
+    EXPECT_NE(fiber::json::gc_string_hash(abc), fiber::json::gc_string_hash(abc0));
+}
+
+TEST(StringTest, Utf8KernelsHandleAsciiBlocksAndTails) {
+    for (std::size_t len : {0u, 7u, 8u, 15u, 16u, 17u, 40u, 4099u}) {
+        for (const char *insert : {"", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80"}) {
+            std::string text(len, 'x');
+            text.insert(len / 2, insert);
+            fiber::json::Utf8ScanResult scan;
+            ASSERT_TRUE(fiber::json::utf8_scan(text.data(), text.size(), scan)) << len;
+            std::size_t extra = std::string_view(insert).size() == 4 ? 2 : (*insert ? 1 : 0);
+            EXPECT_EQ(scan.utf16_len, len + extra);
+            EXPECT_EQ(scan.all_byte, std::string_view(insert).size() < 3);
+
+            std::u16string units(scan.utf16_len, u'\0');
+            ASSERT_TRUE(fiber::json::utf8_write_utf16(text.data(), text.size(), units.data(), units.size()));
+            EXPECT_EQ(std::u16string(units.size() - extra, u'x'),
+                      units.substr(0, len / 2) + units.substr(len / 2 + extra));
+            if (scan.all_byte) {
+                std::vector<std::uint8_t> bytes(scan.utf16_len);
+                ASSERT_TRUE(fiber::json::utf8_write_bytes(text.data(), text.size(), bytes.data(), bytes.size()));
+                if (extra == 1) {
+                    EXPECT_EQ(bytes[len / 2], 0xE9);
+                }
+                // Too small a destination fails instead of overrunning.
+                if (!bytes.empty()) {
+                    EXPECT_FALSE(fiber::json::utf8_write_bytes(text.data(), text.size(), bytes.data(), bytes.size() - 1));
+                }
+            }
+        }
+    }
+    std::string broken(20, 'a');
+    broken[18] = static_cast<char>(0xC3);
+    fiber::json::Utf8ScanResult scan;
+    EXPECT_FALSE(fiber::json::utf8_scan(broken.data(), broken.size(), scan));
+}
+
+TEST(StringTest, AtomsAreSharedAndWeak) {
+    GcHeap heap;
+    EXPECT_NE(fiber::json::gc_atom(&heap, "id", 2), fiber::json::gc_atom(&heap, "id", 2));
+
+    fiber::json::gc_set_atom_limit(heap, 8);
+    GcString *id = fiber::json::gc_atom(&heap, "id", 2);
+    ASSERT_NE(id, nullptr);
+    EXPECT_TRUE(id->hash_valid);
+    EXPECT_EQ(fiber::json::gc_atom(&heap, "id", 2), id);
+    const std::uint8_t latin1[] = {'i', 'd'};
+    EXPECT_EQ(fiber::json::gc_atom_bytes(&heap, latin1, 2), id);
+    EXPECT_NE(fiber::json::gc_atom(&heap, "ids", 3), id);
+    EXPECT_NE(fiber::json::gc_atom(&heap, "content-type", 12), fiber::json::gc_atom(&heap, "content-type", 12));
+    EXPECT_NE(fiber::json::gc_atom(&heap, "caf\xC3\xA9", 5), fiber::json::gc_atom(&heap, "caf\xC3\xA9", 5));
+    EXPECT_EQ(heap.atoms.count, 2u);
+
+    for (int i = 0; i < 500; ++i) {
+        std::string text = std::to_string(i);
+        ASSERT_NE(fiber::json::gc_atom(&heap, text.data(), text.size()), nullptr);
+    }
+    EXPECT_EQ(heap.atoms.count, 502u);
+    EXPECT_GE(heap.atoms.slots.size(), 2 * heap.atoms.count);
+
+    // Only the rooted atom survives; the table forgets the rest and hands
+    // out the survivor again.
+    fiber::json::JsValue root;
+    root.type_ = fiber::json::JsNodeType::HeapString;
+    root.gc = &id->hdr;
+    fiber::json::JsValue *roots[] = {&root};
+    fiber::json::gc_collect(&heap, roots, 1);
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_EQ(heap.atoms.count, 1u);
+    EXPECT_EQ(fiber::json::gc_atom(&heap, "id", 2), id);
+    EXPECT_NE(fiber::json::gc_atom(&heap, "7", 1), nullptr);
+    EXPECT_EQ(heap.atoms.count, 2u);
+
+    fiber::json::gc_set_atom_limit(heap, 0);
+    EXPECT_EQ(heap.atoms.count, 0u);
+    EXPECT_NE(fiber::json::gc_atom(&heap, "id", 2), id);
+}
+
+TEST(StringTest, DecoderInternsShortKeysAndValues) {
+    std::string text = "[";
+    for (int i = 0; i < 100; ++i) {
+        text += i ? "," : "";
+        text += R"({"id":)" + std::to_string(i) + R"(,"method":"GET","ab":"café"})";
+    }
+    text += "]";
+    auto decode = [&](GcHeap &heap, fiber::json::JsValue &out) {
+        fiber::json::Parser parser(heap);
+        ASSERT_TRUE(parser.parse(text, out));
+    };
+    GcHeap plain;
+    fiber::json::JsValue plain_root;
+    decode(plain, plain_root);
+
+    GcHeap heap;
+    fiber::json::gc_set_atom_limit(heap, 16);
+    fiber::json::JsValue root;
+    decode(heap, root);
+    EXPECT_LT(heap.bytes, plain.bytes * 3 / 4);
+
+    auto *arr = reinterpret_cast<const fiber::json::GcArray *>(root.gc);
+    auto *first = reinterpret_cast<const fiber::json::GcObject *>(arr->elems[0].gc);
+    auto *last = reinterpret_cast<const fiber::json::GcObject *>(arr->elems[99].gc);
+    for (std::size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(first->entries[i].key, last->entries[i].key);
+    }
+    EXPECT_EQ(first->entries[1].value.gc, last->entries[1].value.gc);
+    // Latin-1 text that had to be transcoded is interned too.
+    EXPECT_EQ(first->entries[2].value.gc, last->entries[2].value.gc);
+    EXPECT_EQ(fiber::json::gc_object_get(last, fiber::json::gc_atom(&heap, "method", 6)),
+              &last->entries[1].value);
+}
+
+TEST(StringTest, AppendsExtendTheirBufferInPlace) {
+    GcHeap heap;
+    using fiber::json::JsValue;
+    auto text_of = [](const JsValue &value) {
+        std::string out;
+        EXPECT_TRUE(fiber::json::gc_string_to_utf8(reinterpret_cast<const GcString *>(value.gc), out));
+        return out;
+    };
+    auto concat = [&](const JsValue &lhs, const JsValue &rhs) {
+        fiber::json::JsOpResult result = fiber::json::js_binary_op(fiber::json::JsBinaryOp::Add, lhs, rhs, &heap);
+        EXPECT_EQ(result.error, fiber::json::JsOpError::None);
+        return result.value;
+    };
+    JsValue part = JsValue::make_string(heap, "abcdefgh", 8);
+    JsValue built = JsValue::make_string(heap, "", 0);
+    JsValue early;
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+        built = concat(built, part);
+        expected += "abcdefgh";
+        if (i == 20) {
+            early = built;
+        }
+    }
+    EXPECT_EQ(text_of(built), expected);
+    // Copying on every append would have cost about 4 MB.
+    EXPECT_LT(heap.bytes, 256u * 1024);
+
+    // Strings sharing the buffer keep their text; appending to one that no
+    // longer ends the buffer copies.
+    EXPECT_EQ(text_of(early), expected.substr(0, 21 * 8));
+    JsValue fork = concat(early, JsValue::make_string(heap, "XY", 2));
+    EXPECT_EQ(text_of(fork), expected.substr(0, 21 * 8) + "XY");
+    EXPECT_EQ(text_of(built), expected);
+
+    JsValue wide = concat(built, JsValue::make_string(heap, "\xE4\xB8\xAD", 3));
+    EXPECT_EQ(reinterpret_cast<const GcString *>(wide.gc)->encoding, GcStringEncoding::Utf16);
+    EXPECT_EQ(text_of(wide), expected + "\xE4\xB8\xAD");
+    JsValue wider = concat(wide, part);
+    EXPECT_EQ(text_of(wider), expected + "\xE4\xB8\xAD" + "abcdefgh");
+
+    GcString *reserved = fiber::json::gc_string_reserve(&heap, nullptr, 16);
+    ASSERT_NE(reserved, nullptr);
+    GcString *grown = fiber::json::gc_string_extend(&heap, reserved, 4, GcStringEncoding::Byte);
+    ASSERT_NE(grown, nullptr);
+    EXPECT_EQ(grown->data8, reserved->data8);
+    std::memcpy(grown->data8, "path", 4);
+    EXPECT_EQ(reserved->len, 0u);
+
+    JsValue *roots[] = {&early};
+    fiber::json::gc_collect(&heap, roots, 1);
+    EXPECT_EQ(text_of(early), expected.substr(0, 21 * 8));
+    fiber::json::gc_collect(&heap, nullptr, 0);
+    EXPECT_EQ(heap.bytes, 0u);
+}